@@ -0,0 +1,48 @@
+// The Dart side of the amount formatting comparison: what the pages cost
+// when every value is parsed with double.parse and displayed with
+// toStringAsFixed. Run with
+//   dart run benchmark/amount_format_benchmark.dart
+// and compare with the "amount_format" case of currency_converter_bench.
+import 'dart:math';
+
+const int count = 1000000;
+
+void main() {
+  final random = Random(42);
+  final amounts = List<double>.generate(
+      count, (_) => (random.nextDouble() * 2 - 1) * 100000000);
+
+  // Warm up the JIT before timing.
+  var texts = amounts.map((a) => a.toStringAsFixed(2)).toList();
+  var watch = Stopwatch()..start();
+  texts = amounts.map((a) => a.toStringAsFixed(2)).toList();
+  watch.stop();
+  report('dart/toStringAsFixed', watch);
+
+  var sum = 0.0;
+  watch = Stopwatch()..start();
+  for (final text in texts) {
+    sum += double.parse(text);
+  }
+  watch.stop();
+  report('dart/double.parse', watch);
+
+  // double.parse rejects grouped input such as '1,000.50', so that costs
+  // an extra pass to strip separators.
+  final grouped = texts.map(group).toList();
+  watch = Stopwatch()..start();
+  for (final text in grouped) {
+    sum += double.parse(text.replaceAll(',', ''));
+  }
+  watch.stop();
+  report('dart/double.parse_grouped', watch);
+  print('checksum $sum');
+}
+
+String group(String text) => text.replaceAllMapped(
+    RegExp(r'(\d)(?=(\d{3})+\.)'), (match) => '${match[1]},');
+
+void report(String name, Stopwatch watch) {
+  final ns = watch.elapsedMicroseconds * 1000 / count;
+  print('${name.padRight(40)} ${ns.toStringAsFixed(1)} ns/value');
+}
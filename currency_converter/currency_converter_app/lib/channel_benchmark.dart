@@ -0,0 +1,50 @@
+import 'dart:typed_data';
+
+import 'package:currency_converter/native_converter.dart';
+import 'package:flutter/services.dart';
+import 'package:flutter/widgets.dart';
+
+// Entry point argument under which main() runs [runChannelBenchmark]
+// instead of the app. The native benchmark suite starts a headless engine
+// with it.
+const String channelBenchmarkArgument = '--channel-benchmark';
+
+const MethodChannel _benchChannel = MethodChannel('currency_converter/bench');
+
+// Runs [call] repeatedly for at least [minMilliseconds] and reports the
+// mean time of one call to the native suite under [name]. [items] is the
+// number of conversions one call performs.
+Future<void> _time(String name, Future<void> Function() call,
+    {int items = 1, int minMilliseconds = 200}) async {
+  await call();
+  final stopwatch = Stopwatch()..start();
+  var iterations = 0;
+  while (stopwatch.elapsedMilliseconds < minMilliseconds) {
+    await call();
+    iterations++;
+  }
+  await _benchChannel.invokeMethod<void>('report', {
+    'name': name,
+    'ns': stopwatch.elapsedMicroseconds * 1000 / iterations,
+    'items': items,
+  });
+}
+
+// Times calls of the 'currency_converter/engine' channel from Dart, codec
+// and engine thread hops included, then tells the native side it is done.
+Future<void> runChannelBenchmark() async {
+  WidgetsFlutterBinding.ensureInitialized();
+  await _time('channel_roundtrip/convert',
+      () => NativeConverter.convert('1234.56'));
+  await _time('channel_roundtrip/convert_locale',
+      () => NativeConverter.convert('1,234.56', locale: 'en_US'));
+  for (final count in [1000, 1000000]) {
+    final amounts =
+        Int64List.fromList(List.generate(count, (i) => 100 + i % 100000));
+    await _time('channel_roundtrip/convert_batch/$count',
+        () => NativeConverter.convertBatch(amounts), items: count);
+    await _time('channel_roundtrip/format_batch/$count',
+        () => NativeConverter.formatBatch(amounts), items: count);
+  }
+  await _benchChannel.invokeMethod<void>('done');
+}
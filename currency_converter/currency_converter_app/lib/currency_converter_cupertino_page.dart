@@ -1,3 +1,6 @@
+import 'dart:async';
+
+import 'package:currency_converter/native_converter.dart';
 import 'package:flutter/cupertino.dart';
 
 class CurrencyConverterCupertinoPage extends StatefulWidget {
@@ -10,12 +13,53 @@ class CurrencyConverterCupertinoPage extends StatefulWidget {
 
 class _CurrencyConverterCupertinoPageState
     extends State<CurrencyConverterCupertinoPage> {
-  double result = 0;
+  String result = '0';
   final TextEditingController textEditingController = TextEditingController();
+  final LiveConverter liveConverter = LiveConverter();
+  StreamSubscription<RateUpdate>? rateUpdates;
+
+  @override
+  void initState() {
+    super.initState();
+    // Convert as the user types; the button stays for an explicit refresh.
+    liveConverter.results.listen((live) {
+      if (!mounted) return;
+      setState(() {
+        result = live.text ?? '0';
+      });
+    });
+    textEditingController.addListener(updateLive);
+    // Keep the shown result at the live rates when a feed is running.
+    rateUpdates = RateFeed.updates.listen(
+      (_) => updateLive(),
+      onError: (Object _) {},
+    );
+  }
+
+  void updateLive() {
+    liveConverter.update(
+      textEditingController.text,
+      locale: Localizations.maybeLocaleOf(context)?.toString(),
+    );
+  }
+
+  Future<void> convert() async {
+    final conversion = await NativeConverter.convert(
+      textEditingController.text,
+      locale: Localizations.maybeLocaleOf(context)?.toString(),
+    );
+    if (!mounted) return;
+    setState(() {
+      result = conversion.value != 0 ? conversion.text : '0';
+    });
+  }
 
-  void convert() {
-    result = double.parse(textEditingController.text) * 80;
-    setState(() {});
+  @override
+  void dispose() {
+    rateUpdates?.cancel();
+    liveConverter.dispose();
+    textEditingController.dispose();
+    super.dispose();
   }
 
   @override
@@ -33,7 +77,7 @@ class _CurrencyConverterCupertinoPageState
             mainAxisAlignment: MainAxisAlignment.center,
             children: [
               Text(
-                'INR ${result != 0 ? result.toStringAsFixed(3) : result.toStringAsFixed(0)}',
+                'INR $result',
                 style: const TextStyle(
                   fontSize: 55,
                   fontWeight: FontWeight.bold,
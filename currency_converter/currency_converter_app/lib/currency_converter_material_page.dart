@@ -1,3 +1,6 @@
+import 'dart:async';
+
+import 'package:currency_converter/native_converter.dart';
 import 'package:flutter/material.dart';
 
 class CurrencyConverterMaterialPage extends StatefulWidget {
@@ -10,16 +13,88 @@ class CurrencyConverterMaterialPage extends StatefulWidget {
 
 class _CurrencyConverterMaterialPageState
     extends State<CurrencyConverterMaterialPage> {
-  double result = 0;
+  String result = '0';
   final TextEditingController textEditingController = TextEditingController();
+  final LiveConverter liveConverter = LiveConverter();
+  StreamSubscription<RateUpdate>? rateUpdates;
+  StreamSubscription<List<ArbitrageAlert>>? arbitrageAlerts;
+
+  @override
+  void initState() {
+    super.initState();
+    // Convert as the user types; the button stays for an explicit refresh.
+    liveConverter.results.listen((live) {
+      if (!mounted) return;
+      setState(() {
+        result = live.text ?? '0';
+      });
+    });
+    textEditingController.addListener(updateLive);
+    textEditingController.addListener(saveAmount);
+    restoreAmount();
+    // Keep the shown result at the live rates when a feed is running.
+    rateUpdates = RateFeed.updates.listen(
+      (_) => updateLive(),
+      onError: (Object _) {},
+    );
+    arbitrageAlerts = RateFeed.arbitrage.listen(
+      showArbitrage,
+      onError: (Object _) {},
+    );
+  }
+
+  // Warns that the live rates may be off while quotes disagree.
+  void showArbitrage(List<ArbitrageAlert> alerts) {
+    if (!mounted) return;
+    final messenger = ScaffoldMessenger.of(context);
+    messenger.hideCurrentSnackBar();
+    if (alerts.isEmpty) return;
+    final alert = alerts.first;
+    final cycle = [...alert.currencies, alert.currencies.first].join(' → ');
+    final gain = (alert.gain * 100).toStringAsFixed(3);
+    messenger.showSnackBar(SnackBar(
+      content: Text('Inconsistent quotes: $cycle (+$gain%)'),
+      duration: const Duration(days: 1),
+    ));
+  }
 
-  void convert() {
-    result = double.parse(textEditingController.text) * 80;
-    setState(() {});
+  // Picks up the amount the previous session ended with, unless the user
+  // has started typing already.
+  Future<void> restoreAmount() async {
+    final session = await Session.restore();
+    if (!mounted || session == null || textEditingController.text.isNotEmpty) {
+      return;
+    }
+    textEditingController.text = session.state;
+  }
+
+  void saveAmount() {
+    Session.save(textEditingController.text);
+  }
+
+  void updateLive() {
+    liveConverter.update(
+      textEditingController.text,
+      locale: Localizations.maybeLocaleOf(context)?.toString(),
+    );
+  }
+
+  Future<void> convert() async {
+    final conversion = await NativeConverter.convert(
+      textEditingController.text,
+      locale: Localizations.maybeLocaleOf(context)?.toString(),
+    );
+    if (!mounted) return;
+    setState(() {
+      result = conversion.value != 0 ? conversion.text : '0';
+    });
   }
 
   @override
   void dispose() {
+    rateUpdates?.cancel();
+    arbitrageAlerts?.cancel();
+    liveConverter.dispose();
     textEditingController.dispose();
     super.dispose();
   }
@@ -48,7 +123,7 @@ class _CurrencyConverterMaterialPageState
             mainAxisAlignment: MainAxisAlignment.center,
             children: [
               Text(
-                'INR ${result != 0 ? result.toStringAsFixed(3) : result.toStringAsFixed(0)}',
+                'INR $result',
                 style: const TextStyle(
                   fontSize: 55,
                   fontWeight: FontWeight.bold,
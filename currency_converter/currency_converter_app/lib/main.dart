@@ -1,9 +1,14 @@
+import 'package:currency_converter/channel_benchmark.dart';
 import 'package:currency_converter/currency_converter_cupertino_page.dart';
 import 'package:currency_converter/currency_converter_material_page.dart';
 import 'package:flutter/cupertino.dart';
 import 'package:flutter/material.dart';
 
-void main() {
+void main(List<String> args) {
+  if (args.contains(channelBenchmarkArgument)) {
+    runChannelBenchmark();
+    return;
+  }
   runApp(const MyApp());
 }
 
@@ -0,0 +1,547 @@
+import 'dart:async';
+import 'dart:convert';
+import 'dart:typed_data';
+
+import 'package:flutter/services.dart';
+
+// Result of converting an amount, rounded to the target currency's minor
+// units. [text] is the result formatted for display in the requested locale.
+class Conversion {
+  const Conversion(this.value, this.minorUnits, this.text);
+
+  final double value;
+  final int minorUnits;
+  final String text;
+}
+
+// Amounts formatted natively by [NativeConverter.formatBatch]: one UTF-8
+// buffer plus offsets. Strings are only created for the entries actually
+// read, e.g. the rows a list view is showing.
+class FormattedAmounts {
+  FormattedAmounts(this.bytes, this.offsets);
+
+  final Uint8List bytes;
+  final Int32List offsets;
+
+  int get length => offsets.length - 1;
+
+  String operator [](int index) =>
+      utf8.decode(Uint8List.sublistView(
+          bytes, offsets[index], offsets[index + 1]));
+}
+
+// Amounts converted into many currencies by [NativeConverter.convertAll].
+// [currencies] holds indices into [NativeConverter.currencies] in the order
+// asked for; [results] is a [Float64List] in major units or an [Int64List]
+// in minor units, like the amounts, grouped by currency.
+class FanOut {
+  const FanOut(this.currencies, this.results);
+
+  final Int32List currencies;
+  final TypedData results;
+
+  int get amountCount => currencies.isEmpty
+      ? 0
+      : (results as List<num>).length ~/ currencies.length;
+
+  // Amount [amount] in currencies[[currency]]: NaN, or the smallest int64
+  // for minor units, if it does not fit.
+  num valueAt(int currency, int amount) =>
+      (results as List<num>)[currency * amountCount + amount];
+}
+
+// Talks to the native conversion engine over the 'currency_converter/engine'
+// method channel. Platforms without the native engine fall back to the
+// original fixed USD to INR rate.
+class NativeConverter {
+  static const MethodChannel _channel =
+      MethodChannel('currency_converter/engine');
+
+  // Converts [amount] at the live rates, or with [at] at the historical
+  // rates in effect at that time. [amount] may be grouped as in [locale],
+  // e.g. '1,000.50', which also sets how the result text is formatted.
+  static Future<Conversion> convert(
+    String amount, {
+    String from = 'USD',
+    String to = 'INR',
+    DateTime? at,
+    String? locale,
+  }) async {
+    try {
+      final result = await _channel.invokeMapMethod<String, Object?>(
+        'convert',
+        {
+          'amount': amount.trim(),
+          'from': from,
+          'to': to,
+          if (at != null) 'at': at.millisecondsSinceEpoch,
+          if (locale != null) 'locale': locale,
+        },
+      );
+      return Conversion(
+        result!['value'] as double,
+        result['minorUnits'] as int,
+        result['text'] as String,
+      );
+    } on MissingPluginException {
+      final value = double.parse(amount.replaceAll(',', '')) * 80;
+      return Conversion(value, 3, value.toStringAsFixed(3));
+    }
+  }
+
+  // Formats [amounts], in minor units of [currency], for display in
+  // [locale] in a single call.
+  static Future<FormattedAmounts> formatBatch(
+    Int64List amounts, {
+    String currency = 'INR',
+    String? locale,
+  }) async {
+    final result = await _channel.invokeMapMethod<String, Object?>(
+      'formatBatch',
+      {
+        'amounts': amounts,
+        'currency': currency,
+        if (locale != null) 'locale': locale,
+      },
+    );
+    return FormattedAmounts(
+      result!['text'] as Uint8List,
+      result['offsets'] as Int32List,
+    );
+  }
+
+  // Converts [amounts], a [Float64List] in major units or an [Int64List] in
+  // minor units of [from], into each currency of [targets] (indices as
+  // returned by [currencies], e.g. the user's favourites) or into every
+  // currency, in one call. [order] is 'code' or 'value' (largest result of
+  // the first amount first) to have the currencies sorted natively.
+  static Future<FanOut> convertAll(
+    TypedData amounts, {
+    String from = 'USD',
+    Int32List? targets,
+    String? order,
+  }) async {
+    final result = await _channel.invokeMapMethod<String, Object?>(
+      'convertAll',
+      {
+        'amounts': amounts,
+        'from': from,
+        if (targets != null) 'targets': targets,
+        if (order != null) 'order': order,
+      },
+    );
+    return FanOut(
+      result!['currencies'] as Int32List,
+      result['results'] as TypedData,
+    );
+  }
+
+  // Packs a pair of currency indices, as returned by [currencies], for
+  // [convertBatch].
+  static int packPair(int from, int to) => from << 16 | to;
+
+  static Future<List<String>> currencies() async {
+    final result =
+        await _channel.invokeMapMethod<String, Object?>('currencies');
+    return (result!['codes'] as List<Object?>).cast<String>();
+  }
+
+  // Converts many amounts in one call. [amounts] is either a [Float64List] in
+  // major units or an [Int64List] in minor units, and the result has the
+  // same type. Either [from] and [to] apply to every amount, or [pairs]
+  // gives a packed pair per amount.
+  static Future<TypedData> convertBatch(
+    TypedData amounts, {
+    String from = 'USD',
+    String to = 'INR',
+    Int32List? pairs,
+  }) async {
+    final result = await _channel.invokeMethod<TypedData>(
+      'convertBatch',
+      pairs != null
+          ? {'amounts': amounts, 'pairs': pairs}
+          : {'amounts': amounts, 'from': from, 'to': to},
+    );
+    return result!;
+  }
+}
+
+// One result from [LiveConverter]: [text] is the converted amount formatted
+// for display, or null with [error] set to the engine's error code, e.g.
+// 'invalid_amount' while the field holds a partial number.
+class LiveResult {
+  const LiveResult(this.sequence, this.text, this.error);
+
+  final int sequence;
+  final String? text;
+  final String? error;
+}
+
+// Converts the text of one input field as it is typed. Call [update] on
+// every edit; the native side keeps only the latest text per field, converts
+// it at most once per frame, and results arrive on [results]. A result for
+// an edit that has since been superseded is never delivered.
+class LiveConverter {
+  LiveConverter({this.from = 'USD', this.to = 'INR'}) : _field = _nextField++ {
+    _subscription = _nativeResults.listen(_onResults);
+  }
+
+  static const MethodChannel _channel =
+      MethodChannel('currency_converter/live');
+  static const EventChannel _resultsChannel =
+      EventChannel('currency_converter/live_results');
+  // Shared by every field, as the native side sends one event per frame
+  // covering all of them.
+  static final Stream<Object?> _nativeResults =
+      _resultsChannel.receiveBroadcastStream();
+  static int _nextField = 0;
+
+  final String from;
+  final String to;
+  final int _field;
+  int _sequence = 0;
+  late final StreamSubscription<Object?> _subscription;
+  final StreamController<LiveResult> _results =
+      StreamController<LiveResult>.broadcast();
+
+  Stream<LiveResult> get results => _results.stream;
+
+  Future<void> update(String amount, {String? locale}) async {
+    final sequence = ++_sequence;
+    try {
+      await _channel.invokeMethod<void>('update', {
+        'field': _field,
+        'sequence': sequence,
+        'amount': amount,
+        'from': from,
+        'to': to,
+        if (locale != null) 'locale': locale,
+      });
+    } on MissingPluginException {
+      final value = double.tryParse(amount.replaceAll(',', ''));
+      _results.add(value == null
+          ? LiveResult(sequence, null, 'invalid_amount')
+          : LiveResult(sequence, (value * 80).toStringAsFixed(3), null));
+    }
+  }
+
+  void _onResults(Object? event) {
+    final entries = (event as List<Object?>).cast<Map<Object?, Object?>>();
+    for (final entry in entries) {
+      if (entry['field'] != _field || entry['sequence'] != _sequence) {
+        continue;
+      }
+      _results.add(LiveResult(
+        _sequence,
+        entry['text'] as String?,
+        entry['error'] as String?,
+      ));
+    }
+  }
+
+  void dispose() {
+    _subscription.cancel();
+    _results.close();
+  }
+}
+
+// Base rates changed by the native rate feed, scaled by 10^12 as in the
+// engine. [currencies] holds indices into [NativeConverter.currencies]. The
+// first update after listening carries every rate; later ones only those
+// that changed, at most one update per frame however fast quotes arrive.
+class RateUpdate {
+  const RateUpdate(this.version, this.currencies, this.rates);
+
+  final int version;
+  final Int32List currencies;
+  final Int64List rates;
+}
+
+// A cycle of quotes from the native rate feed whose rates multiply to
+// 1 + [gain]: converting around [currencies] and back to the first returns
+// more than it started with, which usually means a stale or bad quote.
+class ArbitrageAlert {
+  const ArbitrageAlert(this.currencies, this.gain);
+
+  final List<String> currencies;
+  final double gain;
+}
+
+class RateFeed {
+  static const EventChannel _channel =
+      EventChannel('currency_converter/rates');
+  static const EventChannel _arbitrageChannel =
+      EventChannel('currency_converter/arbitrage');
+
+  // Every cycle currently flagged, sent again whenever the set changes; an
+  // empty list means earlier alerts no longer hold.
+  static final Stream<List<ArbitrageAlert>> arbitrage =
+      _arbitrageChannel.receiveBroadcastStream().map((event) {
+    return (event as List<Object?>).map((entry) {
+      final map = entry as Map<Object?, Object?>;
+      return ArbitrageAlert(
+        (map['currencies'] as List<Object?>).cast<String>(),
+        map['gain'] as double,
+      );
+    }).toList();
+  });
+
+  static final Stream<RateUpdate> updates =
+      _channel.receiveBroadcastStream().map((event) {
+    final map = event as Map<Object?, Object?>;
+    return RateUpdate(
+      map['version'] as int,
+      map['currencies'] as Int32List,
+      map['rates'] as Int64List,
+    );
+  });
+}
+
+// The value of a [Portfolio] in its reporting [currency]: [minor] units of
+// 10^-[minorUnits], formatted as [text], or null with [error] set if the
+// total does not fit the engine's 64-bit amounts.
+class PortfolioTotal {
+  const PortfolioTotal(
+      this.currency, this.minor, this.minorUnits, this.text, this.error);
+
+  factory PortfolioTotal._fromMap(Map<Object?, Object?> map) => PortfolioTotal(
+        map['currency'] as String,
+        map['minor'] as int?,
+        map['minorUnits'] as int?,
+        map['text'] as String?,
+        map['error'] as String?,
+      );
+
+  final String currency;
+  final int? minor;
+  final int? minorUnits;
+  final String? text;
+  final String? error;
+}
+
+// Positions held natively and valued at the live rates. A rate update only
+// revalues the currencies it touches, and [totals] gets the new total
+// whenever it changes.
+class Portfolio {
+  static const MethodChannel _channel =
+      MethodChannel('currency_converter/portfolio');
+  static const EventChannel _totalChannel =
+      EventChannel('currency_converter/portfolio_total');
+
+  static final Stream<PortfolioTotal> totals = _totalChannel
+      .receiveBroadcastStream()
+      .map((event) => PortfolioTotal._fromMap(event as Map<Object?, Object?>));
+
+  // Adds positions of [amounts], in minor units, in [currencies], given as
+  // indices into [NativeConverter.currencies]. Returns their ids.
+  static Future<Int32List> add(Int32List currencies, Int64List amounts) async {
+    final ids = await _channel.invokeMethod<Int32List>(
+      'add',
+      {'currencies': currencies, 'amounts': amounts},
+    );
+    return ids!;
+  }
+
+  static Future<void> update(Int32List ids, Int64List amounts) =>
+      _channel.invokeMethod<void>('update', {'ids': ids, 'amounts': amounts});
+
+  static Future<void> remove(Int32List ids) =>
+      _channel.invokeMethod<void>('remove', {'ids': ids});
+
+  static Future<void> setReportingCurrency(String currency, {String? locale}) =>
+      _channel.invokeMethod<void>('setReportingCurrency', {
+        'currency': currency,
+        if (locale != null) 'locale': locale,
+      });
+
+  static Future<PortfolioTotal> total() async {
+    final result = await _channel.invokeMapMethod<Object?, Object?>('total');
+    return PortfolioTotal._fromMap(result!);
+  }
+}
+
+// Alerts that fired, in parallel lists: the alert ids, their pairs packed as
+// first << 16 | second, and the cross rates that fired them, scaled by 1e12.
+class FiredAlerts {
+  const FiredAlerts(this.ids, this.pairs, this.rates);
+
+  factory FiredAlerts._fromMap(Map<Object?, Object?> map) => FiredAlerts(
+        map['ids'] as Int32List,
+        map['pairs'] as Int32List,
+        map['rates'] as Int64List,
+      );
+
+  final Int32List ids;
+  final Int32List pairs;
+  final Int64List rates;
+}
+
+// One-shot rate alerts held natively. Each fires once, on [fired], the first
+// time its pair's rate reaches the threshold, and is then removed.
+class RateAlerts {
+  static const MethodChannel _channel =
+      MethodChannel('currency_converter/alerts');
+  static const EventChannel _firedChannel =
+      EventChannel('currency_converter/alerts_fired');
+
+  static final Stream<FiredAlerts> fired = _firedChannel
+      .receiveBroadcastStream()
+      .map((event) => FiredAlerts._fromMap(event as Map<Object?, Object?>));
+
+  // Adds an alert per entry of [pairs], packed as first << 16 | second with
+  // indices into [NativeConverter.currencies], firing once the rate rises to
+  // the threshold if [above] is nonzero and falls to it otherwise.
+  // [thresholds] are in units of second per first scaled by 1e12. Returns
+  // the ids, -1 for an invalid alert.
+  static Future<Int32List> add(
+      Int32List pairs, Uint8List above, Int64List thresholds) async {
+    final ids = await _channel.invokeMethod<Int32List>(
+      'add',
+      {'pairs': pairs, 'above': above, 'thresholds': thresholds},
+    );
+    return ids!;
+  }
+
+  static Future<void> remove(Int32List ids) =>
+      _channel.invokeMethod<void>('remove', {'ids': ids});
+}
+
+// Open/high/low/close candles of one pair, in parallel lists with an entry
+// per candle. Rates are scaled by 1e12; [average] is the mean quote, the
+// VWAP by tick volume, and [ticks] the number of quotes.
+class CandleSeries {
+  const CandleSeries(this.start, this.open, this.high, this.low, this.close,
+      this.average, this.ticks);
+
+  factory CandleSeries._fromMap(Map<Object?, Object?> map) => CandleSeries(
+        map['start'] as Int64List,
+        map['open'] as Int64List,
+        map['high'] as Int64List,
+        map['low'] as Int64List,
+        map['close'] as Int64List,
+        map['average'] as Int64List,
+        map['ticks'] as Int64List,
+      );
+
+  // Start of each candle in milliseconds since the epoch.
+  final Int64List start;
+  final Int64List open;
+  final Int64List high;
+  final Int64List low;
+  final Int64List close;
+  final Int64List average;
+  final Int64List ticks;
+
+  int get length => start.length;
+}
+
+// Candles built natively from the rate history and the live feed.
+class Candles {
+  static const MethodChannel _channel =
+      MethodChannel('currency_converter/candles');
+
+  // Returns the candles of [pair], packed as from_index << 16 | to_index,
+  // overlapping [begin, end), each [interval] wide; or, if [months] is
+  // given instead, that many calendar months wide. [interval] must be a
+  // whole number of minutes. Intervals without quotes are skipped.
+  static Future<CandleSeries> get(int pair, DateTime begin, DateTime end,
+      {Duration? interval, int? months}) async {
+    final result = await _channel.invokeMapMethod<Object?, Object?>(
+      'candles',
+      {
+        'pair': pair,
+        'begin': begin.millisecondsSinceEpoch,
+        'end': end.millisecondsSinceEpoch,
+        if (interval != null) 'interval': interval.inMilliseconds,
+        if (months != null) 'months': months,
+      },
+    );
+    return CandleSeries._fromMap(result!);
+  }
+}
+
+// UI state kept natively in the warm-start snapshot, so the next launch can
+// show it from the first frame with the previous session's rates.
+class Session {
+  static const MethodChannel _channel =
+      MethodChannel('currency_converter/session');
+
+  // Returns the state saved by the previous session and when it ended, or
+  // null if there was none or the platform keeps no snapshot.
+  static Future<({String state, DateTime savedAt})?> restore() async {
+    final Map<Object?, Object?>? result;
+    try {
+      result = await _channel.invokeMapMethod<Object?, Object?>('restore');
+    } on MissingPluginException {
+      return null;
+    }
+    if (result == null || result.isEmpty) return null;
+    return (
+      state: result['state'] as String,
+      savedAt:
+          DateTime.fromMillisecondsSinceEpoch(result['savedAt'] as int),
+    );
+  }
+
+  // Keeps [state] for the snapshot written when the app exits.
+  static Future<void> save(String state) async {
+    try {
+      await _channel.invokeMethod<void>('save', {'state': state});
+    } on MissingPluginException {
+      // Nothing to keep it in.
+    }
+  }
+}
+
+// Latency histograms and counters of the native side, in parallel lists
+// with an entry per metric. [names] are in the Prometheus form
+// family{labels}; [kinds] are 0 for a latency and 1 for a counter. For a
+// latency, [counts] is the number of calls and the rest are nanoseconds;
+// a counter only has its total, in [counts].
+class MetricsReading {
+  const MetricsReading(this.names, this.kinds, this.counts, this.sums,
+      this.maxes, this.p50, this.p90, this.p99, this.p999);
+
+  factory MetricsReading._fromMap(Map<Object?, Object?> map) => MetricsReading(
+        (map['names'] as List<Object?>).cast<String>(),
+        map['kinds'] as Uint8List,
+        map['counts'] as Int64List,
+        map['sums'] as Int64List,
+        map['maxes'] as Int64List,
+        map['p50'] as Int64List,
+        map['p90'] as Int64List,
+        map['p99'] as Int64List,
+        map['p999'] as Int64List,
+      );
+
+  final List<String> names;
+  final Uint8List kinds;
+  final Int64List counts;
+  final Int64List sums;
+  final Int64List maxes;
+  final Int64List p50;
+  final Int64List p90;
+  final Int64List p99;
+  final Int64List p999;
+
+  int get length => names.length;
+}
+
+// Where native time goes: every method-channel call and the operations of
+// a conversion are timed. The same metrics are served in the Prometheus
+// text format on a Unix socket under the user runtime directory.
+class NativeMetrics {
+  static const MethodChannel _channel =
+      MethodChannel('currency_converter/metrics');
+
+  static Future<MetricsReading> read() async {
+    final result = await _channel.invokeMapMethod<Object?, Object?>('read');
+    return MetricsReading._fromMap(result!);
+  }
+
+  // Returns the metrics in the Prometheus text exposition format.
+  static Future<String> prometheus() async {
+    final text = await _channel.invokeMethod<String>('prometheus');
+    return text!;
+  }
+}
@@ -0,0 +1,210 @@
+#include "alert_channel.h"
+
+#include <cstring>
+#include <vector>
+
+#include "channel_util.h"
+#include "engine/alert_index.h"
+#include "engine/metrics.h"
+#include "metrics_channel.h"
+
+struct _AlertChannel {
+  GObject parent_instance;
+  FlMethodChannel* channel;
+  FlEventChannel* fired_channel;
+  converter::ConversionEngine* engine;
+  converter::AlertIndex* index;
+  // Fired and not yet sent, as nothing was listening. Reused between
+  // updates so evaluating does not allocate once warm.
+  std::vector<converter::FiredAlert>* fired;
+  gboolean listening;
+};
+
+G_DEFINE_TYPE(AlertChannel, alert_channel, G_TYPE_OBJECT)
+
+static constexpr char kChannelName[] = "currency_converter/alerts";
+static constexpr char kFiredChannelName[] = "currency_converter/alerts_fired";
+
+// Sends every alert that fired and was not sent yet as one event: {ids,
+// pairs, rates}, an Int32List of alert ids, an Int32List of their packed
+// pairs and an Int64List of the cross rates, scaled by
+// converter::kRateScale, that fired them. Without a listener they are kept
+// for the next one.
+static void send_fired(AlertChannel* self) {
+  if (self->fired->empty() || !self->listening) {
+    return;
+  }
+
+  size_t count = self->fired->size();
+  std::vector<int32_t> ids(count);
+  std::vector<int32_t> pairs(count);
+  std::vector<int64_t> rates(count);
+  for (size_t i = 0; i < count; i++) {
+    const converter::FiredAlert& alert = (*self->fired)[i];
+    ids[i] = static_cast<int32_t>(alert.id);
+    pairs[i] = static_cast<int32_t>(alert.pair);
+    rates[i] = alert.rate;
+  }
+  self->fired->clear();
+  g_autoptr(FlValue) event = fl_value_new_map();
+  fl_value_set_string_take(event, "ids",
+                           fl_value_new_int32_list(ids.data(), count));
+  fl_value_set_string_take(event, "pairs",
+                           fl_value_new_int32_list(pairs.data(), count));
+  fl_value_set_string_take(event, "rates",
+                           fl_value_new_int64_list(rates.data(), count));
+  g_autoptr(GError) error = nullptr;
+  if (!fl_event_channel_send(self->fired_channel, event, nullptr, &error)) {
+    g_warning("Failed to send fired alerts: %s", error->message);
+  }
+}
+
+// Evaluates the alerts against the engine's current rates and sends those
+// that fired.
+static void evaluate(AlertChannel* self) {
+  {
+    converter::RateStore::Snapshot snapshot = self->engine->rates().Read();
+    self->index->Refresh(snapshot.table(), self->fired);
+  }
+  send_fired(self);
+}
+
+// Handles "add" with arguments {pairs, above, thresholds}: an Int32List of
+// pairs packed as on the engine channel, a Uint8List that is 1 for alerts
+// on a rise to the threshold and 0 for a fall, and an Int64List of
+// thresholds scaled by converter::kRateScale. Responds with the alert ids
+// as an Int32List, -1 for an invalid alert. Alerts whose condition already
+// holds fire right after the response.
+static FlMethodResponse* add(AlertChannel* self, FlValue* args) {
+  FlValue* pairs = lookup_typed(args, "pairs", FL_VALUE_TYPE_INT32_LIST);
+  FlValue* above = lookup_typed(args, "above", FL_VALUE_TYPE_UINT8_LIST);
+  FlValue* thresholds =
+      lookup_typed(args, "thresholds", FL_VALUE_TYPE_INT64_LIST);
+  if (pairs == nullptr || above == nullptr || thresholds == nullptr ||
+      fl_value_get_length(above) != fl_value_get_length(pairs) ||
+      fl_value_get_length(thresholds) != fl_value_get_length(pairs)) {
+    return invalid_arguments_response(
+        "Expected pairs as an Int32List, above as a Uint8List and "
+        "thresholds as an Int64List of the same length");
+  }
+  size_t count = fl_value_get_length(pairs);
+  const int32_t* pair_list = fl_value_get_int32_list(pairs);
+  const uint8_t* above_list = fl_value_get_uint8_list(above);
+  const int64_t* threshold_list = fl_value_get_int64_list(thresholds);
+  std::vector<int32_t> ids(count);
+  for (size_t i = 0; i < count; i++) {
+    converter::AlertId id = self->index->Add(
+        static_cast<uint32_t>(pair_list[i]),
+        above_list[i] != 0 ? converter::AlertDirection::kAbove
+                           : converter::AlertDirection::kBelow,
+        threshold_list[i]);
+    ids[i] = id == converter::kInvalidAlert ? -1 : static_cast<int32_t>(id);
+  }
+  g_autoptr(FlValue) result = fl_value_new_int32_list(ids.data(), count);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// Handles "remove" with arguments {ids}, an Int32List of alert ids. Ids of
+// alerts that already fired or were removed are ignored, even once a new
+// alert has taken over their slot, as it does so under a different id.
+static FlMethodResponse* remove(AlertChannel* self, FlValue* args) {
+  FlValue* ids = lookup_typed(args, "ids", FL_VALUE_TYPE_INT32_LIST);
+  if (ids == nullptr) {
+    return invalid_arguments_response("Expected ids as an Int32List");
+  }
+  size_t count = fl_value_get_length(ids);
+  const int32_t* id_list = fl_value_get_int32_list(ids);
+  for (size_t i = 0; i < count; i++) {
+    self->index->Remove(static_cast<converter::AlertId>(id_list[i]));
+  }
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+}
+
+// Called when a method call is received from Flutter.
+static void method_call_cb(FlMethodChannel* channel, FlMethodCall* method_call,
+                           gpointer user_data) {
+  AlertChannel* self = ALERT_CHANNEL(user_data);
+  uint64_t start = converter::MetricsClock();
+  const gchar* method = fl_method_call_get_name(method_call);
+  FlValue* args = fl_method_call_get_args(method_call);
+
+  g_autoptr(FlMethodResponse) response = nullptr;
+  if (strcmp(method, "add") == 0) {
+    response = add(self, args);
+  } else if (strcmp(method, "remove") == 0) {
+    response = remove(self, args);
+  } else {
+    response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+  }
+
+  g_autoptr(GError) error = nullptr;
+  if (!fl_method_call_respond(method_call, response, &error)) {
+    g_warning("Failed to send response: %s", error->message);
+  }
+  metrics_channel_record_call(kChannelName, method, start, response);
+  // Dart has the ids of new alerts before any of them fire.
+  if (strcmp(method, "add") == 0) {
+    evaluate(self);
+  }
+}
+
+static FlMethodErrorResponse* listen_cb(FlEventChannel* channel, FlValue* args,
+                                        gpointer user_data) {
+  AlertChannel* self = ALERT_CHANNEL(user_data);
+  self->listening = TRUE;
+  send_fired(self);
+  return nullptr;
+}
+
+static FlMethodErrorResponse* cancel_cb(FlEventChannel* channel, FlValue* args,
+                                        gpointer user_data) {
+  ALERT_CHANNEL(user_data)->listening = FALSE;
+  return nullptr;
+}
+
+void alert_channel_rates_changed(AlertChannel* self) {
+  if (self->index->size() != 0) {
+    evaluate(self);
+  }
+}
+
+static void alert_channel_dispose(GObject* object) {
+  AlertChannel* self = ALERT_CHANNEL(object);
+  g_clear_object(&self->channel);
+  g_clear_object(&self->fired_channel);
+  G_OBJECT_CLASS(alert_channel_parent_class)->dispose(object);
+}
+
+static void alert_channel_finalize(GObject* object) {
+  AlertChannel* self = ALERT_CHANNEL(object);
+  delete self->index;
+  delete self->fired;
+  G_OBJECT_CLASS(alert_channel_parent_class)->finalize(object);
+}
+
+static void alert_channel_class_init(AlertChannelClass* klass) {
+  G_OBJECT_CLASS(klass)->dispose = alert_channel_dispose;
+  G_OBJECT_CLASS(klass)->finalize = alert_channel_finalize;
+}
+
+static void alert_channel_init(AlertChannel* self) {}
+
+AlertChannel* alert_channel_new(FlBinaryMessenger* messenger,
+                                converter::ConversionEngine* engine) {
+  AlertChannel* self =
+      ALERT_CHANNEL(g_object_new(alert_channel_get_type(), nullptr));
+  self->engine = engine;
+  self->index = new converter::AlertIndex();
+  self->fired = new std::vector<converter::FiredAlert>();
+
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  self->channel = fl_method_channel_new(messenger, kChannelName,
+                                        FL_METHOD_CODEC(codec));
+  fl_method_channel_set_method_call_handler(self->channel, method_call_cb,
+                                            self, nullptr);
+  self->fired_channel = fl_event_channel_new(messenger, kFiredChannelName,
+                                             FL_METHOD_CODEC(codec));
+  fl_event_channel_set_stream_handlers(self->fired_channel, listen_cb,
+                                       cancel_cb, self, nullptr);
+  return self;
+}
@@ -0,0 +1,36 @@
+#ifndef FLUTTER_ALERT_CHANNEL_H_
+#define FLUTTER_ALERT_CHANNEL_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+#include "engine/conversion_engine.h"
+
+G_DECLARE_FINAL_TYPE(AlertChannel, alert_channel, ALERT, CHANNEL, GObject)
+
+/**
+ * alert_channel_new:
+ * @messenger: an #FlBinaryMessenger to register the channels on.
+ * @engine: the native conversion engine whose rates the alerts watch. Must
+ * outlive the channel.
+ *
+ * Creates the "currency_converter/alerts" method channel, which registers
+ * rate threshold alerts natively, and the "currency_converter/alerts_fired"
+ * event channel, which sends the alerts that fired as one batch per rate
+ * update, keeping them until Dart listens.
+ *
+ * Returns: a new #AlertChannel.
+ */
+AlertChannel* alert_channel_new(FlBinaryMessenger* messenger,
+                                converter::ConversionEngine* engine);
+
+/**
+ * alert_channel_rates_changed:
+ * @self: an #AlertChannel.
+ *
+ * Evaluates the alerts on the pairs whose rates changed and sends those
+ * that fired. Connect it to the "rates-changed" signal of a
+ * #RateFeedChannel.
+ */
+void alert_channel_rates_changed(AlertChannel* self);
+
+#endif  // FLUTTER_ALERT_CHANNEL_H_
@@ -0,0 +1,205 @@
+#include "batch_mode.h"
+
+#include <fcntl.h>
+#include <glib-unix.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "engine/csv_batch.h"
+#include "engine/history_writer.h"
+#include "engine/rate_feed.h"
+#include "engine/shared_rates.h"
+#include "engine/tick_csv.h"
+
+gchar* batch_mode_history_path() {
+  return g_build_filename(g_get_user_data_dir(), "currency_converter",
+                          "rate_history.bin", nullptr);
+}
+
+gboolean batch_mode_requested(gchar** arguments) {
+  for (gchar** arg = arguments; *arg != nullptr; arg++) {
+    if (strcmp(*arg, "--batch") == 0 ||
+        strcmp(*arg, "--import-history") == 0 ||
+        strcmp(*arg, "--publish-rates") == 0) {
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+// Opens |path| for the batch, treating "-" as |standard_fd|.
+static int open_batch_file(const gchar* path, int flags, int standard_fd) {
+  if (strcmp(path, "-") == 0) {
+    return standard_fd;
+  }
+  int fd = open(path, flags | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    g_printerr("Failed to open %s: %s\n", path, g_strerror(errno));
+  }
+  return fd;
+}
+
+// Runs --import-history: parses |input_path| on every core and writes the
+// ticks to |output_path|, or the default history file if that is null.
+static int import_history(const gchar* input_path, const gchar* output_path) {
+  g_autofree gchar* default_path = nullptr;
+  if (output_path == nullptr) {
+    default_path = batch_mode_history_path();
+    g_autofree gchar* directory = g_path_get_dirname(default_path);
+    g_mkdir_with_parents(directory, 0755);
+    output_path = default_path;
+  }
+
+  converter::TickColumns ticks;
+  converter::TickIngestStats stats;
+  if (!converter::IngestTickFile(input_path, 0, &ticks, &stats)) {
+    g_printerr("Failed to read %s: %s\n", input_path, g_strerror(errno));
+    return 1;
+  }
+  if (!converter::WriteHistoryFile(ticks, output_path)) {
+    g_printerr("Failed to write %s: %s\n", output_path, g_strerror(errno));
+    return 1;
+  }
+
+  g_printerr("Imported %" G_GUINT64_FORMAT " ticks into %s, %" G_GUINT64_FORMAT
+             " rejected\n",
+             stats.rows, output_path, stats.rejected);
+  return stats.rejected == 0 ? 0 : 2;
+}
+
+static gboolean quit_cb(gpointer user_data) {
+  g_main_loop_quit(static_cast<GMainLoop*>(user_data));
+  return G_SOURCE_CONTINUE;
+}
+
+// Runs --publish-rates: applies the feed from |source| and mirrors it into
+// shared memory for every running instance, until interrupted.
+static int publish_rates(converter::ConversionEngine* engine,
+                         const gchar* source) {
+  std::unique_ptr<converter::RateSource> rate_source =
+      converter::CreateRateSource(source);
+  if (rate_source == nullptr) {
+    g_printerr("Invalid rate feed source: %s\n", source);
+    return 1;
+  }
+  std::string shared_name = converter::shared_rates::DefaultName();
+  std::unique_ptr<converter::SharedRatesWriter> writer =
+      converter::SharedRatesWriter::Create(shared_name);
+  if (writer == nullptr) {
+    g_printerr("Failed to set up %s; is another publisher running?\n",
+               shared_name.c_str());
+    return 1;
+  }
+
+  // Readers that start before the first tick still find a full rate page.
+  {
+    converter::RateStore::Snapshot snapshot = engine->rates().Read();
+    std::vector<converter::RateTick> rates;
+    for (size_t i = 0; i < snapshot.table().size(); i++) {
+      converter::CurrencyId currency = static_cast<converter::CurrencyId>(i);
+      rates.push_back({currency, snapshot.table().BaseRate(currency)});
+    }
+    writer->Append(rates.data(), rates.size(), snapshot.version());
+  }
+
+  converter::RateFeed feed(&engine->rates(), std::move(rate_source));
+  feed.MirrorTo(writer.get());
+  if (!feed.Start(nullptr)) {
+    g_printerr("Failed to start the rate feed\n");
+    return 1;
+  }
+  g_printerr("Publishing %s to %s\n", source, shared_name.c_str());
+  GMainLoop* loop = g_main_loop_new(nullptr, FALSE);
+  g_unix_signal_add(SIGINT, quit_cb, loop);
+  g_unix_signal_add(SIGTERM, quit_cb, loop);
+  g_main_loop_run(loop);
+  g_main_loop_unref(loop);
+  feed.Stop();
+
+  converter::RateFeedStats stats = feed.stats();
+  g_printerr("Published %" G_GUINT64_FORMAT " versions from %" G_GUINT64_FORMAT
+             " ticks, %" G_GUINT64_FORMAT " rejected\n",
+             stats.versions, stats.ticks, stats.rejected);
+  return 0;
+}
+
+int batch_mode_run(converter::ConversionEngine* engine, gchar** arguments) {
+  const gchar* input_path = nullptr;
+  const gchar* output_path = nullptr;
+  gboolean import = FALSE;
+  gboolean publish = FALSE;
+  for (gchar** arg = arguments; *arg != nullptr; arg++) {
+    if (strcmp(*arg, "--batch") == 0 && arg[1] != nullptr) {
+      input_path = *++arg;
+    } else if (strcmp(*arg, "--import-history") == 0 && arg[1] != nullptr) {
+      input_path = *++arg;
+      import = TRUE;
+    } else if (strcmp(*arg, "--publish-rates") == 0 && arg[1] != nullptr) {
+      input_path = *++arg;
+      publish = TRUE;
+    } else if (strcmp(*arg, "--out") == 0 && arg[1] != nullptr) {
+      output_path = *++arg;
+    } else {
+      input_path = nullptr;
+      break;
+    }
+  }
+  if (input_path == nullptr) {
+    g_printerr(
+        "Usage: currency_converter --batch <in.csv> [--out <out.csv>]\n"
+        "       currency_converter --import-history <ticks.csv> "
+        "[--out <history file>]\n"
+        "       currency_converter --publish-rates <rate feed source>\n");
+    return 1;
+  }
+  if (publish) {
+    return publish_rates(engine, input_path);
+  }
+  if (import) {
+    return import_history(input_path, output_path);
+  }
+  if (output_path == nullptr) {
+    output_path = "-";
+  }
+
+  int in_fd = open_batch_file(input_path, O_RDONLY, STDIN_FILENO);
+  if (in_fd < 0) {
+    return 1;
+  }
+  int out_fd = open_batch_file(output_path, O_WRONLY | O_CREAT | O_TRUNC,
+                               STDOUT_FILENO);
+  if (out_fd < 0) {
+    if (in_fd != STDIN_FILENO) {
+      close(in_fd);
+    }
+    return 1;
+  }
+  posix_fadvise(in_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+  converter::CsvBatchStats stats;
+  bool ok = converter::ConvertCsvStream(*engine, in_fd, out_fd, &stats);
+  if (!ok) {
+    g_printerr("Batch conversion failed: %s\n", g_strerror(errno));
+  }
+  if (in_fd != STDIN_FILENO) {
+    close(in_fd);
+  }
+  if (out_fd != STDOUT_FILENO && close(out_fd) != 0 && ok) {
+    g_printerr("Failed to write %s: %s\n", output_path, g_strerror(errno));
+    ok = false;
+  }
+  if (!ok) {
+    return 1;
+  }
+
+  g_printerr("Converted %" G_GUINT64_FORMAT " rows, %" G_GUINT64_FORMAT
+             " rejected\n",
+             stats.rows, stats.rejected);
+  return stats.rejected == 0 ? 0 : 2;
+}
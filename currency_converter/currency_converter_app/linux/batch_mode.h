@@ -0,0 +1,60 @@
+#ifndef FLUTTER_BATCH_MODE_H_
+#define FLUTTER_BATCH_MODE_H_
+
+#include <glib.h>
+
+#include "engine/conversion_engine.h"
+
+/**
+ * batch_mode_history_path:
+ *
+ * Gets the default location of the rate history file: the file the
+ * application maps at start-up and `--import-history` writes.
+ *
+ * Returns: (transfer full): a path under the user data directory.
+ */
+gchar* batch_mode_history_path();
+
+/**
+ * batch_mode_requested:
+ * @arguments: (array zero-terminated=1): command line arguments, without the
+ * binary name.
+ *
+ * Checks whether the command line asks for a headless batch job, i.e.
+ * contains `--batch`, `--import-history` or `--publish-rates`.
+ *
+ * Returns: %TRUE if batch_mode_run() should be used instead of starting the
+ * UI.
+ */
+gboolean batch_mode_requested(gchar** arguments);
+
+/**
+ * batch_mode_run:
+ * @engine: the conversion engine to use.
+ * @arguments: (array zero-terminated=1): command line arguments, without the
+ * binary name.
+ *
+ * Runs `--batch <in.csv> [--out <out.csv>]`, streaming "amount,from,to" rows
+ * through @engine. Either path may be `-` for stdin or stdout, which is also
+ * the default output.
+ *
+ * Alternatively runs `--import-history <ticks.csv> [--out <history file>]`,
+ * which parses "timestamp,pair,rate" ticks and writes them as a rate history
+ * file, by default at batch_mode_history_path(). The application queries
+ * history by milliseconds since the epoch, so ticks should use that unit.
+ *
+ * Or runs `--publish-rates <source>`, which applies the rate feed from
+ * <source>, a specification such as "unix:/run/rates.sock" as taken by
+ * converter::CreateRateSource(), and mirrors every change into shared
+ * memory until interrupted. Instances started with
+ * CURRENCY_CONVERTER_RATE_FEED=shm follow it instead of parsing the feed
+ * themselves.
+ *
+ * No window, Flutter engine or Dart VM is created.
+ *
+ * Returns: the process exit status: 0 on success, 1 on a usage or I/O error
+ * and 2 if some rows were rejected.
+ */
+int batch_mode_run(converter::ConversionEngine* engine, gchar** arguments);
+
+#endif  // FLUTTER_BATCH_MODE_H_
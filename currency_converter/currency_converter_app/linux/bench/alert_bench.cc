@@ -0,0 +1,114 @@
+// Threshold alerts with 1M registered: the cost of a tick through the
+// sorted trigger index, against checking every alert.
+
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "engine/alert_index.h"
+#include "engine/conversion_engine.h"
+#include "engine/rate_table.h"
+
+namespace {
+
+struct NaiveAlert {
+  uint32_t pair;
+  converter::AlertDirection direction;
+  int64_t threshold;
+};
+
+}  // namespace
+
+BENCH_CASE(alerts) {
+  constexpr size_t kAlerts = 1000000;
+  converter::RateTable rates;
+  converter::CurrencyId usd = converter::FindCurrency("USD");
+  converter::CurrencyId inr = converter::FindCurrency("INR");
+
+  // Half the alerts on USD/INR, the rest over pairs of the first 32
+  // currencies, with thresholds within 5% of the rate either way.
+  std::mt19937_64 rng(13);
+  std::uniform_real_distribution<double> spread(0.95, 1.05);
+  converter::AlertIndex index;
+  std::vector<NaiveAlert> naive;
+  naive.reserve(kAlerts);
+  for (size_t i = 0; i < kAlerts; i++) {
+    converter::CurrencyId from = usd;
+    converter::CurrencyId to = inr;
+    if (i % 2 == 1) {
+      from = static_cast<converter::CurrencyId>(rng() % 32);
+      to = static_cast<converter::CurrencyId>((from + 1 + rng() % 31) % 32);
+    }
+    int64_t rate;
+    rates.CrossRate(from, to, &rate);
+    int64_t threshold = static_cast<int64_t>(rate * spread(rng));
+    converter::AlertDirection direction = threshold > rate
+                                              ? converter::AlertDirection::kAbove
+                                              : converter::AlertDirection::kBelow;
+    uint32_t pair = converter::PackPair(from, to);
+    index.Add(pair, direction, threshold);
+    naive.push_back({pair, direction, threshold});
+  }
+  std::vector<converter::FiredAlert> fired;
+  index.Refresh(rates, &fired);
+  bench::Note("alerts/registered", std::to_string(index.size()));
+
+  // INR moves by 0.001% a tick, back and forth, so each tick crosses a few
+  // USD/INR thresholds. Every alert that fires is registered again the
+  // other way round, keeping 1M alerts pending.
+  int64_t inr_rate = rates.BaseRate(inr);
+  bool up = false;
+  size_t total_fired = 0;
+  size_t ticks = 0;
+  bench::Report("alerts/tick_1m_alerts", bench::TimeNs([&] {
+                  up = !up;
+                  converter::RateTick tick = {
+                      inr, up ? inr_rate + inr_rate / 100000 : inr_rate};
+                  rates.SetBaseRate(inr, tick.rate);
+                  fired.clear();
+                  index.ApplyTicks(rates, &tick, 1, &fired);
+                  for (const converter::FiredAlert& alert : fired) {
+                    index.Add(alert.pair,
+                              up ? converter::AlertDirection::kBelow
+                                 : converter::AlertDirection::kAbove,
+                              alert.rate + (up ? -1 : 1));
+                  }
+                  total_fired += fired.size();
+                  ticks++;
+                }));
+  bench::Note("alerts/tick_1m_alerts/fired_per_tick",
+              std::to_string(static_cast<double>(total_fired) / ticks));
+
+  // The same tick checked against every alert.
+  bench::Report("alerts/scan_1m_alerts", bench::TimeNs([&] {
+                  up = !up;
+                  rates.SetBaseRate(
+                      inr, up ? inr_rate + inr_rate / 100000 : inr_rate);
+                  size_t hits = 0;
+                  for (const NaiveAlert& alert : naive) {
+                    int64_t rate;
+                    rates.CrossRate(alert.pair >> 16, alert.pair & 0xffff,
+                                    &rate);
+                    hits += alert.direction == converter::AlertDirection::kAbove
+                                ? rate >= alert.threshold
+                                : rate <= alert.threshold;
+                  }
+                  bench::DoNotOptimize(hits);
+                }));
+  rates.SetBaseRate(inr, inr_rate);
+
+  // Registering another 10k alerts on USD/INR, merged on the next tick.
+  bench::Report("alerts/add_10k", bench::TimeNs([&] {
+                  for (int i = 0; i < 10000; i++) {
+                    int64_t rate;
+                    rates.CrossRate(usd, inr, &rate);
+                    index.Add(converter::PackPair(usd, inr),
+                              converter::AlertDirection::kAbove,
+                              static_cast<int64_t>(rate * spread(rng)) +
+                                  rate / 10);
+                  }
+                  converter::RateTick tick = {inr, inr_rate};
+                  fired.clear();
+                  index.ApplyTicks(rates, &tick, 1, &fired);
+                }, 0.05), 10000);
+}
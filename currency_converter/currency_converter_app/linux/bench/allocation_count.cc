@@ -0,0 +1,48 @@
+// Replaces the global allocation functions with ones that count calls, for
+// bench::AllocationCount(). The array, nothrow and sized forms all end up in
+// these. Kept apart from the cases so the compiler does not pair inlined
+// allocations with deallocation functions it takes to be mismatched.
+
+#include <cstdlib>
+#include <new>
+
+#include "bench.h"
+
+namespace {
+
+thread_local uint64_t allocation_count = 0;
+
+}  // namespace
+
+uint64_t bench::AllocationCount() {
+  return allocation_count;
+}
+
+void* operator new(size_t size) {
+  allocation_count++;
+  void* p = malloc(size != 0 ? size : 1);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+  allocation_count++;
+  // aligned_alloc wants a whole number of alignments.
+  size_t align = static_cast<size_t>(alignment);
+  size_t rounded = (size != 0 ? size + align - 1 : align) / align * align;
+  void* p = aligned_alloc(align, rounded);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+  free(p);
+}
@@ -0,0 +1,55 @@
+// Locale-aware parsing and bulk formatting of a million amounts, the work
+// the Dart pages otherwise do with double.parse and toStringAsFixed (see
+// benchmark/amount_format_benchmark.dart for that side).
+
+#include <memory_resource>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "engine/amount_format.h"
+
+BENCH_CASE(amount_format) {
+  constexpr size_t kCount = 1000000;
+  std::mt19937_64 rng(42);
+  std::uniform_int_distribution<int64_t> dist(-10000000000, 10000000000);
+  std::vector<int64_t> amounts(kCount);
+  for (int64_t& amount : amounts) {
+    amount = dist(rng);
+  }
+
+  for (const char* locale : {"en_US", "en_IN", "fr_FR"}) {
+    const converter::NumberFormat& format =
+        converter::NumberFormatForLocale(locale);
+    std::string prefix = std::string("amount_format/") + locale;
+
+    std::pmr::string text;
+    std::pmr::vector<uint32_t> offsets;
+    double format_ns = bench::TimeNs([&] {
+      converter::FormatAmounts(amounts.data(), kCount, 2, format, &text,
+                               &offsets);
+      bench::DoNotOptimize(text[0]);
+    });
+    bench::Report(prefix + "/format_batch", format_ns, kCount);
+    bench::Note(prefix + "/bytes_per_value",
+                std::to_string(static_cast<double>(text.size()) / kCount));
+
+    size_t mismatches = 0;
+    double parse_ns = bench::TimeNs([&] {
+      mismatches = 0;
+      for (size_t i = 0; i < kCount; i++) {
+        int64_t value = 0;
+        converter::ParseAmount(
+            std::string_view(text.data() + offsets[i],
+                             offsets[i + 1] - offsets[i]),
+            2, format, &value);
+        mismatches += value != amounts[i];
+      }
+    });
+    bench::Report(prefix + "/parse", parse_ns, kCount);
+    if (mismatches != 0) {
+      bench::Note(prefix + "/mismatch", std::to_string(mismatches));
+    }
+  }
+}
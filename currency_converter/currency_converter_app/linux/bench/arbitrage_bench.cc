@@ -0,0 +1,77 @@
+// Arbitrage detection with every cross pair quoted: the cost of re-checking
+// after a tick, against searching the whole graph.
+
+#include <cmath>
+#include <random>
+
+#include "bench.h"
+#include "engine/arbitrage.h"
+#include "engine/conversion_engine.h"
+#include "engine/fixed_point.h"
+#include "engine/rate_table.h"
+
+namespace {
+
+int64_t CrossQuote(const converter::RateTable& rates, converter::CurrencyId from,
+                   converter::CurrencyId to, double skew) {
+  double rate = static_cast<double>(rates.BaseRate(to)) /
+                static_cast<double>(rates.BaseRate(from));
+  return std::llround(rate * skew * converter::kRateScale);
+}
+
+}  // namespace
+
+BENCH_CASE(arbitrage) {
+  converter::RateTable rates;
+  size_t count = converter::CurrencyCount();
+  converter::ArbitrageDetector detector;
+  detector.SetBaseRates(rates);
+  // Quotes for all N * (N - 1) / 2 pairs, a little off the triangulated
+  // rates as real quotes are.
+  std::mt19937_64 rng(7);
+  std::uniform_real_distribution<double> noise(1 - 1e-6, 1 + 1e-6);
+  for (size_t a = 0; a < count; a++) {
+    for (size_t b = a + 1; b < count; b++) {
+      converter::CurrencyId from = static_cast<converter::CurrencyId>(a);
+      converter::CurrencyId to = static_cast<converter::CurrencyId>(b);
+      int64_t quote = CrossQuote(rates, from, to, noise(rng));
+      if (quote > 0) {
+        detector.ApplyQuote(converter::PackPair(from, to), quote);
+      }
+    }
+  }
+  detector.CheckAll();
+  bench::Note("arbitrage/currencies", std::to_string(count));
+
+  converter::CurrencyId eur = converter::FindCurrency("EUR");
+  converter::CurrencyId gbp = converter::FindCurrency("GBP");
+  converter::RateTick tick = {eur, rates.BaseRate(eur)};
+  bool flip = false;
+  bench::Report("arbitrage/base_tick", bench::TimeNs([&] {
+                  flip = !flip;
+                  tick.rate = rates.BaseRate(eur) + (flip ? 1000 : 0);
+                  detector.ApplyBaseTicks(&tick, 1);
+                  bench::DoNotOptimize(detector.Check());
+                }));
+  bench::Report("arbitrage/cross_tick", bench::TimeNs([&] {
+                  flip = !flip;
+                  detector.ApplyQuote(
+                      converter::PackPair(eur, gbp),
+                      CrossQuote(rates, eur, gbp, flip ? 1 + 1e-7 : 1));
+                  bench::DoNotOptimize(detector.Check());
+                }));
+  bench::Report("arbitrage/full_search", bench::TimeNs([&] {
+                  bench::DoNotOptimize(detector.CheckAll());
+                }));
+
+  // A bad quote, flagged and then withdrawn.
+  bench::Report("arbitrage/flag_and_clear", bench::TimeNs([&] {
+                  detector.ApplyQuote(converter::PackPair(eur, gbp),
+                                      CrossQuote(rates, eur, gbp, 1.01));
+                  detector.Check();
+                  bench::DoNotOptimize(detector.cycles().size());
+                  detector.ApplyQuote(converter::PackPair(eur, gbp),
+                                      CrossQuote(rates, eur, gbp, 1));
+                  detector.Check();
+                }));
+}
@@ -0,0 +1,125 @@
+// Heap allocations per channel call: the temporaries of formatBatch from the
+// heap, as before, against from a RequestArena; and convertBatch converting
+// into a buffer from the heap and copying that into the response, against
+// into one from a RequestArena.
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "engine/amount_format.h"
+#include "engine/conversion_engine.h"
+#include "engine/request_arena.h"
+
+namespace {
+
+// Returns the mean number of allocations one call of |body| makes, once
+// warmed up.
+template <typename Body>
+std::string AllocationsPerCall(Body&& body) {
+  constexpr int kCalls = 100;
+  body();
+  uint64_t before = bench::AllocationCount();
+  for (int i = 0; i < kCalls; i++) {
+    body();
+  }
+  char text[32];
+  snprintf(text, sizeof(text), "%.2f",
+           static_cast<double>(bench::AllocationCount() - before) / kCalls);
+  return text;
+}
+
+std::vector<int64_t> RandomAmounts(size_t count) {
+  std::mt19937_64 rng(42);
+  std::uniform_int_distribution<int64_t> dist(1, 100000000);
+  std::vector<int64_t> amounts(count);
+  for (int64_t& amount : amounts) {
+    amount = dist(rng);
+  }
+  return amounts;
+}
+
+}  // namespace
+
+BENCH_CASE(request_arena) {
+  const converter::NumberFormat& format =
+      converter::NumberFormatForLocale("en_US");
+  converter::RequestArena arena;
+  for (size_t count : {size_t{100}, size_t{10000}}) {
+    std::string suffix = "/" + std::to_string(count);
+    std::vector<int64_t> amounts = RandomAmounts(count);
+
+    auto heap = [&] {
+      std::pmr::string text;
+      std::pmr::vector<uint32_t> offsets;
+      converter::FormatAmounts(amounts.data(), count, 2, format, &text,
+                               &offsets);
+      bench::DoNotOptimize(text[0]);
+    };
+    bench::Report("request_arena/format_batch/heap" + suffix,
+                  bench::TimeNs(heap), count);
+    bench::Note("request_arena/format_batch/heap" + suffix + "/allocations",
+                AllocationsPerCall(heap));
+
+    auto pooled = [&] {
+      {
+        std::pmr::string text(arena.resource());
+        std::pmr::vector<uint32_t> offsets(arena.resource());
+        converter::FormatAmounts(amounts.data(), count, 2, format, &text,
+                                 &offsets);
+        bench::DoNotOptimize(text[0]);
+      }
+      arena.Reset();
+    };
+    bench::Report("request_arena/format_batch/arena" + suffix,
+                  bench::TimeNs(pooled), count);
+    bench::Note("request_arena/format_batch/arena" + suffix + "/allocations",
+                AllocationsPerCall(pooled));
+  }
+
+  // Both start from the decoded request, which the codec has copied out of
+  // the message.
+  converter::ConversionEngine engine;
+  converter::CurrencyId usd = converter::FindCurrency("USD");
+  converter::CurrencyId inr = converter::FindCurrency("INR");
+  constexpr size_t kCount = 100000;
+  std::vector<int64_t> message = RandomAmounts(kCount);
+  std::vector<int64_t> decoded(kCount);
+  auto copied = [&] {
+    memcpy(decoded.data(), message.data(), kCount * sizeof(int64_t));
+    std::vector<int64_t> out(kCount);
+    engine.ConvertBatch(decoded.data(), kCount, usd, inr, out.data());
+    std::unique_ptr<int64_t[]> response(new int64_t[kCount]);
+    memcpy(response.get(), out.data(), kCount * sizeof(int64_t));
+    bench::DoNotOptimize(response[0]);
+  };
+  bench::Report("request_arena/convert_batch/copied", bench::TimeNs(copied),
+                kCount);
+  bench::Note("request_arena/convert_batch/copied/allocations",
+              AllocationsPerCall(copied));
+
+  // FlValue copies a typed list in when it is made, so the channel converts
+  // into a buffer from its arena and makes the response from that.
+  auto pooled = [&] {
+    memcpy(decoded.data(), message.data(), kCount * sizeof(int64_t));
+    {
+      std::pmr::polymorphic_allocator<int64_t> allocator(arena.resource());
+      int64_t* out = allocator.allocate(kCount);
+      engine.ConvertBatch(decoded.data(), kCount, usd, inr, out);
+      std::unique_ptr<int64_t[]> response(new int64_t[kCount]);
+      memcpy(response.get(), out, kCount * sizeof(int64_t));
+      bench::DoNotOptimize(response[0]);
+      allocator.deallocate(out, kCount);
+    }
+    arena.Reset();
+  };
+  bench::Report("request_arena/convert_batch/arena", bench::TimeNs(pooled),
+                kCount);
+  bench::Note("request_arena/convert_batch/arena/allocations",
+              AllocationsPerCall(pooled));
+}
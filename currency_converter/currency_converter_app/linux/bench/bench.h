@@ -0,0 +1,64 @@
+#ifndef CONVERTER_BENCH_BENCH_H_
+#define CONVERTER_BENCH_BENCH_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace bench {
+
+// Prevents the compiler from optimising away the computation of |value|.
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Runs |body| repeatedly for at least |min_seconds| and returns the mean
+// wall time of one call in nanoseconds.
+template <typename Body>
+double TimeNs(Body&& body, double min_seconds = 0.2) {
+  using Clock = std::chrono::steady_clock;
+  body();  // Warm up caches and lazily initialised state.
+  uint64_t iterations = 1;
+  while (true) {
+    Clock::time_point start = Clock::now();
+    for (uint64_t i = 0; i < iterations; i++) {
+      body();
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    if (elapsed >= min_seconds) {
+      return elapsed * 1e9 / iterations;
+    }
+    double growth = elapsed > 0 ? min_seconds / elapsed * 1.2 : 16;
+    iterations *= std::max<uint64_t>(2, static_cast<uint64_t>(growth));
+  }
+}
+
+// Prints one measurement. |items| is the number of logical operations (e.g.
+// conversions) performed by a single call, used to derive throughput.
+void Report(const std::string& name, double ns_per_call, double items = 1);
+
+// Prints a free-form derived result, such as a crossover point.
+void Note(const std::string& name, const std::string& value);
+
+// Returns the number of times the calling thread has called operator new.
+// The suite replaces it to count; memory from malloc directly, as GLib
+// allocates, is not counted.
+uint64_t AllocationCount();
+
+using CaseFn = void (*)();
+
+// Adds a benchmark case to the suite. Returns true so it can initialise a
+// static, see BENCH_CASE.
+bool RegisterCase(const char* name, CaseFn fn);
+
+}  // namespace bench
+
+// Defines a benchmark case that is registered with the suite at start-up.
+#define BENCH_CASE(name)                                            \
+  static void name();                                               \
+  static const bool name##_registered = bench::RegisterCase(#name, name); \
+  static void name()
+
+#endif  // CONVERTER_BENCH_BENCH_H_
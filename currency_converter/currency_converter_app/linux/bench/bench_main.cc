@@ -0,0 +1,240 @@
+// Runs the native benchmark suite. Pass substrings as arguments to only run
+// the cases whose names contain one of them, and
+//   --json=PATH       to also write the results to PATH as JSON;
+//   --baseline=PATH   to compare them with a file written by --json,
+//                     exiting with status 1 if any result got slower by
+//                     more than the tolerance;
+//   --tolerance=F     to allow slowdowns up to the fraction F, 0.25 by
+//                     default;
+//   --repetitions=N   to run each case N times and keep the fastest time of
+//                     each result, which filters out most of the noise of a
+//                     shared machine.
+// Baselines only mean something on the machine that recorded them; see
+// bench/baseline.json.
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+
+namespace bench {
+
+namespace {
+
+struct Case {
+  const char* name;
+  CaseFn fn;
+};
+
+std::vector<Case>& Cases() {
+  static std::vector<Case> cases;
+  return cases;
+}
+
+struct Result {
+  std::string name;
+  double ns_per_call;
+  double items_per_second;
+};
+
+struct NoteResult {
+  std::string name;
+  std::string value;
+};
+
+std::vector<Result>& Results() {
+  static std::vector<Result> results;
+  return results;
+}
+
+std::vector<NoteResult>& Notes() {
+  static std::vector<NoteResult> notes;
+  return notes;
+}
+
+std::string JsonString(const std::string& text) {
+  std::string quoted = "\"";
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      quoted += '\\';
+      quoted += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escape[8];
+      snprintf(escape, sizeof(escape), "\\u%04x", c);
+      quoted += escape;
+    } else {
+      quoted += c;
+    }
+  }
+  return quoted + "\"";
+}
+
+// Writes the results with one per line, which is all ReadBaseline relies
+// on.
+bool WriteJson(const char* path) {
+  FILE* file = fopen(path, "w");
+  if (file == nullptr) {
+    return false;
+  }
+  fprintf(file, "{\n  \"results\": [\n");
+  const std::vector<Result>& results = Results();
+  for (size_t i = 0; i < results.size(); i++) {
+    fprintf(file,
+            "    {\"name\": %s, \"ns_per_call\": %.6g, "
+            "\"items_per_second\": %.6g}%s\n",
+            JsonString(results[i].name).c_str(), results[i].ns_per_call,
+            results[i].items_per_second, i + 1 < results.size() ? "," : "");
+  }
+  fprintf(file, "  ],\n  \"notes\": [\n");
+  const std::vector<NoteResult>& notes = Notes();
+  for (size_t i = 0; i < notes.size(); i++) {
+    fprintf(file, "    {\"name\": %s, \"value\": %s}%s\n",
+            JsonString(notes[i].name).c_str(),
+            JsonString(notes[i].value).c_str(),
+            i + 1 < notes.size() ? "," : "");
+  }
+  fprintf(file, "  ]\n}\n");
+  return fclose(file) == 0;
+}
+
+// Reads the time per call of each result in a file written by WriteJson.
+// Names are not unescaped, as the suite's contain nothing to escape.
+bool ReadBaseline(const char* path, std::map<std::string, double>* baseline) {
+  FILE* file = fopen(path, "r");
+  if (file == nullptr) {
+    return false;
+  }
+  char line[1024];
+  while (fgets(line, sizeof(line), file) != nullptr) {
+    char name[512];
+    double ns_per_call;
+    if (sscanf(line, " {\"name\": \"%511[^\"]\", \"ns_per_call\": %lf", name,
+               &ns_per_call) == 2) {
+      (*baseline)[name] = ns_per_call;
+    }
+  }
+  fclose(file);
+  return true;
+}
+
+// Prints how each result compares with |baseline| and returns the number
+// slower than it by more than |tolerance|.
+int CompareWithBaseline(const std::map<std::string, double>& baseline,
+                        double tolerance) {
+  int regressions = 0;
+  int compared = 0;
+  printf("\n%-48s %14s %14s %8s\n", "compared with baseline", "baseline ns",
+         "ns", "change");
+  for (const Result& result : Results()) {
+    auto it = baseline.find(result.name);
+    if (it == baseline.end() || it->second <= 0) {
+      printf("%-48s %14s %14.1f %8s\n", result.name.c_str(), "-",
+             result.ns_per_call, "new");
+      continue;
+    }
+    compared++;
+    double change = result.ns_per_call / it->second - 1;
+    bool regressed = change > tolerance;
+    regressions += regressed;
+    printf("%-48s %14.1f %14.1f %+7.1f%%%s\n", result.name.c_str(),
+           it->second, result.ns_per_call, change * 100,
+           regressed ? "  REGRESSION" : "");
+  }
+  printf("%d of %d results slower than the baseline by more than %.0f%%\n",
+         regressions, compared, tolerance * 100);
+  return regressions;
+}
+
+}  // namespace
+
+bool RegisterCase(const char* name, CaseFn fn) {
+  Cases().push_back({name, fn});
+  return true;
+}
+
+void Report(const std::string& name, double ns_per_call, double items) {
+  double items_per_second = items * 1e9 / ns_per_call;
+  printf("%-48s %14.1f ns/call %14.3f M items/s\n", name.c_str(), ns_per_call,
+         items_per_second / 1e6);
+  fflush(stdout);
+  for (Result& result : Results()) {
+    if (result.name == name) {
+      if (ns_per_call < result.ns_per_call) {
+        result = {name, ns_per_call, items_per_second};
+      }
+      return;
+    }
+  }
+  Results().push_back({name, ns_per_call, items_per_second});
+}
+
+void Note(const std::string& name, const std::string& value) {
+  printf("%-48s %s\n", name.c_str(), value.c_str());
+  fflush(stdout);
+  for (NoteResult& note : Notes()) {
+    if (note.name == name) {
+      note.value = value;
+      return;
+    }
+  }
+  Notes().push_back({name, value});
+}
+
+}  // namespace bench
+
+int main(int argc, char** argv) {
+  const char* json_path = nullptr;
+  const char* baseline_path = nullptr;
+  double tolerance = 0.25;
+  int repetitions = 1;
+  std::vector<const char*> filters;
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], "--json=", 7) == 0) {
+      json_path = argv[i] + 7;
+    } else if (strncmp(argv[i], "--baseline=", 11) == 0) {
+      baseline_path = argv[i] + 11;
+    } else if (strncmp(argv[i], "--tolerance=", 12) == 0) {
+      tolerance = atof(argv[i] + 12);
+    } else if (strncmp(argv[i], "--repetitions=", 14) == 0) {
+      repetitions = atoi(argv[i] + 14);
+    } else {
+      filters.push_back(argv[i]);
+    }
+  }
+
+  // Read the baseline first, so a bad path fails before the long run.
+  std::map<std::string, double> baseline;
+  if (baseline_path != nullptr &&
+      !bench::ReadBaseline(baseline_path, &baseline)) {
+    fprintf(stderr, "Failed to read baseline %s: %s\n", baseline_path,
+            strerror(errno));
+    return 2;
+  }
+
+  for (int repetition = 0; repetition < repetitions; repetition++) {
+    for (const bench::Case& c : bench::Cases()) {
+      bool selected = filters.empty();
+      for (size_t i = 0; i < filters.size() && !selected; i++) {
+        selected = strstr(c.name, filters[i]) != nullptr;
+      }
+      if (selected) {
+        c.fn();
+      }
+    }
+  }
+
+  if (json_path != nullptr && !bench::WriteJson(json_path)) {
+    fprintf(stderr, "Failed to write %s: %s\n", json_path, strerror(errno));
+    return 2;
+  }
+  if (baseline_path != nullptr &&
+      bench::CompareWithBaseline(baseline, tolerance) > 0) {
+    return 1;
+  }
+  return 0;
+}
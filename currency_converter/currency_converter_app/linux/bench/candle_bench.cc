@@ -0,0 +1,130 @@
+// Candles over a year of history: the first, parallel read of a pair, then
+// requests served from the cached rollups, and live quotes extending them.
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "engine/conversion_engine.h"
+#include "engine/history_writer.h"
+
+namespace {
+
+constexpr int64_t kMinuteMs = converter::kCandleMinuteMs;
+constexpr int64_t kYearMinutes = 365 * 24 * 60;
+constexpr int64_t kStartMs = 1672531200000;  // 2023-01-01T00:00:00Z
+constexpr int kTicksPerMinute = 4;
+
+// A year of EUR/USD quotes at irregular gaps averaging a quarter minute.
+converter::TickColumns YearTicks(uint32_t pair) {
+  converter::TickColumns ticks;
+  ticks.resize(kYearMinutes * kTicksPerMinute);
+  std::mt19937_64 rng(23);
+  std::uniform_int_distribution<int64_t> gap(1, 2 * kMinuteMs / kTicksPerMinute);
+  std::uniform_int_distribution<int> pips(-3, 3);
+  int64_t timestamp = kStartMs;
+  int64_t rate = 108345;  // In units of 10^-5.
+  for (size_t i = 0; i < ticks.size(); i++) {
+    timestamp += gap(rng);
+    rate += pips(rng);
+    ticks.timestamps[i] = timestamp;
+    ticks.pairs[i] = pair;
+    ticks.rates[i] = rate * 10000000;
+  }
+  return ticks;
+}
+
+}  // namespace
+
+BENCH_CASE(candles) {
+  uint32_t pair = converter::PackPair(converter::FindCurrency("EUR"),
+                                      converter::FindCurrency("USD"));
+  converter::TickColumns ticks = YearTicks(pair);
+  char path[] = "/tmp/currency_converter_candles_XXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0) {
+    perror("mkstemp");
+    return;
+  }
+  close(fd);
+  if (!converter::WriteHistoryFile(ticks, path)) {
+    perror("WriteHistoryFile");
+    unlink(path);
+    return;
+  }
+  converter::ConversionEngine engine;
+  engine.history().Open(path);
+  converter::CandleStore& store = engine.candles();
+  int64_t begin = kStartMs;
+  int64_t end = ticks.timestamps.back() + 1;
+  std::vector<converter::Candle> candles;
+
+  // The first request for a pair reads its history, on one thread and then
+  // split across the pool.
+  for (converter::ThreadPool* pool :
+       {static_cast<converter::ThreadPool*>(nullptr),
+        &converter::ThreadPool::Get()}) {
+    engine.set_thread_pool(pool);
+    double ns = bench::TimeNs([&] {
+      store.Reset();
+      store.Candles(pair, begin, end,
+                    converter::CandleInterval::Fixed(kMinuteMs), &candles);
+    });
+    bench::Report(std::string("candles/first_read/") +
+                      (pool == nullptr ? "serial" : "pool"),
+                  ns, static_cast<double>(ticks.size()));
+  }
+
+  struct Width {
+    const char* name;
+    converter::CandleInterval interval;
+  };
+  const Width widths[] = {
+      {"1m", converter::CandleInterval::Fixed(kMinuteMs)},
+      {"15m", converter::CandleInterval::Fixed(15 * kMinuteMs)},
+      {"1h", converter::CandleInterval::Fixed(60 * kMinuteMs)},
+      {"4h", converter::CandleInterval::Fixed(240 * kMinuteMs)},
+      {"1d", converter::CandleInterval::Fixed(1440 * kMinuteMs)},
+      {"1M", converter::CandleInterval::Months(1)},
+  };
+  for (const Width& width : widths) {
+    double ns = bench::TimeNs([&] {
+      store.Candles(pair, begin, end, width.interval, &candles);
+      bench::DoNotOptimize(candles.data());
+    });
+    bench::Report(std::string("candles/year/") + width.name, ns,
+                  static_cast<double>(candles.size()));
+  }
+
+  // Live quotes continuing the history, a feed batch at a time.
+  constexpr size_t kBatch = 64;
+  converter::TickColumns live;
+  live.resize(kBatch);
+  int64_t timestamp = ticks.timestamps.back();
+  int64_t rate = ticks.rates.back();
+  bench::Report("candles/live_append",
+                bench::TimeNs([&] {
+                  for (size_t i = 0; i < kBatch; i++) {
+                    timestamp += 250;
+                    rate += (i % 7 - 3) * 10000000;
+                    live.timestamps[i] = timestamp;
+                    live.pairs[i] = pair;
+                    live.rates[i] = rate;
+                  }
+                  store.Append(live);
+                }),
+                kBatch);
+  // The last hour of minute candles, as a chart polls for after each update.
+  bench::Report("candles/last_hour/1m", bench::TimeNs([&] {
+                  store.Candles(pair, timestamp - 60 * kMinuteMs, timestamp + 1,
+                                converter::CandleInterval::Fixed(kMinuteMs),
+                                &candles);
+                  bench::DoNotOptimize(candles.data());
+                }));
+  unlink(path);
+}
@@ -0,0 +1,83 @@
+// Measures what a platform-channel call costs natively (standard codec
+// encoding and decoding on both sides plus the engine work) for single and
+// batched conversions, and derives the batch size at which one batch call
+// beats that many single calls.
+
+#include <flutter_linux/flutter_linux.h>
+
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "engine/conversion_engine.h"
+
+namespace {
+
+// Encodes |value| with |codec| and decodes it again, as happens for every
+// message crossing the channel.
+void RoundTrip(FlMessageCodec* codec, FlValue* value) {
+  g_autoptr(GBytes) message =
+      fl_message_codec_encode_message(codec, value, nullptr);
+  g_autoptr(FlValue) decoded =
+      fl_message_codec_decode_message(codec, message, nullptr);
+  bench::DoNotOptimize(decoded);
+}
+
+}  // namespace
+
+BENCH_CASE(channel_crossover) {
+  g_autoptr(FlStandardMessageCodec) standard_codec =
+      fl_standard_message_codec_new();
+  FlMessageCodec* codec = FL_MESSAGE_CODEC(standard_codec);
+  converter::ConversionEngine engine;
+  converter::CurrencyId usd = converter::FindCurrency("USD");
+  converter::CurrencyId inr = converter::FindCurrency("INR");
+
+  double single_ns = bench::TimeNs([&] {
+    g_autoptr(FlValue) request = fl_value_new_map();
+    fl_value_set_string_take(request, "amount", fl_value_new_string("1234.56"));
+    fl_value_set_string_take(request, "from", fl_value_new_string("USD"));
+    fl_value_set_string_take(request, "to", fl_value_new_string("INR"));
+    RoundTrip(codec, request);
+
+    int64_t minor;
+    engine.ConvertText("1234.56", usd, inr, &minor);
+
+    g_autoptr(FlValue) response = fl_value_new_map();
+    fl_value_set_string_take(response, "minor", fl_value_new_int(minor));
+    fl_value_set_string_take(response, "minorUnits", fl_value_new_int(2));
+    fl_value_set_string_take(response, "value",
+                             fl_value_new_float(minor / 100.0));
+    RoundTrip(codec, response);
+  });
+  bench::Report("channel_crossover/single_call", single_ns);
+
+  size_t crossover = 0;
+  for (size_t count = 1; count <= 65536; count *= 2) {
+    std::vector<double> amounts(count, 1234.56);
+    std::vector<double> results(count);
+    double batch_ns = bench::TimeNs([&] {
+      g_autoptr(FlValue) request = fl_value_new_map();
+      fl_value_set_string_take(request, "amounts",
+                               fl_value_new_float_list(amounts.data(), count));
+      fl_value_set_string_take(request, "from", fl_value_new_string("USD"));
+      fl_value_set_string_take(request, "to", fl_value_new_string("INR"));
+      RoundTrip(codec, request);
+
+      engine.ConvertBatch(amounts.data(), count, usd, inr, results.data());
+
+      g_autoptr(FlValue) response =
+          fl_value_new_float_list(results.data(), count);
+      RoundTrip(codec, response);
+    });
+    bench::Report("channel_crossover/batch/" + std::to_string(count),
+                  batch_ns, count);
+    if (crossover == 0 && batch_ns < single_ns * count) {
+      crossover = count;
+    }
+  }
+  // The real per-call cost also includes the Dart side and a thread hop, so
+  // batching pays off at or before this size in the running app.
+  bench::Note("channel_crossover/batch_wins_from",
+              crossover == 0 ? "never" : std::to_string(crossover));
+}
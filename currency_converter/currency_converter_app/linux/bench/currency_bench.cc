@@ -0,0 +1,71 @@
+// Currency code lookup: the compile-time perfect hash against the usual
+// hash map and the sorted-table search it replaced.
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "bench.h"
+#include "engine/currency.h"
+
+BENCH_CASE(currency_lookup) {
+  size_t count = converter::CurrencyCount();
+  std::vector<std::string_view> codes(count);
+  std::unordered_map<std::string, converter::CurrencyId> map;
+  for (size_t i = 0; i < count; i++) {
+    codes[i] = converter::GetCurrency(i).code;
+    map.emplace(codes[i], static_cast<converter::CurrencyId>(i));
+  }
+
+  // A random mix, with one unknown code in eight, so that neither the
+  // branch predictor nor the cache sees a pattern.
+  constexpr size_t kQueries = 4096;
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<size_t> pick(0, count - 1);
+  std::vector<std::string_view> queries(kQueries);
+  for (size_t i = 0; i < kQueries; i++) {
+    queries[i] = i % 8 == 7 ? std::string_view("QQQ") : codes[pick(rng)];
+  }
+
+  bench::Report("currency_lookup/perfect_hash",
+                bench::TimeNs([&] {
+                  unsigned sum = 0;
+                  for (std::string_view code : queries) {
+                    sum += converter::FindCurrency(code);
+                  }
+                  bench::DoNotOptimize(sum);
+                }),
+                kQueries);
+
+  // Callers hold string_views, and C++17 maps have no heterogeneous lookup,
+  // so each find builds a key string; short-string optimisation keeps that
+  // off the heap.
+  bench::Report("currency_lookup/unordered_map",
+                bench::TimeNs([&] {
+                  unsigned sum = 0;
+                  for (std::string_view code : queries) {
+                    auto it = map.find(std::string(code));
+                    sum += it == map.end() ? converter::kInvalidCurrency
+                                           : it->second;
+                  }
+                  bench::DoNotOptimize(sum);
+                }),
+                kQueries);
+
+  bench::Report("currency_lookup/binary_search",
+                bench::TimeNs([&] {
+                  unsigned sum = 0;
+                  for (std::string_view code : queries) {
+                    auto it = std::lower_bound(codes.begin(), codes.end(),
+                                               code);
+                    sum += it == codes.end() || *it != code
+                               ? converter::kInvalidCurrency
+                               : it - codes.begin();
+                  }
+                  bench::DoNotOptimize(sum);
+                }),
+                kQueries);
+}
@@ -0,0 +1,90 @@
+// An amount, or many, in every currency: one fan-out call against a
+// Convert per currency, and the blocked fan-out against a ConvertBatch per
+// currency, which streams the whole amount list once for each.
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "engine/conversion_engine.h"
+
+BENCH_CASE(fan_out) {
+  converter::ConversionEngine engine;
+  converter::CurrencyId usd = converter::FindCurrency("USD");
+  size_t currencies = converter::CurrencyCount();
+  std::vector<converter::CurrencyId> targets(currencies);
+  for (size_t t = 0; t < currencies; t++) {
+    targets[t] = static_cast<converter::CurrencyId>(t);
+  }
+
+  int64_t amount = 123456;
+  std::vector<int64_t> single_out(currencies);
+  bench::Report("fan_out/single/per_currency", bench::TimeNs([&] {
+                  for (size_t t = 0; t < currencies; t++) {
+                    engine.Convert(amount, usd, targets[t], &single_out[t]);
+                  }
+                  bench::DoNotOptimize(single_out[0]);
+                }),
+                currencies);
+  bench::Report("fan_out/single/all", bench::TimeNs([&] {
+                  engine.ConvertToAll(&amount, 1, usd, targets.data(),
+                                      currencies,
+                                      converter::FanOutOrder::kAsGiven,
+                                      single_out.data());
+                  bench::DoNotOptimize(single_out[0]);
+                }),
+                currencies);
+  bench::Report("fan_out/single/all_by_value", bench::TimeNs([&] {
+                  engine.ConvertToAll(&amount, 1, usd, targets.data(),
+                                      currencies,
+                                      converter::FanOutOrder::kValue,
+                                      single_out.data());
+                  bench::DoNotOptimize(single_out[0]);
+                }),
+                currencies);
+
+  std::mt19937_64 rng(42);
+  std::uniform_real_distribution<double> dist(0.01, 1000000.0);
+  for (size_t count : {size_t{1000}, size_t{100000}}) {
+    std::string suffix = "/" + std::to_string(count);
+    std::vector<double> amounts(count);
+    for (double& value : amounts) {
+      value = dist(rng);
+    }
+    std::vector<double> out(count * currencies);
+    bench::Report("fan_out/double/per_currency" + suffix,
+                  bench::TimeNs([&] {
+                    for (size_t t = 0; t < currencies; t++) {
+                      engine.ConvertBatch(amounts.data(), count, usd,
+                                          targets[t], out.data() + t * count);
+                    }
+                    bench::DoNotOptimize(out[0]);
+                  }),
+                  count * currencies);
+    bench::Report("fan_out/double/all" + suffix,
+                  bench::TimeNs([&] {
+                    engine.ConvertToAll(amounts.data(), count, usd,
+                                        targets.data(), currencies,
+                                        converter::FanOutOrder::kAsGiven,
+                                        out.data());
+                    bench::DoNotOptimize(out[0]);
+                  }),
+                  count * currencies);
+
+    std::vector<int64_t> minor(count);
+    for (size_t i = 0; i < count; i++) {
+      minor[i] = static_cast<int64_t>(amounts[i] * 100);
+    }
+    std::vector<int64_t> minor_out(count * currencies);
+    bench::Report("fan_out/int64/all" + suffix,
+                  bench::TimeNs([&] {
+                    engine.ConvertToAll(minor.data(), count, usd,
+                                        targets.data(), currencies,
+                                        converter::FanOutOrder::kAsGiven,
+                                        minor_out.data());
+                    bench::DoNotOptimize(minor_out[0]);
+                  }),
+                  count * currencies);
+  }
+}
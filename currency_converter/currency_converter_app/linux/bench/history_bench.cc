@@ -0,0 +1,226 @@
+// Opening, point-in-time lookups and range scans on a year of ticks, for the
+// raw and the compressed block encodings.
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "engine/conversion_engine.h"
+#include "engine/history_writer.h"
+#include "engine/kernels.h"
+
+namespace {
+
+constexpr int64_t kMinuteMs = 60 * 1000;
+constexpr int64_t kYearMinutes = 365 * 24 * 60;
+constexpr int64_t kStartMs = 1672531200000;  // 2023-01-01T00:00:00Z
+
+// One random-walk quote per minute for |currencies| USD pairs.
+converter::TickColumns MinuteTicks(size_t currencies) {
+  converter::TickColumns ticks;
+  ticks.resize(currencies * kYearMinutes);
+  std::mt19937_64 rng(11);
+  std::normal_distribution<double> step(0, 2e-4);
+  size_t i = 0;
+  converter::CurrencyId usd = converter::FindCurrency("USD");
+  for (size_t c = 0; c < currencies; c++) {
+    converter::CurrencyId currency = static_cast<converter::CurrencyId>(c);
+    if (currency == usd) {
+      currency = static_cast<converter::CurrencyId>(currencies);
+    }
+    double rate = 1.0;
+    for (int64_t minute = 0; minute < kYearMinutes; minute++, i++) {
+      rate *= 1 + step(rng);
+      ticks.timestamps[i] = kStartMs + minute * kMinuteMs;
+      ticks.pairs[i] = converter::PackPair(usd, currency);
+      ticks.rates[i] = static_cast<int64_t>(rate * 1e12);
+    }
+  }
+  return ticks;
+}
+
+// Quotes shaped like a live feed for one pair: five decimal places, moves
+// of a few pips, and irregular gaps averaging a quarter of a second.
+converter::TickColumns FeedTicks(size_t count) {
+  converter::TickColumns ticks;
+  ticks.resize(count);
+  std::mt19937_64 rng(13);
+  std::exponential_distribution<double> gap(1 / 250.0);
+  std::uniform_int_distribution<int> pips(-3, 3);
+  uint32_t pair = converter::PackPair(converter::FindCurrency("EUR"),
+                                      converter::FindCurrency("USD"));
+  int64_t timestamp = kStartMs;
+  int64_t rate = 108345;  // In units of 10^-5.
+  for (size_t i = 0; i < count; i++) {
+    timestamp += 1 + static_cast<int64_t>(gap(rng));
+    rate += pips(rng);
+    ticks.timestamps[i] = timestamp;
+    ticks.pairs[i] = pair;
+    ticks.rates[i] = rate * 10000000;
+  }
+  return ticks;
+}
+
+const char* EncodingName(converter::history::BlockEncoding encoding) {
+  return encoding == converter::history::BlockEncoding::kRaw ? "raw"
+                                                             : "packed";
+}
+
+// Writes |ticks| to a new temporary file. Returns its size, or 0 on failure.
+size_t WriteTemporary(const converter::TickColumns& ticks,
+                      converter::history::BlockEncoding encoding, char* path) {
+  int fd = mkstemp(path);
+  if (fd < 0) {
+    perror("mkstemp");
+    return 0;
+  }
+  close(fd);
+  if (!converter::WriteHistoryFile(ticks, path, encoding)) {
+    perror("WriteHistoryFile");
+    unlink(path);
+    return 0;
+  }
+  struct stat info;
+  return stat(path, &info) == 0 ? info.st_size : 0;
+}
+
+// Reports the file size relative to 16 bytes per tick and the speed of a
+// full scan, in bytes of decoded ticks per second.
+void ScanCase(const std::string& name, const converter::TickColumns& ticks) {
+  uint32_t pair = ticks.pairs[0];
+  for (auto encoding : {converter::history::BlockEncoding::kRaw,
+                        converter::history::BlockEncoding::kDeltaPacked}) {
+    std::string label = name + "/" + EncodingName(encoding);
+    char path[] = "/tmp/currency_converter_history_XXXXXX";
+    size_t size = WriteTemporary(ticks, encoding, path);
+    if (size == 0) {
+      continue;
+    }
+    converter::HistoryStore store;
+    store.Open(path);
+    char ratio[32];
+    snprintf(ratio, sizeof(ratio), "%.2fx",
+             16.0 * ticks.size() / static_cast<double>(size));
+    bench::Note(label + "/compression", ratio);
+
+    std::vector<int64_t> timestamps;
+    std::vector<int64_t> rates;
+    timestamps.reserve(ticks.size());
+    rates.reserve(ticks.size());
+    double ns = bench::TimeNs([&] {
+      timestamps.clear();
+      rates.clear();
+      store.ReadRange(pair, INT64_MIN, INT64_MAX, &timestamps, &rates);
+    });
+    bench::Report(label + "/scan", ns, static_cast<double>(ticks.size()));
+    char rate[32];
+    snprintf(rate, sizeof(rate), "%.2f GB/s", 16.0 * ticks.size() / ns);
+    bench::Note(label + "/scan_bandwidth", rate);
+
+    // The same scan straight after the file was opened with none of it in
+    // the page cache, as for a history nobody has read since boot. This is
+    // where the smaller encoding pays off.
+    int fd = open(path, O_RDONLY);
+    ns = bench::TimeNs([&] {
+      store.Close();
+      fdatasync(fd);
+      posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+      store.Open(path);
+      timestamps.clear();
+      rates.clear();
+      store.ReadRange(pair, INT64_MIN, INT64_MAX, &timestamps, &rates);
+    });
+    close(fd);
+    bench::Report(label + "/cold_scan", ns, static_cast<double>(ticks.size()));
+    unlink(path);
+  }
+}
+
+}  // namespace
+
+BENCH_CASE(history_scan) {
+  converter::TickColumns minutes = MinuteTicks(1);
+  ScanCase("history_scan/random_walk", minutes);
+  converter::TickColumns feed = FeedTicks(size_t{1} << 22);
+  ScanCase("history_scan/feed", feed);
+
+  // The decode kernels alone, on one frame's worth of packed values.
+  std::mt19937_64 rng(17);
+  std::vector<uint64_t> packed(64 * 2);
+  for (uint64_t& word : packed) {
+    word = rng();
+  }
+  std::vector<int64_t> out(64);
+  for (auto level : {converter::KernelLevel::kScalar,
+                     converter::KernelLevel::kAvx2}) {
+    const converter::ConversionKernels* kernels =
+        converter::GetKernels(level);
+    if (kernels == nullptr) {
+      continue;
+    }
+    for (int width : {4, 12, 29}) {
+      double ns = bench::TimeNs([&] {
+        kernels->unpack_delta(packed.data(), width, 63, 1, 1, out.data());
+        bench::DoNotOptimize(out[62]);
+      });
+      bench::Report(std::string("history_scan/decode/") + kernels->name +
+                        "/bits=" + std::to_string(width),
+                    ns, 63);
+    }
+  }
+}
+
+BENCH_CASE(history) {
+  constexpr size_t kCurrencies = 20;
+  char path[] = "/tmp/currency_converter_history_XXXXXX";
+  if (WriteTemporary(MinuteTicks(kCurrencies),
+                     converter::history::BlockEncoding::kDeltaPacked,
+                     path) == 0) {
+    return;
+  }
+
+  converter::ConversionEngine engine;
+  bench::Report("history/open", bench::TimeNs([&] {
+                  engine.history().Open(path);
+                }));
+
+  std::mt19937_64 rng(5);
+  std::uniform_int_distribution<int64_t> when(kStartMs,
+                                              kStartMs + kYearMinutes * kMinuteMs);
+  std::uniform_int_distribution<int> currency(0, kCurrencies - 1);
+  constexpr size_t kQueries = 1 << 16;
+  std::vector<int64_t> times(kQueries);
+  std::vector<converter::CurrencyId> currencies(kQueries);
+  for (size_t i = 0; i < kQueries; i++) {
+    times[i] = when(rng);
+    currencies[i] = static_cast<converter::CurrencyId>(currency(rng));
+  }
+
+  converter::CurrencyId usd = converter::FindCurrency("USD");
+  size_t q = 0;
+  bench::Report("history/rate_at", bench::TimeNs([&] {
+                  converter::HistoryPoint point;
+                  engine.history().RateAt(
+                      converter::PackPair(usd, currencies[q]), times[q],
+                      &point);
+                  bench::DoNotOptimize(point);
+                  q = (q + 1) % kQueries;
+                }));
+  bench::Report("history/convert_at", bench::TimeNs([&] {
+                  int64_t out;
+                  engine.ConvertAt(12345, currencies[q],
+                                   currencies[(q + 1) % kQueries], times[q],
+                                   &out);
+                  bench::DoNotOptimize(out);
+                  q = (q + 1) % kQueries;
+                }));
+  unlink(path);
+}
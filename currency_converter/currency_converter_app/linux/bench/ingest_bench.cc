@@ -0,0 +1,69 @@
+// Tick-file parsing throughput in GB/s by thread count.
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+
+#include "bench.h"
+#include "engine/fixed_point.h"
+#include "engine/tick_csv.h"
+
+namespace {
+
+// Builds roughly |bytes| of "timestamp,pair,rate" lines over a handful of
+// majors, in the shape a market-data recorder writes them.
+std::string SyntheticTicks(size_t bytes) {
+  static const char* const kPairs[] = {"EURUSD", "USDJPY", "GBPUSD",
+                                       "USDINR", "AUDUSD", "USD/CHF"};
+  std::mt19937_64 rng(7);
+  std::uniform_int_distribution<int> pair(0, 5);
+  std::uniform_int_distribution<int64_t> rate(500000, 1500000);
+  std::string text = "timestamp,pair,rate\n";
+  text.reserve(bytes + 64);
+  int64_t timestamp = 1700000000000;
+  char line[96];
+  char rate_text[32];
+  while (text.size() < bytes) {
+    timestamp += 1 + rng() % 5;
+    size_t rate_size =
+        converter::FormatScaledDecimal(rate(rng), 5, rate_text);
+    rate_text[rate_size] = '\0';
+    int size = snprintf(line, sizeof(line), "%lld,%s,%s\n",
+                        static_cast<long long>(timestamp), kPairs[pair(rng)],
+                        rate_text);
+    text.append(line, size);
+  }
+  return text;
+}
+
+}  // namespace
+
+BENCH_CASE(ingest) {
+  const std::string text = SyntheticTicks(size_t{256} << 20);
+  unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+  converter::TickColumns columns;
+  for (unsigned threads = 1; threads <= cores; threads *= 2) {
+    converter::TickIngestStats stats;
+    double ns = bench::TimeNs(
+        [&] {
+          columns.clear();
+          stats = converter::TickIngestStats();
+          converter::ParseTicks(text, threads, &columns, &stats);
+        },
+        1.0);
+    bench::Report("ingest/threads=" + std::to_string(threads), ns,
+                  static_cast<double>(stats.rows));
+    char rate[32];
+    snprintf(rate, sizeof(rate), "%.2f GB/s", text.size() / ns);
+    bench::Note("ingest/threads=" + std::to_string(threads) + "/bandwidth",
+                rate);
+    if (stats.rejected != 0) {
+      bench::Note("ingest/rejected", std::to_string(stats.rejected));
+    }
+    if (threads < cores && threads * 2 > cores) {
+      threads = cores / 2;
+    }
+  }
+}
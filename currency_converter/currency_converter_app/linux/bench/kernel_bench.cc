@@ -0,0 +1,71 @@
+// Throughput of each compiled-in kernel level on large arrays, checked
+// against the scalar results.
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "engine/conversion_engine.h"
+#include "engine/kernels.h"
+
+BENCH_CASE(kernels) {
+  constexpr size_t kCount = 1 << 20;
+  converter::RateTable rates;
+  converter::PairFactors factors;
+  converter::ConversionEngine::PrepareFactors(
+      rates, converter::FindCurrency("USD"), converter::FindCurrency("INR"),
+      &factors);
+
+  std::mt19937_64 rng(7);
+  std::uniform_int_distribution<int64_t> minor_dist(-100000000, 100000000);
+  std::uniform_real_distribution<double> major_dist(-1000000.0, 1000000.0);
+  std::vector<int64_t> minor(kCount);
+  std::vector<double> major(kCount);
+  for (size_t i = 0; i < kCount; i++) {
+    minor[i] = minor_dist(rng);
+    major[i] = major_dist(rng);
+  }
+
+  const converter::ConversionKernels* scalar =
+      converter::GetKernels(converter::KernelLevel::kScalar);
+  std::vector<int64_t> minor_expected(kCount);
+  std::vector<double> major_expected(kCount);
+  scalar->convert_fixed(minor.data(), kCount, factors.cross_rate,
+                        factors.divisor_digits, minor_expected.data());
+  scalar->convert_double(major.data(), kCount, factors.minor_rate,
+                         factors.minor_scale, major_expected.data());
+
+  for (converter::KernelLevel level :
+       {converter::KernelLevel::kScalar, converter::KernelLevel::kSse42,
+        converter::KernelLevel::kAvx2}) {
+    const converter::ConversionKernels* kernels = converter::GetKernels(level);
+    if (kernels == nullptr) {
+      continue;
+    }
+    std::string prefix = std::string("kernels/") + kernels->name;
+
+    std::vector<int64_t> minor_out(kCount);
+    bench::Report(prefix + "/fixed", bench::TimeNs([&] {
+                    kernels->convert_fixed(minor.data(), kCount,
+                                           factors.cross_rate,
+                                           factors.divisor_digits,
+                                           minor_out.data());
+                    bench::DoNotOptimize(minor_out[0]);
+                  }),
+                  kCount);
+    std::vector<double> major_out(kCount);
+    bench::Report(prefix + "/double", bench::TimeNs([&] {
+                    kernels->convert_double(major.data(), kCount,
+                                            factors.minor_rate,
+                                            factors.minor_scale,
+                                            major_out.data());
+                    bench::DoNotOptimize(major_out[0]);
+                  }),
+                  kCount);
+
+    if (minor_out != minor_expected || major_out != major_expected) {
+      bench::Note(prefix + "/mismatch", "results differ from scalar");
+    }
+  }
+}
@@ -0,0 +1,44 @@
+// Native time spent per frame on live-as-you-type conversion: a burst of
+// keystrokes across the input fields of a page, coalesced and then flushed
+// once. The frame budget for this work is 2 ms.
+
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "engine/conversion_engine.h"
+#include "engine/live_conversion.h"
+
+BENCH_CASE(live_frame) {
+  converter::ConversionEngine engine;
+  converter::LiveConversions live(&engine);
+  const converter::NumberFormat* format =
+      &converter::NumberFormatForLocale("en_IN");
+  converter::CurrencyId usd = converter::FindCurrency("USD");
+  converter::CurrencyId inr = converter::FindCurrency("INR");
+
+  // The text of a field after each keystroke of "12,34,567.89".
+  const std::string typed = "12,34,567.89";
+  std::vector<std::string> prefixes;
+  for (size_t i = 1; i <= typed.size(); i++) {
+    prefixes.push_back(typed.substr(0, i));
+  }
+
+  std::vector<converter::LiveResult> results;
+  for (uint32_t fields : {1u, 4u}) {
+    int64_t sequence = 0;
+    double ns = bench::TimeNs([&] {
+      for (const std::string& text : prefixes) {
+        for (uint32_t field = 0; field < fields; field++) {
+          live.Update({field, ++sequence, text, usd, inr, format});
+        }
+      }
+      results.clear();
+      live.Flush(&results);
+      bench::DoNotOptimize(results[0].minor);
+    });
+    std::string name = "live_frame/" + std::to_string(fields) + "_fields";
+    bench::Report(name, ns, prefixes.size() * fields);
+    bench::Note(name + "/within_2ms_budget", ns < 2e6 ? "yes" : "no");
+  }
+}
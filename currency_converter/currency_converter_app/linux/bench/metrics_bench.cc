@@ -0,0 +1,48 @@
+// Cost of recording latencies and counts on the hot path, and of merging
+// them for a scrape.
+
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "engine/metrics.h"
+
+BENCH_CASE(metrics) {
+  converter::Metrics& metrics = converter::Metrics::Get();
+  converter::MetricId latency =
+      metrics.Register(converter::MetricKind::kLatency,
+                       "bench_latency_seconds", "Benchmark latency.", "");
+  converter::MetricId counter =
+      metrics.Register(converter::MetricKind::kCounter, "bench_events_total",
+                       "Benchmark events.", "");
+
+  // Spread the values over the buckets of a typical channel call.
+  uint64_t value = 0;
+  bench::Report("metrics/record", bench::TimeNs([&] {
+                  value = (value * 7 + 1013) & 0xfffff;
+                  metrics.Record(latency, value);
+                }));
+  bench::Report("metrics/add", bench::TimeNs([&] { metrics.Add(counter); }));
+  bench::Report("metrics/clock", bench::TimeNs([] {
+                  bench::DoNotOptimize(converter::MetricsClock());
+                }));
+  // What instrumenting a call site costs in all: two clock reads and a
+  // record.
+  bench::Report("metrics/scoped_latency", bench::TimeNs([&] {
+                  converter::ScopedLatency scoped(latency);
+                }));
+
+  // About as many metrics as the application registers.
+  for (int i = 0; i < 40; i++) {
+    converter::MetricId id = metrics.Register(
+        converter::MetricKind::kLatency, "bench_latency_seconds",
+        "Benchmark latency.", "op=\"" + std::to_string(i) + "\"");
+    metrics.Record(id, 1000);
+  }
+  std::string text;
+  bench::Report("metrics/prometheus", bench::TimeNs([&] {
+                  text.clear();
+                  metrics.WritePrometheus(&text);
+                }));
+  bench::Note("metrics/prometheus_bytes", std::to_string(text.size()));
+}
@@ -0,0 +1,54 @@
+// Scaling of large batch conversions across the thread pool.
+
+#include <atomic>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "engine/conversion_engine.h"
+#include "engine/thread_pool.h"
+
+BENCH_CASE(pool) {
+  constexpr size_t kCount = 4 << 20;
+  converter::ConversionEngine engine;
+  converter::CurrencyId usd = converter::FindCurrency("USD");
+  converter::CurrencyId inr = converter::FindCurrency("INR");
+  std::mt19937_64 rng(42);
+  std::uniform_int_distribution<int64_t> dist(1, 100000000);
+  std::vector<int64_t> amounts(kCount);
+  for (int64_t& amount : amounts) {
+    amount = dist(rng);
+  }
+  std::vector<int64_t> out(kCount);
+
+  unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+  double single_ns = 0;
+  for (unsigned threads = 1; threads <= cores; threads *= 2) {
+    converter::ThreadPool pool(threads);
+    engine.set_thread_pool(&pool);
+    double ns = bench::TimeNs([&] {
+      engine.ConvertBatch(amounts.data(), kCount, usd, inr, out.data());
+      bench::DoNotOptimize(out[0]);
+    });
+    std::string suffix = "/threads=" + std::to_string(threads);
+    bench::Report("pool/convert_batch" + suffix, ns, kCount);
+    if (threads == 1) {
+      single_ns = ns;
+    } else {
+      bench::Note("pool/speedup" + suffix, std::to_string(single_ns / ns));
+    }
+    engine.set_thread_pool(nullptr);
+  }
+
+  // Round trip of one empty task, the fixed cost paid per off-thread call.
+  converter::ThreadPool pool(1);
+  bench::Report("pool/submit_wait", bench::TimeNs([&] {
+                  std::atomic<bool> done{false};
+                  pool.Submit([&] { done.store(true); });
+                  while (!done.load()) {
+                    std::this_thread::yield();
+                  }
+                }));
+}
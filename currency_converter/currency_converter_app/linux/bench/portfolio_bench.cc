@@ -0,0 +1,85 @@
+// Portfolio revaluation on a rate tick: the incremental per-currency
+// aggregates against re-summing every position.
+
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "engine/conversion_engine.h"
+#include "engine/fixed_point.h"
+#include "engine/portfolio.h"
+#include "engine/rate_table.h"
+
+BENCH_CASE(portfolio) {
+  constexpr size_t kPositions = 1000000;
+  converter::CurrencyId eur = converter::FindCurrency("EUR");
+  converter::CurrencyId inr = converter::FindCurrency("INR");
+  size_t currency_count = converter::CurrencyCount();
+
+  converter::RateTable before;
+  converter::RateTable after;
+  after.CopyFrom(before);
+  after.SetBaseRate(eur, before.BaseRate(eur) + 1000000);
+
+  std::mt19937_64 rng(5);
+  std::uniform_int_distribution<int64_t> amount(-100000000, 100000000);
+  std::vector<converter::CurrencyId> currencies(kPositions);
+  std::vector<int64_t> amounts(kPositions);
+  converter::Portfolio portfolio(inr);
+  for (size_t i = 0; i < kPositions; i++) {
+    currencies[i] = static_cast<converter::CurrencyId>(rng() % currency_count);
+    amounts[i] = amount(rng);
+    portfolio.Add(currencies[i], amounts[i]);
+  }
+  portfolio.Revalue(before);
+
+  bool flip = false;
+  converter::RateTick tick = {eur, 0};
+  bench::Report("portfolio/tick_1m_positions", bench::TimeNs([&] {
+                  flip = !flip;
+                  const converter::RateTable& rates = flip ? after : before;
+                  tick.rate = rates.BaseRate(eur);
+                  portfolio.ApplyTicks(rates, &tick, 1);
+                  int64_t total;
+                  portfolio.Total(&total);
+                  bench::DoNotOptimize(total);
+                }));
+  bench::Report("portfolio/refresh_1m_positions", bench::TimeNs([&] {
+                  flip = !flip;
+                  portfolio.Refresh(flip ? after : before);
+                  int64_t total;
+                  portfolio.Total(&total);
+                  bench::DoNotOptimize(total);
+                }));
+
+  // A change of the reporting currency's own rate revalues every currency.
+  converter::RateTable reporting_moved;
+  reporting_moved.CopyFrom(before);
+  reporting_moved.SetBaseRate(inr, before.BaseRate(inr) + 1000000);
+  bench::Report("portfolio/reporting_tick_1m_positions", bench::TimeNs([&] {
+                  flip = !flip;
+                  portfolio.Refresh(flip ? reporting_moved : before);
+                }));
+
+  // The alternative: convert and re-sum every position on each tick.
+  std::vector<converter::PairFactors> factors(currency_count);
+  bench::Report("portfolio/full_scan_1m_positions", bench::TimeNs([&] {
+                  flip = !flip;
+                  const converter::RateTable& rates = flip ? after : before;
+                  for (size_t c = 0; c < currency_count; c++) {
+                    converter::ConversionEngine::PrepareFactors(
+                        rates, static_cast<converter::CurrencyId>(c), inr,
+                        &factors[c]);
+                  }
+                  __int128 total = 0;
+                  for (size_t i = 0; i < kPositions; i++) {
+                    const converter::PairFactors& f = factors[currencies[i]];
+                    int64_t value = 0;
+                    converter::DivRoundHalfEven(
+                        static_cast<__int128>(amounts[i]) * f.cross_rate,
+                        converter::Pow10(f.divisor_digits), &value);
+                    total += value;
+                  }
+                  bench::DoNotOptimize(total);
+                }));
+}
@@ -0,0 +1,167 @@
+// Rate-feed ingestion through a named pipe: the highest tick rate the feed
+// thread sustains, and the cost and coalescing of a 100k ticks/s feed that
+// the UI drains once per 60 Hz frame, with and without arbitrage checks.
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "engine/conversion_engine.h"
+#include "engine/rate_feed.h"
+
+namespace {
+
+// |count| quotes over a handful of USD pairs, one per line, or with
+// |crosses| over cross pairs as well. The rates are random, so crosses
+// keep the arbitrage detector flagging cycles.
+std::string FeedLines(size_t count, bool crosses = false) {
+  static const char* const kPairs[] = {"USDEUR", "USDJPY", "USDGBP",
+                                       "USDINR", "USDAUD", "USDCHF",
+                                       "EURGBP", "EURJPY", "GBPINR",
+                                       "AUDCHF", "EURINR", "JPYINR"};
+  size_t pairs = crosses ? 12 : 6;
+  std::mt19937_64 rng(11);
+  std::string text;
+  char line[64];
+  for (size_t i = 0; i < count; i++) {
+    int size = snprintf(line, sizeof(line), "%zu,%s,%d.%05d\n",
+                        1700000000000 + i, kPairs[rng() % pairs],
+                        static_cast<int>(rng() % 100) + 1,
+                        static_cast<int>(rng() % 100000));
+    text.append(line, size);
+  }
+  return text;
+}
+
+// Writes |text| to the pipe at |path|, |lines_per_second| at a time in 1 ms
+// slices, or as fast as the pipe takes it if 0.
+void Produce(const std::string& path, const std::string& text,
+             size_t lines_per_second) {
+  int fd = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+  size_t lines_per_slice = std::max<size_t>(lines_per_second / 1000, 1);
+  auto next = std::chrono::steady_clock::now();
+  size_t offset = 0;
+  while (offset < text.size()) {
+    size_t end = offset;
+    if (lines_per_second == 0) {
+      end = text.size();
+    } else {
+      for (size_t i = 0; i < lines_per_slice && end < text.size(); i++) {
+        end = text.find('\n', end) + 1;
+      }
+      next += std::chrono::milliseconds(1);
+      std::this_thread::sleep_until(next);
+    }
+    while (offset < end) {
+      ssize_t written = write(fd, text.data() + offset, end - offset);
+      if (written <= 0) {
+        break;
+      }
+      offset += written;
+    }
+  }
+  close(fd);
+}
+
+double ProcessCpuSeconds() {
+  timespec now;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+struct FeedRun {
+  double seconds;
+  // Includes the producer and the simulated UI.
+  double cpu_seconds;
+  size_t frames;
+  converter::RateFeedStats stats;
+};
+
+// Feeds |text| through a fresh feed, taking deltas every 16 ms like a UI,
+// until every tick has been read.
+FeedRun RunFeed(const std::string& text, size_t count, size_t lines_per_second,
+                bool detect_arbitrage = false) {
+  char directory[] = "/tmp/rate_feed_bench_XXXXXX";
+  mkdtemp(directory);
+  std::string path = std::string(directory) + "/feed";
+
+  converter::ConversionEngine engine;
+  converter::RateFeed feed(&engine.rates(),
+                           converter::CreateRateSource("fifo:" + path));
+  converter::ArbitrageDetector detector;
+  if (detect_arbitrage) {
+    detector.SetBaseRates(engine.rates().Read().table());
+    feed.DetectArbitrage(&detector);
+  }
+  std::atomic<int> pending{0};
+  feed.Start([&] { pending++; });
+  // The pipe only exists once the feed thread has opened it.
+  while (access(path.c_str(), F_OK) != 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  double cpu_start = ProcessCpuSeconds();
+  std::thread producer(Produce, path, std::cref(text), lines_per_second);
+  std::vector<converter::RateTick> delta;
+  std::vector<converter::ArbitrageCycle> cycles;
+  FeedRun run = {};
+  while (feed.stats().ticks < count) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(16));
+    feed.TakeDelta(&delta);
+    feed.TakeCycles(&cycles);
+    run.frames++;
+  }
+  run.seconds = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+  run.cpu_seconds = ProcessCpuSeconds() - cpu_start;
+  producer.join();
+  feed.Stop();
+  run.stats = feed.stats();
+  unlink(path.c_str());
+  rmdir(directory);
+  return run;
+}
+
+}  // namespace
+
+BENCH_CASE(rate_feed) {
+  constexpr size_t kCount = 2000000;
+  const std::string text = FeedLines(kCount);
+  FeedRun flood = RunFeed(text, kCount, 0);
+  bench::Report("rate_feed/max_ticks", flood.seconds * 1e9, kCount);
+  bench::Note("rate_feed/max_ticks/versions",
+              std::to_string(flood.stats.versions));
+
+  constexpr size_t kPacedCount = 100000;
+  const std::string paced_text = FeedLines(kPacedCount);
+  FeedRun paced = RunFeed(paced_text, kPacedCount, 100000);
+  bench::Report("rate_feed/100k_per_s", paced.seconds * 1e9, kPacedCount);
+  bench::Note("rate_feed/100k_per_s/versions",
+              std::to_string(paced.stats.versions));
+  bench::Note("rate_feed/100k_per_s/cpu_share",
+              std::to_string(paced.cpu_seconds / paced.seconds));
+  bench::Note("rate_feed/100k_per_s/superseded",
+              std::to_string(paced.stats.superseded));
+  bench::Note("rate_feed/100k_per_s/ui_deltas", std::to_string(paced.frames));
+  bench::Note("rate_feed/100k_per_s/rejected",
+              std::to_string(paced.stats.rejected));
+
+  const std::string cross_text = FeedLines(kPacedCount, true);
+  FeedRun checked = RunFeed(cross_text, kPacedCount, 100000, true);
+  bench::Note("rate_feed/100k_per_s_arbitrage/cpu_share",
+              std::to_string(checked.cpu_seconds / checked.seconds));
+  bench::Note("rate_feed/100k_per_s_arbitrage/versions",
+              std::to_string(checked.stats.versions));
+}
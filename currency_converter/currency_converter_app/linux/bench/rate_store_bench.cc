@@ -0,0 +1,121 @@
+// Reader latency of RateStore snapshots with and without a writer publishing
+// ticks at 10 kHz.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "engine/rate_store.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Runs |reader_count| readers for |duration|, each timing one snapshot plus a
+// few cross-rate lookups per iteration, and returns all samples in ns.
+std::vector<uint32_t> MeasureReaders(converter::RateStore& store,
+                                     size_t reader_count,
+                                     std::chrono::milliseconds duration) {
+  std::atomic<bool> stop{false};
+  std::vector<std::vector<uint32_t>> samples(reader_count);
+  std::vector<std::thread> readers;
+  for (size_t r = 0; r < reader_count; r++) {
+    readers.emplace_back([&, r] {
+      std::mt19937 rng(r);
+      size_t count = converter::CurrencyCount();
+      std::vector<uint32_t>& out = samples[r];
+      out.reserve(1 << 22);
+      while (!stop.load(std::memory_order_relaxed) && out.size() < (1 << 22)) {
+        converter::CurrencyId from = rng() % count;
+        converter::CurrencyId to = rng() % count;
+        Clock::time_point start = Clock::now();
+        {
+          converter::RateStore::Snapshot snapshot = store.Read();
+          int64_t sum = 0;
+          for (int i = 0; i < 4; i++) {
+            int64_t rate;
+            snapshot.table().CrossRate(from, (to + i) % count, &rate);
+            sum += rate;
+          }
+          bench::DoNotOptimize(sum);
+        }
+        out.push_back(static_cast<uint32_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                                 start)
+                .count()));
+      }
+    });
+  }
+  std::this_thread::sleep_for(duration);
+  stop = true;
+  for (std::thread& reader : readers) {
+    reader.join();
+  }
+
+  std::vector<uint32_t> all;
+  for (const std::vector<uint32_t>& s : samples) {
+    all.insert(all.end(), s.begin(), s.end());
+  }
+  std::sort(all.begin(), all.end());
+  return all;
+}
+
+std::string Percentiles(const std::vector<uint32_t>& sorted) {
+  if (sorted.empty()) {
+    return "no samples";
+  }
+  auto at = [&](double q) {
+    return sorted[std::min(sorted.size() - 1,
+                           static_cast<size_t>(q * sorted.size()))];
+  };
+  char buffer[160];
+  snprintf(buffer, sizeof(buffer),
+           "p50 %u ns  p99 %u ns  p99.9 %u ns  max %u ns  (%zu reads)",
+           at(0.5), at(0.99), at(0.999), sorted.back(), sorted.size());
+  return buffer;
+}
+
+}  // namespace
+
+BENCH_CASE(rate_store_stress) {
+  constexpr std::chrono::milliseconds kDuration(500);
+  size_t reader_count = std::max(1u, std::thread::hardware_concurrency() - 1);
+  reader_count = std::min<size_t>(reader_count, 4);
+  converter::RateStore store;
+
+  bench::Note("rate_store_stress/readers_idle_writer",
+              Percentiles(MeasureReaders(store, reader_count, kDuration)));
+
+  std::atomic<bool> stop{false};
+  uint64_t ticks = 0;
+  Clock::duration publish_time{0};
+  std::thread writer([&] {
+    std::mt19937_64 rng(11);
+    Clock::time_point next = Clock::now();
+    while (!stop.load(std::memory_order_relaxed)) {
+      converter::CurrencyId id = rng() % converter::CurrencyCount();
+      int64_t rate = store.Read().table().BaseRate(id);
+      rate += (rate / 1000) * (static_cast<int64_t>(rng() % 3) - 1);
+      Clock::time_point start = Clock::now();
+      store.Publish(id, rate);
+      publish_time += Clock::now() - start;
+      ticks++;
+      next += std::chrono::microseconds(100);
+      std::this_thread::sleep_until(next);
+    }
+  });
+  std::vector<uint32_t> busy = MeasureReaders(store, reader_count, kDuration);
+  stop = true;
+  writer.join();
+
+  bench::Note("rate_store_stress/readers_10khz_writer", Percentiles(busy));
+  bench::Report(
+      "rate_store_stress/publish",
+      std::chrono::duration<double, std::nano>(publish_time).count() / ticks);
+}
@@ -0,0 +1,42 @@
+// Cross-rate matrix lookups and incremental updates on base-rate ticks.
+
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "engine/fixed_point.h"
+#include "engine/rate_table.h"
+
+BENCH_CASE(cross_rates) {
+  converter::RateTable table;
+  size_t count = table.size();
+
+  std::mt19937_64 rng(3);
+  std::vector<converter::CurrencyId> from(4096);
+  std::vector<converter::CurrencyId> to(4096);
+  for (size_t i = 0; i < from.size(); i++) {
+    from[i] = rng() % count;
+    to[i] = rng() % count;
+  }
+  size_t next = 0;
+  bench::Report("cross_rates/lookup", bench::TimeNs([&] {
+                  int64_t rate;
+                  table.CrossRate(from[next], to[next], &rate);
+                  bench::DoNotOptimize(rate);
+                  next = (next + 1) % from.size();
+                }));
+
+  // A tick nudges one base rate by up to +-0.5%.
+  bench::Report("cross_rates/tick_update", bench::TimeNs([&] {
+                  converter::CurrencyId id = rng() % count;
+                  int64_t rate = table.BaseRate(id);
+                  rate += rate / 200 - static_cast<int64_t>(rng() % (rate / 100 + 1));
+                  table.SetBaseRate(id, rate > 0 ? rate : converter::kRateScale);
+                }));
+
+  bench::Report("cross_rates/full_rebuild", bench::TimeNs([&] {
+                  converter::RateTable rebuilt;
+                  bench::DoNotOptimize(rebuilt);
+                }),
+                count * count);
+}
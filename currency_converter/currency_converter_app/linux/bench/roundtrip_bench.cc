@@ -0,0 +1,116 @@
+// Channel calls as the app makes them: a headless Flutter engine runs the
+// Dart side with --channel-benchmark (lib/channel_benchmark.dart), which
+// times calls of the converter channel served here, messenger, codecs and
+// thread hops included, and reports them back on "currency_converter/bench".
+//
+// The engine loads the app from data/ and lib/ next to the executable, which
+// the build links to the bundle; the case is skipped if it is not there.
+
+#include <dlfcn.h>
+#include <flutter_linux/flutter_linux.h>
+
+#include <cstring>
+#include <string>
+
+#include "bench.h"
+#include "converter_channel.h"
+#include "engine/conversion_engine.h"
+
+namespace {
+
+// Longest the Dart side may take before the case gives up.
+constexpr guint kTimeoutSeconds = 300;
+
+// An FlView normally starts the engine, so fl_engine_start() is missing
+// from the public headers. It is looked up at run time, so an engine
+// without it skips the case rather than failing to link.
+using EngineStartFn = gboolean (*)(FlEngine* engine, GError** error);
+
+struct RoundTripState {
+  GMainLoop* loop;
+  bool done;
+};
+
+// Called when the Dart side reports a result or finishes.
+void bench_method_call_cb(FlMethodChannel* channel, FlMethodCall* method_call,
+                          gpointer user_data) {
+  RoundTripState* state = static_cast<RoundTripState*>(user_data);
+  const gchar* method = fl_method_call_get_name(method_call);
+  FlValue* args = fl_method_call_get_args(method_call);
+  if (strcmp(method, "report") == 0 &&
+      fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+    FlValue* name = fl_value_lookup_string(args, "name");
+    FlValue* ns = fl_value_lookup_string(args, "ns");
+    FlValue* items = fl_value_lookup_string(args, "items");
+    if (name != nullptr && ns != nullptr && items != nullptr) {
+      bench::Report(fl_value_get_string(name), fl_value_get_float(ns),
+                    fl_value_get_int(items));
+    }
+  } else if (strcmp(method, "done") == 0) {
+    state->done = true;
+    g_main_loop_quit(state->loop);
+  }
+
+  g_autoptr(GError) error = nullptr;
+  if (!fl_method_call_respond_success(method_call, nullptr, &error)) {
+    g_warning("Failed to send response: %s", error->message);
+  }
+}
+
+gboolean timeout_cb(gpointer user_data) {
+  g_main_loop_quit(static_cast<GMainLoop*>(user_data));
+  return G_SOURCE_REMOVE;
+}
+
+}  // namespace
+
+BENCH_CASE(channel_roundtrip) {
+  EngineStartFn engine_start =
+      reinterpret_cast<EngineStartFn>(dlsym(RTLD_DEFAULT, "fl_engine_start"));
+  if (engine_start == nullptr) {
+    bench::Note("channel_roundtrip",
+                "skipped: the Flutter engine does not export fl_engine_start");
+    return;
+  }
+  g_autoptr(FlDartProject) project = fl_dart_project_new();
+  const gchar* assets = fl_dart_project_get_assets_path(project);
+  if (!g_file_test(assets, G_FILE_TEST_IS_DIR)) {
+    bench::Note("channel_roundtrip",
+                std::string("skipped: no Flutter assets at ") + assets);
+    return;
+  }
+  char argument[] = "--channel-benchmark";
+  char* arguments[] = {argument, nullptr};
+  fl_dart_project_set_dart_entrypoint_arguments(project, arguments);
+
+  g_autoptr(FlEngine) engine = fl_engine_new_headless(project);
+  FlBinaryMessenger* messenger = fl_engine_get_binary_messenger(engine);
+  converter::ConversionEngine conversion_engine;
+  g_autoptr(ConverterChannel) converter_channel =
+      converter_channel_new(messenger, &conversion_engine);
+
+  RoundTripState state = {g_main_loop_new(nullptr, FALSE), false};
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  g_autoptr(FlMethodChannel) channel = fl_method_channel_new(
+      messenger, "currency_converter/bench", FL_METHOD_CODEC(codec));
+  fl_method_channel_set_method_call_handler(channel, bench_method_call_cb,
+                                            &state, nullptr);
+
+  g_autoptr(GError) error = nullptr;
+  if (!engine_start(engine, &error)) {
+    bench::Note("channel_roundtrip",
+                std::string("skipped: engine failed to start: ") +
+                    error->message);
+    g_main_loop_unref(state.loop);
+    return;
+  }
+  guint timeout = g_timeout_add_seconds(kTimeoutSeconds, timeout_cb,
+                                        state.loop);
+  g_main_loop_run(state.loop);
+  if (state.done) {
+    g_source_remove(timeout);
+  } else {
+    bench::Note("channel_roundtrip", "timed out waiting for the Dart side");
+  }
+  g_main_loop_unref(state.loop);
+}
@@ -0,0 +1,81 @@
+// Shared-memory rate ring: cost of publishing a version, and of a reader
+// picking changes up in place while the writer runs on another thread.
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "engine/currency.h"
+#include "engine/shared_rates.h"
+
+BENCH_CASE(shared_rates) {
+  std::string name = "/currency_converter_bench_" + std::to_string(getpid());
+  std::unique_ptr<converter::SharedRatesWriter> writer =
+      converter::SharedRatesWriter::Create(name);
+  std::unique_ptr<converter::SharedRatesReader> reader =
+      converter::SharedRatesReader::Open(name);
+  if (writer == nullptr || reader == nullptr) {
+    bench::Note("shared_rates", "shared memory unavailable");
+    return;
+  }
+
+  // A version of 8 changed currencies, as the rate feed publishes them.
+  std::vector<converter::RateTick> ticks;
+  for (converter::CurrencyId i = 0; i < 8; i++) {
+    ticks.push_back({i, 1000000000000 + i});
+  }
+  uint64_t version = 0;
+  std::vector<converter::RateTick> out;
+  bench::Report("shared_rates/append_8", bench::TimeNs([&] {
+                  writer->Append(ticks.data(), ticks.size(), ++version);
+                }),
+                ticks.size());
+  bench::Report("shared_rates/append_poll_8", bench::TimeNs([&] {
+                  writer->Append(ticks.data(), ticks.size(), ++version);
+                  out.clear();
+                  reader->Poll(&out);
+                  bench::DoNotOptimize(out.data());
+                }),
+                ticks.size());
+  bench::Report("shared_rates/has_new", bench::TimeNs([&] {
+                  bench::DoNotOptimize(reader->has_new());
+                }));
+
+  // Writer and reader on separate threads; the reader counts what it gets
+  // and how often it is lapped.
+  constexpr uint64_t kVersions = 2000000;
+  std::atomic<bool> done{false};
+  std::atomic<uint64_t> received{0};
+  std::vector<int64_t> snapshot;
+  reader->ReadSnapshot(&snapshot);
+  std::thread consumer([&] {
+    std::vector<converter::RateTick> batch;
+    while (!done.load(std::memory_order_relaxed) || reader->has_new()) {
+      batch.clear();
+      reader->Poll(&batch);
+      received.fetch_add(batch.size(), std::memory_order_relaxed);
+    }
+  });
+  double ns = bench::TimeNs(
+      [&] {
+        for (uint64_t i = 0; i < kVersions; i++) {
+          writer->Append(ticks.data(), 1, ++version);
+        }
+      },
+      0);
+  done = true;
+  consumer.join();
+  bench::Report("shared_rates/cross_thread", ns, kVersions);
+  bench::Note("shared_rates/cross_thread/received",
+              std::to_string(received.load()));
+  bench::Note("shared_rates/cross_thread/overruns",
+              std::to_string(reader->overruns()));
+  reader.reset();
+  writer.reset();
+  shm_unlink(name.c_str());
+}
@@ -0,0 +1,43 @@
+// Native work on the path to the first frame: constructing the engine and
+// restoring the warm-start snapshot, against writing it at exit.
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+#include "bench.h"
+#include "engine/conversion_engine.h"
+#include "engine/rate_snapshot.h"
+
+BENCH_CASE(startup) {
+  bench::Report("startup/engine_construct", bench::TimeNs([] {
+                  auto engine = std::make_unique<converter::ConversionEngine>();
+                  bench::DoNotOptimize(engine.get());
+                }));
+
+  char path[] = "/tmp/currency_converter_snapshot_XXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0) {
+    perror("mkstemp");
+    return;
+  }
+  close(fd);
+  converter::ConversionEngine engine;
+  // A typical UI state: a few fields of JSON.
+  std::string state = "{\"amount\":\"1234.56\",\"from\":\"USD\",\"to\":\"INR\"}";
+  bench::Report("startup/snapshot_write", bench::TimeNs([&] {
+                  converter::WriteRateSnapshot(engine.rates().Read().table(),
+                                               0, state, path);
+                }));
+
+  converter::RateSnapshot restored;
+  bench::Report("startup/snapshot_load", bench::TimeNs([&] {
+                  converter::LoadRateSnapshot(path, &engine.rates(), &restored);
+                }),
+                static_cast<double>(converter::CurrencyCount()));
+  bench::Note("startup/snapshot_rates", std::to_string(restored.rates));
+  unlink(path);
+}
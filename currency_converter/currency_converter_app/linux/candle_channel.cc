@@ -0,0 +1,278 @@
+#include "candle_channel.h"
+
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include "channel_util.h"
+#include "engine/candles.h"
+#include "engine/metrics.h"
+#include "metrics_channel.h"
+
+struct CandleJobs;
+
+struct _CandleChannel {
+  GObject parent_instance;
+  FlMethodChannel* channel;
+  converter::ConversionEngine* engine;
+  // Requests handed to the thread pool and not yet answered.
+  CandleJobs* jobs;
+};
+
+G_DEFINE_TYPE(CandleChannel, candle_channel, G_TYPE_OBJECT)
+
+static constexpr char kChannelName[] = "currency_converter/candles";
+
+// A parsed "candles" call, built on the thread pool.
+struct CandleJob {
+  FlMethodCall* method_call;
+  converter::ConversionEngine* engine;
+  uint32_t pair;
+  int64_t begin;
+  int64_t end;
+  converter::CandleInterval interval;
+  std::vector<converter::Candle> candles;
+  bool ok;
+  // converter::MetricsClock() when the call was dispatched.
+  uint64_t start;
+
+  ~CandleJob() { g_object_unref(method_call); }
+};
+
+// Builds the candles of |job|. Safe to call on any thread.
+static void candle_job_run(CandleJob* job) {
+  static const converter::MetricId metric =
+      converter::OperationMetric("candles");
+  converter::ScopedLatency latency(metric);
+  job->ok = job->engine->candles().Candles(job->pair, job->begin, job->end,
+                                           job->interval, &job->candles);
+}
+
+// Responds with the candles as {start, open, high, low, close, average,
+// ticks}, one Int64List each with an element per candle.
+static FlMethodResponse* candle_job_response(CandleJob* job) {
+  if (!job->ok) {
+    return FL_METHOD_RESPONSE(fl_method_error_response_new(
+        "corrupt_history", "The rate history file is corrupt", nullptr));
+  }
+  size_t count = job->candles.size();
+  std::vector<int64_t> columns[7];
+  for (std::vector<int64_t>& column : columns) {
+    column.resize(count);
+  }
+  for (size_t i = 0; i < count; i++) {
+    const converter::Candle& candle = job->candles[i];
+    columns[0][i] = candle.start;
+    columns[1][i] = candle.open;
+    columns[2][i] = candle.high;
+    columns[3][i] = candle.low;
+    columns[4][i] = candle.close;
+    columns[5][i] = candle.average();
+    columns[6][i] = static_cast<int64_t>(candle.ticks);
+  }
+  static const char* const kKeys[] = {"start", "open",    "high", "low",
+                                      "close", "average", "ticks"};
+  g_autoptr(FlValue) result = fl_value_new_map();
+  for (size_t i = 0; i < 7; i++) {
+    fl_value_set_string_take(result, kKeys[i],
+                             fl_value_new_int64_list(columns[i].data(), count));
+  }
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// The requests of a channel that are on the thread pool or waiting for the
+// main loop to send their candles. Disposing the channel waits for the ones
+// still reading the engine's history and frees those never answered.
+struct CandleJobs {
+  std::mutex mutex;
+  // Notified when |building| drops to zero.
+  std::condition_variable idle;
+  size_t building = 0;
+  std::vector<CandleJob*> built;
+};
+
+// Sends the candles built on the thread pool. Runs on the main loop, which
+// owns the channel; |user_data| is a weak reference to it.
+static gboolean candle_jobs_respond_cb(gpointer user_data) {
+  g_autoptr(GObject) object =
+      G_OBJECT(g_weak_ref_get(static_cast<GWeakRef*>(user_data)));
+  if (object == nullptr) {
+    return G_SOURCE_REMOVE;
+  }
+  CandleChannel* self = CANDLE_CHANNEL(object);
+  std::vector<CandleJob*> built;
+  {
+    std::lock_guard<std::mutex> lock(self->jobs->mutex);
+    built.swap(self->jobs->built);
+  }
+  for (CandleJob* job : built) {
+    g_autoptr(FlMethodResponse) response = candle_job_response(job);
+    g_autoptr(GError) error = nullptr;
+    if (!fl_method_call_respond(job->method_call, response, &error)) {
+      g_warning("Failed to send response: %s", error->message);
+    }
+    metrics_channel_record_call(kChannelName, "candles", job->start,
+                                response);
+    delete job;
+  }
+  return G_SOURCE_REMOVE;
+}
+
+static void free_weak_ref(gpointer data) {
+  GWeakRef* ref = static_cast<GWeakRef*>(data);
+  g_weak_ref_clear(ref);
+  g_free(ref);
+}
+
+// Builds the candles of |job| on |pool| and has the main loop send them.
+static void submit_candle_job(CandleChannel* self, converter::ThreadPool* pool,
+                              CandleJob* job) {
+  CandleJobs* jobs = self->jobs;
+  {
+    std::lock_guard<std::mutex> lock(jobs->mutex);
+    jobs->building++;
+  }
+  GWeakRef* channel_ref = g_new(GWeakRef, 1);
+  g_weak_ref_init(channel_ref, self);
+  pool->Submit([jobs, job, channel_ref] {
+    candle_job_run(job);
+    {
+      // Once this is released the channel may be disposed and |jobs| freed.
+      std::lock_guard<std::mutex> lock(jobs->mutex);
+      jobs->built.push_back(job);
+      if (--jobs->building == 0) {
+        jobs->idle.notify_all();
+      }
+    }
+    g_idle_add_full(G_PRIORITY_DEFAULT, candle_jobs_respond_cb, channel_ref,
+                    free_weak_ref);
+  });
+}
+
+// Handles "candles" with arguments {pair, begin, end} and either "interval",
+// a width in milliseconds that is a whole number of minutes, or "months".
+// "pair" is packed as on the engine channel and "begin" and "end" are
+// milliseconds since the epoch. Responds with the whole candles overlapping
+// [begin, end), as parallel Int64Lists; rates are scaled by
+// converter::kRateScale.
+//
+// The first request for a pair reads its whole history, so candles are
+// built on the engine's thread pool and nullptr is returned; the response
+// follows once they are ready, recorded as a call started at |start|.
+static FlMethodResponse* candles(CandleChannel* self,
+                                 FlMethodCall* method_call, FlValue* args,
+                                 uint64_t start) {
+  FlValue* pair = lookup_typed(args, "pair", FL_VALUE_TYPE_INT);
+  FlValue* begin = lookup_typed(args, "begin", FL_VALUE_TYPE_INT);
+  FlValue* end = lookup_typed(args, "end", FL_VALUE_TYPE_INT);
+  FlValue* interval = lookup_typed(args, "interval", FL_VALUE_TYPE_INT);
+  FlValue* months = lookup_typed(args, "months", FL_VALUE_TYPE_INT);
+  if (pair == nullptr || begin == nullptr || end == nullptr ||
+      (interval == nullptr) == (months == nullptr)) {
+    return invalid_arguments_response(
+        "Expected pair, begin, end and either interval or months");
+  }
+  converter::CandleInterval width =
+      interval != nullptr
+          ? converter::CandleInterval::Fixed(fl_value_get_int(interval))
+          : converter::CandleInterval::Months(
+                static_cast<int32_t>(fl_value_get_int(months)));
+  if (!width.valid() || fl_value_get_int(begin) >= fl_value_get_int(end) ||
+      fl_value_get_int(pair) < 0 || fl_value_get_int(pair) > UINT32_MAX) {
+    return invalid_arguments_response(
+        "Expected begin before end, and an interval of whole minutes or "
+        "months");
+  }
+
+  CandleJob* job = new CandleJob{
+      FL_METHOD_CALL(g_object_ref(method_call)),
+      self->engine,
+      static_cast<uint32_t>(fl_value_get_int(pair)),
+      fl_value_get_int(begin),
+      fl_value_get_int(end),
+      width,
+      {},
+      false,
+      start,
+  };
+  converter::ThreadPool* pool = self->engine->thread_pool();
+  if (pool != nullptr) {
+    submit_candle_job(self, pool, job);
+    return nullptr;
+  }
+  candle_job_run(job);
+  FlMethodResponse* response = candle_job_response(job);
+  delete job;
+  return response;
+}
+
+// Called when a method call is received from Flutter.
+static void method_call_cb(FlMethodChannel* channel, FlMethodCall* method_call,
+                           gpointer user_data) {
+  CandleChannel* self = CANDLE_CHANNEL(user_data);
+  uint64_t start = converter::MetricsClock();
+  const gchar* method = fl_method_call_get_name(method_call);
+  FlValue* args = fl_method_call_get_args(method_call);
+
+  g_autoptr(FlMethodResponse) response = nullptr;
+  if (strcmp(method, "candles") == 0) {
+    response = candles(self, method_call, args, start);
+  } else {
+    response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+  }
+
+  // A handler that finishes the call asynchronously responds, and records
+  // the call, itself.
+  if (response == nullptr) {
+    return;
+  }
+  g_autoptr(GError) error = nullptr;
+  if (!fl_method_call_respond(method_call, response, &error)) {
+    g_warning("Failed to send response: %s", error->message);
+  }
+  metrics_channel_record_call(kChannelName, method, start, response);
+}
+
+static void candle_channel_dispose(GObject* object) {
+  CandleChannel* self = CANDLE_CHANNEL(object);
+  g_clear_object(&self->channel);
+  // The engine may be deleted as soon as this returns.
+  std::unique_lock<std::mutex> lock(self->jobs->mutex);
+  self->jobs->idle.wait(lock, [self] { return self->jobs->building == 0; });
+  for (CandleJob* job : self->jobs->built) {
+    delete job;
+  }
+  self->jobs->built.clear();
+  lock.unlock();
+  G_OBJECT_CLASS(candle_channel_parent_class)->dispose(object);
+}
+
+static void candle_channel_finalize(GObject* object) {
+  CandleChannel* self = CANDLE_CHANNEL(object);
+  delete self->jobs;
+  G_OBJECT_CLASS(candle_channel_parent_class)->finalize(object);
+}
+
+static void candle_channel_class_init(CandleChannelClass* klass) {
+  G_OBJECT_CLASS(klass)->dispose = candle_channel_dispose;
+  G_OBJECT_CLASS(klass)->finalize = candle_channel_finalize;
+}
+
+static void candle_channel_init(CandleChannel* self) {
+  self->jobs = new CandleJobs();
+}
+
+CandleChannel* candle_channel_new(FlBinaryMessenger* messenger,
+                                  converter::ConversionEngine* engine) {
+  CandleChannel* self =
+      CANDLE_CHANNEL(g_object_new(candle_channel_get_type(), nullptr));
+  self->engine = engine;
+
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  self->channel = fl_method_channel_new(messenger, kChannelName,
+                                        FL_METHOD_CODEC(codec));
+  fl_method_channel_set_method_call_handler(self->channel, method_call_cb,
+                                            self, nullptr);
+  return self;
+}
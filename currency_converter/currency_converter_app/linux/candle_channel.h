@@ -0,0 +1,26 @@
+#ifndef FLUTTER_CANDLE_CHANNEL_H_
+#define FLUTTER_CANDLE_CHANNEL_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+#include "engine/conversion_engine.h"
+
+G_DECLARE_FINAL_TYPE(CandleChannel, candle_channel, CANDLE, CHANNEL, GObject)
+
+/**
+ * candle_channel_new:
+ * @messenger: an #FlBinaryMessenger to register the channel on.
+ * @engine: the native conversion engine whose history and live quotes the
+ * candles are built from. Must outlive the channel.
+ *
+ * Creates the "currency_converter/candles" method channel, which serves
+ * open/high/low/close candles of a currency pair at any interval from a
+ * minute to years. Disposing the channel waits for the candles it is still
+ * building on the engine's thread pool.
+ *
+ * Returns: a new #CandleChannel.
+ */
+CandleChannel* candle_channel_new(FlBinaryMessenger* messenger,
+                                  converter::ConversionEngine* engine);
+
+#endif  // FLUTTER_CANDLE_CHANNEL_H_
@@ -0,0 +1,38 @@
+#include "channel_util.h"
+
+const gchar* status_error_code(converter::Status status) {
+  switch (status) {
+    case converter::Status::kUnknownCurrency:
+      return "unknown_currency";
+    case converter::Status::kInvalidAmount:
+      return "invalid_amount";
+    case converter::Status::kOverflow:
+      return "overflow";
+    case converter::Status::kNoHistory:
+      return "no_history";
+    case converter::Status::kOk:
+      break;
+  }
+  return "error";
+}
+
+FlMethodResponse* status_error_response(converter::Status status) {
+  return FL_METHOD_RESPONSE(fl_method_error_response_new(
+      status_error_code(status), converter::StatusMessage(status), nullptr));
+}
+
+FlMethodResponse* invalid_arguments_response(const gchar* message) {
+  return FL_METHOD_RESPONSE(
+      fl_method_error_response_new("invalid_arguments", message, nullptr));
+}
+
+FlValue* lookup_typed(FlValue* args, const gchar* key, FlValueType type) {
+  if (args == nullptr || fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
+    return nullptr;
+  }
+  FlValue* value = fl_value_lookup_string(args, key);
+  if (value == nullptr || fl_value_get_type(value) != type) {
+    return nullptr;
+  }
+  return value;
+}
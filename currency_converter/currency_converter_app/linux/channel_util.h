@@ -0,0 +1,51 @@
+#ifndef FLUTTER_CHANNEL_UTIL_H_
+#define FLUTTER_CHANNEL_UTIL_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+#include "engine/conversion_engine.h"
+
+/**
+ * status_error_code:
+ * @status: a failed engine status.
+ *
+ * Gets the error code Dart sees for @status, such as "unknown_currency".
+ *
+ * Returns: a static string.
+ */
+const gchar* status_error_code(converter::Status status);
+
+/**
+ * status_error_response:
+ * @status: a failed engine status.
+ *
+ * Creates an error response with the code of @status and its message.
+ *
+ * Returns: (transfer full): a new #FlMethodResponse.
+ */
+FlMethodResponse* status_error_response(converter::Status status);
+
+/**
+ * invalid_arguments_response:
+ * @message: what the method expected.
+ *
+ * Creates the "invalid_arguments" error response with @message.
+ *
+ * Returns: (transfer full): a new #FlMethodResponse.
+ */
+FlMethodResponse* invalid_arguments_response(const gchar* message);
+
+/**
+ * lookup_typed:
+ * @args: (nullable): the arguments of a method call.
+ * @key: the key to look up.
+ * @type: the type the value must have.
+ *
+ * Looks up @key in @args, if @args is a map.
+ *
+ * Returns: (transfer none) (nullable): the value under @key if it has
+ * @type, or %NULL.
+ */
+FlValue* lookup_typed(FlValue* args, const gchar* key, FlValueType type);
+
+#endif  // FLUTTER_CHANNEL_UTIL_H_
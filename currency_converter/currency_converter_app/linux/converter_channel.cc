@@ -0,0 +1,699 @@
+#include "converter_channel.h"
+
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "channel_util.h"
+#include "engine/amount_format.h"
+#include "engine/fixed_point.h"
+#include "engine/metrics.h"
+#include "engine/request_arena.h"
+#include "metrics_channel.h"
+
+struct AsyncBatchJobs;
+
+struct _ConverterChannel {
+  GObject parent_instance;
+  FlMethodChannel* channel;
+  converter::ConversionEngine* engine;
+  // Temporaries of the call being handled, reset after each response.
+  converter::RequestArena* arena;
+  // Batches handed to the thread pool and not yet answered.
+  AsyncBatchJobs* jobs;
+};
+
+G_DEFINE_TYPE(ConverterChannel, converter_channel, G_TYPE_OBJECT)
+
+static constexpr char kChannelName[] = "currency_converter/engine";
+
+// Most results one "convertAll" call may produce. The results are held three
+// times over, in the buffer converted into, the list sent back and the
+// encoded message, so this keeps a call to about 100 MB.
+static constexpr size_t kMaxFanOutResults = size_t{1} << 22;
+
+// Latency metrics of the operations a call goes through.
+struct OperationMetrics {
+  converter::MetricId lookup;
+  converter::MetricId parse;
+  converter::MetricId convert;
+  converter::MetricId convert_at;
+  converter::MetricId convert_batch;
+  converter::MetricId convert_all;
+  converter::MetricId format;
+  converter::MetricId format_batch;
+  converter::MetricId marshal;
+  // Heap allocations calls needed beyond their arena.
+  converter::MetricId arena_allocations;
+};
+
+static const OperationMetrics& operation_metrics() {
+  static const OperationMetrics metrics = {
+      converter::OperationMetric("lookup"),
+      converter::OperationMetric("parse"),
+      converter::OperationMetric("convert"),
+      converter::OperationMetric("convert_at"),
+      converter::OperationMetric("convert_batch"),
+      converter::OperationMetric("convert_all"),
+      converter::OperationMetric("format"),
+      converter::OperationMetric("format_batch"),
+      converter::OperationMetric("marshal"),
+      converter::Metrics::Get().Register(
+          converter::MetricKind::kCounter,
+          "currency_converter_arena_allocations_total",
+          "Heap allocations made by calls that outgrew their arena.", ""),
+  };
+  return metrics;
+}
+
+// Records the time since |*since| against |metric| and moves |*since| on to
+// now, so that consecutive operations share their clock reads.
+static void record_operation(converter::MetricId metric, uint64_t* since) {
+  uint64_t now = converter::MetricsClock();
+  converter::Metrics::Get().Record(metric, now - *since);
+  *since = now;
+}
+
+// Resolves the currency code stored under |key| in the |args| map.
+static converter::CurrencyId lookup_currency(FlValue* args, const char* key) {
+  FlValue* value = fl_value_lookup_string(args, key);
+  if (value == nullptr || fl_value_get_type(value) != FL_VALUE_TYPE_STRING) {
+    return converter::kInvalidCurrency;
+  }
+  return converter::FindCurrency(fl_value_get_string(value));
+}
+
+// Returns the number format for the optional "locale" argument in |args|,
+// such as "en_IN"; en_US if absent.
+static const converter::NumberFormat& lookup_format(FlValue* args) {
+  FlValue* value = fl_value_lookup_string(args, "locale");
+  if (value == nullptr || fl_value_get_type(value) != FL_VALUE_TYPE_STRING) {
+    return converter::NumberFormatForLocale("");
+  }
+  return converter::NumberFormatForLocale(fl_value_get_string(value));
+}
+
+// Converts an "amount" argument, given either as decimal text in |format|
+// (exact) or as a number in major units, into minor units of |currency|.
+static converter::Status amount_to_minor(FlValue* amount,
+                                         converter::CurrencyId currency,
+                                         const converter::NumberFormat& format,
+                                         int64_t* out) {
+  int minor_units = converter::GetCurrency(currency).minor_units;
+  switch (fl_value_get_type(amount)) {
+    case FL_VALUE_TYPE_STRING:
+      return converter::ParseAmount(fl_value_get_string(amount), minor_units,
+                                    format, out)
+                 ? converter::Status::kOk
+                 : converter::Status::kInvalidAmount;
+    case FL_VALUE_TYPE_INT: {
+      __int128 minor = static_cast<__int128>(fl_value_get_int(amount)) *
+                       converter::Pow10(minor_units);
+      if (minor > INT64_MAX || minor < INT64_MIN) {
+        return converter::Status::kOverflow;
+      }
+      *out = static_cast<int64_t>(minor);
+      return converter::Status::kOk;
+    }
+    case FL_VALUE_TYPE_FLOAT: {
+      double minor = std::nearbyint(fl_value_get_float(amount) *
+                                    static_cast<double>(
+                                        converter::Pow10(minor_units)));
+      if (!std::isfinite(minor) || std::fabs(minor) >= 9.2e18) {
+        return converter::Status::kInvalidAmount;
+      }
+      *out = static_cast<int64_t>(minor);
+      return converter::Status::kOk;
+    }
+    default:
+      return converter::Status::kInvalidAmount;
+  }
+}
+
+// Handles "convert" with arguments {amount, from, to} and an optional "at",
+// in milliseconds since the epoch, to convert at the historical rates in
+// effect at that time. A text amount may use the grouping of the optional
+// "locale", e.g. "1,000.50" or, for "de_DE", "1.000,50". Responds with
+// {minor, minorUnits, value, text}: the exact result in minor units of "to",
+// the number of minor digits, the same result as a double in major units,
+// and as display text in the locale's format.
+static FlMethodResponse* convert(ConverterChannel* self, FlValue* args) {
+  if (args == nullptr || fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
+    return invalid_arguments_response("Expected a map of arguments");
+  }
+  FlValue* amount = fl_value_lookup_string(args, "amount");
+  if (amount == nullptr) {
+    return invalid_arguments_response("Missing amount");
+  }
+  const OperationMetrics& operations = operation_metrics();
+  uint64_t time = converter::MetricsClock();
+  converter::CurrencyId from = lookup_currency(args, "from");
+  converter::CurrencyId to = lookup_currency(args, "to");
+  record_operation(operations.lookup, &time);
+  if (from == converter::kInvalidCurrency ||
+      to == converter::kInvalidCurrency) {
+    return status_error_response(converter::Status::kUnknownCurrency);
+  }
+
+  FlValue* at = fl_value_lookup_string(args, "at");
+  if (at != nullptr && fl_value_get_type(at) != FL_VALUE_TYPE_INT &&
+      fl_value_get_type(at) != FL_VALUE_TYPE_NULL) {
+    return invalid_arguments_response("Expected at as an int");
+  }
+
+  const converter::NumberFormat& format = lookup_format(args);
+  int64_t amount_minor;
+  converter::Status status =
+      amount_to_minor(amount, from, format, &amount_minor);
+  record_operation(operations.parse, &time);
+  int64_t result_minor = 0;
+  if (status == converter::Status::kOk) {
+    bool historical =
+        at != nullptr && fl_value_get_type(at) == FL_VALUE_TYPE_INT;
+    status = historical
+                 ? self->engine->ConvertAt(amount_minor, from, to,
+                                           fl_value_get_int(at), &result_minor)
+                 : self->engine->Convert(amount_minor, from, to,
+                                         &result_minor);
+    record_operation(historical ? operations.convert_at : operations.convert,
+                     &time);
+  }
+  if (status != converter::Status::kOk) {
+    return status_error_response(status);
+  }
+
+  int minor_units = converter::GetCurrency(to).minor_units;
+  char text[converter::kMaxAmountTextSize + 1];
+  text[converter::FormatAmount(result_minor, minor_units, format, text)] = '\0';
+  record_operation(operations.format, &time);
+
+  g_autoptr(FlValue) result = fl_value_new_map();
+  fl_value_set_string_take(result, "minor", fl_value_new_int(result_minor));
+  fl_value_set_string_take(result, "minorUnits", fl_value_new_int(minor_units));
+  fl_value_set_string_take(
+      result, "value",
+      fl_value_new_float(static_cast<double>(result_minor) /
+                         static_cast<double>(converter::Pow10(minor_units))));
+  fl_value_set_string_take(result, "text", fl_value_new_string(text));
+  FlMethodResponse* response =
+      FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  record_operation(operations.marshal, &time);
+  return response;
+}
+
+// Creates a typed list holding a copy of |values|.
+static FlValue* new_typed_list(const double* values, size_t count) {
+  return fl_value_new_float_list(values, count);
+}
+
+static FlValue* new_typed_list(const int64_t* values, size_t count) {
+  return fl_value_new_int64_list(values, count);
+}
+
+// A parsed "convertBatch" call. The request's lists belong to the method
+// call and are only read; the results go into a list of their own, which
+// is sent back as is.
+struct BatchJob {
+  converter::ConversionEngine* engine;
+  FlValue* amounts;
+  size_t count;
+  const uint32_t* pairs;
+  converter::CurrencyId from;
+  converter::CurrencyId to;
+  // Set by batch_job_run(), and owned by the job.
+  FlValue* results;
+  converter::Status status;
+
+  ~BatchJob() {
+    if (results != nullptr) {
+      fl_value_unref(results);
+    }
+  }
+};
+
+// A batch converted on the thread pool. Holds references to the call and its
+// arguments, so the lists stay valid until the response is sent.
+struct AsyncBatchJob {
+  BatchJob batch;
+  FlMethodCall* method_call;
+  FlValue* args;
+  // converter::MetricsClock() when the call was dispatched.
+  uint64_t start;
+
+  ~AsyncBatchJob() {
+    g_object_unref(method_call);
+    fl_value_unref(args);
+  }
+};
+
+template <typename T>
+static void batch_job_run(BatchJob* job, const T* amounts,
+                          std::pmr::memory_resource* resource) {
+  std::pmr::polymorphic_allocator<T> allocator(resource);
+  T* results = allocator.allocate(job->count);
+  job->status = job->pairs != nullptr
+                    ? job->engine->ConvertBatch(amounts, job->pairs,
+                                                job->count, results)
+                    : job->engine->ConvertBatch(amounts, job->count, job->from,
+                                                job->to, results);
+  if (job->status == converter::Status::kOk) {
+    job->results = new_typed_list(results, job->count);
+  }
+  allocator.deallocate(results, job->count);
+}
+
+// Converts the amounts of |job| into a new list of the same kind, through a
+// buffer from |resource|: FlValue only makes typed lists by copying their
+// contents in. Safe to call on any thread that may use |resource|.
+static void batch_job_run(BatchJob* job, std::pmr::memory_resource* resource) {
+  converter::ScopedLatency latency(operation_metrics().convert_batch);
+  if (fl_value_get_type(job->amounts) == FL_VALUE_TYPE_FLOAT_LIST) {
+    batch_job_run(job, fl_value_get_float_list(job->amounts), resource);
+  } else {
+    batch_job_run(job, fl_value_get_int64_list(job->amounts), resource);
+  }
+}
+
+static FlMethodResponse* batch_job_response(const BatchJob& job) {
+  if (job.status != converter::Status::kOk) {
+    return status_error_response(job.status);
+  }
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(job.results));
+}
+
+// The batches of a channel that are on the thread pool or waiting for the
+// main loop to send their results. The pool outlives the channel, and so
+// may the main loop callbacks, so disposing the channel waits for the
+// batches still converting, since they use the engine, and frees those
+// whose response was never sent.
+struct AsyncBatchJobs {
+  std::mutex mutex;
+  // Notified when |converting| drops to zero.
+  std::condition_variable idle;
+  size_t converting = 0;
+  std::vector<AsyncBatchJob*> converted;
+};
+
+// Sends the results of the batches converted on the thread pool. Runs on the
+// main loop, which owns the channel; |user_data| is a weak reference to it.
+static gboolean batch_jobs_respond_cb(gpointer user_data) {
+  g_autoptr(GObject) object =
+      G_OBJECT(g_weak_ref_get(static_cast<GWeakRef*>(user_data)));
+  if (object == nullptr) {
+    return G_SOURCE_REMOVE;
+  }
+  ConverterChannel* self = CONVERTER_CHANNEL(object);
+  std::vector<AsyncBatchJob*> converted;
+  {
+    std::lock_guard<std::mutex> lock(self->jobs->mutex);
+    converted.swap(self->jobs->converted);
+  }
+  for (AsyncBatchJob* job : converted) {
+    g_autoptr(FlMethodResponse) response = batch_job_response(job->batch);
+    g_autoptr(GError) error = nullptr;
+    if (!fl_method_call_respond(job->method_call, response, &error)) {
+      g_warning("Failed to send response: %s", error->message);
+    }
+    metrics_channel_record_call(kChannelName, "convertBatch", job->start,
+                                response);
+    delete job;
+  }
+  return G_SOURCE_REMOVE;
+}
+
+static void free_weak_ref(gpointer data) {
+  GWeakRef* ref = static_cast<GWeakRef*>(data);
+  g_weak_ref_clear(ref);
+  g_free(ref);
+}
+
+// Converts |async_job| on |pool| and has the main loop send its results.
+static void submit_batch_job(ConverterChannel* self,
+                             converter::ThreadPool* pool,
+                             AsyncBatchJob* async_job) {
+  AsyncBatchJobs* jobs = self->jobs;
+  {
+    std::lock_guard<std::mutex> lock(jobs->mutex);
+    jobs->converting++;
+  }
+  GWeakRef* channel_ref = g_new(GWeakRef, 1);
+  g_weak_ref_init(channel_ref, self);
+  pool->Submit([jobs, async_job, channel_ref] {
+    batch_job_run(&async_job->batch, std::pmr::new_delete_resource());
+    {
+      // Once this is released the channel may be disposed and |jobs| freed.
+      std::lock_guard<std::mutex> lock(jobs->mutex);
+      jobs->converted.push_back(async_job);
+      if (--jobs->converting == 0) {
+        jobs->idle.notify_all();
+      }
+    }
+    // Unlike g_main_context_invoke(), never runs the callback here, even
+    // when the main loop has already stopped.
+    g_idle_add_full(G_PRIORITY_DEFAULT, batch_jobs_respond_cb, channel_ref,
+                    free_weak_ref);
+  });
+}
+
+// Handles "convertBatch" with arguments {amounts, from, to} or
+// {amounts, pairs}. "amounts" is a Float64List in major units or an Int64List
+// in minor units, and "pairs" an Int32List of per-element pairs packed as
+// from_index << 16 | to_index. Responds with a typed list of the same kind,
+// so no element is ever boxed on either side of the channel.
+//
+// Large batches are converted on the engine's thread pool, keeping the main
+// loop free to draw frames; nullptr is returned and the response follows
+// once the pool is done, recorded as a call started at |start|.
+static FlMethodResponse* convert_batch(ConverterChannel* self,
+                                       FlMethodCall* method_call,
+                                       FlValue* args, uint64_t start) {
+  if (args == nullptr || fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
+    return invalid_arguments_response("Expected a map of arguments");
+  }
+  FlValue* amounts = fl_value_lookup_string(args, "amounts");
+  if (amounts == nullptr ||
+      (fl_value_get_type(amounts) != FL_VALUE_TYPE_FLOAT_LIST &&
+       fl_value_get_type(amounts) != FL_VALUE_TYPE_INT64_LIST)) {
+    return invalid_arguments_response(
+        "Expected amounts as a Float64List or Int64List");
+  }
+  size_t count = fl_value_get_length(amounts);
+
+  const uint32_t* pairs = nullptr;
+  converter::CurrencyId from = converter::kInvalidCurrency;
+  converter::CurrencyId to = converter::kInvalidCurrency;
+  FlValue* pairs_value = fl_value_lookup_string(args, "pairs");
+  if (pairs_value != nullptr) {
+    if (fl_value_get_type(pairs_value) != FL_VALUE_TYPE_INT32_LIST ||
+        fl_value_get_length(pairs_value) != count) {
+      return invalid_arguments_response(
+          "Expected pairs as an Int32List matching amounts");
+    }
+    pairs = reinterpret_cast<const uint32_t*>(
+        fl_value_get_int32_list(pairs_value));
+  } else {
+    from = lookup_currency(args, "from");
+    to = lookup_currency(args, "to");
+    if (from == converter::kInvalidCurrency ||
+        to == converter::kInvalidCurrency) {
+      return status_error_response(converter::Status::kUnknownCurrency);
+    }
+  }
+
+  converter::ThreadPool* pool = self->engine->thread_pool();
+  if (pool != nullptr &&
+      count >= converter::ConversionEngine::kParallelBatchSize) {
+    AsyncBatchJob* async_job = new AsyncBatchJob{
+        {self->engine, amounts, count, pairs, from, to, nullptr,
+         converter::Status::kOk},
+        FL_METHOD_CALL(g_object_ref(method_call)),
+        fl_value_ref(args),
+        start,
+    };
+    submit_batch_job(self, pool, async_job);
+    return nullptr;
+  }
+  BatchJob job = {
+      self->engine, amounts, count, pairs, from, to, nullptr,
+      converter::Status::kOk,
+  };
+  batch_job_run(&job, self->arena->resource());
+  return batch_job_response(job);
+}
+
+// Converts |count| |amounts| into every currency of |targets|, sorted by
+// |order|, through a buffer from the channel's arena and, on success, makes
+// |*results| from it.
+template <typename T>
+static converter::Status convert_to_all(
+    ConverterChannel* self, const T* amounts, size_t count,
+    converter::CurrencyId from,
+    std::pmr::vector<converter::CurrencyId>* targets,
+    converter::FanOutOrder order, FlValue** results) {
+  size_t total = count * targets->size();
+  std::pmr::polymorphic_allocator<T> allocator(self->arena->resource());
+  T* buffer = allocator.allocate(total);
+  converter::Status status = self->engine->ConvertToAll(
+      amounts, count, from, targets->data(), targets->size(), order, buffer);
+  if (status == converter::Status::kOk) {
+    *results = new_typed_list(buffer, total);
+  }
+  allocator.deallocate(buffer, total);
+  return status;
+}
+
+// Handles "convertAll" with arguments {amounts, from} and the optional
+// "targets" and "order". "amounts" is a Float64List in major units or an
+// Int64List in minor units of "from", "targets" an Int32List of currency
+// indices such as a list of favourites, every currency if absent, and
+// "order" either "code" or "value" (the largest result of the first amount
+// first). Responds with {currencies, results}: the targets as an Int32List
+// in the order used, and a list of the same kind as "amounts" in which
+// results[t * amounts.length + i] is amount i in currencies[t]. Results
+// that overflow are NaN in major units and INT64_MIN in minor units.
+//
+// Showing an amount in every currency takes one call rather than one
+// "convert" per currency.
+static FlMethodResponse* convert_all(ConverterChannel* self, FlValue* args) {
+  if (args == nullptr || fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
+    return invalid_arguments_response("Expected a map of arguments");
+  }
+  FlValue* amounts = fl_value_lookup_string(args, "amounts");
+  if (amounts == nullptr ||
+      (fl_value_get_type(amounts) != FL_VALUE_TYPE_FLOAT_LIST &&
+       fl_value_get_type(amounts) != FL_VALUE_TYPE_INT64_LIST)) {
+    return invalid_arguments_response(
+        "Expected amounts as a Float64List or Int64List");
+  }
+  converter::CurrencyId from = lookup_currency(args, "from");
+  if (from == converter::kInvalidCurrency) {
+    return status_error_response(converter::Status::kUnknownCurrency);
+  }
+
+  converter::FanOutOrder order = converter::FanOutOrder::kAsGiven;
+  FlValue* order_value = fl_value_lookup_string(args, "order");
+  if (order_value != nullptr &&
+      fl_value_get_type(order_value) != FL_VALUE_TYPE_NULL) {
+    const gchar* name = fl_value_get_type(order_value) == FL_VALUE_TYPE_STRING
+                            ? fl_value_get_string(order_value)
+                            : "";
+    if (strcmp(name, "code") == 0) {
+      order = converter::FanOutOrder::kCode;
+    } else if (strcmp(name, "value") == 0) {
+      order = converter::FanOutOrder::kValue;
+    } else {
+      return invalid_arguments_response("Expected order as code or value");
+    }
+  }
+
+  std::pmr::vector<converter::CurrencyId> targets(self->arena->resource());
+  FlValue* targets_value = fl_value_lookup_string(args, "targets");
+  if (targets_value != nullptr &&
+      fl_value_get_type(targets_value) != FL_VALUE_TYPE_NULL) {
+    if (fl_value_get_type(targets_value) != FL_VALUE_TYPE_INT32_LIST) {
+      return invalid_arguments_response("Expected targets as an Int32List");
+    }
+    const int32_t* ids = fl_value_get_int32_list(targets_value);
+    size_t target_count = fl_value_get_length(targets_value);
+    targets.resize(target_count);
+    for (size_t t = 0; t < target_count; t++) {
+      if (ids[t] < 0 ||
+          static_cast<size_t>(ids[t]) >= converter::CurrencyCount()) {
+        return status_error_response(converter::Status::kUnknownCurrency);
+      }
+      targets[t] = static_cast<converter::CurrencyId>(ids[t]);
+    }
+  } else {
+    targets.resize(converter::CurrencyCount());
+    for (size_t t = 0; t < targets.size(); t++) {
+      targets[t] = static_cast<converter::CurrencyId>(t);
+    }
+  }
+
+  size_t count = fl_value_get_length(amounts);
+  if (targets.size() != 0 && count > kMaxFanOutResults / targets.size()) {
+    return invalid_arguments_response("Too many results for one call");
+  }
+  const OperationMetrics& operations = operation_metrics();
+  uint64_t time = converter::MetricsClock();
+  g_autoptr(FlValue) results = nullptr;
+  converter::Status status =
+      fl_value_get_type(amounts) == FL_VALUE_TYPE_FLOAT_LIST
+          ? convert_to_all(self, fl_value_get_float_list(amounts), count, from,
+                           &targets, order, &results)
+          : convert_to_all(self, fl_value_get_int64_list(amounts), count, from,
+                           &targets, order, &results);
+  record_operation(operations.convert_all, &time);
+  if (status != converter::Status::kOk) {
+    return status_error_response(status);
+  }
+
+  std::pmr::vector<int32_t> currencies(targets.begin(), targets.end(),
+                                       self->arena->resource());
+  g_autoptr(FlValue) result = fl_value_new_map();
+  fl_value_set_string_take(
+      result, "currencies",
+      fl_value_new_int32_list(currencies.data(), currencies.size()));
+  fl_value_set_string_take(result, "results", fl_value_ref(results));
+  FlMethodResponse* response =
+      FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  record_operation(operations.marshal, &time);
+  return response;
+}
+
+// Handles "formatBatch" with arguments {amounts, currency} and an optional
+// "locale". "amounts" is an Int64List in minor units of "currency". Responds
+// with {text, offsets}: every amount formatted for display, back to back in
+// one UTF-8 Uint8List, and an Int32List in which amount i spans
+// [offsets[i], offsets[i + 1]). A whole list of values crosses the channel
+// as two buffers rather than one string per value.
+static FlMethodResponse* format_batch(ConverterChannel* self, FlValue* args) {
+  if (args == nullptr || fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
+    return invalid_arguments_response("Expected a map of arguments");
+  }
+  FlValue* amounts = fl_value_lookup_string(args, "amounts");
+  if (amounts == nullptr ||
+      fl_value_get_type(amounts) != FL_VALUE_TYPE_INT64_LIST) {
+    return invalid_arguments_response("Expected amounts as an Int64List");
+  }
+  converter::CurrencyId currency = lookup_currency(args, "currency");
+  if (currency == converter::kInvalidCurrency) {
+    return status_error_response(converter::Status::kUnknownCurrency);
+  }
+  size_t count = fl_value_get_length(amounts);
+  if (count * converter::kMaxAmountTextSize > INT32_MAX) {
+    return invalid_arguments_response("Too many amounts for one call");
+  }
+
+  const OperationMetrics& operations = operation_metrics();
+  uint64_t time = converter::MetricsClock();
+  std::pmr::string text(self->arena->resource());
+  std::pmr::vector<uint32_t> offsets(self->arena->resource());
+  converter::FormatAmounts(fl_value_get_int64_list(amounts), count,
+                           converter::GetCurrency(currency).minor_units,
+                           lookup_format(args), &text, &offsets);
+  record_operation(operations.format_batch, &time);
+  g_autoptr(FlValue) result = fl_value_new_map();
+  fl_value_set_string_take(
+      result, "text",
+      fl_value_new_uint8_list(reinterpret_cast<const uint8_t*>(text.data()),
+                              text.size()));
+  fl_value_set_string_take(
+      result, "offsets",
+      fl_value_new_int32_list(reinterpret_cast<const int32_t*>(offsets.data()),
+                              offsets.size()));
+  FlMethodResponse* response =
+      FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  record_operation(operations.marshal, &time);
+  return response;
+}
+
+// Handles "currencies". Responds with {codes, minorUnits}, where the index of
+// each code is the currency index used by packed pairs.
+static FlMethodResponse* list_currencies(ConverterChannel* self) {
+  size_t count = converter::CurrencyCount();
+  g_autoptr(FlValue) codes = fl_value_new_list();
+  std::pmr::vector<uint8_t> minor_units(count, self->arena->resource());
+  for (size_t i = 0; i < count; i++) {
+    const converter::Currency& currency =
+        converter::GetCurrency(static_cast<converter::CurrencyId>(i));
+    fl_value_append_take(codes, fl_value_new_string(currency.code));
+    minor_units[i] = currency.minor_units;
+  }
+  g_autoptr(FlValue) result = fl_value_new_map();
+  fl_value_set_string_take(result, "codes", fl_value_ref(codes));
+  fl_value_set_string_take(result, "minorUnits",
+                           fl_value_new_uint8_list(minor_units.data(), count));
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// Called when a method call is received from Flutter.
+static void method_call_cb(FlMethodChannel* channel, FlMethodCall* method_call,
+                           gpointer user_data) {
+  ConverterChannel* self = CONVERTER_CHANNEL(user_data);
+  uint64_t start = converter::MetricsClock();
+  const gchar* method = fl_method_call_get_name(method_call);
+  FlValue* args = fl_method_call_get_args(method_call);
+
+  g_autoptr(FlMethodResponse) response = nullptr;
+  if (strcmp(method, "convert") == 0) {
+    response = convert(self, args);
+  } else if (strcmp(method, "convertBatch") == 0) {
+    response = convert_batch(self, method_call, args, start);
+  } else if (strcmp(method, "convertAll") == 0) {
+    response = convert_all(self, args);
+  } else if (strcmp(method, "formatBatch") == 0) {
+    response = format_batch(self, args);
+  } else if (strcmp(method, "currencies") == 0) {
+    response = list_currencies(self);
+  } else {
+    response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+  }
+
+  // The response holds copies of whatever it took from the arena.
+  size_t arena_allocations = self->arena->Reset();
+  if (arena_allocations > 0) {
+    converter::Metrics::Get().Add(operation_metrics().arena_allocations,
+                                  arena_allocations);
+  }
+
+  // A handler that finishes the call asynchronously responds, and records
+  // the call, itself.
+  if (response == nullptr) {
+    return;
+  }
+  g_autoptr(GError) error = nullptr;
+  if (!fl_method_call_respond(method_call, response, &error)) {
+    g_warning("Failed to send response: %s", error->message);
+  }
+  metrics_channel_record_call(kChannelName, method, start, response);
+}
+
+static void converter_channel_dispose(GObject* object) {
+  ConverterChannel* self = CONVERTER_CHANNEL(object);
+  g_clear_object(&self->channel);
+  // The engine may be deleted as soon as this returns.
+  std::unique_lock<std::mutex> lock(self->jobs->mutex);
+  self->jobs->idle.wait(lock, [self] { return self->jobs->converting == 0; });
+  for (AsyncBatchJob* job : self->jobs->converted) {
+    delete job;
+  }
+  self->jobs->converted.clear();
+  lock.unlock();
+  G_OBJECT_CLASS(converter_channel_parent_class)->dispose(object);
+}
+
+static void converter_channel_finalize(GObject* object) {
+  ConverterChannel* self = CONVERTER_CHANNEL(object);
+  delete self->arena;
+  delete self->jobs;
+  G_OBJECT_CLASS(converter_channel_parent_class)->finalize(object);
+}
+
+static void converter_channel_class_init(ConverterChannelClass* klass) {
+  G_OBJECT_CLASS(klass)->dispose = converter_channel_dispose;
+  G_OBJECT_CLASS(klass)->finalize = converter_channel_finalize;
+}
+
+static void converter_channel_init(ConverterChannel* self) {
+  self->arena = new converter::RequestArena();
+  self->jobs = new AsyncBatchJobs();
+}
+
+ConverterChannel* converter_channel_new(FlBinaryMessenger* messenger,
+                                        converter::ConversionEngine* engine) {
+  ConverterChannel* self =
+      CONVERTER_CHANNEL(g_object_new(converter_channel_get_type(), nullptr));
+  self->engine = engine;
+
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  self->channel = fl_method_channel_new(messenger, kChannelName,
+                                        FL_METHOD_CODEC(codec));
+  fl_method_channel_set_method_call_handler(self->channel, method_call_cb,
+                                            self, nullptr);
+  return self;
+}
@@ -0,0 +1,25 @@
+#ifndef FLUTTER_CONVERTER_CHANNEL_H_
+#define FLUTTER_CONVERTER_CHANNEL_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+#include "engine/conversion_engine.h"
+
+G_DECLARE_FINAL_TYPE(ConverterChannel, converter_channel, CONVERTER, CHANNEL,
+                     GObject)
+
+/**
+ * converter_channel_new:
+ * @messenger: an #FlBinaryMessenger to register the channel on.
+ * @engine: the native conversion engine to serve. Must outlive the channel.
+ *
+ * Creates the "currency_converter/engine" method channel, which answers
+ * conversion requests from Dart using @engine. Disposing the channel waits
+ * for the batches it is still converting on the engine's thread pool.
+ *
+ * Returns: a new #ConverterChannel.
+ */
+ConverterChannel* converter_channel_new(FlBinaryMessenger* messenger,
+                                        converter::ConversionEngine* engine);
+
+#endif  // FLUTTER_CONVERTER_CHANNEL_H_
@@ -0,0 +1,214 @@
+#include "alert_index.h"
+
+#include <algorithm>
+
+namespace converter {
+
+namespace {
+
+constexpr uint32_t kNoSlot = 0xffffffff;
+
+constexpr uint32_t kAlertSlotMask = (uint32_t{1} << kAlertSlotBits) - 1;
+
+static_assert(kAlertSlotBits + kAlertGenerationBits <= 31,
+              "alert ids must fit an int32");
+static_assert(kAlertGenerationBits <= 8, "Record::generation is 8 bits");
+
+// Staged alerts are inserted one by one into lists at least this many times
+// their number, and merged in with a sort otherwise.
+constexpr size_t kMaxInsertRatio = 64;
+
+}  // namespace
+
+AlertIndex::AlertIndex()
+    : slots_(CurrencyCount() * CurrencyCount(), kNoSlot),
+      by_currency_(CurrencyCount()) {}
+
+AlertId AlertIndex::Add(uint32_t pair, AlertDirection direction,
+                        int64_t threshold) {
+  CurrencyId first = pair >> 16;
+  CurrencyId second = pair & 0xffff;
+  size_t count = CurrencyCount();
+  if (first >= count || second >= count || first == second ||
+      threshold <= 0 ||
+      (free_slots_.empty() && records_.size() > kAlertSlotMask)) {
+    return kInvalidAlert;
+  }
+  uint32_t& slot = slots_[first * count + second];
+  if (slot == kNoSlot) {
+    slot = static_cast<uint32_t>(watched_.size());
+    watched_.emplace_back();
+    watched_.back().pair = pair;
+    by_currency_[first].push_back(slot);
+    by_currency_[second].push_back(slot);
+  }
+
+  uint32_t record_slot;
+  uint8_t generation = 0;
+  if (!free_slots_.empty()) {
+    record_slot = free_slots_.back();
+    free_slots_.pop_back();
+    generation = static_cast<uint8_t>(
+        (records_[record_slot].generation + 1) &
+        ((1u << kAlertGenerationBits) - 1));
+  } else {
+    record_slot = static_cast<uint32_t>(records_.size());
+    records_.emplace_back();
+  }
+  records_[record_slot] = {threshold, slot, direction, true, generation};
+  AlertId id = static_cast<AlertId>(generation) << kAlertSlotBits | record_slot;
+  size_++;
+
+  WatchedPair& watched = watched_[slot];
+  std::vector<Trigger>& staged = direction == AlertDirection::kAbove
+                                     ? watched.staged_rising
+                                     : watched.staged_falling;
+  staged.push_back({threshold, id});
+  if (!watched.marked) {
+    watched.marked = true;
+    marked_.push_back(slot);
+  }
+  return id;
+}
+
+bool AlertIndex::Remove(AlertId id) {
+  uint32_t record_slot = id & kAlertSlotMask;
+  if (id >> kAlertSlotBits >= (1u << kAlertGenerationBits) ||
+      record_slot >= records_.size() || !records_[record_slot].pending ||
+      records_[record_slot].generation != id >> kAlertSlotBits) {
+    return false;
+  }
+  Record& record = records_[record_slot];
+  WatchedPair& watched = watched_[record.slot];
+  Merge(&watched);
+  std::vector<Trigger>& triggers = record.direction == AlertDirection::kAbove
+                                       ? watched.rising
+                                       : watched.falling;
+  // Both lists are ordered by threshold; only the direction differs.
+  auto range =
+      record.direction == AlertDirection::kAbove
+          ? std::equal_range(triggers.begin(), triggers.end(),
+                             Trigger{record.threshold, id},
+                             [](const Trigger& a, const Trigger& b) {
+                               return a.threshold > b.threshold;
+                             })
+          : std::equal_range(triggers.begin(), triggers.end(),
+                             Trigger{record.threshold, id},
+                             [](const Trigger& a, const Trigger& b) {
+                               return a.threshold < b.threshold;
+                             });
+  auto it = std::find_if(range.first, range.second,
+                         [id](const Trigger& t) { return t.id == id; });
+  triggers.erase(it);
+  record.pending = false;
+  free_slots_.push_back(record_slot);
+  size_--;
+  return true;
+}
+
+size_t AlertIndex::ApplyTicks(const RateTable& rates, const RateTick* ticks,
+                              size_t count, std::vector<FiredAlert>* out) {
+  for (size_t i = 0; i < count; i++) {
+    if (ticks[i].currency >= by_currency_.size()) {
+      continue;
+    }
+    for (uint32_t slot : by_currency_[ticks[i].currency]) {
+      if (!watched_[slot].marked) {
+        watched_[slot].marked = true;
+        marked_.push_back(slot);
+      }
+    }
+  }
+  size_t fired = 0;
+  for (uint32_t slot : marked_) {
+    WatchedPair& watched = watched_[slot];
+    watched.marked = false;
+    int64_t rate;
+    if (rates.CrossRate(watched.pair >> 16, watched.pair & 0xffff, &rate)) {
+      fired += Evaluate(slot, rate, out);
+    }
+  }
+  marked_.clear();
+  return fired;
+}
+
+size_t AlertIndex::Refresh(const RateTable& rates,
+                           std::vector<FiredAlert>* out) {
+  size_t fired = 0;
+  for (uint32_t slot = 0; slot < watched_.size(); slot++) {
+    WatchedPair& watched = watched_[slot];
+    bool marked = watched.marked;
+    watched.marked = false;
+    int64_t rate;
+    if (rates.CrossRate(watched.pair >> 16, watched.pair & 0xffff, &rate) &&
+        (rate != watched.rate || marked)) {
+      fired += Evaluate(slot, rate, out);
+    }
+  }
+  marked_.clear();
+  return fired;
+}
+
+size_t AlertIndex::Evaluate(uint32_t slot, int64_t rate,
+                            std::vector<FiredAlert>* out) {
+  WatchedPair& watched = watched_[slot];
+  Merge(&watched);
+  size_t fired = 0;
+  while (!watched.rising.empty() && watched.rising.back().threshold <= rate) {
+    Fire(watched, watched.rising.back(), rate, out);
+    watched.rising.pop_back();
+    fired++;
+  }
+  while (!watched.falling.empty() &&
+         watched.falling.back().threshold >= rate) {
+    Fire(watched, watched.falling.back(), rate, out);
+    watched.falling.pop_back();
+    fired++;
+  }
+  watched.rate = rate;
+  return fired;
+}
+
+void AlertIndex::Merge(WatchedPair* watched) {
+  auto merge = [](std::vector<Trigger>* triggers,
+                  std::vector<Trigger>* staged, auto before) {
+    if (staged->empty()) {
+      return;
+    }
+    if (staged->size() * kMaxInsertRatio < triggers->size()) {
+      // A few alerts: insert each. The lists end at the thresholds nearest
+      // the rate, where new alerts usually go, so little moves.
+      for (const Trigger& trigger : *staged) {
+        triggers->insert(std::upper_bound(triggers->begin(), triggers->end(),
+                                          trigger, before),
+                         trigger);
+      }
+    } else {
+      std::sort(staged->begin(), staged->end(), before);
+      size_t middle = triggers->size();
+      triggers->insert(triggers->end(), staged->begin(), staged->end());
+      std::inplace_merge(triggers->begin(), triggers->begin() + middle,
+                         triggers->end(), before);
+    }
+    staged->clear();
+  };
+  merge(&watched->rising, &watched->staged_rising,
+        [](const Trigger& a, const Trigger& b) {
+          return a.threshold > b.threshold;
+        });
+  merge(&watched->falling, &watched->staged_falling,
+        [](const Trigger& a, const Trigger& b) {
+          return a.threshold < b.threshold;
+        });
+}
+
+void AlertIndex::Fire(const WatchedPair& watched, const Trigger& trigger,
+                      int64_t rate, std::vector<FiredAlert>* out) {
+  out->push_back({trigger.id, watched.pair, rate});
+  uint32_t record_slot = trigger.id & kAlertSlotMask;
+  records_[record_slot].pending = false;
+  free_slots_.push_back(record_slot);
+  size_--;
+}
+
+}  // namespace converter
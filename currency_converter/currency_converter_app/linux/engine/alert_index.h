@@ -0,0 +1,133 @@
+#ifndef CONVERTER_ENGINE_ALERT_INDEX_H_
+#define CONVERTER_ENGINE_ALERT_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "rate_store.h"
+#include "rate_table.h"
+
+namespace converter {
+
+// An alert's slot in the index in the low kAlertSlotBits, and above them
+// the slot's generation, which moves on each time the slot is reused. Ids
+// stay below 2^31, so they fit the int32 lists of the channel.
+using AlertId = uint32_t;
+constexpr AlertId kInvalidAlert = 0xffffffff;
+constexpr int kAlertSlotBits = 23;
+constexpr int kAlertGenerationBits = 8;
+
+enum class AlertDirection : uint8_t {
+  // Fires once the rate is at or above the threshold.
+  kAbove,
+  // Fires once the rate is at or below the threshold.
+  kBelow,
+};
+
+struct FiredAlert {
+  AlertId id;
+  // The pair, packed with PackPair, and the cross rate that fired it, in
+  // units of second per first scaled by kRateScale.
+  uint32_t pair;
+  int64_t rate;
+};
+
+// One-shot "notify me when the rate crosses X" alerts over currency pairs.
+//
+// Each watched pair keeps the thresholds still waiting for the rate to rise
+// sorted in descending order and those waiting for it to fall in ascending
+// order, so the next threshold to fire either way is at the back. A rate
+// change pops exactly the thresholds it crossed and looks at no other
+// alert. Alerts are registered into a per-pair staging list that is sorted
+// and merged in on the pair's next evaluation, so adding many alerts costs
+// one sort rather than an insertion each.
+//
+// Not thread-safe.
+class AlertIndex {
+ public:
+  AlertIndex();
+
+  // Registers an alert on |pair|, packed with PackPair, against |threshold|
+  // in units of second per first scaled by kRateScale. An alert whose
+  // condition already holds fires at the pair's next evaluation. Returns
+  // its id, or kInvalidAlert for an invalid pair or threshold or once
+  // 2^kAlertSlotBits alerts are pending. The slots of fired and removed
+  // alerts are reused under a new id, so an id that was handed out before
+  // does not name a later alert until its slot has been reused
+  // 2^kAlertGenerationBits times.
+  AlertId Add(uint32_t pair, AlertDirection direction, int64_t threshold);
+  // Cancels alert |id|. Returns false if it is not pending, which includes
+  // an id whose alert fired or was removed and whose slot now holds another.
+  bool Remove(AlertId id);
+
+  // Number of alerts pending.
+  size_t size() const { return size_; }
+
+  // Evaluates the watched pairs that include a currency in |ticks|, and
+  // those with alerts added since, at |rates|, the table with the ticks
+  // applied. Appends the alerts that fired to |out| and returns their
+  // number.
+  size_t ApplyTicks(const RateTable& rates, const RateTick* ticks,
+                    size_t count, std::vector<FiredAlert>* out);
+
+  // As ApplyTicks, for the watched pairs whose cross rate differs from the
+  // one they were last evaluated at or that have new alerts. Compares one
+  // rate per watched pair, not per alert.
+  size_t Refresh(const RateTable& rates, std::vector<FiredAlert>* out);
+
+ private:
+  struct Trigger {
+    int64_t threshold;
+    AlertId id;
+  };
+
+  struct WatchedPair {
+    uint32_t pair;
+    // Cross rate at the last evaluation, or 0 before the first.
+    int64_t rate = 0;
+    // Waiting for a rise, in descending order of threshold, and for a fall,
+    // in ascending order.
+    std::vector<Trigger> rising;
+    std::vector<Trigger> falling;
+    // Added since the last evaluation, in no order.
+    std::vector<Trigger> staged_rising;
+    std::vector<Trigger> staged_falling;
+    // Due for evaluation: has alerts added since the last one, or is queued
+    // in |marked_|.
+    bool marked = false;
+  };
+
+  struct Record {
+    int64_t threshold;
+    uint32_t slot;
+    AlertDirection direction;
+    bool pending;
+    // Of the id the record was last handed out under.
+    uint8_t generation;
+  };
+
+  // Evaluates the pair in |slot| at |rate|.
+  size_t Evaluate(uint32_t slot, int64_t rate, std::vector<FiredAlert>* out);
+  // Sorts the staged alerts of |watched| into its trigger lists.
+  static void Merge(WatchedPair* watched);
+  void Fire(const WatchedPair& watched, const Trigger& trigger, int64_t rate,
+            std::vector<FiredAlert>* out);
+
+  std::vector<WatchedPair> watched_;
+  // Slot in |watched_| per pair, indexed by first * CurrencyCount() +
+  // second, or kNoSlot.
+  std::vector<uint32_t> slots_;
+  // Slots of the watched pairs that include each currency.
+  std::vector<std::vector<uint32_t>> by_currency_;
+  std::vector<uint32_t> marked_;
+
+  // Per alert slot, the low kAlertSlotBits of an id.
+  std::vector<Record> records_;
+  std::vector<uint32_t> free_slots_;
+  size_t size_ = 0;
+};
+
+}  // namespace converter
+
+#endif  // CONVERTER_ENGINE_ALERT_INDEX_H_
@@ -0,0 +1,75 @@
+#ifndef CONVERTER_ENGINE_ALIGNED_BUFFER_H_
+#define CONVERTER_ENGINE_ALIGNED_BUFFER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace converter {
+
+constexpr size_t kCacheLineSize = 64;
+
+// A fixed-size, zero-initialised array of trivially copyable |T| whose first
+// element starts on a cache-line boundary.
+template <typename T>
+class AlignedBuffer {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "AlignedBuffer only holds trivially copyable types");
+
+ public:
+  AlignedBuffer() = default;
+  // Throws std::bad_alloc, as operator new does, if the memory cannot be
+  // allocated.
+  explicit AlignedBuffer(size_t size) : size_(size) {
+    if (size == 0) {
+      return;
+    }
+    if (size > (SIZE_MAX - kCacheLineSize) / sizeof(T)) {
+      throw std::bad_alloc();
+    }
+    // aligned_alloc requires the byte count to be a multiple of the alignment.
+    size_t bytes = (size * sizeof(T) + kCacheLineSize - 1) / kCacheLineSize *
+                   kCacheLineSize;
+    data_ = static_cast<T*>(std::aligned_alloc(kCacheLineSize, bytes));
+    if (data_ == nullptr) {
+      throw std::bad_alloc();
+    }
+    std::memset(static_cast<void*>(data_), 0, bytes);
+  }
+  AlignedBuffer(const AlignedBuffer& other) : AlignedBuffer(other.size_) {
+    std::memcpy(static_cast<void*>(data_), other.data_, size_ * sizeof(T));
+  }
+  AlignedBuffer(AlignedBuffer&& other) noexcept
+      : data_(std::exchange(other.data_, nullptr)),
+        size_(std::exchange(other.size_, 0)) {}
+  AlignedBuffer& operator=(AlignedBuffer other) noexcept {
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    return *this;
+  }
+  ~AlignedBuffer() { std::free(data_); }
+
+  // Copies the contents of |other|, which must have the same size, without
+  // reallocating.
+  void CopyFrom(const AlignedBuffer& other) {
+    std::memcpy(static_cast<void*>(data_), other.data_, size_ * sizeof(T));
+  }
+
+  T* data() { return data_; }
+  const T* data() const { return data_; }
+  size_t size() const { return size_; }
+  T& operator[](size_t i) { return data_[i]; }
+  const T& operator[](size_t i) const { return data_[i]; }
+
+ private:
+  T* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+}  // namespace converter
+
+#endif  // CONVERTER_ENGINE_ALIGNED_BUFFER_H_
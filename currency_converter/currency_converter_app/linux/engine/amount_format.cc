@@ -0,0 +1,373 @@
+#include "amount_format.h"
+
+#include <algorithm>
+#include <charconv>
+
+#include "fixed_point.h"
+
+namespace converter {
+
+namespace {
+
+// U+00A0 NO-BREAK SPACE and U+202F NARROW NO-BREAK SPACE.
+constexpr std::string_view kNoBreakSpace = "\xc2\xa0";
+constexpr std::string_view kNarrowNoBreakSpace = "\xe2\x80\xaf";
+
+constexpr NumberFormat kEnglish = {'.', ",", 3, 3};
+constexpr NumberFormat kIndian = {'.', ",", 3, 2};
+constexpr NumberFormat kDotGrouped = {',', ".", 3, 3};
+constexpr NumberFormat kSpaceGrouped = {',', kNoBreakSpace, 3, 3};
+constexpr NumberFormat kNarrowSpaceGrouped = {',', kNarrowNoBreakSpace, 3, 3};
+constexpr NumberFormat kApostropheGrouped = {'.', "\xe2\x80\x99", 3, 3};
+
+struct LocaleFormat {
+  std::string_view language;
+  // Empty to match any region not listed separately.
+  std::string_view region;
+  const NumberFormat* format;
+};
+
+// Following CLDR. Region-specific entries come before the language-wide one
+// they override.
+constexpr LocaleFormat kLocaleFormats[] = {
+    {"bn", "", &kIndian},
+    {"cs", "", &kSpaceGrouped},
+    {"da", "", &kDotGrouped},
+    {"de", "CH", &kApostropheGrouped},
+    {"de", "LI", &kApostropheGrouped},
+    {"de", "", &kDotGrouped},
+    {"el", "", &kDotGrouped},
+    {"en", "IN", &kIndian},
+    {"es", "MX", &kEnglish},
+    {"es", "US", &kEnglish},
+    {"es", "", &kDotGrouped},
+    {"fi", "", &kSpaceGrouped},
+    {"fr", "CH", &kNarrowSpaceGrouped},
+    {"fr", "", &kNarrowSpaceGrouped},
+    {"gu", "", &kIndian},
+    {"hi", "", &kIndian},
+    {"hr", "", &kDotGrouped},
+    {"hu", "", &kSpaceGrouped},
+    {"id", "", &kDotGrouped},
+    {"it", "CH", &kApostropheGrouped},
+    {"it", "", &kDotGrouped},
+    {"kn", "", &kIndian},
+    {"ml", "", &kIndian},
+    {"mr", "", &kIndian},
+    {"nb", "", &kSpaceGrouped},
+    {"nl", "", &kDotGrouped},
+    {"pl", "", &kSpaceGrouped},
+    {"pt", "PT", &kSpaceGrouped},
+    {"pt", "", &kDotGrouped},
+    {"ro", "", &kDotGrouped},
+    {"ru", "", &kSpaceGrouped},
+    {"sk", "", &kSpaceGrouped},
+    {"sl", "", &kDotGrouped},
+    {"sv", "", &kSpaceGrouped},
+    {"ta", "", &kIndian},
+    {"te", "", &kIndian},
+    {"tr", "", &kDotGrouped},
+    {"uk", "", &kSpaceGrouped},
+    {"vi", "", &kDotGrouped},
+};
+
+constexpr uint64_t kPow10[] = {
+    1,
+    10,
+    100,
+    1000,
+    10000,
+    100000,
+    1000000,
+    10000000,
+    100000000,
+    1000000000,
+    10000000000,
+    100000000000,
+    1000000000000,
+    10000000000000,
+    100000000000000,
+    1000000000000000,
+    10000000000000000,
+    100000000000000000,
+    1000000000000000000,
+    10000000000000000000u,
+};
+
+// Any 19-digit number fits in uint64; the result is range-checked after.
+constexpr int kMaxWholeDigits = 19;
+
+inline bool IsDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+bool IsSpaceSeparator(std::string_view separator) {
+  return separator == " " || separator == kNoBreakSpace ||
+         separator == kNarrowNoBreakSpace;
+}
+
+// Returns the length of the group separator starting at |text|, or 0.
+size_t MatchSeparator(std::string_view text, const NumberFormat& format) {
+  if (format.group_separator.empty()) {
+    return 0;
+  }
+  if (text.substr(0, format.group_separator.size()) ==
+      format.group_separator) {
+    return format.group_separator.size();
+  }
+  // Spaces look alike, so accept any of them where the locale uses one.
+  if (IsSpaceSeparator(format.group_separator)) {
+    for (std::string_view space : {std::string_view(" "), kNoBreakSpace,
+                                   kNarrowNoBreakSpace}) {
+      if (text.substr(0, space.size()) == space) {
+        return space.size();
+      }
+    }
+  }
+  return 0;
+}
+
+std::string_view TrimWhitespace(std::string_view text) {
+  while (!text.empty() && (text.front() == ' ' || text.front() == '\t' ||
+                           text.front() == '\n' || text.front() == '\r')) {
+    text.remove_prefix(1);
+  }
+  while (!text.empty() && (text.back() == ' ' || text.back() == '\t' ||
+                           text.back() == '\n' || text.back() == '\r')) {
+    text.remove_suffix(1);
+  }
+  return text;
+}
+
+// Parses a run of at most 19 digits, which always fits in uint64.
+inline uint64_t ParseDigits(const char* begin, const char* end) {
+  uint64_t value = 0;
+  std::from_chars(begin, end, value);
+  return value;
+}
+
+// Returns the number of decimal digits in |value|, counting 0 as one digit.
+inline int DigitCount(uint64_t value) {
+  // Estimate from the bit length, as log10(2) ~= 1233 / 4096, then correct.
+  int bits = 64 - __builtin_clzll(value | 1);
+  int estimate = (bits * 1233) >> 12;
+  return std::max(estimate + (value >= kPow10[estimate]), 1);
+}
+
+// Copies |size| bytes. Sizes here are a few bytes, where a loop beats a
+// call to memcpy.
+inline char* AppendBytes(char* out, const char* bytes, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    out[i] = bytes[i];
+  }
+  return out + size;
+}
+
+}  // namespace
+
+const NumberFormat& NumberFormatForLocale(std::string_view locale) {
+  // Drop any encoding or modifier, e.g. "fr_FR.UTF-8" or "de_DE@euro".
+  locale = locale.substr(0, locale.find_first_of(".@"));
+  size_t split = locale.find_first_of("_-");
+  std::string_view language = locale.substr(0, split);
+  std::string_view region =
+      split == std::string_view::npos ? std::string_view()
+                                      : locale.substr(split + 1);
+  for (const LocaleFormat& entry : kLocaleFormats) {
+    if (entry.language == language &&
+        (entry.region.empty() || entry.region == region)) {
+      return *entry.format;
+    }
+  }
+  return kEnglish;
+}
+
+bool ParseAmount(std::string_view text, int minor_units,
+                 const NumberFormat& format, int64_t* out) {
+  text = TrimWhitespace(text);
+  const char* p = text.data();
+  const char* end = p + text.size();
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = *p == '-';
+    p++;
+  }
+
+  // Whole digits, in runs split by group separators. Groups must have the
+  // locale's sizes, so a separator typed where another locale puts its
+  // decimal point, as "1,5" in en_US or "1.5" in de_DE, is rejected rather
+  // than silently scaling the amount.
+  uint64_t whole = 0;
+  int whole_digits = 0;
+  int groups = 0;
+  int last_run = 0;
+  while (true) {
+    const char* run_end = p;
+    while (run_end < end && IsDigit(*run_end)) {
+      run_end++;
+    }
+    int run = static_cast<int>(run_end - p);
+    if (run == 0) {
+      // Only ".5" may have no whole digits at all.
+      if (whole_digits != 0 || p == end || *p != format.decimal_point) {
+        return false;
+      }
+      break;
+    }
+    whole_digits += run;
+    if (whole_digits > kMaxWholeDigits) {
+      return false;
+    }
+    whole = whole * kPow10[run] + ParseDigits(p, run_end);
+    last_run = run;
+    p = run_end;
+    size_t separator = MatchSeparator(std::string_view(p, end - p), format);
+    if (separator == 0 || p + separator == end || !IsDigit(p[separator])) {
+      break;
+    }
+    // A leading group has 1 to secondary_group digits, later ones exactly
+    // that many; the last is checked below.
+    if (run > format.secondary_group ||
+        (groups > 0 && run != format.secondary_group)) {
+      return false;
+    }
+    groups++;
+    p += separator;
+  }
+  if (groups > 0 && last_run != format.primary_group) {
+    return false;
+  }
+
+  uint64_t fraction = 0;
+  bool round_up = false;
+  if (p < end && *p == format.decimal_point) {
+    p++;
+    const char* digits_end = p;
+    while (digits_end < end && IsDigit(*digits_end)) {
+      digits_end++;
+    }
+    if (whole_digits == 0 && digits_end == p) {
+      return false;
+    }
+    const char* kept_end = std::min(digits_end, p + minor_units);
+    fraction = ParseDigits(p, kept_end) *
+               kPow10[minor_units - (kept_end - p)];
+    if (kept_end < digits_end) {
+      // Round half to even on the dropped digits.
+      char first = *kept_end;
+      bool rest_nonzero =
+          std::find_if(kept_end + 1, digits_end,
+                       [](char c) { return c != '0'; }) != digits_end;
+      uint64_t last = minor_units > 0 ? fraction : whole;
+      round_up = first > '5' || (first == '5' && (rest_nonzero || last & 1));
+    }
+    p = digits_end;
+  }
+  if (p != end) {
+    return false;
+  }
+
+  __int128 value = static_cast<__int128>(whole) * kPow10[minor_units] +
+                   fraction + round_up;
+  if (negative) {
+    value = -value;
+  }
+  if (value > INT64_MAX || value < INT64_MIN) {
+    return false;
+  }
+  *out = static_cast<int64_t>(value);
+  return true;
+}
+
+size_t FormatAmount(int64_t minor, int minor_units, const NumberFormat& format,
+                    char* out) {
+  uint64_t magnitude = minor < 0 ? 0 - static_cast<uint64_t>(minor)
+                                 : static_cast<uint64_t>(minor);
+  uint64_t whole = magnitude / kPow10[minor_units];
+  uint64_t fraction = magnitude - whole * kPow10[minor_units];
+
+  char* p = out;
+  if (minor < 0) {
+    *p++ = '-';
+  }
+  char digits[20];
+  size_t count = std::to_chars(digits, digits + sizeof(digits), whole).ptr -
+                 digits;
+  const char* separator = format.group_separator.data();
+  size_t separator_size = format.group_separator.size();
+  if (separator_size == 0 || count <= format.primary_group) {
+    p = AppendBytes(p, digits, count);
+  } else {
+    // A leading partial group, full secondary groups, then the primary
+    // group next to the decimal point.
+    const char* next = digits;
+    size_t rest = count - format.primary_group;
+    size_t lead = rest % format.secondary_group;
+    if (lead == 0) {
+      lead = format.secondary_group;
+    }
+    p = AppendBytes(p, next, lead);
+    next += lead;
+    rest -= lead;
+    while (rest != 0) {
+      p = AppendBytes(p, separator, separator_size);
+      p = AppendBytes(p, next, format.secondary_group);
+      next += format.secondary_group;
+      rest -= format.secondary_group;
+    }
+    p = AppendBytes(p, separator, separator_size);
+    p = AppendBytes(p, next, format.primary_group);
+  }
+
+  if (minor_units > 0) {
+    *p++ = format.decimal_point;
+    for (int i = minor_units - 1; i >= 0; i--) {
+      p[i] = static_cast<char>('0' + fraction % 10);
+      fraction /= 10;
+    }
+    p += minor_units;
+  }
+  return p - out;
+}
+
+void FormatAmounts(const int64_t* minor, size_t count, int minor_units,
+                   const NumberFormat& format, std::pmr::string* text,
+                   std::pmr::vector<uint32_t>* offsets) {
+  // Two passes: the first sizes every amount from its digit count alone, so
+  // |text| is allocated once at its exact size and the second pass writes
+  // straight into it.
+  size_t length_by_digits[21] = {};
+  for (int digits = 1; digits <= 20; digits++) {
+    int whole_digits = std::max(digits - minor_units, 1);
+    size_t length = whole_digits;
+    if (!format.group_separator.empty() &&
+        whole_digits > format.primary_group) {
+      size_t groups =
+          1 + (whole_digits - format.primary_group - 1) / format.secondary_group;
+      length += groups * format.group_separator.size();
+    }
+    if (minor_units > 0) {
+      length += 1 + minor_units;
+    }
+    length_by_digits[digits] = length;
+  }
+
+  offsets->resize(count + 1);
+  uint32_t* offset = offsets->data();
+  size_t size = 0;
+  for (size_t i = 0; i < count; i++) {
+    offset[i] = static_cast<uint32_t>(size);
+    uint64_t magnitude = minor[i] < 0 ? 0 - static_cast<uint64_t>(minor[i])
+                                      : static_cast<uint64_t>(minor[i]);
+    size += length_by_digits[DigitCount(magnitude)] + (minor[i] < 0);
+  }
+  offset[count] = static_cast<uint32_t>(size);
+
+  text->resize(size);
+  char* data = &(*text)[0];
+  for (size_t i = 0; i < count; i++) {
+    FormatAmount(minor[i], minor_units, format, data + offset[i]);
+  }
+}
+
+}  // namespace converter
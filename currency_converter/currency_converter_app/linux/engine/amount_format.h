@@ -0,0 +1,59 @@
+#ifndef CONVERTER_ENGINE_AMOUNT_FORMAT_H_
+#define CONVERTER_ENGINE_AMOUNT_FORMAT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace converter {
+
+// How a locale writes amounts: "1,234,567.89" in en_US, "12,34,567.89" in
+// en_IN, "1.234.567,89" in de_DE.
+struct NumberFormat {
+  // Separator between whole and fractional digits.
+  char decimal_point;
+  // UTF-8 text placed between digit groups; empty for no grouping.
+  std::string_view group_separator;
+  // Digits in the group next to the decimal point, and in each group to the
+  // left of it.
+  uint8_t primary_group;
+  uint8_t secondary_group;
+};
+
+// Upper bound on the length of one formatted amount, in bytes.
+constexpr size_t kMaxAmountTextSize = 48;
+
+// Returns the format for |locale|, a language tag such as "en_IN", "de-CH"
+// or "fr_FR.UTF-8". Unknown languages get the en_US format.
+const NumberFormat& NumberFormatForLocale(std::string_view locale);
+
+// Parses |text|, as typed by a user in |format|, into an integer number of
+// 10^-|minor_units| units. Whole digits may be grouped, but only as
+// |format| groups them: "1,234,567" and "1234567" parse in en_US, "1,5" and
+// "12,34" do not. Where a locale groups with a space, any of the usual space
+// characters is accepted. Surrounding whitespace and a leading sign are
+// allowed. Digits beyond |minor_units| are rounded half to even. Returns
+// false on malformed input or overflow.
+bool ParseAmount(std::string_view text, int minor_units,
+                 const NumberFormat& format, int64_t* out);
+
+// Writes |minor|, in 10^-|minor_units| units, in |format| to |out|, which
+// must have room for kMaxAmountTextSize bytes. Returns the number of bytes
+// written; no terminator is added.
+size_t FormatAmount(int64_t minor, int minor_units, const NumberFormat& format,
+                    char* out);
+
+// Formats |count| amounts back to back into |text|, replacing its contents,
+// with no separator between them. Amount i occupies bytes
+// [offsets[i], offsets[i + 1]), so |offsets| gets |count| + 1 entries. Both
+// are allocated from their own resources, e.g. a RequestArena's.
+void FormatAmounts(const int64_t* minor, size_t count, int minor_units,
+                   const NumberFormat& format, std::pmr::string* text,
+                   std::pmr::vector<uint32_t>* offsets);
+
+}  // namespace converter
+
+#endif  // CONVERTER_ENGINE_AMOUNT_FORMAT_H_
@@ -0,0 +1,303 @@
+#include "arbitrage.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "fixed_point.h"
+#include "tick.h"
+
+namespace converter {
+
+namespace {
+
+constexpr double kNoLeg = std::numeric_limits<double>::infinity();
+
+// Beyond this many changed currencies one search of the whole graph is
+// cheaper than a search from each.
+constexpr size_t kMaxIncrementalSources = 4;
+
+// Searches repeated from one source once it yields a cycle, to find others
+// through the same currency.
+constexpr int kMaxCyclesPerSearch = 4;
+
+// Bounds the flagged cycles, and so the per-leg quarantine counts.
+constexpr size_t kMaxCycles = 64;
+
+}  // namespace
+
+ArbitrageDetector::ArbitrageDetector(double tolerance)
+    : size_(CurrencyCount()),
+      shift_(std::log1p(tolerance)),
+      weights_(size_ * size_, kNoLeg),
+      quarantined_(size_ * size_, 0),
+      legs_(size_),
+      is_source_(size_, 0),
+      distance_(size_),
+      parent_(size_),
+      queued_(size_, 0) {}
+
+void ArbitrageDetector::SetBaseRates(const RateTable& rates) {
+  for (size_t i = 0; i < size_; i++) {
+    CurrencyId currency = static_cast<CurrencyId>(i);
+    SetBaseLeg(currency, rates.BaseRate(currency));
+  }
+}
+
+void ArbitrageDetector::ApplyBaseTicks(const RateTick* ticks, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    if (ticks[i].currency < size_ && ticks[i].rate > 0) {
+      SetBaseLeg(ticks[i].currency, ticks[i].rate);
+    }
+  }
+}
+
+bool ArbitrageDetector::ApplyQuote(uint32_t pair, int64_t rate) {
+  CurrencyId first = pair >> 16;
+  CurrencyId second = pair & 0xffff;
+  if (rate <= 0 || first == second || first >= size_ || second >= size_) {
+    return false;
+  }
+  CurrencyId base = BaseCurrency();
+  if (first == base || second == base) {
+    RateTick tick;
+    if (QuoteToRateTick(pair, rate, &tick)) {
+      SetBaseLeg(tick.currency, tick.rate);
+    }
+    return true;
+  }
+  double real = static_cast<double>(rate) / kRateScale;
+  SetLeg(first, second, real);
+  SetLeg(second, first, 1 / real);
+  // Any cycle through either leg passes through |first|.
+  MarkChanged(first);
+  return true;
+}
+
+void ArbitrageDetector::SetLeg(CurrencyId from, CurrencyId to, double rate) {
+  double& weight = weights_[static_cast<size_t>(from) * size_ + to];
+  double updated = -std::log(rate);
+  if (weight == updated) {
+    return;
+  }
+  if (weight == kNoLeg) {
+    legs_[from].push_back(to);
+  }
+  weight = updated;
+}
+
+void ArbitrageDetector::MarkChanged(CurrencyId currency) {
+  if (!is_source_[currency]) {
+    is_source_[currency] = 1;
+    sources_.push_back(currency);
+  }
+}
+
+void ArbitrageDetector::SetBaseLeg(CurrencyId currency, int64_t rate) {
+  CurrencyId base = BaseCurrency();
+  if (currency == base || rate <= 0) {
+    return;
+  }
+  double real = static_cast<double>(rate) / kRateScale;
+  SetLeg(base, currency, real);
+  SetLeg(currency, base, 1 / real);
+  // One search from the base currency covers every base leg.
+  MarkChanged(base);
+}
+
+bool ArbitrageDetector::Check() {
+  bool changed = Reverify();
+  if (sources_.size() > kMaxIncrementalSources) {
+    return CheckAll() || changed;
+  }
+  for (CurrencyId source : sources_) {
+    is_source_[source] = 0;
+    ArbitrageCycle cycle;
+    for (int i = 0; i < kMaxCyclesPerSearch && Search(source, &cycle); i++) {
+      if (!Flag(std::move(cycle))) {
+        break;
+      }
+      changed = true;
+    }
+  }
+  sources_.clear();
+  return changed;
+}
+
+bool ArbitrageDetector::CheckAll() {
+  bool changed = Reverify();
+  for (CurrencyId source : sources_) {
+    is_source_[source] = 0;
+  }
+  sources_.clear();
+  ArbitrageCycle cycle;
+  for (int i = 0; i < kMaxCyclesPerSearch && Search(kInvalidCurrency, &cycle);
+       i++) {
+    if (!Flag(std::move(cycle))) {
+      break;
+    }
+    changed = true;
+  }
+  return changed;
+}
+
+bool ArbitrageDetector::Reverify() {
+  bool changed = false;
+  for (size_t i = 0; i < cycles_.size();) {
+    ArbitrageCycle& cycle = cycles_[i];
+    double total = 0;
+    size_t count = cycle.currencies.size();
+    for (size_t j = 0; j < count; j++) {
+      total += weight(cycle.currencies[j], cycle.currencies[(j + 1) % count]);
+    }
+    if (total + shift_ * count < 0) {
+      double gain = std::expm1(-total);
+      changed |= gain != cycle.gain;
+      cycle.gain = gain;
+      i++;
+      continue;
+    }
+    Quarantine(cycle, -1);
+    cycles_.erase(cycles_.begin() + i);
+    changed = true;
+  }
+  return changed;
+}
+
+bool ArbitrageDetector::Search(CurrencyId source, ArbitrageCycle* cycle) {
+  active_.clear();
+  std::fill(parent_.begin(), parent_.end(), kInvalidCurrency);
+  if (source == kInvalidCurrency) {
+    // A virtual source with a free leg to every currency.
+    std::fill(distance_.begin(), distance_.end(), 0.0);
+    for (size_t i = 0; i < size_; i++) {
+      active_.push_back(static_cast<CurrencyId>(i));
+    }
+  } else {
+    std::fill(distance_.begin(), distance_.end(), kNoLeg);
+    distance_[source] = 0;
+    active_.push_back(source);
+  }
+
+  // Queue-based Bellman-Ford: each round relaxes only the legs out of
+  // currencies whose distance fell in the previous one.
+  // Shortest paths have at most size_ legs, counting the virtual one.
+  for (size_t round = 0; round <= size_ && !active_.empty(); round++) {
+    next_.clear();
+    for (CurrencyId from : active_) {
+      double base = distance_[from] + shift_;
+      const double* row = weights_.data() + static_cast<size_t>(from) * size_;
+      const uint8_t* skip =
+          quarantined_.data() + static_cast<size_t>(from) * size_;
+      for (CurrencyId to : legs_[from]) {
+        double distance = base + row[to];
+        if (distance >= distance_[to] || skip[to] != 0) {
+          continue;
+        }
+        distance_[to] = distance;
+        parent_[to] = from;
+        if (to == source) {
+          for (CurrencyId currency : next_) {
+            queued_[currency] = 0;
+          }
+          ExtractCycle(source, from, cycle);
+          return true;
+        }
+        if (!queued_[to]) {
+          queued_[to] = 1;
+          next_.push_back(to);
+        }
+      }
+    }
+    for (CurrencyId currency : next_) {
+      queued_[currency] = 0;
+    }
+    active_.swap(next_);
+  }
+  if (active_.empty()) {
+    return false;
+  }
+  // Distances still falling after every round: some cycle is negative.
+  ExtractCycle(kInvalidCurrency, active_.front(), cycle);
+  return true;
+}
+
+void ArbitrageDetector::ExtractCycle(CurrencyId source, CurrencyId last,
+                                     ArbitrageCycle* cycle) {
+  std::vector<CurrencyId>& currencies = cycle->currencies;
+  currencies.clear();
+  if (source != kInvalidCurrency) {
+    CurrencyId current = last;
+    while (current != source && current != kInvalidCurrency &&
+           currencies.size() <= size_) {
+      currencies.push_back(current);
+      current = parent_[current];
+    }
+    if (current == source) {
+      currencies.push_back(source);
+      std::reverse(currencies.begin(), currencies.end());
+      return;
+    }
+    // The walk entered a negative cycle that does not reach |source|.
+    currencies.clear();
+  }
+  // After size_ steps back the walk is certainly on a cycle.
+  CurrencyId start = last;
+  for (size_t i = 0; i < size_ && start != kInvalidCurrency; i++) {
+    start = parent_[start];
+  }
+  CurrencyId current = start;
+  while (current != kInvalidCurrency) {
+    currencies.push_back(current);
+    current = parent_[current];
+    if (current == start) {
+      break;
+    }
+    if (currencies.size() > size_) {
+      current = kInvalidCurrency;
+    }
+  }
+  if (current == kInvalidCurrency) {
+    // Not expected; Flag ignores the empty cycle.
+    currencies.clear();
+    return;
+  }
+  std::reverse(currencies.begin(), currencies.end());
+}
+
+bool ArbitrageDetector::Flag(ArbitrageCycle cycle) {
+  std::vector<CurrencyId>& currencies = cycle.currencies;
+  if (currencies.size() < 2 || cycles_.size() >= kMaxCycles) {
+    return false;
+  }
+  std::rotate(currencies.begin(),
+              std::min_element(currencies.begin(), currencies.end()),
+              currencies.end());
+  for (const ArbitrageCycle& flagged : cycles_) {
+    if (flagged.currencies == currencies) {
+      return false;
+    }
+  }
+  double total = 0;
+  for (size_t i = 0; i < currencies.size(); i++) {
+    total += weight(currencies[i], currencies[(i + 1) % currencies.size()]);
+  }
+  if (total + shift_ * currencies.size() >= 0) {
+    return false;
+  }
+  cycle.gain = std::expm1(-total);
+  Quarantine(cycle, 1);
+  cycles_.push_back(std::move(cycle));
+  return true;
+}
+
+void ArbitrageDetector::Quarantine(const ArbitrageCycle& cycle, int delta) {
+  size_t count = cycle.currencies.size();
+  for (size_t i = 0; i < count; i++) {
+    size_t leg = static_cast<size_t>(cycle.currencies[i]) * size_ +
+                 cycle.currencies[(i + 1) % count];
+    quarantined_[leg] = static_cast<uint8_t>(quarantined_[leg] + delta);
+  }
+}
+
+}  // namespace converter
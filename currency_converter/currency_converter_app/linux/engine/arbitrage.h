@@ -0,0 +1,114 @@
+#ifndef CONVERTER_ENGINE_ARBITRAGE_H_
+#define CONVERTER_ENGINE_ARBITRAGE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "rate_store.h"
+#include "rate_table.h"
+
+namespace converter {
+
+// A cycle of quotes whose rates multiply to more than one: converting an
+// amount along currencies[0] -> currencies[1] -> ... -> currencies[0]
+// returns 1 + gain times the amount.
+struct ArbitrageCycle {
+  std::vector<CurrencyId> currencies;
+  double gain = 0;
+};
+
+// Flags inconsistent quotes, which usually mean a stale or bad feed.
+//
+// The detector holds a graph with a leg per quoted direction: the base
+// currency to and from every currency at its base rate, plus a leg each way
+// for every cross pair quoted directly. The cross-rate matrix of a
+// RateTable is triangulated from the base rates and so is consistent by
+// construction; only direct cross quotes can disagree with it.
+//
+// A leg a -> b at rate r weighs -ln(r) + ln(1 + tolerance), so a cycle of
+// k legs weighs less than zero exactly when its rates multiply to more than
+// (1 + tolerance)^k. Cycles are negative cycles of the graph, found with
+// Bellman-Ford. Every cycle through a changed leg passes through one of its
+// ends, so Check() searches only from the currencies whose legs changed;
+// a search from the base currency covers any number of base-rate ticks.
+//
+// Legs of a flagged cycle are left out of later searches and the cycle is
+// re-verified directly instead, so a bad quote that persists costs no more
+// than a good one. Not thread-safe.
+class ArbitrageDetector {
+ public:
+  // Default allowed disagreement per leg, one basis point.
+  static constexpr double kDefaultTolerance = 1e-4;
+
+  explicit ArbitrageDetector(double tolerance = kDefaultTolerance);
+
+  // Replaces every base leg with the base rates of |rates|.
+  void SetBaseRates(const RateTable& rates);
+  // Updates the base legs of the currencies in |ticks|.
+  void ApplyBaseTicks(const RateTick* ticks, size_t count);
+  // Records a direct quote for |pair|, packed with PackPair, in units of
+  // second per first scaled by kRateScale. Quotes against the base currency
+  // update its base leg. Returns false for an invalid pair or rate.
+  bool ApplyQuote(uint32_t pair, int64_t rate);
+
+  // Searches for cycles through the legs changed since the last check, and
+  // drops flagged cycles that no longer hold. Returns true if cycles()
+  // changed.
+  bool Check();
+  // As Check, but searches the whole graph.
+  bool CheckAll();
+
+  // The cycles currently flagged, each starting at its smallest currency.
+  const std::vector<ArbitrageCycle>& cycles() const { return cycles_; }
+
+ private:
+  // Sets the weight of leg |from| -> |to| to -ln(|rate|), |rate| in natural
+  // units.
+  void SetLeg(CurrencyId from, CurrencyId to, double rate);
+  // Sets both base legs of |currency| from its base |rate|, scaled by
+  // kRateScale.
+  void SetBaseLeg(CurrencyId currency, int64_t rate);
+  // Queues a search from |currency| at the next check.
+  void MarkChanged(CurrencyId currency);
+  double weight(CurrencyId from, CurrencyId to) const {
+    return weights_[static_cast<size_t>(from) * size_ + to];
+  }
+  // Recomputes the gain of each flagged cycle, dropping those within
+  // tolerance. Returns true if any was dropped.
+  bool Reverify();
+  // Runs Bellman-Ford from |source|, or from every currency at once if it is
+  // kInvalidCurrency. Returns true and fills |cycle| if a negative cycle was
+  // found.
+  bool Search(CurrencyId source, ArbitrageCycle* cycle);
+  // Extracts the cycle ending at |last| from the parent pointers, walking
+  // back to |source| if given.
+  void ExtractCycle(CurrencyId source, CurrencyId last, ArbitrageCycle* cycle);
+  // Adds |cycle| unless already flagged. Returns true if added.
+  bool Flag(ArbitrageCycle cycle);
+  void Quarantine(const ArbitrageCycle& cycle, int delta);
+
+  size_t size_;
+  double shift_;
+  // Leg weights, row-major; +infinity where there is no leg.
+  std::vector<double> weights_;
+  // Number of flagged cycles using each leg, row-major.
+  std::vector<uint8_t> quarantined_;
+  // Currencies each currency has a leg to.
+  std::vector<std::vector<CurrencyId>> legs_;
+  std::vector<ArbitrageCycle> cycles_;
+
+  std::vector<CurrencyId> sources_;
+  std::vector<uint8_t> is_source_;
+
+  // Search state, kept between searches to avoid allocating.
+  std::vector<double> distance_;
+  std::vector<CurrencyId> parent_;
+  std::vector<uint8_t> queued_;
+  std::vector<CurrencyId> active_;
+  std::vector<CurrencyId> next_;
+};
+
+}  // namespace converter
+
+#endif  // CONVERTER_ENGINE_ARBITRAGE_H_
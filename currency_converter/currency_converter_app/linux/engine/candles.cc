@@ -0,0 +1,332 @@
+#include "candles.h"
+
+#include <algorithm>
+
+namespace converter {
+
+namespace {
+
+constexpr int64_t kDayMs = 24 * 60 * kCandleMinuteMs;
+
+// Widths of the rollup levels, each a whole number of the one before.
+constexpr int64_t kLevelWidths[] = {kCandleMinuteMs, 60 * kCandleMinuteMs,
+                                    kDayMs};
+
+// Requests are limited to some 30,000 years either side of the epoch, so
+// interval arithmetic cannot overflow.
+constexpr int64_t kMaxTimestamp = int64_t{1} << 50;
+
+// Pieces the history of a pair is split into per pool thread, so threads
+// that finish early can take more.
+constexpr size_t kChunksPerThread = 4;
+
+int64_t FloorDiv(int64_t value, int64_t divisor) {
+  int64_t quotient = value / divisor;
+  return quotient - (value % divisor < 0);
+}
+
+int64_t FloorTo(int64_t value, int64_t width) {
+  return FloorDiv(value, width) * width;
+}
+
+// Days since the epoch of the first of |month| (1-12) in |year|, in the
+// proleptic Gregorian calendar.
+int64_t DaysFromCivil(int64_t year, int64_t month) {
+  year -= month <= 2;
+  int64_t era = FloorDiv(year, 400);
+  int64_t year_of_era = year - era * 400;
+  int64_t day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5;
+  int64_t day_of_era =
+      year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+  return era * 146097 + day_of_era - 719468;
+}
+
+// Months since January 1970 of the day |days| after the epoch.
+int64_t MonthFromDays(int64_t days) {
+  days += 719468;
+  int64_t era = FloorDiv(days, 146097);
+  int64_t day_of_era = days - era * 146097;
+  int64_t year_of_era = (day_of_era - day_of_era / 1460 +
+                         day_of_era / 36524 - day_of_era / 146096) /
+                        365;
+  int64_t day_of_year =
+      day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+  int64_t shifted_month = (5 * day_of_year + 2) / 153;
+  int64_t month = shifted_month < 10 ? shifted_month + 3 : shifted_month - 9;
+  int64_t year = year_of_era + era * 400 + (month <= 2);
+  return (year - 1970) * 12 + month - 1;
+}
+
+// Start of month |month| since January 1970, in milliseconds.
+int64_t MonthStart(int64_t month) {
+  int64_t year = FloorDiv(month, 12);
+  return DaysFromCivil(1970 + year, month - year * 12 + 1) * kDayMs;
+}
+
+void Merge(const Candle& candle, Candle* into) {
+  into->high = std::max(into->high, candle.high);
+  into->low = std::min(into->low, candle.low);
+  into->close = candle.close;
+  into->ticks += candle.ticks;
+  into->sum += candle.sum;
+}
+
+// Adds a quote of |rate| to the candle starting at |start|, which must be
+// the last in |level| or after it. Returns false if it is before.
+bool AddQuote(int64_t start, int64_t rate, std::vector<Candle>* level) {
+  if (level->empty() || level->back().start < start) {
+    level->push_back({start, rate, rate, rate, rate, 1, rate});
+    return true;
+  }
+  Candle& last = level->back();
+  if (last.start != start) {
+    return false;
+  }
+  last.high = std::max(last.high, rate);
+  last.low = std::min(last.low, rate);
+  last.close = rate;
+  last.ticks++;
+  last.sum += rate;
+  return true;
+}
+
+// Appends |candle| to |out| in the interval holding its start, merging it
+// into the last candle if that is the same interval.
+void Fold(const Candle& candle, const CandleInterval& interval,
+          std::vector<Candle>* out) {
+  int64_t start = interval.Start(candle.start);
+  if (!out->empty() && out->back().start == start) {
+    Merge(candle, &out->back());
+    return;
+  }
+  out->push_back(candle);
+  out->back().start = start;
+}
+
+// Rolls the candles of |level| up into the next level in |out|.
+void RollUp(const std::vector<Candle>& level, size_t next,
+            std::vector<Candle>* out) {
+  CandleInterval interval = CandleInterval::Fixed(kLevelWidths[next]);
+  for (const Candle& candle : level) {
+    Fold(candle, interval, out);
+  }
+}
+
+}  // namespace
+
+bool CandleInterval::valid() const {
+  if (months == 0) {
+    return milliseconds > 0 && milliseconds % kCandleMinuteMs == 0 &&
+           milliseconds <= kMaxTimestamp;
+  }
+  return milliseconds == 0 && months > 0 && months <= 12 * 1000;
+}
+
+int64_t CandleInterval::Start(int64_t timestamp) const {
+  if (months == 0) {
+    return FloorTo(timestamp, milliseconds);
+  }
+  return MonthStart(
+      FloorTo(MonthFromDays(FloorDiv(timestamp, kDayMs)), months));
+}
+
+int64_t CandleInterval::Next(int64_t start) const {
+  if (months == 0) {
+    return start + milliseconds;
+  }
+  return MonthStart(MonthFromDays(FloorDiv(start, kDayMs)) + months);
+}
+
+bool CandleStore::Candles(uint32_t pair, int64_t begin, int64_t end,
+                          CandleInterval interval, std::vector<Candle>* out) {
+  out->clear();
+  if (!interval.valid() || begin >= end || begin < -kMaxTimestamp ||
+      end > kMaxTimestamp) {
+    return false;
+  }
+  // The coarsest rollup the interval is made of. Months are made of days.
+  size_t level = kLevelCount - 1;
+  while (interval.months == 0 &&
+         interval.milliseconds % kLevelWidths[level] != 0) {
+    level--;
+  }
+  int64_t first = interval.Start(begin);
+  int64_t stop = interval.Next(interval.Start(end - 1));
+  auto starts_before = [](const Candle& candle, int64_t start) {
+    return candle.start < start;
+  };
+
+  std::shared_ptr<const Rollups> history = HistoryRollups(pair);
+  if (history == nullptr) {
+    return false;
+  }
+  const std::vector<Candle>& stored = history->levels[level];
+  auto from =
+      std::lower_bound(stored.begin(), stored.end(), first, starts_before);
+  auto to = std::lower_bound(from, stored.end(), stop, starts_before);
+  if (interval.months == 0 && interval.milliseconds == kLevelWidths[level]) {
+    out->assign(from, to);
+  } else {
+    for (auto candle = from; candle != to; ++candle) {
+      Fold(*candle, interval, out);
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto live = live_.find(pair);
+  if (live == live_.end()) {
+    return true;
+  }
+  // Live candles continue from the last stored one, merging with it if they
+  // share its start.
+  const std::vector<Candle>& appended = live->second.levels[level];
+  int64_t resume =
+      stored.empty() ? first : std::max(first, stored.back().start);
+  from = std::lower_bound(appended.begin(), appended.end(), resume,
+                          starts_before);
+  to = std::lower_bound(from, appended.end(), stop, starts_before);
+  for (auto candle = from; candle != to; ++candle) {
+    Fold(*candle, interval, out);
+  }
+  return true;
+}
+
+void CandleStore::Append(const TickColumns& ticks) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Rollups* rollups = nullptr;
+  uint32_t pair = 0;
+  for (size_t i = 0; i < ticks.size(); i++) {
+    // Feeds tend to repeat a pair, so skip the lookup when they do.
+    if (rollups == nullptr || ticks.pairs[i] != pair) {
+      pair = ticks.pairs[i];
+      rollups = &live_[pair];
+    }
+    int64_t timestamp = ticks.timestamps[i];
+    int64_t rate = ticks.rates[i];
+    if (rate <= 0 || timestamp < -kMaxTimestamp || timestamp > kMaxTimestamp ||
+        !AddQuote(FloorTo(timestamp, kLevelWidths[0]), rate,
+                  &rollups->levels[0])) {
+      continue;
+    }
+    for (size_t level = 1; level < kLevelCount; level++) {
+      AddQuote(FloorTo(timestamp, kLevelWidths[level]), rate,
+               &rollups->levels[level]);
+    }
+  }
+}
+
+void CandleStore::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  cache_.clear();
+}
+
+std::shared_ptr<const CandleStore::Rollups> CandleStore::HistoryRollups(
+    uint32_t pair) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto entry = cache_.begin(); entry != cache_.end(); ++entry) {
+      if (entry->first == pair) {
+        cache_.splice(cache_.begin(), cache_, entry);
+        return entry->second;
+      }
+    }
+  }
+  // Read without the lock, so live quotes keep flowing meanwhile. Two
+  // threads may both read a pair; the second result is dropped.
+  auto rollups = std::make_shared<Rollups>();
+  if (!ReadHistory(pair, rollups.get())) {
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& entry : cache_) {
+    if (entry.first == pair) {
+      return entry.second;
+    }
+  }
+  cache_.emplace_front(pair, rollups);
+  if (cache_.size() > kMaxCachedPairs) {
+    cache_.pop_back();
+  }
+  return rollups;
+}
+
+bool CandleStore::ReadHistory(uint32_t pair, Rollups* out) const {
+  HistorySpan span;
+  if (!history_->Span(pair, &span)) {
+    return true;
+  }
+  // Chunks are whole days, so no candle of any level spans two of them.
+  int64_t begin = FloorTo(span.first_timestamp, kDayMs);
+  int64_t end = FloorTo(span.last_timestamp, kDayMs) + kDayMs;
+  int64_t days = (end - begin) / kDayMs;
+  int64_t chunks =
+      pool_ == nullptr
+          ? 1
+          : std::min<int64_t>(days, pool_->size() * kChunksPerThread);
+  int64_t chunk_days = (days + chunks - 1) / chunks;
+  chunks = (days + chunk_days - 1) / chunk_days;
+  // Minute candles per chunk if ticks are spread evenly, and there is at
+  // most one per minute. Growing the rollups instead costs more in page
+  // faults than reducing the ticks does.
+  size_t expected_minutes = static_cast<size_t>(
+      std::min<uint64_t>(chunk_days * 24 * 60,
+                         span.ticks / static_cast<uint64_t>(days) *
+                                 chunk_days + 24 * 60));
+
+  std::vector<Rollups> parts(chunks);
+  std::vector<uint8_t> read(chunks, 0);
+  auto reduce = [&](size_t first_chunk, size_t end_chunk) {
+    // Read a day at a time, so the tick buffers stay small and are reused.
+    std::vector<int64_t> timestamps;
+    std::vector<int64_t> rates;
+    for (size_t chunk = first_chunk; chunk < end_chunk; chunk++) {
+      Rollups& part = parts[chunk];
+      part.levels[0].reserve(expected_minutes);
+      int64_t day = begin + static_cast<int64_t>(chunk) * chunk_days * kDayMs;
+      int64_t chunk_end = std::min(day + chunk_days * kDayMs, end);
+      for (; day < chunk_end; day += kDayMs) {
+        timestamps.clear();
+        rates.clear();
+        if (!history_->ReadRange(pair, day, day + kDayMs, &timestamps,
+                                 &rates)) {
+          break;
+        }
+        for (size_t i = 0; i < timestamps.size(); i++) {
+          if (rates[i] > 0) {
+            AddQuote(FloorTo(timestamps[i], kLevelWidths[0]), rates[i],
+                     &part.levels[0]);
+          }
+        }
+      }
+      for (size_t level = 1; level < kLevelCount; level++) {
+        RollUp(part.levels[level - 1], level, &part.levels[level]);
+      }
+      read[chunk] = day >= chunk_end;
+    }
+  };
+  if (pool_ != nullptr && chunks > 1) {
+    pool_->ParallelFor(chunks, 1, reduce);
+  } else {
+    reduce(0, chunks);
+  }
+
+  if (chunks == 1) {
+    *out = std::move(parts[0]);
+  } else {
+    for (size_t level = 0; level < kLevelCount; level++) {
+      size_t size = 0;
+      for (const Rollups& part : parts) {
+        size += part.levels[level].size();
+      }
+      out->levels[level].reserve(size);
+      for (const Rollups& part : parts) {
+        out->levels[level].insert(out->levels[level].end(),
+                                  part.levels[level].begin(),
+                                  part.levels[level].end());
+      }
+    }
+  }
+  return std::find(read.begin(), read.end(), 0) == read.end();
+}
+
+}  // namespace converter
@@ -0,0 +1,125 @@
+#ifndef CONVERTER_ENGINE_CANDLES_H_
+#define CONVERTER_ENGINE_CANDLES_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "history_store.h"
+#include "thread_pool.h"
+#include "tick.h"
+
+namespace converter {
+
+constexpr int64_t kCandleMinuteMs = 60 * 1000;
+
+// Open, high, low and close of the quotes of one pair over one interval.
+struct Candle {
+  // Start of the interval, in milliseconds since the epoch.
+  int64_t start;
+  // Quotes in units of second per first, scaled by kRateScale.
+  int64_t open;
+  int64_t high;
+  int64_t low;
+  int64_t close;
+  // Number of quotes, and their exact sum.
+  uint64_t ticks;
+  __int128 sum;
+
+  // Mean of the quotes. Spot quotes carry no traded volume, so this is the
+  // VWAP with every quote weighing one, i.e. by tick volume.
+  int64_t average() const {
+    return static_cast<int64_t>(sum / static_cast<__int128>(ticks));
+  }
+};
+
+// Width of a candle: a fixed multiple of a minute, aligned to the epoch, or
+// a number of calendar months in UTC, aligned to January 1970.
+struct CandleInterval {
+  int64_t milliseconds = 0;
+  int32_t months = 0;
+
+  static CandleInterval Fixed(int64_t milliseconds) {
+    return {milliseconds, 0};
+  }
+  static CandleInterval Months(int32_t months) { return {0, months}; }
+
+  bool valid() const;
+  // Start of the interval holding |timestamp|, and of the one after it.
+  int64_t Start(int64_t timestamp) const;
+  int64_t Next(int64_t start) const;
+};
+
+// Candles over a HistoryStore, extended by live quotes.
+//
+// The first request for a pair reads all of its history once, split into
+// day-aligned chunks reduced in parallel, into rollups of one minute, one
+// hour and one day. Every interval is a whole number of one of them, so
+// a request merges the coarsest rollup that divides it and never touches
+// the ticks again: a year of minute candles is a copy. Rollups of the most
+// recently used pairs are cached.
+//
+// Live quotes go into rollups of their own, updated per quote, which
+// requests append after the history. They are kept for every pair quoted
+// since start-up, at under a hundred bytes per pair and minute of quotes.
+//
+// Safe to call from any thread. Open the history before the first request,
+// or call Reset after reopening it.
+class CandleStore {
+ public:
+  // Rollups of the history of this many pairs are kept.
+  static constexpr size_t kMaxCachedPairs = 4;
+
+  explicit CandleStore(const HistoryStore* history) : history_(history) {}
+
+  CandleStore(const CandleStore&) = delete;
+  CandleStore& operator=(const CandleStore&) = delete;
+
+  // Pool the history of a pair is read on, or null to read it on the
+  // calling thread. Not owned.
+  void set_thread_pool(ThreadPool* pool) { pool_ = pool; }
+
+  // Replaces |out| with the candles of |pair|, packed with PackPair, that
+  // overlap [begin, end), oldest first and skipping intervals without
+  // quotes. Candles are always whole: the first may start before |begin|
+  // and the last end after |end|. Returns false for an invalid interval or
+  // range, or if the history turns out to be corrupt.
+  bool Candles(uint32_t pair, int64_t begin, int64_t end,
+               CandleInterval interval, std::vector<Candle>* out);
+
+  // Adds live quotes. Quotes of a pair are expected in time order; one
+  // older than the pair's current minute is ignored.
+  void Append(const TickColumns& ticks);
+
+  // Drops the cached history rollups.
+  void Reset();
+
+ private:
+  static constexpr size_t kLevelCount = 3;
+
+  struct Rollups {
+    // Candles of each level, oldest first.
+    std::vector<Candle> levels[kLevelCount];
+  };
+
+  // Returns the history rollups of |pair|, reading them if not cached, or
+  // null if the history is corrupt.
+  std::shared_ptr<const Rollups> HistoryRollups(uint32_t pair);
+  bool ReadHistory(uint32_t pair, Rollups* out) const;
+
+  const HistoryStore* history_;
+  ThreadPool* pool_ = nullptr;
+
+  std::mutex mutex_;
+  // Cached history rollups, most recently used first.
+  std::list<std::pair<uint32_t, std::shared_ptr<const Rollups>>> cache_;
+  std::unordered_map<uint32_t, Rollups> live_;
+};
+
+}  // namespace converter
+
+#endif  // CONVERTER_ENGINE_CANDLES_H_
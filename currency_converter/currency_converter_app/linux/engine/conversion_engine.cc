@@ -0,0 +1,408 @@
+#include "conversion_engine.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "fixed_point.h"
+#include "kernels.h"
+
+namespace converter {
+
+const char* StatusMessage(Status status) {
+  switch (status) {
+    case Status::kOk:
+      return "ok";
+    case Status::kUnknownCurrency:
+      return "unknown currency";
+    case Status::kInvalidAmount:
+      return "invalid amount";
+    case Status::kOverflow:
+      return "amount out of range";
+    case Status::kNoHistory:
+      return "no rate history for that time";
+  }
+  return "unknown status";
+}
+
+namespace {
+
+inline Status ConvertWithFactors(int64_t amount, const PairFactors& factors,
+                                 int64_t* out) {
+  if (!internal::ConvertFixedScalar(&amount, 1, factors.cross_rate,
+                                    factors.divisor_digits, out)) {
+    return Status::kOverflow;
+  }
+  return Status::kOk;
+}
+
+static_assert(kRateScaleDigits + kMaxMinorUnits <= kMaxDivisorDigits,
+              "every pair's divisor must have a kernel instantiation");
+
+// Fills in the rest of |factors| once its cross rate is known.
+void CompleteFactors(CurrencyId from, CurrencyId to, PairFactors* factors) {
+  // amount / 10^from_units * rate / 10^scale * 10^to_units, folded into a
+  // single division so that only one rounding step happens.
+  int from_units = GetCurrency(from).minor_units;
+  int to_units = GetCurrency(to).minor_units;
+  factors->divisor_digits = kRateScaleDigits + from_units - to_units;
+  factors->minor_scale = static_cast<double>(Pow10(to_units));
+  factors->minor_rate = static_cast<double>(factors->cross_rate) / kRateScale *
+                        factors->minor_scale;
+}
+
+// std::nearbyint honours the default round-to-nearest-even mode.
+inline double ConvertWithFactors(double amount, const PairFactors& factors) {
+  return std::nearbyint(amount * factors.minor_rate) / factors.minor_scale;
+}
+
+// Single-snapshot implementations of the public batch methods.
+
+Status ConvertRun(const RateTable& rates, const int64_t* amounts,
+                  size_t count, CurrencyId from, CurrencyId to, int64_t* out) {
+  PairFactors factors;
+  Status status = ConversionEngine::PrepareFactors(rates, from, to, &factors);
+  if (status != Status::kOk) {
+    return status;
+  }
+  if (!GetKernels().convert_fixed(amounts, count, factors.cross_rate,
+                                  factors.divisor_digits, out)) {
+    return Status::kOverflow;
+  }
+  return Status::kOk;
+}
+
+Status ConvertRun(const RateTable& rates, const double* amounts, size_t count,
+                  CurrencyId from, CurrencyId to, double* out) {
+  PairFactors factors;
+  Status status = ConversionEngine::PrepareFactors(rates, from, to, &factors);
+  if (status != Status::kOk) {
+    return status;
+  }
+  GetKernels().convert_double(amounts, count, factors.minor_rate,
+                              factors.minor_scale, out);
+  return Status::kOk;
+}
+
+// Batches are typically grouped by pair, so each run of equal pairs is
+// handed to the single-pair kernel in one go.
+template <typename T>
+Status ConvertRuns(const RateTable& rates, const T* amounts,
+                   const uint32_t* pairs, size_t count, T* out) {
+  size_t start = 0;
+  while (start < count) {
+    size_t end = start + 1;
+    while (end < count && pairs[end] == pairs[start]) {
+      end++;
+    }
+    Status status = ConvertRun(rates, amounts + start, end - start,
+                               pairs[start] >> 16, pairs[start] & 0xffff,
+                               out + start);
+    if (status != Status::kOk) {
+      return status;
+    }
+    start = end;
+  }
+  return Status::kOk;
+}
+
+// Calls |body|(begin, end) over [0, count), split across |pool| when the
+// batch is large enough, and returns the first failure any part reports.
+// Each element stands for |work| conversions.
+template <typename Body>
+Status RunChunked(ThreadPool* pool, size_t count, Body&& body,
+                  size_t work = 1) {
+  if (pool == nullptr || pool->size() < 2 ||
+      count * work < ConversionEngine::kParallelBatchSize) {
+    return body(0, count);
+  }
+  std::atomic<Status> result{Status::kOk};
+  size_t grain = std::max<size_t>(
+      1, ConversionEngine::kParallelBatchSize / 4 / work);
+  pool->ParallelFor(count, grain, [&](size_t begin, size_t end) {
+    Status status = body(begin, end);
+    if (status != Status::kOk) {
+      Status expected = Status::kOk;
+      result.compare_exchange_strong(expected, status);
+    }
+  });
+  return result.load();
+}
+
+// Amounts per block of a fan-out: 32 KiB of them, which stay in cache while
+// the kernel of every target runs over them.
+constexpr size_t kFanOutBlock = 4096;
+
+// Shorter runs, such as a single amount, are converted by the scalar
+// kernels, which cost less to call than the vector ones win.
+constexpr size_t kMinVectorRun = 16;
+
+// Converts |count| amounts into one target with |factors|, or marks them all
+// unconvertible if the cross rate overflowed (|factors| null).
+void FanOutTarget(const PairFactors* factors, const double* amounts,
+                  size_t count, double* out) {
+  if (factors == nullptr) {
+    std::fill(out, out + count, std::numeric_limits<double>::quiet_NaN());
+    return;
+  }
+  if (count < kMinVectorRun) {
+    internal::ConvertDoubleScalar(amounts, count, factors->minor_rate,
+                                  factors->minor_scale, out);
+    return;
+  }
+  GetKernels().convert_double(amounts, count, factors->minor_rate,
+                              factors->minor_scale, out);
+}
+
+void FanOutTarget(const PairFactors* factors, const int64_t* amounts,
+                  size_t count, int64_t* out) {
+  if (factors == nullptr) {
+    std::fill(out, out + count, kFanOutOverflow);
+    return;
+  }
+  bool converted =
+      count < kMinVectorRun
+          ? internal::ConvertFixedScalar(amounts, count, factors->cross_rate,
+                                         factors->divisor_digits, out)
+          : GetKernels().convert_fixed(amounts, count, factors->cross_rate,
+                                       factors->divisor_digits, out);
+  if (converted) {
+    return;
+  }
+  // Rare: find which results overflowed.
+  for (size_t i = 0; i < count; i++) {
+    if (!internal::ConvertFixedScalar(&amounts[i], 1, factors->cross_rate,
+                                      factors->divisor_digits, &out[i])) {
+      out[i] = kFanOutOverflow;
+    }
+  }
+}
+
+// Converts amounts [begin, end) of a fan-out, a block at a time, into every
+// target.
+template <typename T>
+void FanOutRun(const RateTable& rates, const T* amounts, size_t count,
+               size_t begin, size_t end, CurrencyId from,
+               const CurrencyId* targets, size_t target_count, T* out) {
+  for (size_t block = begin; block < end; block += kFanOutBlock) {
+    size_t size = std::min(kFanOutBlock, end - block);
+    for (size_t t = 0; t < target_count; t++) {
+      PairFactors factors;
+      bool ok = ConversionEngine::PrepareFactors(rates, from, targets[t],
+                                                 &factors) == Status::kOk;
+      FanOutTarget(ok ? &factors : nullptr, amounts + block, size,
+                   out + t * count + block);
+    }
+  }
+}
+
+bool CodeLess(CurrencyId a, CurrencyId b) {
+  return strcmp(GetCurrency(a).code, GetCurrency(b).code) < 0;
+}
+
+// Sorts |targets| for a fan-out of |first_amount| from |from|.
+template <typename T>
+void OrderTargets(const RateTable& rates, T first_amount, CurrencyId from,
+                  FanOutOrder order, CurrencyId* targets, size_t count) {
+  if (order == FanOutOrder::kCode) {
+    std::sort(targets, targets + count, CodeLess);
+    return;
+  }
+  if (order != FanOutOrder::kValue) {
+    return;
+  }
+  // Unconvertible targets sort as -infinity, i.e. last.
+  std::vector<std::pair<double, CurrencyId>> keys(count);
+  for (size_t t = 0; t < count; t++) {
+    T value;
+    FanOutRun(rates, &first_amount, 1, 0, 1, from, &targets[t], 1, &value);
+    bool valid;
+    if constexpr (std::is_floating_point<T>::value) {
+      valid = !std::isnan(value);
+    } else {
+      valid = value != kFanOutOverflow;
+    }
+    keys[t] = {valid ? static_cast<double>(value)
+                     : -std::numeric_limits<double>::infinity(),
+               targets[t]};
+  }
+  std::sort(keys.begin(), keys.end(), [](const auto& a, const auto& b) {
+    return a.first != b.first ? a.first > b.first
+                              : CodeLess(a.second, b.second);
+  });
+  for (size_t t = 0; t < count; t++) {
+    targets[t] = keys[t].second;
+  }
+}
+
+template <typename T>
+Status ConvertToAllImpl(const RateStore& rate_store, ThreadPool* pool,
+                        const T* amounts, size_t count, CurrencyId from,
+                        CurrencyId* targets, size_t target_count,
+                        FanOutOrder order, T* out) {
+  size_t currencies = CurrencyCount();
+  if (from >= currencies) {
+    return Status::kUnknownCurrency;
+  }
+  for (size_t t = 0; t < target_count; t++) {
+    if (targets[t] >= currencies) {
+      return Status::kUnknownCurrency;
+    }
+  }
+  RateStore::Snapshot snapshot = rate_store.Read();
+  if (count > 0) {
+    OrderTargets(snapshot.table(), amounts[0], from, order, targets,
+                 target_count);
+  }
+  return RunChunked(
+      pool, count,
+      [&](size_t begin, size_t end) {
+        FanOutRun(snapshot.table(), amounts, count, begin, end, from, targets,
+                  target_count, out);
+        return Status::kOk;
+      },
+      std::max<size_t>(target_count, 1));
+}
+
+}  // namespace
+
+Status ConversionEngine::PrepareFactors(const RateTable& rates,
+                                        CurrencyId from, CurrencyId to,
+                                        PairFactors* out) {
+  if (from >= rates.size() || to >= rates.size()) {
+    return Status::kUnknownCurrency;
+  }
+  if (!rates.CrossRate(from, to, &out->cross_rate)) {
+    return Status::kOverflow;
+  }
+  CompleteFactors(from, to, out);
+  return Status::kOk;
+}
+
+Status ConversionEngine::Convert(int64_t amount, CurrencyId from, CurrencyId to,
+                                 int64_t* out) const {
+  RateStore::Snapshot snapshot = rates_.Read();
+  PairFactors factors;
+  Status status = PrepareFactors(snapshot.table(), from, to, &factors);
+  if (status != Status::kOk) {
+    return status;
+  }
+  return ConvertWithFactors(amount, factors, out);
+}
+
+Status ConversionEngine::ConvertAt(int64_t amount, CurrencyId from,
+                                   CurrencyId to, int64_t timestamp,
+                                   int64_t* out) const {
+  if (from >= CurrencyCount() || to >= CurrencyCount()) {
+    return Status::kUnknownCurrency;
+  }
+  int64_t from_rate;
+  int64_t to_rate;
+  if (!history_.BaseRateAt(from, timestamp, &from_rate) ||
+      !history_.BaseRateAt(to, timestamp, &to_rate)) {
+    return Status::kNoHistory;
+  }
+  // Triangulated through the base exactly as RateTable does for live rates.
+  PairFactors factors;
+  factors.cross_rate = kRateScale;
+  if (from != to &&
+      !DivRoundHalfEven(static_cast<__int128>(to_rate) * kRateScale, from_rate,
+                        &factors.cross_rate)) {
+    return Status::kOverflow;
+  }
+  CompleteFactors(from, to, &factors);
+  return ConvertWithFactors(amount, factors, out);
+}
+
+Status ConversionEngine::ConvertText(std::string_view amount, CurrencyId from,
+                                     CurrencyId to, int64_t* out) const {
+  if (from >= CurrencyCount()) {
+    return Status::kUnknownCurrency;
+  }
+  int64_t minor;
+  if (!ParseScaledDecimal(amount, GetCurrency(from).minor_units, &minor)) {
+    return Status::kInvalidAmount;
+  }
+  return Convert(minor, from, to, out);
+}
+
+Status ConversionEngine::ConvertDouble(double amount, CurrencyId from,
+                                       CurrencyId to, double* out) const {
+  if (!std::isfinite(amount)) {
+    return Status::kInvalidAmount;
+  }
+  RateStore::Snapshot snapshot = rates_.Read();
+  PairFactors factors;
+  Status status = PrepareFactors(snapshot.table(), from, to, &factors);
+  if (status != Status::kOk) {
+    return status;
+  }
+  *out = ConvertWithFactors(amount, factors);
+  return Status::kOk;
+}
+
+// The snapshot taken by the calling thread keeps its table alive for the
+// workers too, since the call does not return until they are done.
+
+Status ConversionEngine::ConvertBatch(const int64_t* amounts, size_t count,
+                                      CurrencyId from, CurrencyId to,
+                                      int64_t* out) const {
+  RateStore::Snapshot snapshot = rates_.Read();
+  return RunChunked(thread_pool_, count, [&](size_t begin, size_t end) {
+    return ConvertRun(snapshot.table(), amounts + begin, end - begin, from, to,
+                      out + begin);
+  });
+}
+
+Status ConversionEngine::ConvertBatch(const double* amounts, size_t count,
+                                      CurrencyId from, CurrencyId to,
+                                      double* out) const {
+  RateStore::Snapshot snapshot = rates_.Read();
+  return RunChunked(thread_pool_, count, [&](size_t begin, size_t end) {
+    return ConvertRun(snapshot.table(), amounts + begin, end - begin, from, to,
+                      out + begin);
+  });
+}
+
+Status ConversionEngine::ConvertBatch(const int64_t* amounts,
+                                      const uint32_t* pairs, size_t count,
+                                      int64_t* out) const {
+  RateStore::Snapshot snapshot = rates_.Read();
+  return RunChunked(thread_pool_, count, [&](size_t begin, size_t end) {
+    return ConvertRuns(snapshot.table(), amounts + begin, pairs + begin,
+                       end - begin, out + begin);
+  });
+}
+
+Status ConversionEngine::ConvertBatch(const double* amounts,
+                                      const uint32_t* pairs, size_t count,
+                                      double* out) const {
+  RateStore::Snapshot snapshot = rates_.Read();
+  return RunChunked(thread_pool_, count, [&](size_t begin, size_t end) {
+    return ConvertRuns(snapshot.table(), amounts + begin, pairs + begin,
+                       end - begin, out + begin);
+  });
+}
+
+Status ConversionEngine::ConvertToAll(const double* amounts, size_t count,
+                                      CurrencyId from, CurrencyId* targets,
+                                      size_t target_count, FanOutOrder order,
+                                      double* out) const {
+  return ConvertToAllImpl(rates_, thread_pool_, amounts, count, from, targets,
+                          target_count, order, out);
+}
+
+Status ConversionEngine::ConvertToAll(const int64_t* amounts, size_t count,
+                                      CurrencyId from, CurrencyId* targets,
+                                      size_t target_count, FanOutOrder order,
+                                      int64_t* out) const {
+  return ConvertToAllImpl(rates_, thread_pool_, amounts, count, from, targets,
+                          target_count, order, out);
+}
+
+}  // namespace converter
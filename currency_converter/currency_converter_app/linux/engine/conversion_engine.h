@@ -0,0 +1,162 @@
+#ifndef CONVERTER_ENGINE_CONVERSION_ENGINE_H_
+#define CONVERTER_ENGINE_CONVERSION_ENGINE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "candles.h"
+#include "currency.h"
+#include "history_store.h"
+#include "rate_store.h"
+#include "rate_table.h"
+#include "thread_pool.h"
+
+namespace converter {
+
+enum class Status {
+  kOk,
+  kUnknownCurrency,
+  kInvalidAmount,
+  kOverflow,
+  kNoHistory,
+};
+
+// Returns a short human-readable description of |status|.
+const char* StatusMessage(Status status);
+
+// Packs a currency pair into the 32-bit form used by the batch APIs.
+constexpr uint32_t PackPair(CurrencyId from, CurrencyId to) {
+  return static_cast<uint32_t>(from) << 16 | to;
+}
+
+// Order in which ConvertToAll lays out its targets.
+enum class FanOutOrder {
+  // As the caller listed them.
+  kAsGiven,
+  // By currency code.
+  kCode,
+  // By the converted value of the first amount, largest first, then by
+  // code. Targets it cannot be converted to come last.
+  kValue,
+};
+
+// What the int64 ConvertToAll writes for a result that does not fit.
+constexpr int64_t kFanOutOverflow = INT64_MIN;
+
+// Everything needed to convert between one pair of currencies, computed once
+// so that batches can reuse it for every element.
+struct PairFactors {
+  // Units of "to" per unit of "from", scaled by kRateScale.
+  int64_t cross_rate;
+  // Exponent of the power of ten that maps amount * cross_rate back to minor
+  // units of "to".
+  int divisor_digits;
+  // Multiplier taking major units of "from" to minor units of "to".
+  double minor_rate;
+  // 10^minor_units of "to".
+  double minor_scale;
+};
+
+// Converts amounts between registry currencies using exact fixed-point
+// arithmetic. Results are rounded half to even to the minor units of the
+// target currency.
+//
+// All methods are safe to call from any thread while rates are published
+// through rates(). Each call reads one consistent rate snapshot, so every
+// element of a batch is converted at the same version.
+class ConversionEngine {
+ public:
+  // Smallest batch worth splitting across threads; below this the cost of
+  // waking workers outweighs the conversion itself.
+  static constexpr size_t kParallelBatchSize = 64 * 1024;
+
+  ConversionEngine() = default;
+
+  // Computes the conversion factors for |from| to |to| in |rates|.
+  static Status PrepareFactors(const RateTable& rates, CurrencyId from,
+                               CurrencyId to, PairFactors* out);
+
+  RateStore& rates() { return rates_; }
+  const RateStore& rates() const { return rates_; }
+
+  // Pool used to split large batches and history reads across threads, or
+  // null to do all the work on the calling thread. Not owned.
+  ThreadPool* thread_pool() const { return thread_pool_; }
+  void set_thread_pool(ThreadPool* pool) {
+    thread_pool_ = pool;
+    candles_.set_thread_pool(pool);
+  }
+
+  // Rate history used by ConvertAt. Closed until a history file is opened.
+  HistoryStore& history() { return history_; }
+  const HistoryStore& history() const { return history_; }
+
+  // Candles over history(), extended by the live quotes given to it.
+  CandleStore& candles() { return candles_; }
+
+  // Converts |amount|, in minor units of |from|, into minor units of |to|.
+  Status Convert(int64_t amount, CurrencyId from, CurrencyId to,
+                 int64_t* out) const;
+
+  // Like Convert, but at the rates in effect at |timestamp| according to
+  // history() rather than the live rates. Returns kNoHistory if either
+  // currency has no base-pair quote that early.
+  Status ConvertAt(int64_t amount, CurrencyId from, CurrencyId to,
+                   int64_t timestamp, int64_t* out) const;
+
+  // Converts a decimal |amount| in major units of |from|, e.g. "12.34", into
+  // minor units of |to|.
+  Status ConvertText(std::string_view amount, CurrencyId from, CurrencyId to,
+                     int64_t* out) const;
+
+  // Converts |amount| in major units using double arithmetic, rounding the
+  // result to the minor units of |to|. Faster but not exact for large values.
+  Status ConvertDouble(double amount, CurrencyId from, CurrencyId to,
+                       double* out) const;
+
+  // Batch variants of Convert and ConvertDouble. Every amount is converted
+  // from |from| to |to| and written to the matching index of |out|, which
+  // may alias |amounts|. On failure the contents of |out| are unspecified.
+  // Batches of kParallelBatchSize or more are split across thread_pool(),
+  // still at a single rate version.
+  Status ConvertBatch(const int64_t* amounts, size_t count, CurrencyId from,
+                      CurrencyId to, int64_t* out) const;
+  Status ConvertBatch(const double* amounts, size_t count, CurrencyId from,
+                      CurrencyId to, double* out) const;
+
+  // As above, but each amount has its own pair, packed with PackPair.
+  Status ConvertBatch(const int64_t* amounts, const uint32_t* pairs,
+                      size_t count, int64_t* out) const;
+  Status ConvertBatch(const double* amounts, const uint32_t* pairs,
+                      size_t count, double* out) const;
+
+  // Converts |count| amounts of |from| into each of the |target_count|
+  // currencies in |targets|, e.g. every registry currency or a list of
+  // favourites, after sorting |targets| in place by |order|. Results are
+  // grouped by target: out[t * count + i] is amounts[i] in targets[t], as
+  // ConvertBatch converts it. A result that cannot be computed, because the
+  // cross rate or the amount overflows, is NaN or kFanOutOverflow rather
+  // than failing the whole call.
+  //
+  // This is the outer product of the amounts with the cross-rate row of
+  // |from|. It runs through blocks of amounts small enough to stay in cache
+  // while the vector kernel of every target goes over them, with large
+  // products split across thread_pool().
+  Status ConvertToAll(const double* amounts, size_t count, CurrencyId from,
+                      CurrencyId* targets, size_t target_count,
+                      FanOutOrder order, double* out) const;
+  Status ConvertToAll(const int64_t* amounts, size_t count, CurrencyId from,
+                      CurrencyId* targets, size_t target_count,
+                      FanOutOrder order, int64_t* out) const;
+
+ private:
+  RateStore rates_;
+  HistoryStore history_;
+  CandleStore candles_{&history_};
+  ThreadPool* thread_pool_ = nullptr;
+};
+
+}  // namespace converter
+
+#endif  // CONVERTER_ENGINE_CONVERSION_ENGINE_H_
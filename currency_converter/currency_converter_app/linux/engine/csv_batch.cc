@@ -0,0 +1,241 @@
+#include "csv_batch.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#include "fixed_point.h"
+
+namespace converter {
+
+namespace {
+
+constexpr size_t kReadChunkSize = 1 << 20;
+constexpr size_t kWriteFlushSize = 1 << 20;
+
+bool WriteAll(int fd, const char* data, size_t size) {
+  while (size > 0) {
+    ssize_t written = write(fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+std::string_view Trim(std::string_view field) {
+  while (!field.empty() && (field.front() == ' ' || field.front() == '\t')) {
+    field.remove_prefix(1);
+  }
+  while (!field.empty() && (field.back() == ' ' || field.back() == '\t' ||
+                            field.back() == '\r')) {
+    field.remove_suffix(1);
+  }
+  return field;
+}
+
+// Converts the complete lines of one input chunk and appends them, with their
+// result column, to an output buffer.
+class ChunkConverter {
+ public:
+  ChunkConverter(const ConversionEngine& engine, int out_fd,
+                 CsvBatchStats* stats)
+      : engine_(engine), out_fd_(out_fd), stats_(stats) {}
+
+  // Converts every line in |lines|, which holds whole lines only.
+  bool Process(std::string_view lines) {
+    lines_.clear();
+    amounts_.clear();
+    pairs_.clear();
+    valid_.clear();
+    while (!lines.empty()) {
+      size_t end = lines.find('\n');
+      std::string_view line = lines.substr(0, end);
+      lines.remove_prefix(end == std::string_view::npos ? lines.size()
+                                                         : end + 1);
+      if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+      }
+      if (Trim(line).empty()) {
+        continue;
+      }
+      if (first_line_) {
+        first_line_ = false;
+        if (IsHeader(line)) {
+          Append(line);
+          Append(",result\n");
+          continue;
+        }
+      }
+      AddRow(line);
+    }
+
+    results_.resize(amounts_.size());
+    if (engine_.ConvertBatch(amounts_.data(), pairs_.data(), amounts_.size(),
+                             results_.data()) != Status::kOk) {
+      // Some row overflowed; redo the chunk row by row to find which.
+      for (size_t i = 0; i < amounts_.size(); i++) {
+        valid_[i] = valid_[i] &&
+                    engine_.Convert(amounts_[i], pairs_[i] >> 16,
+                                    pairs_[i] & 0xffff,
+                                    &results_[i]) == Status::kOk;
+      }
+    }
+
+    for (size_t i = 0; i < lines_.size(); i++) {
+      stats_->rows++;
+      Append(lines_[i]);
+      Append(",");
+      if (valid_[i]) {
+        char text[32];
+        int minor_units = GetCurrency(pairs_[i] & 0xffff).minor_units;
+        Append(std::string_view(
+            text, FormatScaledDecimal(results_[i], minor_units, text)));
+      } else {
+        stats_->rejected++;
+      }
+      Append("\n");
+      if (output_.size() >= kWriteFlushSize && !Flush()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool Flush() {
+    bool ok = WriteAll(out_fd_, output_.data(), output_.size());
+    output_.clear();
+    return ok;
+  }
+
+ private:
+  static bool IsHeader(std::string_view line) {
+    std::string_view first = Trim(line.substr(0, line.find(',')));
+    return !first.empty() && first[0] != '-' && first[0] != '+' &&
+           first[0] != '.' && (first[0] < '0' || first[0] > '9');
+  }
+
+  void AddRow(std::string_view line) {
+    std::string_view fields[3];
+    size_t field_count = 0;
+    std::string_view rest = line;
+    while (field_count < 3) {
+      size_t comma = rest.find(',');
+      fields[field_count++] = Trim(rest.substr(0, comma));
+      if (comma == std::string_view::npos) {
+        rest = std::string_view();
+        break;
+      }
+      rest.remove_prefix(comma + 1);
+    }
+
+    CurrencyId from = field_count == 3 ? FindCurrency(fields[1])
+                                       : kInvalidCurrency;
+    CurrencyId to = field_count == 3 ? FindCurrency(fields[2])
+                                     : kInvalidCurrency;
+    int64_t amount = 0;
+    bool valid = from != kInvalidCurrency && to != kInvalidCurrency &&
+                 rest.empty() &&
+                 ParseScaledDecimal(fields[0], GetCurrency(from).minor_units,
+                                    &amount);
+    if (!valid) {
+      // Keep the batch well formed; the row is reported as rejected.
+      from = to = 0;
+      amount = 0;
+    }
+    lines_.push_back(line);
+    amounts_.push_back(amount);
+    pairs_.push_back(PackPair(from, to));
+    valid_.push_back(valid);
+  }
+
+  void Append(std::string_view text) {
+    output_.insert(output_.end(), text.begin(), text.end());
+  }
+
+  const ConversionEngine& engine_;
+  const int out_fd_;
+  CsvBatchStats* const stats_;
+  bool first_line_ = true;
+
+  // Columns of the chunk being processed, reused between chunks.
+  std::vector<std::string_view> lines_;
+  std::vector<int64_t> amounts_;
+  std::vector<uint32_t> pairs_;
+  std::vector<int64_t> results_;
+  std::vector<bool> valid_;
+  std::vector<char> output_;
+};
+
+}  // namespace
+
+bool ConvertCsvStream(const ConversionEngine& engine, int in_fd, int out_fd,
+                      CsvBatchStats* stats) {
+  ChunkConverter converter(engine, out_fd, stats);
+  std::vector<char> buffer(kReadChunkSize);
+  size_t filled = 0;
+  // Set while skipping the remainder of a line longer than the buffer.
+  bool skipping = false;
+
+  while (true) {
+    ssize_t count = read(in_fd, buffer.data() + filled, buffer.size() - filled);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    filled += count;
+    bool at_end = count == 0;
+
+    std::string_view data(buffer.data(), filled);
+    size_t last_newline = data.rfind('\n');
+    size_t complete = at_end ? filled
+                      : last_newline == std::string_view::npos
+                          ? 0
+                          : last_newline + 1;
+    if (skipping) {
+      size_t first_newline = data.find('\n');
+      if (first_newline == std::string_view::npos && !at_end) {
+        filled = 0;
+        continue;
+      }
+      skipping = false;
+      size_t skip = first_newline == std::string_view::npos ? filled
+                                                            : first_newline + 1;
+      data.remove_prefix(skip);
+      complete -= std::min(complete, skip);
+    }
+
+    if (complete == 0 && filled == buffer.size()) {
+      // A single line fills the whole buffer: reject it and skip the rest.
+      stats->rows++;
+      stats->rejected++;
+      skipping = true;
+      filled = 0;
+      continue;
+    }
+    if (!converter.Process(data.substr(0, complete))) {
+      return false;
+    }
+
+    size_t consumed = (data.data() - buffer.data()) + complete;
+    memmove(buffer.data(), buffer.data() + consumed, filled - consumed);
+    filled -= consumed;
+    if (at_end) {
+      break;
+    }
+  }
+  return converter.Flush();
+}
+
+}  // namespace converter
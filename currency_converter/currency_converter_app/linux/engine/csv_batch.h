@@ -0,0 +1,31 @@
+#ifndef CONVERTER_ENGINE_CSV_BATCH_H_
+#define CONVERTER_ENGINE_CSV_BATCH_H_
+
+#include <cstdint>
+
+#include "conversion_engine.h"
+
+namespace converter {
+
+struct CsvBatchStats {
+  // Data rows read, excluding an optional header.
+  uint64_t rows = 0;
+  // Rows that could not be converted. They are still written, with an empty
+  // result column.
+  uint64_t rejected = 0;
+};
+
+// Streams "amount,from,to" rows from |in_fd| and writes each one back with a
+// fourth "result" column holding the exact amount in |to|, formatted with its
+// minor units. A first line that does not start with an amount is treated as
+// a header and extended with ",result".
+//
+// Input is processed in fixed-size chunks, so memory use does not depend on
+// the input size. Lines longer than a chunk (1 MiB) are counted as rejected
+// and dropped. Returns false on a read or write error.
+bool ConvertCsvStream(const ConversionEngine& engine, int in_fd, int out_fd,
+                      CsvBatchStats* stats);
+
+}  // namespace converter
+
+#endif  // CONVERTER_ENGINE_CSV_BATCH_H_
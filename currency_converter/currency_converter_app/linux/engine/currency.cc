@@ -0,0 +1,144 @@
+#include "currency.h"
+
+namespace converter {
+
+namespace {
+
+// Active ISO-4217 currencies and funds, sorted by code. The table is
+// generated from currencies.csv at build time.
+constexpr Currency kCurrencies[] = {
+#include "currency_table.inc"
+};
+
+constexpr size_t kCount = sizeof(kCurrencies) / sizeof(kCurrencies[0]);
+static_assert(kCount < 0xff, "currency ids must fit in a byte");
+
+constexpr bool MinorUnitsInRange() {
+  for (const Currency& currency : kCurrencies) {
+    if (currency.minor_units > kMaxMinorUnits) {
+      return false;
+    }
+  }
+  return true;
+}
+static_assert(MinorUnitsInRange(), "minor units above kMaxMinorUnits");
+
+// Packs a three-letter code into 15 bits, five per letter with 'A' as 1, so
+// that no valid code packs to 0. |valid| is cleared if |code| is not three
+// upper-case ASCII letters.
+constexpr uint32_t PackCode(std::string_view code, bool* valid) {
+  uint32_t key = 0;
+  bool letters = code.size() == 3;
+  for (size_t i = 0; i < 3; i++) {
+    uint32_t letter =
+        static_cast<uint8_t>(i < code.size() ? code[i] : 0) - uint32_t{'A'};
+    letters &= letter < 26;
+    key = key << 5 | ((letter + 1) & 31);
+  }
+  *valid = letters;
+  return key;
+}
+
+constexpr uint32_t PackCode(std::string_view code) {
+  bool valid = false;
+  return PackCode(code, &valid);
+}
+
+// Code lookup is a multiplicative hash into kSlotCount slots with a
+// multiplier chosen at compile time so that no two registry codes collide.
+// With the table 25 times larger than the registry a working multiplier is
+// found within a few dozen candidates, which keeps the search well inside
+// compilers' constant-evaluation limits.
+constexpr int kSlotBits = 12;
+constexpr size_t kSlotCount = size_t{1} << kSlotBits;
+constexpr uint8_t kEmptySlot = 0xff;
+
+constexpr uint32_t SlotOf(uint32_t key, uint32_t multiplier) {
+  return (key * multiplier) >> (32 - kSlotBits);
+}
+
+constexpr bool IsPerfect(uint32_t multiplier) {
+  uint64_t used[kSlotCount / 64] = {};
+  for (const Currency& currency : kCurrencies) {
+    uint32_t slot = SlotOf(PackCode(currency.code), multiplier);
+    if (used[slot / 64] >> (slot % 64) & 1) {
+      return false;
+    }
+    used[slot / 64] |= uint64_t{1} << (slot % 64);
+  }
+  return true;
+}
+
+// Tries odd multipliers along a golden-ratio sequence. Returns 0 if none of
+// the first few thousand works, which the static_assert below reports.
+constexpr uint32_t FindMultiplier() {
+  uint32_t multiplier = 0x9e3779b1;
+  for (int attempt = 0; attempt < 4096; attempt++) {
+    if (IsPerfect(multiplier)) {
+      return multiplier;
+    }
+    multiplier += 0x9e3779b8;
+  }
+  return 0;
+}
+
+constexpr uint32_t kMultiplier = FindMultiplier();
+static_assert(kMultiplier != 0,
+              "no collision-free hash multiplier for the currency registry");
+
+struct CodeIndex {
+  // Id of the currency hashing to each slot, or kEmptySlot.
+  uint8_t slots[kSlotCount];
+  // Packed code of each id. Index kEmptySlot holds 0, which matches no code,
+  // so empty slots need no separate check.
+  uint16_t keys[256];
+};
+
+constexpr CodeIndex BuildCodeIndex() {
+  CodeIndex index = {};
+  for (uint8_t& slot : index.slots) {
+    slot = kEmptySlot;
+  }
+  for (size_t id = 0; id < kCount; id++) {
+    uint32_t key = PackCode(kCurrencies[id].code);
+    index.slots[SlotOf(key, kMultiplier)] = static_cast<uint8_t>(id);
+    index.keys[id] = static_cast<uint16_t>(key);
+  }
+  return index;
+}
+
+constexpr CodeIndex kCodeIndex = BuildCodeIndex();
+
+constexpr CurrencyId LookupCode(std::string_view code) {
+  bool valid = false;
+  uint32_t key = PackCode(code, &valid);
+  uint8_t id = kCodeIndex.slots[SlotOf(key, kMultiplier)];
+  bool found = valid & (kCodeIndex.keys[id] == key);
+  return found ? id : kInvalidCurrency;
+}
+
+static_assert(kCurrencies[LookupCode("USD")].numeric == 840, "USD lookup");
+static_assert(LookupCode("usd") == kInvalidCurrency, "lower case rejected");
+static_assert(LookupCode("US") == kInvalidCurrency, "short code rejected");
+static_assert(LookupCode("XXXX") == kInvalidCurrency, "long code rejected");
+
+}  // namespace
+
+size_t CurrencyCount() {
+  return kCount;
+}
+
+const Currency& GetCurrency(CurrencyId id) {
+  return kCurrencies[id];
+}
+
+CurrencyId FindCurrency(std::string_view code) {
+  return LookupCode(code);
+}
+
+CurrencyId BaseCurrency() {
+  static const CurrencyId base = FindCurrency(kBaseCurrencyCode);
+  return base;
+}
+
+}  // namespace converter
@@ -0,0 +1,47 @@
+#ifndef CONVERTER_ENGINE_CURRENCY_H_
+#define CONVERTER_ENGINE_CURRENCY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace converter {
+
+// Index of a currency in the registry. Ids are dense, starting at 0, so they
+// can be used directly as array indices.
+using CurrencyId = uint16_t;
+constexpr CurrencyId kInvalidCurrency = 0xffff;
+
+// The base currency all seed rates are quoted against.
+constexpr std::string_view kBaseCurrencyCode = "USD";
+
+// Largest number of minor-unit digits a registry currency may have.
+constexpr int kMaxMinorUnits = 6;
+
+struct Currency {
+  // ISO-4217 alphabetic code, e.g. "USD".
+  const char* code;
+  // ISO-4217 numeric code, e.g. 840.
+  uint16_t numeric;
+  // Number of digits after the decimal point in the minor unit.
+  uint8_t minor_units;
+  // Units of this currency per one unit of the base currency, as a decimal
+  // string. Used to seed the rate table before any feed is connected.
+  const char* seed_rate;
+};
+
+// Returns the number of currencies in the registry.
+size_t CurrencyCount();
+
+// Returns the currency with the given |id|, which must be valid.
+const Currency& GetCurrency(CurrencyId id);
+
+// Returns the id of the currency with alphabetic |code|, or kInvalidCurrency.
+CurrencyId FindCurrency(std::string_view code);
+
+// Returns the id of kBaseCurrencyCode.
+CurrencyId BaseCurrency();
+
+}  // namespace converter
+
+#endif  // CONVERTER_ENGINE_CURRENCY_H_
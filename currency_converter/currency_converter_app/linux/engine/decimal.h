@@ -0,0 +1,218 @@
+#ifndef CONVERTER_ENGINE_DECIMAL_H_
+#define CONVERTER_ENGINE_DECIMAL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+#include "fixed_point.h"
+
+namespace converter {
+
+// Divides |n| by 10^Digits, rounding half to even. Digits may be 0 to 38.
+//
+// The divisor is a compile-time constant, and 10^Digits = 2^Digits *
+// 5^Digits, so the quotient is (|n| >> Digits) / 5^Digits. Whenever that
+// shifted value fits in 64 bits, which covers every amount times rate that
+// converts without overflow at usual scales, the division compiles to a
+// multiply and shift instead of a call into the 128-bit division routine.
+template <int Digits>
+inline __int128 DivPow10RoundHalfEven(__int128 n) {
+  static_assert(Digits >= 0 && Digits <= 38, "10^Digits must fit in int128");
+  if constexpr (Digits == 0) {
+    return n;
+  } else {
+    constexpr unsigned __int128 kDivisor = Pow10(Digits);
+    // All ones for negative |n|. Signs and rounding are applied with
+    // arithmetic rather than branches, which mispredict on real batches.
+    unsigned __int128 sign = static_cast<unsigned __int128>(n >> 127);
+    unsigned __int128 magnitude = (static_cast<unsigned __int128>(n) ^ sign) -
+                                  sign;
+    unsigned __int128 quotient;
+    // 5^27 is the largest power of five below 2^64.
+    if constexpr (Digits <= 27) {
+      constexpr uint64_t kOddPart = static_cast<uint64_t>(kDivisor >> Digits);
+      unsigned __int128 shifted = magnitude >> Digits;
+      if (shifted >> 64 == 0) {
+        quotient = static_cast<uint64_t>(shifted) / kOddPart;
+      } else {
+        quotient = magnitude / kDivisor;
+      }
+    } else {
+      quotient = magnitude / kDivisor;
+    }
+    unsigned __int128 remainder = magnitude - quotient * kDivisor;
+    unsigned __int128 twice = 2 * remainder;
+    quotient += static_cast<unsigned>(twice > kDivisor) |
+                (static_cast<unsigned>(twice == kDivisor) &
+                 static_cast<unsigned>(quotient & 1));
+    return static_cast<__int128>((quotient ^ sign) - sign);
+  }
+}
+
+// Decimal<Scale> scales above this are held in __int128 by default. At this
+// scale an int64 still holds over nine million whole units, which is the
+// range rates are stored in; amounts use far smaller scales.
+constexpr int kMaxInt64DecimalScale = kRateScaleDigits;
+
+template <int Scale>
+using DefaultDecimalRep =
+    std::conditional_t<(Scale <= kMaxInt64DecimalScale), int64_t, __int128>;
+
+// A fixed-point decimal with |Scale| digits after the point, held as an
+// integer count of 10^-Scale units. The scale is part of the type, so every
+// rescaling factor is a compile-time constant and no operation branches on
+// precision at run time.
+//
+// The representation is int64 or __int128, chosen from the scale unless
+// given: sums of many int64 amounts want __int128 at any scale, and a factor
+// known to fit in int64 can say so at a wide scale, which spares multiplying
+// by it an overflow check.
+//
+// Arithmetic is exact. Results that need fewer digits than the exact value
+// has are rounded half to even (banker's rounding), and every operation that
+// can overflow reports it by returning false, leaving |out| untouched.
+template <int Scale, typename RepType = DefaultDecimalRep<Scale>>
+class Decimal {
+ public:
+  static_assert(Scale >= 0 && Scale <= 18, "Scale must be 0 to 18");
+  static_assert(std::is_same_v<RepType, int64_t> ||
+                    std::is_same_v<RepType, __int128>,
+                "Decimal is held in int64_t or __int128");
+
+  using Rep = RepType;
+  static constexpr int kScale = Scale;
+
+  constexpr Decimal() = default;
+
+  // Wraps |raw| units of 10^-Scale.
+  static constexpr Decimal FromRaw(Rep raw) {
+    Decimal result;
+    result.raw_ = raw;
+    return result;
+  }
+
+  constexpr Rep raw() const { return raw_; }
+
+  // Parses a plain decimal string such as "-12.345", rounding digits beyond
+  // Scale half to even. Returns false on malformed input or overflow.
+  static bool Parse(std::string_view text, Decimal* out) {
+    if constexpr (std::is_same_v<Rep, int64_t>) {
+      int64_t raw;
+      if (!ParseScaledDecimal(text, Scale, &raw)) {
+        return false;
+      }
+      out->raw_ = raw;
+    } else {
+      __int128 raw;
+      if (!ParseScaledDecimal128(text, Scale, &raw)) {
+        return false;
+      }
+      out->raw_ = raw;
+    }
+    return true;
+  }
+
+  // Writes the value as a plain decimal string into |out|, which must have
+  // room for 42 characters. Returns the number of characters written; no
+  // terminator is added.
+  size_t Format(char* out) const {
+    if constexpr (std::is_same_v<Rep, int64_t>) {
+      return FormatScaledDecimal(raw_, Scale, out);
+    } else {
+      return FormatScaledDecimal128(raw_, Scale, out);
+    }
+  }
+
+  bool Add(Decimal other, Decimal* out) const {
+    Rep sum;
+    if (__builtin_add_overflow(raw_, other.raw_, &sum)) {
+      return false;
+    }
+    out->raw_ = sum;
+    return true;
+  }
+
+  bool Subtract(Decimal other, Decimal* out) const {
+    Rep difference;
+    if (__builtin_sub_overflow(raw_, other.raw_, &difference)) {
+      return false;
+    }
+    out->raw_ = difference;
+    return true;
+  }
+
+  // Converts to another scale, rounding half to even when digits are
+  // dropped.
+  template <int To, typename ToRep>
+  bool Rescale(Decimal<To, ToRep>* out) const {
+    if constexpr (To >= Scale) {
+      __int128 scaled;
+      if (__builtin_mul_overflow(static_cast<__int128>(raw_),
+                                 Pow10(To - Scale), &scaled)) {
+        return false;
+      }
+      return Narrow(scaled, out);
+    } else {
+      return Narrow(DivPow10RoundHalfEven<Scale - To>(raw_), out);
+    }
+  }
+
+  // Multiplies by |rate| and rounds the exact product half to even to
+  // scale To, e.g. an amount in cents times a 12-digit rate into the minor
+  // units of another currency.
+  template <int To, typename ToRep, int RateScale, typename RateRep>
+  bool Multiply(Decimal<RateScale, RateRep> rate,
+                Decimal<To, ToRep>* out) const {
+    __int128 product;
+    if constexpr (std::is_same_v<Rep, int64_t> &&
+                  std::is_same_v<RateRep, int64_t>) {
+      // Cannot overflow, so the common case needs no check.
+      product = static_cast<__int128>(raw_) * rate.raw();
+    } else if (__builtin_mul_overflow(static_cast<__int128>(raw_),
+                                      static_cast<__int128>(rate.raw()),
+                                      &product)) {
+      return false;
+    }
+    constexpr int kDropped = Scale + RateScale - To;
+    if constexpr (kDropped >= 0) {
+      return Narrow(DivPow10RoundHalfEven<kDropped>(product), out);
+    } else {
+      __int128 scaled;
+      if (__builtin_mul_overflow(product, Pow10(-kDropped), &scaled)) {
+        return false;
+      }
+      return Narrow(scaled, out);
+    }
+  }
+
+  friend constexpr bool operator==(Decimal a, Decimal b) {
+    return a.raw_ == b.raw_;
+  }
+  friend constexpr bool operator!=(Decimal a, Decimal b) {
+    return a.raw_ != b.raw_;
+  }
+  friend constexpr bool operator<(Decimal a, Decimal b) {
+    return a.raw_ < b.raw_;
+  }
+
+ private:
+  // Stores |value| in |out| if it fits that decimal's representation.
+  template <int To, typename ToRep>
+  static bool Narrow(__int128 value, Decimal<To, ToRep>* out) {
+    if constexpr (std::is_same_v<ToRep, int64_t>) {
+      if (value > INT64_MAX || value < INT64_MIN) {
+        return false;
+      }
+    }
+    *out = Decimal<To, ToRep>::FromRaw(static_cast<ToRep>(value));
+    return true;
+  }
+
+  Rep raw_ = 0;
+};
+
+}  // namespace converter
+
+#endif  // CONVERTER_ENGINE_DECIMAL_H_
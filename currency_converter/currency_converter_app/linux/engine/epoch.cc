@@ -0,0 +1,97 @@
+#include "epoch.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+namespace converter {
+
+// Owns the current thread's slot and hands it back when the thread exits.
+struct ThreadSlot {
+  ~ThreadSlot() {
+    if (slot != nullptr) {
+      EpochDomain::Get().ReleaseSlot(slot);
+    }
+  }
+
+  EpochDomain::Slot* slot = nullptr;
+};
+
+namespace {
+
+thread_local ThreadSlot current_thread_slot;
+
+}  // namespace
+
+EpochDomain& EpochDomain::Get() {
+  // Intentionally leaked so that threads exiting during static destruction
+  // can still release their slots.
+  static EpochDomain* domain = new EpochDomain();
+  return *domain;
+}
+
+EpochDomain::Slot* EpochDomain::ClaimSlot() {
+  for (size_t i = 0; i < kMaxThreads; i++) {
+    bool expected = false;
+    if (!slots_[i].claimed.load(std::memory_order_relaxed) &&
+        slots_[i].claimed.compare_exchange_strong(expected, true)) {
+      size_t limit = slot_limit_.load();
+      while (limit < i + 1 && !slot_limit_.compare_exchange_weak(limit, i + 1)) {
+      }
+      return &slots_[i];
+    }
+  }
+  fprintf(stderr, "EpochDomain: more than %zu reader threads\n", kMaxThreads);
+  std::abort();
+}
+
+void EpochDomain::ReleaseSlot(Slot* slot) {
+  slot->epoch.store(0);
+  slot->claimed.store(false);
+}
+
+EpochDomain::Guard::Guard() {
+  ThreadSlot& thread_slot = current_thread_slot;
+  EpochDomain& domain = Get();
+  if (thread_slot.slot == nullptr) {
+    thread_slot.slot = domain.ClaimSlot();
+  }
+  Slot* slot = thread_slot.slot;
+  outermost_ = slot->epoch.load(std::memory_order_relaxed) == 0;
+  if (outermost_) {
+    // Sequentially consistent so the announcement is visible before any
+    // shared pointer is loaded inside the guard.
+    slot->epoch.store(domain.global_epoch_.load());
+  }
+}
+
+EpochDomain::Guard::~Guard() {
+  if (outermost_) {
+    current_thread_slot.slot->epoch.store(0, std::memory_order_release);
+  }
+}
+
+void EpochDomain::Synchronize() {
+  WaitFor(Retire());
+}
+
+uint64_t EpochDomain::Retire() {
+  return global_epoch_.fetch_add(1) + 1;
+}
+
+void EpochDomain::WaitFor(uint64_t epoch) const {
+  size_t limit = slot_limit_.load();
+  for (size_t i = 0; i < limit; i++) {
+    // A reader announcing an older epoch may hold retired data. Readers that
+    // announce |epoch| or later entered after the data was unpublished.
+    while (true) {
+      uint64_t announced = slots_[i].epoch.load();
+      if (announced == 0 || announced >= epoch) {
+        break;
+      }
+      std::this_thread::yield();
+    }
+  }
+}
+
+}  // namespace converter
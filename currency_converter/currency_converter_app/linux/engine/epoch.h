@@ -0,0 +1,74 @@
+#ifndef CONVERTER_ENGINE_EPOCH_H_
+#define CONVERTER_ENGINE_EPOCH_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "aligned_buffer.h"
+
+namespace converter {
+
+// Process-wide epoch-based reclamation, the RCU-style scheme that lets
+// readers access shared data without locks while writers retire it.
+//
+// A reader wraps each access in a Guard, which announces the current epoch
+// in a per-thread slot. A writer that has unpublished some data calls
+// Synchronize(), which advances the epoch and waits until every reader that
+// might still hold the old data has left its guard. Readers never wait.
+class EpochDomain {
+ public:
+  // Upper bound on threads that have ever entered a guard and are still
+  // alive. Exceeding it is a programming error and aborts.
+  static constexpr size_t kMaxThreads = 1024;
+
+  static EpochDomain& Get();
+
+  // Marks a read-side critical section on the current thread. Guards may
+  // nest; the outermost one determines the announced epoch. A guard must be
+  // destroyed on the thread that created it.
+  class Guard {
+   public:
+    Guard();
+    ~Guard();
+    Guard(const Guard&) = delete;
+    Guard& operator=(const Guard&) = delete;
+
+   private:
+    bool outermost_;
+  };
+
+  // Waits until no reader can still observe data unpublished before this
+  // call. Never blocks readers.
+  void Synchronize();
+
+  // Synchronize() in two halves, for writers that can put off reusing what
+  // they unpublished. Retire(), called once the data is unpublished, returns
+  // the epoch to pass to WaitFor() before reusing it. By then the readers
+  // that could see it have usually left, and WaitFor() only scans the slots.
+  uint64_t Retire();
+  void WaitFor(uint64_t epoch) const;
+
+ private:
+  struct alignas(kCacheLineSize) Slot {
+    // Epoch announced by the owning thread, or 0 when it is not reading.
+    std::atomic<uint64_t> epoch{0};
+    std::atomic<bool> claimed{false};
+  };
+
+  EpochDomain() = default;
+
+  Slot* ClaimSlot();
+  void ReleaseSlot(Slot* slot);
+
+  alignas(kCacheLineSize) std::atomic<uint64_t> global_epoch_{1};
+  Slot slots_[kMaxThreads];
+  // One past the highest slot ever claimed, to bound writer scans.
+  std::atomic<size_t> slot_limit_{0};
+
+  friend struct ThreadSlot;
+};
+
+}  // namespace converter
+
+#endif  // CONVERTER_ENGINE_EPOCH_H_
@@ -0,0 +1,122 @@
+#include "fixed_point.h"
+
+namespace converter {
+
+bool ParseScaledDecimal128(std::string_view text, int scale_digits,
+                           __int128* out) {
+  size_t pos = 0;
+  bool negative = false;
+  if (pos < text.size() && (text[pos] == '-' || text[pos] == '+')) {
+    negative = text[pos] == '-';
+    pos++;
+  }
+
+  // Accumulate up to 36 digits, which keeps the mantissa well inside the
+  // int128 range; longer inputs are rejected.
+  __int128 mantissa = 0;
+  int digits = 0;
+  int fraction_digits = 0;
+  bool seen_point = false;
+  for (; pos < text.size(); pos++) {
+    char c = text[pos];
+    if (c == '.' && !seen_point) {
+      seen_point = true;
+      continue;
+    }
+    if (c < '0' || c > '9') {
+      return false;
+    }
+    if (digits == 36) {
+      return false;
+    }
+    mantissa = mantissa * 10 + (c - '0');
+    digits++;
+    if (seen_point) {
+      fraction_digits++;
+    }
+  }
+  if (digits == 0) {
+    return false;
+  }
+  if (negative) {
+    mantissa = -mantissa;
+  }
+
+  if (fraction_digits <= scale_digits) {
+    __int128 scaled;
+    if (__builtin_mul_overflow(mantissa, Pow10(scale_digits - fraction_digits),
+                               &scaled)) {
+      return false;
+    }
+    *out = scaled;
+    return true;
+  }
+  // Round away the extra digits half to even.
+  __int128 divisor = Pow10(fraction_digits - scale_digits);
+  __int128 quotient = mantissa / divisor;
+  __int128 remainder = mantissa % divisor;
+  __int128 twice = remainder < 0 ? -2 * remainder : 2 * remainder;
+  if (twice > divisor || (twice == divisor && (quotient & 1) != 0)) {
+    quotient += mantissa < 0 ? -1 : 1;
+  }
+  *out = quotient;
+  return true;
+}
+
+bool ParseScaledDecimal(std::string_view text, int scale_digits, int64_t* out) {
+  __int128 value;
+  if (!ParseScaledDecimal128(text, scale_digits, &value) ||
+      value > INT64_MAX || value < INT64_MIN) {
+    return false;
+  }
+  *out = static_cast<int64_t>(value);
+  return true;
+}
+
+namespace {
+
+// Writes |magnitude|, scaled by 10^|scale_digits|, with a leading minus sign
+// if |negative|.
+template <typename Unsigned>
+size_t FormatMagnitude(Unsigned magnitude, bool negative, int scale_digits,
+                       char* out) {
+  char digits[48];
+  int count = 0;
+  do {
+    digits[count++] = static_cast<char>('0' + magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude != 0);
+  while (count <= scale_digits) {
+    digits[count++] = '0';
+  }
+
+  size_t length = 0;
+  if (negative) {
+    out[length++] = '-';
+  }
+  for (int i = count - 1; i >= 0; i--) {
+    out[length++] = digits[i];
+    if (i == scale_digits && i != 0) {
+      out[length++] = '.';
+    }
+  }
+  return length;
+}
+
+}  // namespace
+
+size_t FormatScaledDecimal(int64_t value, int scale_digits, char* out) {
+  // Work with the magnitude as unsigned so INT64_MIN is handled.
+  uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value)
+                                 : static_cast<uint64_t>(value);
+  return FormatMagnitude(magnitude, value < 0, scale_digits, out);
+}
+
+size_t FormatScaledDecimal128(__int128 value, int scale_digits, char* out) {
+  unsigned __int128 magnitude =
+      value < 0 ? 0 - static_cast<unsigned __int128>(value)
+                : static_cast<unsigned __int128>(value);
+  return FormatMagnitude(magnitude, value < 0, scale_digits, out);
+}
+
+}  // namespace converter
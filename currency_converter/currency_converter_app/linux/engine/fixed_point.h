@@ -0,0 +1,62 @@
+#ifndef CONVERTER_ENGINE_FIXED_POINT_H_
+#define CONVERTER_ENGINE_FIXED_POINT_H_
+
+#include <cstdint>
+#include <string_view>
+
+namespace converter {
+
+// Rates are stored as integers scaled by 10^kRateScaleDigits, so that
+// 83.245 INR per USD is held as 83245000000000.
+constexpr int kRateScaleDigits = 12;
+constexpr int64_t kRateScale = 1000000000000;
+
+// Returns 10^n for 0 <= n <= 38.
+constexpr __int128 Pow10(int n) {
+  __int128 result = 1;
+  for (int i = 0; i < n; i++) {
+    result *= 10;
+  }
+  return result;
+}
+
+// Divides |numerator| by a positive |denominator|, rounding half to even
+// (banker's rounding). Returns false if the quotient does not fit in int64.
+inline bool DivRoundHalfEven(__int128 numerator, __int128 denominator,
+                             int64_t* out) {
+  __int128 quotient = numerator / denominator;
+  __int128 remainder = numerator % denominator;
+  if (remainder != 0) {
+    __int128 twice = remainder < 0 ? -2 * remainder : 2 * remainder;
+    if (twice > denominator || (twice == denominator && (quotient & 1) != 0)) {
+      quotient += numerator < 0 ? -1 : 1;
+    }
+  }
+  if (quotient > INT64_MAX || quotient < INT64_MIN) {
+    return false;
+  }
+  *out = static_cast<int64_t>(quotient);
+  return true;
+}
+
+// Parses a plain decimal string such as "-1234.5678" into an integer scaled
+// by 10^|scale_digits| (at most 18). Digits beyond the scale are rounded half
+// to even. Returns false on malformed input or overflow.
+bool ParseScaledDecimal(std::string_view text, int scale_digits, int64_t* out);
+
+// As above, into an int128 for scales whose values may exceed int64.
+bool ParseScaledDecimal128(std::string_view text, int scale_digits,
+                           __int128* out);
+
+// Writes |value|, an integer scaled by 10^|scale_digits| (at most 18), as a
+// plain decimal string such as "-1234.50" into |out|, which must have room
+// for at least 22 characters. Returns the number of characters written; no
+// terminator is added.
+size_t FormatScaledDecimal(int64_t value, int scale_digits, char* out);
+
+// As above for an int128 |value|. |out| must have room for 42 characters.
+size_t FormatScaledDecimal128(__int128 value, int scale_digits, char* out);
+
+}  // namespace converter
+
+#endif  // CONVERTER_ENGINE_FIXED_POINT_H_
@@ -0,0 +1,36 @@
+# Generates the currency registry table included by currency.cc from
+# currencies.csv. Run as
+#   cmake -DINPUT=<currencies.csv> -DOUTPUT=<currency_table.inc> -P <this file>
+# Entries are sorted by code so that ids follow alphabetical order.
+
+file(STRINGS "${INPUT}" lines)
+set(rows "")
+foreach(line IN LISTS lines)
+  if(line MATCHES "^#" OR line MATCHES "^code," OR line STREQUAL "")
+    continue()
+  endif()
+  if(NOT line MATCHES "^([A-Z][A-Z][A-Z]),([0-9]+),([0-9]),([0-9]+(\\.[0-9]+)?)$")
+    message(FATAL_ERROR "${INPUT}: malformed currency line '${line}'")
+  endif()
+  list(APPEND rows "${line}")
+endforeach()
+list(SORT rows)
+
+set(content "// Generated from currencies.csv by generate_currency_table.cmake.\n")
+string(APPEND content "// Do not edit.\n")
+set(previous "")
+foreach(row IN LISTS rows)
+  string(REPLACE "," ";" fields "${row}")
+  list(GET fields 0 code)
+  list(GET fields 1 numeric)
+  list(GET fields 2 minor_units)
+  list(GET fields 3 seed_rate)
+  if(code STREQUAL previous)
+    message(FATAL_ERROR "${INPUT}: duplicate currency ${code}")
+  endif()
+  set(previous "${code}")
+  string(APPEND content
+    "{\"${code}\", ${numeric}, ${minor_units}, \"${seed_rate}\"},\n")
+endforeach()
+
+file(WRITE "${OUTPUT}" "${content}")
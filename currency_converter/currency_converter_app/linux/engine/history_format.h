@@ -0,0 +1,128 @@
+#ifndef CONVERTER_ENGINE_HISTORY_FORMAT_H_
+#define CONVERTER_ENGINE_HISTORY_FORMAT_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// On-disk layout of rate history files, shared by the writer and the reader.
+// Everything is little-endian and naturally aligned so the reader can use the
+// mapped bytes in place.
+//
+//   FileHeader
+//   block 0: frame 0 .. frame n, BlockFooter
+//   block 1: ...
+//   PairEntry[pair_count]                 sorted by pair
+//   uint64_t block_footers[block_count]   grouped by pair, oldest first
+//   int64_t  index_keys[]                 per pair: Eytzinger-ordered first
+//   uint32_t index_blocks[]               timestamps of its blocks, and the
+//                                         block each key belongs to
+//   FileTrailer
+//
+// A block holds up to kBlockTicks consecutive ticks of one pair, split into
+// frames of kFrameTicks. Its footer carries the first timestamp and offset of
+// every frame, so a lookup reads the footer, then decodes a single frame. In
+// the raw encoding a frame is timestamps[count] followed by rates[count],
+// keeping a tick's timestamp and rate on the same page; see BlockEncoding for
+// the compressed one.
+
+namespace converter {
+namespace history {
+
+constexpr uint64_t kFileMagic = 0x3130545349484343;  // "CCHIST01"
+constexpr uint32_t kFormatVersion = 1;
+constexpr uint32_t kBlockMagic = 0x4b4c4243;  // "CBLK"
+
+constexpr size_t kFrameTicks = 64;
+constexpr size_t kFramesPerBlock = 64;
+constexpr size_t kBlockTicks = kFrameTicks * kFramesPerBlock;
+
+// Sections start on this boundary.
+constexpr size_t kSectionAlignment = 64;
+
+enum class BlockEncoding : uint16_t {
+  // Plain int64 timestamp and rate columns per frame.
+  kRaw = 0,
+  // Per frame, a PackedFrameHeader, then the zigzag-encoded delta-of-deltas
+  // of the timestamps after the second and the deltas of the rates, each bit-packed at the
+  // frame's widest value. Regular tick spacing packs to zero bits, and rate
+  // deltas drop the trailing decimal zeros shared by the whole frame.
+  kDeltaPacked = 1,
+};
+
+struct PackedFrameHeader {
+  int64_t first_timestamp;
+  int64_t first_rate;
+  // Difference between the first two timestamps, from which the packed
+  // delta-of-deltas continue.
+  int64_t first_delta;
+  uint8_t timestamp_width;
+  uint8_t rate_width;
+  // Rate deltas are stored divided by 10^rate_exponent.
+  uint8_t rate_exponent;
+  uint8_t reserved[5];
+};
+
+// Number of words holding |count| packed values of |width| bits. Packed
+// sections are followed by one zero word so decoders can read whole words.
+constexpr size_t PackedWords(size_t count, int width) {
+  return (count * width + 63) / 64;
+}
+
+struct FileHeader {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t reserved;
+  uint8_t padding[48];
+};
+
+struct BlockFooter {
+  uint32_t magic;
+  BlockEncoding encoding;
+  uint16_t frame_count;
+  uint32_t pair;
+  uint32_t count;
+  int64_t first_timestamp;
+  int64_t last_timestamp;
+  // Absolute file offset and size of the block's columns.
+  uint64_t payload_offset;
+  uint64_t payload_size;
+  // First timestamp of each frame; unused entries are INT64_MAX.
+  int64_t frame_first[kFramesPerBlock];
+  // Byte offset of each frame within the payload.
+  uint32_t frame_offset[kFramesPerBlock];
+};
+
+struct PairEntry {
+  uint32_t pair;
+  uint32_t block_count;
+  // Index of the pair's first block in block_footers, and of its first
+  // entries in index_keys / index_blocks (block_count + 1 of each, as the
+  // Eytzinger layout is 1-based).
+  uint64_t first_block;
+  uint64_t first_index;
+  uint64_t tick_count;
+  int64_t first_timestamp;
+  int64_t last_timestamp;
+};
+
+struct FileTrailer {
+  uint64_t pair_count;
+  uint64_t block_count;
+  uint64_t index_size;
+  uint64_t directory_offset;
+  uint64_t block_footers_offset;
+  uint64_t index_keys_offset;
+  uint64_t index_blocks_offset;
+  uint64_t magic;
+};
+
+static_assert(sizeof(FileHeader) == 64, "FileHeader layout");
+static_assert(sizeof(PackedFrameHeader) == 32, "PackedFrameHeader layout");
+static_assert(sizeof(BlockFooter) % 8 == 0, "BlockFooter layout");
+static_assert(sizeof(PairEntry) == 48, "PairEntry layout");
+static_assert(sizeof(FileTrailer) == 64, "FileTrailer layout");
+
+}  // namespace history
+}  // namespace converter
+
+#endif  // CONVERTER_ENGINE_HISTORY_FORMAT_H_
@@ -0,0 +1,427 @@
+#include "history_store.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "conversion_engine.h"
+#include "fixed_point.h"
+#include "kernels.h"
+#include "tick.h"
+
+namespace converter {
+
+namespace {
+
+using history::BlockFooter;
+using history::FileHeader;
+using history::FileTrailer;
+using history::PairEntry;
+
+// Returns whether [offset, offset + count * element) lies inside a file of
+// |size| bytes, without overflowing.
+bool InBounds(uint64_t offset, uint64_t count, size_t element, size_t size) {
+  return offset <= size && count <= (size - offset) / element &&
+         offset % alignof(uint64_t) == 0;
+}
+
+// Starts loading every cache line of [data, data + size) at once, so that a
+// search over the range waits for one memory round trip rather than one per
+// step.
+void PrefetchRange(const void* data, size_t size) {
+  const char* bytes = static_cast<const char*>(data);
+  for (size_t offset = 0; offset < size; offset += 64) {
+    __builtin_prefetch(bytes + offset);
+  }
+}
+
+// Counts the entries of the sorted |values|[0, count) that are at most
+// |timestamp|. The halving step compiles to a conditional move, so the search
+// has no branch mispredictions to pay for.
+size_t CountAtOrBefore(const int64_t* values, size_t count,
+                       int64_t timestamp) {
+  if (count == 0) {
+    return 0;
+  }
+  const int64_t* base = values;
+  while (count > 1) {
+    size_t half = count / 2;
+    base = base[half] <= timestamp ? base + half : base;
+    count -= half;
+  }
+  return base - values + (*base <= timestamp);
+}
+
+}  // namespace
+
+HistoryStore::~HistoryStore() {
+  Close();
+}
+
+bool HistoryStore::Open(const char* path) {
+  Close();
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 ||
+      static_cast<size_t>(info.st_size) <
+          sizeof(FileHeader) + sizeof(FileTrailer)) {
+    close(fd);
+    return false;
+  }
+  void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    return false;
+  }
+  data_ = static_cast<const char*>(mapped);
+  size_ = info.st_size;
+
+  const FileHeader* header = reinterpret_cast<const FileHeader*>(data_);
+  trailer_ = reinterpret_cast<const FileTrailer*>(data_ + size_ -
+                                                  sizeof(FileTrailer));
+  if (header->magic != history::kFileMagic ||
+      header->version != history::kFormatVersion ||
+      trailer_->magic != history::kFileMagic ||
+      !InBounds(trailer_->directory_offset, trailer_->pair_count,
+                sizeof(PairEntry), size_) ||
+      !InBounds(trailer_->block_footers_offset, trailer_->block_count,
+                sizeof(uint64_t), size_) ||
+      !InBounds(trailer_->index_keys_offset, trailer_->index_size,
+                sizeof(int64_t), size_) ||
+      !InBounds(trailer_->index_blocks_offset, trailer_->index_size,
+                sizeof(uint32_t), size_)) {
+    Close();
+    return false;
+  }
+  pairs_ = reinterpret_cast<const PairEntry*>(data_ +
+                                              trailer_->directory_offset);
+  block_footers_ = reinterpret_cast<const uint64_t*>(
+      data_ + trailer_->block_footers_offset);
+  index_keys_ =
+      reinterpret_cast<const int64_t*>(data_ + trailer_->index_keys_offset);
+  index_blocks_ =
+      reinterpret_cast<const uint32_t*>(data_ + trailer_->index_blocks_offset);
+
+  // The directory and the index are small, so check them fully now; blocks
+  // are checked as lookups reach them.
+  for (size_t i = 0; i < trailer_->pair_count; i++) {
+    const PairEntry& entry = pairs_[i];
+    if ((i > 0 && entry.pair <= pairs_[i - 1].pair) ||
+        entry.block_count == 0 ||
+        entry.first_block > trailer_->block_count ||
+        entry.block_count > trailer_->block_count - entry.first_block ||
+        entry.first_index > trailer_->index_size ||
+        entry.block_count + 1 > trailer_->index_size - entry.first_index) {
+      Close();
+      return false;
+    }
+    // FindBlock() takes the pair's block straight from here.
+    const uint32_t* ranks = index_blocks_ + entry.first_index;
+    for (size_t k = 1; k <= entry.block_count; k++) {
+      if (ranks[k] >= entry.block_count) {
+        Close();
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void HistoryStore::Close() {
+  if (data_ != nullptr) {
+    munmap(const_cast<char*>(data_), size_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+  trailer_ = nullptr;
+  pairs_ = nullptr;
+  block_footers_ = nullptr;
+  index_keys_ = nullptr;
+  index_blocks_ = nullptr;
+}
+
+const PairEntry* HistoryStore::FindPair(uint32_t pair) const {
+  const PairEntry* end = pairs_ + trailer_->pair_count;
+  const PairEntry* entry = std::lower_bound(
+      pairs_, end, pair,
+      [](const PairEntry& entry, uint32_t pair) { return entry.pair < pair; });
+  return entry != end && entry->pair == pair ? entry : nullptr;
+}
+
+const BlockFooter* HistoryStore::Footer(uint64_t block) const {
+  if (block >= trailer_->block_count) {
+    return nullptr;
+  }
+  uint64_t offset = block_footers_[block];
+  if (!InBounds(offset, 1, sizeof(BlockFooter), size_)) {
+    return nullptr;
+  }
+  const BlockFooter* footer =
+      reinterpret_cast<const BlockFooter*>(data_ + offset);
+  PrefetchRange(footer, sizeof(BlockFooter));
+  if (footer->magic != history::kBlockMagic || footer->count == 0 ||
+      footer->count > history::kBlockTicks ||
+      footer->frame_count !=
+          (footer->count + history::kFrameTicks - 1) / history::kFrameTicks ||
+      !InBounds(footer->payload_offset, footer->payload_size, 1, size_)) {
+    return nullptr;
+  }
+  return footer;
+}
+
+size_t HistoryStore::FindBlock(const PairEntry& entry,
+                               int64_t timestamp) const {
+  // Find the first block starting after |timestamp| in the pair's Eytzinger
+  // index. The descent has no unpredictable branches, and the prefetch pulls
+  // in the keys four levels down while the current level is compared.
+  const int64_t* keys = index_keys_ + entry.first_index;
+  size_t n = entry.block_count;
+  size_t k = 1;
+  while (k <= n) {
+    __builtin_prefetch(keys + 16 * k);
+    k = 2 * k + (keys[k] <= timestamp);
+  }
+  k >>= __builtin_ffsll(~k);
+  size_t next_block = k == 0 ? n : index_blocks_[entry.first_index + k];
+  return next_block == 0 ? SIZE_MAX : next_block - 1;
+}
+
+const char* HistoryStore::Frame(const BlockFooter& footer, size_t frame,
+                                size_t* count, size_t* size) const {
+  *count = std::min<size_t>(history::kFrameTicks,
+                            footer.count - frame * history::kFrameTicks);
+  uint64_t offset = footer.frame_offset[frame];
+  uint64_t end = frame + 1 < footer.frame_count
+                     ? footer.frame_offset[frame + 1]
+                     : footer.payload_size;
+  if (offset % alignof(int64_t) != 0 || offset > end ||
+      end > footer.payload_size) {
+    return nullptr;
+  }
+  *size = end - offset;
+  return data_ + footer.payload_offset + offset;
+}
+
+bool HistoryStore::DecodeFrame(const BlockFooter& footer, size_t frame,
+                               int64_t* timestamps, int64_t* rates,
+                               size_t* count) const {
+  size_t size;
+  const char* data = Frame(footer, frame, count, &size);
+  if (data == nullptr) {
+    return false;
+  }
+  size_t n = *count;
+  if (footer.encoding == history::BlockEncoding::kRaw) {
+    if (size < 2 * n * sizeof(int64_t)) {
+      return false;
+    }
+    memcpy(timestamps, data, n * sizeof(int64_t));
+    memcpy(rates, data + n * sizeof(int64_t), n * sizeof(int64_t));
+    return true;
+  }
+  if (footer.encoding != history::BlockEncoding::kDeltaPacked ||
+      size < sizeof(history::PackedFrameHeader)) {
+    return false;
+  }
+
+  const history::PackedFrameHeader* header =
+      reinterpret_cast<const history::PackedFrameHeader*>(data);
+  int timestamp_width = header->timestamp_width;
+  int rate_width = header->rate_width;
+  size_t timestamp_words =
+      history::PackedWords(n < 2 ? 0 : n - 2, timestamp_width);
+  size_t rate_words = history::PackedWords(n - 1, rate_width);
+  if (timestamp_width > 64 || rate_width > 64 || header->rate_exponent > 18 ||
+      (size - sizeof(*header)) / sizeof(uint64_t) <
+          timestamp_words + rate_words + 1) {
+    return false;
+  }
+  const uint64_t* packed =
+      reinterpret_cast<const uint64_t*>(data + sizeof(*header));
+  const ConversionKernels& kernels = GetKernels();
+  timestamps[0] = header->first_timestamp;
+  if (n > 1) {
+    // Delta-of-deltas sum to deltas, which sum to timestamps.
+    timestamps[1] = header->first_delta;
+    kernels.unpack_delta(packed, timestamp_width, n - 2, header->first_delta, 1,
+                         timestamps + 2);
+    kernels.prefix_sum(timestamps + 1, n - 1, header->first_timestamp, 1);
+  }
+  rates[0] = header->first_rate;
+  kernels.unpack_delta(packed + timestamp_words, rate_width, n - 1,
+                       header->first_rate,
+                       static_cast<int64_t>(Pow10(header->rate_exponent)),
+                       rates + 1);
+  return true;
+}
+
+bool HistoryStore::RateAt(uint32_t pair, int64_t timestamp,
+                          HistoryPoint* out) const {
+  if (!is_open()) {
+    return false;
+  }
+  const PairEntry* entry = FindPair(pair);
+  if (entry == nullptr || timestamp < entry->first_timestamp) {
+    return false;
+  }
+  size_t block = FindBlock(*entry, timestamp);
+  const BlockFooter* footer =
+      block == SIZE_MAX ? nullptr : Footer(entry->first_block + block);
+  if (footer == nullptr) {
+    return false;
+  }
+
+  // The footer's frame fences narrow the search to one frame of ticks.
+  size_t frame =
+      std::min<size_t>(CountAtOrBefore(footer->frame_first,
+                                       history::kFramesPerBlock, timestamp),
+                       footer->frame_count);
+  if (frame == 0) {
+    return false;
+  }
+  frame--;
+
+  // Raw frames are searched in place; packed ones are decoded first, which
+  // costs about as much as the cache misses it saves.
+  size_t count;
+  const int64_t* timestamps;
+  const int64_t* rates;
+  int64_t decoded_timestamps[history::kFrameTicks];
+  int64_t decoded_rates[history::kFrameTicks];
+  if (footer->encoding == history::BlockEncoding::kRaw) {
+    size_t size;
+    const char* data = Frame(*footer, frame, &count, &size);
+    if (data == nullptr || size < 2 * count * sizeof(int64_t)) {
+      return false;
+    }
+    timestamps = reinterpret_cast<const int64_t*>(data);
+    rates = timestamps + count;
+    PrefetchRange(timestamps, count * sizeof(int64_t));
+  } else {
+    if (!DecodeFrame(*footer, frame, decoded_timestamps, decoded_rates,
+                     &count)) {
+      return false;
+    }
+    timestamps = decoded_timestamps;
+    rates = decoded_rates;
+  }
+  size_t found = CountAtOrBefore(timestamps, count, timestamp);
+  if (found == 0) {
+    return false;
+  }
+  out->timestamp = timestamps[found - 1];
+  out->rate = rates[found - 1];
+  return true;
+}
+
+bool HistoryStore::Span(uint32_t pair, HistorySpan* out) const {
+  const PairEntry* entry = is_open() ? FindPair(pair) : nullptr;
+  if (entry == nullptr) {
+    return false;
+  }
+  out->first_timestamp = entry->first_timestamp;
+  out->last_timestamp = entry->last_timestamp;
+  out->ticks = entry->tick_count;
+  return true;
+}
+
+bool HistoryStore::ReadRange(uint32_t pair, int64_t begin, int64_t end,
+                             std::vector<int64_t>* timestamps,
+                             std::vector<int64_t>* rates) const {
+  const PairEntry* entry = is_open() ? FindPair(pair) : nullptr;
+  if (entry == nullptr || begin >= end) {
+    return true;
+  }
+  size_t block = FindBlock(*entry, begin);
+  if (block == SIZE_MAX) {
+    block = 0;
+  }
+  for (; block < entry->block_count; block++) {
+    const BlockFooter* footer = Footer(entry->first_block + block);
+    if (footer == nullptr) {
+      return false;
+    }
+    if (footer->first_timestamp >= end) {
+      break;
+    }
+    if (footer->first_timestamp >= begin && footer->last_timestamp < end) {
+      // The whole block is in range: decode every frame in place.
+      size_t size = timestamps->size();
+      timestamps->resize(size + footer->count);
+      rates->resize(size + footer->count);
+      for (size_t frame = 0; frame < footer->frame_count; frame++) {
+        size_t offset = size + frame * history::kFrameTicks;
+        size_t count;
+        if (!DecodeFrame(*footer, frame, timestamps->data() + offset,
+                         rates->data() + offset, &count)) {
+          timestamps->resize(size);
+          rates->resize(size);
+          return false;
+        }
+      }
+      continue;
+    }
+    size_t frame = CountAtOrBefore(footer->frame_first, footer->frame_count,
+                                   begin);
+    for (frame = frame == 0 ? 0 : frame - 1; frame < footer->frame_count;
+         frame++) {
+      if (footer->frame_first[frame] >= end) {
+        break;
+      }
+      // Decode straight into the output, then drop the ticks outside the
+      // range, which only happens at its two ends.
+      size_t size = timestamps->size();
+      timestamps->resize(size + history::kFrameTicks);
+      rates->resize(size + history::kFrameTicks);
+      size_t count;
+      if (!DecodeFrame(*footer, frame, timestamps->data() + size,
+                       rates->data() + size, &count)) {
+        timestamps->resize(size);
+        rates->resize(size);
+        return false;
+      }
+      int64_t* first = timestamps->data() + size;
+      size_t skip = std::lower_bound(first, first + count, begin) - first;
+      size_t keep = std::lower_bound(first, first + count, end) - first;
+      if (skip > 0) {
+        std::copy(first + skip, first + keep, first);
+        std::copy(rates->begin() + size + skip, rates->begin() + size + keep,
+                  rates->begin() + size);
+      }
+      timestamps->resize(size + keep - skip);
+      rates->resize(size + keep - skip);
+    }
+  }
+  return true;
+}
+
+bool HistoryStore::BaseRateAt(CurrencyId currency, int64_t timestamp,
+                              int64_t* out) const {
+  CurrencyId base = BaseCurrency();
+  if (currency == base) {
+    *out = kRateScale;
+    return true;
+  }
+  bool found = false;
+  int64_t found_at = INT64_MIN;
+  for (uint32_t pair : {PackPair(base, currency), PackPair(currency, base)}) {
+    HistoryPoint point;
+    RateTick tick;
+    if (RateAt(pair, timestamp, &point) && point.timestamp >= found_at &&
+        QuoteToRateTick(pair, point.rate, &tick)) {
+      *out = tick.rate;
+      found_at = point.timestamp;
+      found = true;
+    }
+  }
+  return found;
+}
+
+}  // namespace converter
@@ -0,0 +1,98 @@
+#ifndef CONVERTER_ENGINE_HISTORY_STORE_H_
+#define CONVERTER_ENGINE_HISTORY_STORE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "currency.h"
+#include "history_format.h"
+
+namespace converter {
+
+struct HistoryPoint {
+  int64_t timestamp;
+  int64_t rate;
+};
+
+struct HistorySpan {
+  int64_t first_timestamp;
+  int64_t last_timestamp;
+  uint64_t ticks;
+};
+
+// Read-only access to a rate history file written by WriteHistoryFile.
+//
+// The file is mapped into memory and queried in place: opening it only
+// validates the header, trailer and directory, so even years of ticks are
+// available immediately and pages are faulted in as lookups touch them.
+//
+// Lookups are safe to call concurrently. Open and Close must not race with
+// them.
+class HistoryStore {
+ public:
+  HistoryStore() = default;
+  ~HistoryStore();
+
+  HistoryStore(const HistoryStore&) = delete;
+  HistoryStore& operator=(const HistoryStore&) = delete;
+
+  // Maps the history file at |path|, replacing any file already open.
+  // Returns false, leaving the store closed, if the file cannot be mapped or
+  // is not a valid history file.
+  bool Open(const char* path);
+  void Close();
+
+  bool is_open() const { return data_ != nullptr; }
+  size_t pair_count() const { return is_open() ? trailer_->pair_count : 0; }
+
+  // Finds the quote for |pair| (packed with PackPair) in effect at
+  // |timestamp|, i.e. its last tick at or before that time. Returns false if
+  // the pair has no tick that early.
+  bool RateAt(uint32_t pair, int64_t timestamp, HistoryPoint* out) const;
+
+  // Finds the base rate of |currency| in effect at |timestamp|, from the most
+  // recent quote of |currency| against the base currency in either
+  // direction.
+  bool BaseRateAt(CurrencyId currency, int64_t timestamp, int64_t* out) const;
+
+  // Describes the ticks of |pair|. Returns false if it has none.
+  bool Span(uint32_t pair, HistorySpan* out) const;
+
+  // Appends every tick of |pair| with a timestamp in [begin, end), oldest
+  // first, to |timestamps| and |rates|. Only the frames overlapping the range
+  // are decoded. Returns false if the file turns out to be corrupt.
+  bool ReadRange(uint32_t pair, int64_t begin, int64_t end,
+                 std::vector<int64_t>* timestamps,
+                 std::vector<int64_t>* rates) const;
+
+ private:
+  const history::PairEntry* FindPair(uint32_t pair) const;
+  const history::BlockFooter* Footer(uint64_t block) const;
+
+  // Returns the index, within |entry|'s blocks, of the last block starting at
+  // or before |timestamp|, or SIZE_MAX if there is none.
+  size_t FindBlock(const history::PairEntry& entry, int64_t timestamp) const;
+
+  // Locates |frame| of |footer|, setting |count| to its ticks and |size| to
+  // its bytes. Returns null if the frame lies outside the payload.
+  const char* Frame(const history::BlockFooter& footer, size_t frame,
+                    size_t* count, size_t* size) const;
+
+  // Decodes |frame| of |footer| into |timestamps| and |rates|, which have
+  // room for kFrameTicks each. Returns false if the frame is malformed.
+  bool DecodeFrame(const history::BlockFooter& footer, size_t frame,
+                   int64_t* timestamps, int64_t* rates, size_t* count) const;
+
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+  const history::FileTrailer* trailer_ = nullptr;
+  const history::PairEntry* pairs_ = nullptr;
+  const uint64_t* block_footers_ = nullptr;
+  const int64_t* index_keys_ = nullptr;
+  const uint32_t* index_blocks_ = nullptr;
+};
+
+}  // namespace converter
+
+#endif  // CONVERTER_ENGINE_HISTORY_STORE_H_
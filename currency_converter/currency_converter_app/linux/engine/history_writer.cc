@@ -0,0 +1,356 @@
+#include "history_writer.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "fixed_point.h"
+#include "history_format.h"
+
+namespace converter {
+
+namespace {
+
+using history::BlockFooter;
+using history::FileHeader;
+using history::FileTrailer;
+using history::PairEntry;
+
+// Appends to a file descriptor through a buffer, tracking the file offset.
+class FileWriter {
+ public:
+  explicit FileWriter(int fd) : fd_(fd) { buffer_.reserve(kBufferSize); }
+
+  uint64_t offset() const { return offset_; }
+
+  bool Write(const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    offset_ += size;
+    if (buffer_.size() + size > kBufferSize && !Flush()) {
+      return false;
+    }
+    if (size >= kBufferSize) {
+      return WriteAll(bytes, size);
+    }
+    buffer_.insert(buffer_.end(), bytes, bytes + size);
+    return true;
+  }
+
+  // Pads with zeros up to the next multiple of |alignment|.
+  bool Align(size_t alignment) {
+    static const char kZeros[history::kSectionAlignment] = {};
+    size_t padding = (alignment - offset_ % alignment) % alignment;
+    return Write(kZeros, padding);
+  }
+
+  bool Flush() {
+    bool ok = WriteAll(buffer_.data(), buffer_.size());
+    buffer_.clear();
+    return ok;
+  }
+
+ private:
+  static constexpr size_t kBufferSize = 1 << 20;
+
+  bool WriteAll(const char* data, size_t size) {
+    while (size > 0) {
+      ssize_t written = write(fd_, data, size);
+      if (written < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return false;
+      }
+      data += written;
+      size -= written;
+    }
+    return true;
+  }
+
+  int fd_;
+  uint64_t offset_ = 0;
+  std::vector<char> buffer_;
+};
+
+// Writes the frames of one block in the kRaw encoding and fills in the
+// payload and frame fields of |footer|.
+bool WriteRawBlock(const int64_t* timestamps, const int64_t* rates,
+                   size_t count, FileWriter* writer, BlockFooter* footer) {
+  footer->encoding = history::BlockEncoding::kRaw;
+  footer->payload_offset = writer->offset();
+  for (size_t frame = 0; frame < footer->frame_count; frame++) {
+    size_t start = frame * history::kFrameTicks;
+    size_t frame_count = std::min(history::kFrameTicks, count - start);
+    footer->frame_offset[frame] =
+        static_cast<uint32_t>(writer->offset() - footer->payload_offset);
+    if (!writer->Write(timestamps + start, frame_count * sizeof(int64_t)) ||
+        !writer->Write(rates + start, frame_count * sizeof(int64_t))) {
+      return false;
+    }
+  }
+  footer->payload_size = writer->offset() - footer->payload_offset;
+  return true;
+}
+
+// Appends the low |width| bits of each of |values| to |words|, least
+// significant bit first, followed by the zero word decoders may read.
+void PackBits(const uint64_t* values, size_t count, int width,
+              std::vector<uint64_t>* words) {
+  size_t start = words->size();
+  words->resize(start + history::PackedWords(count, width) + 1, 0);
+  uint64_t* out = words->data() + start;
+  for (size_t i = 0; i < count && width > 0; i++) {
+    size_t bit = i * width;
+    out[bit / 64] |= values[i] << (bit % 64);
+    if (bit % 64 + width > 64) {
+      out[bit / 64 + 1] |= values[i] >> (64 - bit % 64);
+    }
+  }
+}
+
+int BitWidth(uint64_t value) {
+  return value == 0 ? 0 : 64 - __builtin_clzll(value);
+}
+
+uint64_t Zigzag(uint64_t value) {
+  return value << 1 ^ (0 - (value >> 63));
+}
+
+// Appends one frame in the kDeltaPacked encoding to |words|.
+void PackFrame(const int64_t* timestamps, const int64_t* rates, size_t count,
+               std::vector<uint64_t>* words) {
+  history::PackedFrameHeader header = {};
+  header.first_timestamp = timestamps[0];
+  header.first_rate = rates[0];
+
+  // Differences wrap, and decoding wraps the same way, so any input
+  // round-trips exactly.
+  uint64_t timestamp_values[history::kFrameTicks];
+  uint64_t rate_values[history::kFrameTicks];
+  uint64_t previous_delta = 0;
+  uint64_t timestamp_bits = 0;
+  int64_t rate_exponent = 12;
+  for (size_t i = 1; i < count; i++) {
+    uint64_t delta = static_cast<uint64_t>(timestamps[i]) -
+                     static_cast<uint64_t>(timestamps[i - 1]);
+    if (i == 1) {
+      header.first_delta = static_cast<int64_t>(delta);
+    } else {
+      timestamp_values[i - 2] = Zigzag(delta - previous_delta);
+      timestamp_bits |= timestamp_values[i - 2];
+    }
+    previous_delta = delta;
+    rate_values[i - 1] =
+        static_cast<uint64_t>(rates[i]) - static_cast<uint64_t>(rates[i - 1]);
+    while (rate_exponent > 0 &&
+           static_cast<int64_t>(rate_values[i - 1]) %
+                   static_cast<int64_t>(Pow10(rate_exponent)) !=
+               0) {
+      rate_exponent--;
+    }
+  }
+  uint64_t rate_bits = 0;
+  for (size_t i = 1; i < count; i++) {
+    rate_values[i - 1] = Zigzag(static_cast<uint64_t>(
+        static_cast<int64_t>(rate_values[i - 1]) /
+        static_cast<int64_t>(Pow10(rate_exponent))));
+    rate_bits |= rate_values[i - 1];
+  }
+  header.timestamp_width = static_cast<uint8_t>(BitWidth(timestamp_bits));
+  header.rate_width = static_cast<uint8_t>(BitWidth(rate_bits));
+  header.rate_exponent = static_cast<uint8_t>(rate_exponent);
+
+  size_t start = words->size();
+  words->resize(start + sizeof(header) / sizeof(uint64_t));
+  memcpy(words->data() + start, &header, sizeof(header));
+  // The zero word after the timestamps is dropped again: the rate section
+  // that follows serves the same purpose.
+  PackBits(timestamp_values, count < 2 ? 0 : count - 2, header.timestamp_width,
+           words);
+  words->pop_back();
+  PackBits(rate_values, count - 1, header.rate_width, words);
+}
+
+// Writes the frames of one block in the kDeltaPacked encoding and fills in
+// the payload and frame fields of |footer|.
+bool WritePackedBlock(const int64_t* timestamps, const int64_t* rates,
+                      size_t count, FileWriter* writer, BlockFooter* footer) {
+  footer->encoding = history::BlockEncoding::kDeltaPacked;
+  footer->payload_offset = writer->offset();
+  std::vector<uint64_t> words;
+  for (size_t frame = 0; frame < footer->frame_count; frame++) {
+    size_t start = frame * history::kFrameTicks;
+    footer->frame_offset[frame] =
+        static_cast<uint32_t>(words.size() * sizeof(uint64_t));
+    PackFrame(timestamps + start, rates + start,
+              std::min(history::kFrameTicks, count - start), &words);
+  }
+  footer->payload_size = words.size() * sizeof(uint64_t);
+  return writer->Write(words.data(), footer->payload_size);
+}
+
+// Stores |sorted| in Eytzinger (BFS) order in |keys|[1..n], recording the
+// sorted position of every key in |ranks|. Returns the next position of
+// |sorted| to place.
+size_t BuildEytzinger(const std::vector<int64_t>& sorted, size_t next,
+                      size_t k, int64_t* keys, uint32_t* ranks) {
+  if (k <= sorted.size()) {
+    next = BuildEytzinger(sorted, next, 2 * k, keys, ranks);
+    keys[k] = sorted[next];
+    ranks[k] = static_cast<uint32_t>(next);
+    next = BuildEytzinger(sorted, next + 1, 2 * k + 1, keys, ranks);
+  }
+  return next;
+}
+
+bool WriteFile(const TickColumns& ticks, history::BlockEncoding encoding,
+               FileWriter* writer) {
+  FileHeader header = {};
+  header.magic = history::kFileMagic;
+  header.version = history::kFormatVersion;
+  if (!writer->Write(&header, sizeof(header))) {
+    return false;
+  }
+
+  std::vector<uint32_t> order(ticks.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    if (ticks.pairs[a] != ticks.pairs[b]) {
+      return ticks.pairs[a] < ticks.pairs[b];
+    }
+    return ticks.timestamps[a] < ticks.timestamps[b];
+  });
+
+  std::vector<PairEntry> pairs;
+  std::vector<uint64_t> block_footers;
+  std::vector<int64_t> index_keys;
+  std::vector<uint32_t> index_blocks;
+  std::vector<int64_t> timestamps(history::kBlockTicks);
+  std::vector<int64_t> rates(history::kBlockTicks);
+  size_t start = 0;
+  while (start < order.size()) {
+    uint32_t pair = ticks.pairs[order[start]];
+    size_t end = start;
+    while (end < order.size() && ticks.pairs[order[end]] == pair) {
+      end++;
+    }
+
+    PairEntry entry = {};
+    entry.pair = pair;
+    entry.first_block = block_footers.size();
+    entry.first_index = index_keys.size();
+    entry.tick_count = end - start;
+    entry.first_timestamp = ticks.timestamps[order[start]];
+    entry.last_timestamp = ticks.timestamps[order[end - 1]];
+    std::vector<int64_t> block_firsts;
+    for (size_t block = start; block < end; block += history::kBlockTicks) {
+      size_t count = std::min(end - block, history::kBlockTicks);
+      BlockFooter footer = {};
+      footer.magic = history::kBlockMagic;
+      footer.pair = pair;
+      footer.count = static_cast<uint32_t>(count);
+      footer.frame_count = static_cast<uint16_t>(
+          (count + history::kFrameTicks - 1) / history::kFrameTicks);
+      std::fill(std::begin(footer.frame_first), std::end(footer.frame_first),
+                INT64_MAX);
+      for (size_t i = 0; i < count; i++) {
+        timestamps[i] = ticks.timestamps[order[block + i]];
+        rates[i] = ticks.rates[order[block + i]];
+        if (i % history::kFrameTicks == 0) {
+          footer.frame_first[i / history::kFrameTicks] = timestamps[i];
+        }
+      }
+      footer.first_timestamp = timestamps[0];
+      footer.last_timestamp = timestamps[count - 1];
+      bool (*write_block)(const int64_t*, const int64_t*, size_t, FileWriter*,
+                          BlockFooter*) =
+          encoding == history::BlockEncoding::kRaw ? WriteRawBlock
+                                                   : WritePackedBlock;
+      if (!writer->Align(history::kSectionAlignment) ||
+          !write_block(timestamps.data(), rates.data(), count, writer,
+                       &footer) ||
+          !writer->Align(alignof(BlockFooter))) {
+        return false;
+      }
+      block_footers.push_back(writer->offset());
+      block_firsts.push_back(footer.first_timestamp);
+      if (!writer->Write(&footer, sizeof(footer))) {
+        return false;
+      }
+    }
+    entry.block_count = static_cast<uint32_t>(block_firsts.size());
+    index_keys.resize(index_keys.size() + block_firsts.size() + 1, INT64_MIN);
+    index_blocks.resize(index_keys.size(), 0);
+    BuildEytzinger(block_firsts, 0, 1, &index_keys[entry.first_index],
+                   &index_blocks[entry.first_index]);
+    pairs.push_back(entry);
+    start = end;
+  }
+
+  FileTrailer trailer = {};
+  trailer.pair_count = pairs.size();
+  trailer.block_count = block_footers.size();
+  trailer.index_size = index_keys.size();
+  trailer.magic = history::kFileMagic;
+  if (!writer->Align(history::kSectionAlignment)) {
+    return false;
+  }
+  trailer.directory_offset = writer->offset();
+  if (!writer->Write(pairs.data(), pairs.size() * sizeof(PairEntry)) ||
+      !writer->Align(history::kSectionAlignment)) {
+    return false;
+  }
+  trailer.block_footers_offset = writer->offset();
+  if (!writer->Write(block_footers.data(),
+                     block_footers.size() * sizeof(uint64_t)) ||
+      !writer->Align(history::kSectionAlignment)) {
+    return false;
+  }
+  trailer.index_keys_offset = writer->offset();
+  if (!writer->Write(index_keys.data(), index_keys.size() * sizeof(int64_t)) ||
+      !writer->Align(history::kSectionAlignment)) {
+    return false;
+  }
+  trailer.index_blocks_offset = writer->offset();
+  return writer->Write(index_blocks.data(),
+                       index_blocks.size() * sizeof(uint32_t)) &&
+         writer->Align(history::kSectionAlignment) &&
+         writer->Write(&trailer, sizeof(trailer)) && writer->Flush();
+}
+
+}  // namespace
+
+bool WriteHistoryFile(const TickColumns& ticks, const char* path,
+                      history::BlockEncoding encoding) {
+  std::string temp_path = std::string(path) + ".tmp";
+  int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                0644);
+  if (fd < 0) {
+    return false;
+  }
+  FileWriter writer(fd);
+  bool ok = WriteFile(ticks, encoding, &writer) && fsync(fd) == 0;
+  int saved_errno = errno;
+  if (close(fd) != 0 && ok) {
+    saved_errno = errno;
+    ok = false;
+  }
+  if (ok && rename(temp_path.c_str(), path) != 0) {
+    saved_errno = errno;
+    ok = false;
+  }
+  if (!ok) {
+    unlink(temp_path.c_str());
+    errno = saved_errno;
+  }
+  return ok;
+}
+
+}  // namespace converter
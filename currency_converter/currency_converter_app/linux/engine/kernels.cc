@@ -0,0 +1,185 @@
+#include "kernels.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <utility>
+
+#include "decimal.h"
+
+namespace converter {
+
+namespace internal {
+
+// std::nearbyint honours the default round-to-nearest-even mode.
+void ConvertDoubleScalar(const double* amounts, size_t count,
+                         double minor_rate, double minor_scale, double* out) {
+  for (size_t i = 0; i < count; i++) {
+    out[i] = std::nearbyint(amounts[i] * minor_rate) / minor_scale;
+  }
+}
+
+namespace {
+
+// One instantiation per divisor, so the loop divides by a constant. The
+// amounts count minor units of one currency, and cross_rate / 10^Digits is
+// the minor units of the other per one of them. Both fit in int64, so their
+// product needs no overflow check; only the rounded result does.
+template <int Digits>
+bool ConvertFixedScaled(const int64_t* amounts, size_t count,
+                        int64_t cross_rate, int64_t* out) {
+  const auto factor = Decimal<Digits, int64_t>::FromRaw(cross_rate);
+  for (size_t i = 0; i < count; i++) {
+    Decimal<0> result;
+    if (!Decimal<0>::FromRaw(amounts[i]).Multiply(factor, &result)) {
+      return false;
+    }
+    out[i] = result.raw();
+  }
+  return true;
+}
+
+using ConvertFixedFn = bool (*)(const int64_t* amounts, size_t count,
+                                int64_t cross_rate, int64_t* out);
+
+template <size_t... Digits>
+constexpr std::array<ConvertFixedFn, sizeof...(Digits)> MakeConvertFixedTable(
+    std::index_sequence<Digits...>) {
+  return {ConvertFixedScaled<static_cast<int>(Digits)>...};
+}
+
+constexpr std::array<ConvertFixedFn, kMaxDivisorDigits + 1>
+    kConvertFixedByDigits = MakeConvertFixedTable(
+        std::make_index_sequence<kMaxDivisorDigits + 1>());
+
+}  // namespace
+
+bool ConvertFixedScalar(const int64_t* amounts, size_t count,
+                        int64_t cross_rate, int divisor_digits, int64_t* out) {
+  return kConvertFixedByDigits[divisor_digits](amounts, count, cross_rate,
+                                               out);
+}
+
+void UnpackZigzagRange(const uint64_t* packed, int width, size_t begin,
+                       size_t end, int64_t* out) {
+  if (width == 0) {
+    std::fill(out + begin, out + end, 0);
+    return;
+  }
+  uint64_t mask = width == 64 ? ~uint64_t{0} : (uint64_t{1} << width) - 1;
+  for (size_t i = begin; i < end; i++) {
+    size_t bit = i * width;
+    unsigned __int128 window =
+        packed[bit / 64] |
+        static_cast<unsigned __int128>(packed[bit / 64 + 1]) << 64;
+    uint64_t value = static_cast<uint64_t>(window >> (bit % 64)) & mask;
+    out[i] = static_cast<int64_t>((value >> 1) ^ (0 - (value & 1)));
+  }
+}
+
+void UnpackZigzagScalar(const uint64_t* packed, int width, size_t count,
+                        int64_t* out) {
+  UnpackZigzagRange(packed, width, 0, count, out);
+}
+
+void UnpackDeltaRange(const uint64_t* packed, int width, size_t begin,
+                      size_t end, uint64_t sum, int64_t first, int64_t scale,
+                      int64_t* out) {
+  uint64_t mask = width == 64 ? ~uint64_t{0} : (uint64_t{1} << width) - 1;
+  for (size_t i = begin; i < end; i++) {
+    if (width != 0) {
+      size_t bit = i * width;
+      unsigned __int128 window =
+          packed[bit / 64] |
+          static_cast<unsigned __int128>(packed[bit / 64 + 1]) << 64;
+      uint64_t value = static_cast<uint64_t>(window >> (bit % 64)) & mask;
+      sum += (value >> 1) ^ (0 - (value & 1));
+    }
+    out[i] = static_cast<int64_t>(static_cast<uint64_t>(first) +
+                                  static_cast<uint64_t>(scale) * sum);
+  }
+}
+
+void UnpackDeltaScalar(const uint64_t* packed, int width, size_t count,
+                       int64_t first, int64_t scale, int64_t* out) {
+  UnpackDeltaRange(packed, width, 0, count, 0, first, scale, out);
+}
+
+void PrefixSumScalar(int64_t* values, size_t count, int64_t first,
+                     int64_t scale) {
+  uint64_t sum = 0;
+  for (size_t i = 0; i < count; i++) {
+    sum += static_cast<uint64_t>(values[i]);
+    values[i] = static_cast<int64_t>(static_cast<uint64_t>(first) +
+                                     static_cast<uint64_t>(scale) * sum);
+  }
+}
+
+}  // namespace internal
+
+namespace {
+
+constexpr ConversionKernels kScalarKernels = {
+    KernelLevel::kScalar,
+    "scalar",
+    internal::ConvertDoubleScalar,
+    internal::ConvertFixedScalar,
+    internal::UnpackZigzagScalar,
+    internal::PrefixSumScalar,
+    internal::UnpackDeltaScalar,
+};
+
+bool Supported(KernelLevel level) {
+  switch (level) {
+    case KernelLevel::kScalar:
+      return true;
+#if defined(CONVERTER_HAVE_X86_KERNELS)
+    case KernelLevel::kSse42:
+      return __builtin_cpu_supports("sse4.2");
+    case KernelLevel::kAvx2:
+      return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+    default:
+      return false;
+#endif
+  }
+  return false;
+}
+
+const ConversionKernels* DetectKernels() {
+  for (KernelLevel level : {KernelLevel::kAvx2, KernelLevel::kSse42}) {
+    if (const ConversionKernels* kernels = GetKernels(level)) {
+      return kernels;
+    }
+  }
+  return &kScalarKernels;
+}
+
+}  // namespace
+
+const ConversionKernels& GetKernels() {
+  static const ConversionKernels* kernels = DetectKernels();
+  return *kernels;
+}
+
+const ConversionKernels* GetKernels(KernelLevel level) {
+  if (!Supported(level)) {
+    return nullptr;
+  }
+  switch (level) {
+    case KernelLevel::kScalar:
+      return &kScalarKernels;
+#if defined(CONVERTER_HAVE_X86_KERNELS)
+    case KernelLevel::kSse42:
+      return &internal::kSse42Kernels;
+    case KernelLevel::kAvx2:
+      return &internal::kAvx2Kernels;
+#else
+    default:
+      return nullptr;
+#endif
+  }
+  return nullptr;
+}
+
+}  // namespace converter
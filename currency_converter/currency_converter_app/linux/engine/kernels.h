@@ -0,0 +1,98 @@
+#ifndef CONVERTER_ENGINE_KERNELS_H_
+#define CONVERTER_ENGINE_KERNELS_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace converter {
+
+// Instruction set a kernel table was compiled for, in increasing order of
+// preference.
+enum class KernelLevel {
+  kScalar,
+  kSse42,
+  kAvx2,
+};
+
+// Largest power of ten the fixed-point kernels divide by.
+constexpr int kMaxDivisorDigits = 18;
+
+// Inner loops of batch conversion and of history decoding. Every
+// implementation produces bit-for-bit identical results to the scalar one.
+struct ConversionKernels {
+  KernelLevel level;
+  const char* name;
+
+  // out[i] = nearbyint(amounts[i] * minor_rate) / minor_scale, i.e. a
+  // conversion in major units rounded half to even to the target's minor
+  // units.
+  void (*convert_double)(const double* amounts, size_t count, double minor_rate,
+                         double minor_scale, double* out);
+
+  // out[i] = amounts[i] * cross_rate / 10^divisor_digits, rounded half to
+  // even, with all arithmetic exact. |divisor_digits| is at most
+  // kMaxDivisorDigits. Returns false if any result overflows int64.
+  bool (*convert_fixed)(const int64_t* amounts, size_t count,
+                        int64_t cross_rate, int divisor_digits, int64_t* out);
+
+  // Unpacks |count| zigzag-encoded integers of |width| bits (0 to 64),
+  // stored back to back from the least significant bit of |packed|. One
+  // word past the last value must be readable.
+  void (*unpack_zigzag)(const uint64_t* packed, int width, size_t count,
+                        int64_t* out);
+
+  // Replaces values[i] by first + scale * (values[0] + ... + values[i]),
+  // with wrapping arithmetic.
+  void (*prefix_sum)(int64_t* values, size_t count, int64_t first,
+                     int64_t scale);
+
+  // unpack_zigzag followed by prefix_sum, in one pass: out[i] = first +
+  // scale * (v[0] + ... + v[i]), where v are the unpacked values.
+  void (*unpack_delta)(const uint64_t* packed, int width, size_t count,
+                       int64_t first, int64_t scale, int64_t* out);
+};
+
+// Returns the fastest kernels supported by the running CPU. Detection runs
+// once, on first use.
+const ConversionKernels& GetKernels();
+
+// Returns the kernels for |level|, or nullptr if they were not compiled in or
+// the running CPU does not support them. Used by benchmarks.
+const ConversionKernels* GetKernels(KernelLevel level);
+
+namespace internal {
+
+// Portable implementations, also used by the vector kernels for tails and
+// for elements outside their exact range.
+void ConvertDoubleScalar(const double* amounts, size_t count,
+                         double minor_rate, double minor_scale, double* out);
+bool ConvertFixedScalar(const int64_t* amounts, size_t count,
+                        int64_t cross_rate, int divisor_digits, int64_t* out);
+void UnpackZigzagScalar(const uint64_t* packed, int width, size_t count,
+                        int64_t* out);
+void PrefixSumScalar(int64_t* values, size_t count, int64_t first,
+                     int64_t scale);
+void UnpackDeltaScalar(const uint64_t* packed, int width, size_t count,
+                       int64_t first, int64_t scale, int64_t* out);
+
+// Unpacks values [begin, end) of a stream as UnpackZigzagScalar does, into
+// out[begin, end).
+void UnpackZigzagRange(const uint64_t* packed, int width, size_t begin,
+                       size_t end, int64_t* out);
+
+// Unpacks and sums values [begin, end) of a stream as UnpackDeltaScalar
+// does, into out[begin, end), given |sum| of the values before |begin|.
+void UnpackDeltaRange(const uint64_t* packed, int width, size_t begin,
+                      size_t end, uint64_t sum, int64_t first, int64_t scale,
+                      int64_t* out);
+
+#if defined(CONVERTER_HAVE_X86_KERNELS)
+extern const ConversionKernels kSse42Kernels;
+extern const ConversionKernels kAvx2Kernels;
+#endif
+
+}  // namespace internal
+
+}  // namespace converter
+
+#endif  // CONVERTER_ENGINE_KERNELS_H_
@@ -0,0 +1,281 @@
+// Built with -mavx2 -mfma; only called after runtime detection.
+
+#include <immintrin.h>
+
+#include <cstring>
+#include <numeric>
+
+#include "fixed_point.h"
+#include "kernels.h"
+
+namespace converter {
+namespace internal {
+
+namespace {
+
+// Adding 2^52 + 2^51 to a double holding an integer of magnitude below 2^51
+// leaves that integer in the low mantissa bits, which converts between int64
+// and double lanes without AVX-512.
+constexpr double kMagic = 6755399441055744.0;
+constexpr int64_t kMagicBits = 0x4338000000000000;
+constexpr int64_t kMaxExactAmount = int64_t{1} << 51;
+constexpr double kMaxExactQuotient = 562949953421312.0;  // 2^49
+
+inline __m256d Int64ToDouble(__m256i v) {
+  return _mm256_sub_pd(
+      _mm256_castsi256_pd(_mm256_add_epi64(v, _mm256_set1_epi64x(kMagicBits))),
+      _mm256_set1_pd(kMagic));
+}
+
+void ConvertDoubleAvx2(const double* amounts, size_t count, double minor_rate,
+                       double minor_scale, double* out) {
+  const __m256d rate = _mm256_set1_pd(minor_rate);
+  const __m256d scale = _mm256_set1_pd(minor_scale);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256d a = _mm256_mul_pd(_mm256_loadu_pd(amounts + i), rate);
+    __m256d b = _mm256_mul_pd(_mm256_loadu_pd(amounts + i + 4), rate);
+    a = _mm256_round_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    b = _mm256_round_pd(b, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    _mm256_storeu_pd(out + i, _mm256_div_pd(a, scale));
+    _mm256_storeu_pd(out + i + 4, _mm256_div_pd(b, scale));
+  }
+  ConvertDoubleScalar(amounts + i, count - i, minor_rate, minor_scale, out + i);
+}
+
+// Computes round_half_even(a * c / d) exactly in double lanes. The product
+// is split into a head and an exact tail with FMA, the quotient is estimated
+// by one division, and the exact remainder p - q * d (again via FMA) decides
+// the final +-1 correction and ties. This is exact as long as |a| < 2^51,
+// c < 2^53, d < 2^50 and |q| < 2^49; lanes outside that range are redone by
+// the scalar int128 code.
+bool ConvertFixedAvx2(const int64_t* amounts, size_t count, int64_t cross_rate,
+                      int divisor_digits, int64_t* out) {
+  // Cancelling common factors keeps more rates inside the 2^53 limit and
+  // does not change the rounded result.
+  int64_t rate = cross_rate;
+  int64_t divisor = static_cast<int64_t>(Pow10(divisor_digits));
+  int64_t common = std::gcd(rate, divisor);
+  if (common > 1) {
+    rate /= common;
+    divisor /= common;
+  }
+
+  size_t i = 0;
+  if (rate < (int64_t{1} << 53) && divisor < (int64_t{1} << 50)) {
+    const __m256d c = _mm256_set1_pd(static_cast<double>(rate));
+    const __m256d d = _mm256_set1_pd(static_cast<double>(divisor));
+    const __m256d neg_d = _mm256_set1_pd(-static_cast<double>(divisor));
+    const __m256d abs_mask =
+        _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffff));
+    const __m256i amount_bias = _mm256_set1_epi64x(kMaxExactAmount);
+    const __m256d max_quotient = _mm256_set1_pd(kMaxExactQuotient);
+    const __m256i one = _mm256_set1_epi64x(1);
+    const __m256i magic_bits = _mm256_set1_epi64x(kMagicBits);
+    const __m256d magic = _mm256_set1_pd(kMagic);
+
+    for (; i + 4 <= count; i += 4) {
+      __m256i ai =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(amounts + i));
+      __m256d a = Int64ToDouble(ai);
+      __m256d p_hi = _mm256_mul_pd(a, c);
+      __m256d p_lo = _mm256_fmsub_pd(a, c, p_hi);
+      __m256d q = _mm256_round_pd(_mm256_div_pd(p_hi, d),
+                                  _MM_FROUND_TO_NEAREST_INT |
+                                      _MM_FROUND_NO_EXC);
+
+      // Redo the block in int128 if any amount is outside [-2^51, 2^51),
+      // where Int64ToDouble is wrong, or any quotient is too large for the
+      // single-step correction below.
+      __m256i out_of_range =
+          _mm256_srli_epi64(_mm256_add_epi64(ai, amount_bias), 52);
+      __m256d big_quotient = _mm256_cmp_pd(_mm256_and_pd(q, abs_mask),
+                                           max_quotient, _CMP_GE_OQ);
+      if (!_mm256_testz_si256(out_of_range, out_of_range) ||
+          !_mm256_testz_pd(big_quotient, big_quotient)) {
+        if (!ConvertFixedScalar(amounts + i, 4, cross_rate, divisor_digits,
+                                out + i)) {
+          return false;
+        }
+        continue;
+      }
+
+      __m256d t_hi = _mm256_mul_pd(q, d);
+      __m256d t_lo = _mm256_fmsub_pd(q, d, t_hi);
+      __m256d r = _mm256_add_pd(_mm256_sub_pd(p_hi, t_hi),
+                                _mm256_sub_pd(p_lo, t_lo));
+      __m256d twice_r = _mm256_add_pd(r, r);
+
+      __m256i qi = _mm256_castpd_si256(_mm256_add_pd(q, magic));
+      __m256i odd = _mm256_cmpeq_epi64(_mm256_and_si256(qi, one), one);
+      __m256i up = _mm256_or_si256(
+          _mm256_castpd_si256(_mm256_cmp_pd(twice_r, d, _CMP_GT_OQ)),
+          _mm256_and_si256(
+              _mm256_castpd_si256(_mm256_cmp_pd(twice_r, d, _CMP_EQ_OQ)),
+              odd));
+      __m256i down = _mm256_or_si256(
+          _mm256_castpd_si256(_mm256_cmp_pd(twice_r, neg_d, _CMP_LT_OQ)),
+          _mm256_and_si256(
+              _mm256_castpd_si256(_mm256_cmp_pd(twice_r, neg_d, _CMP_EQ_OQ)),
+              odd));
+      // Comparison masks are -1 where true.
+      qi = _mm256_add_epi64(_mm256_sub_epi64(qi, up), down);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                          _mm256_sub_epi64(qi, magic_bits));
+    }
+  }
+  return ConvertFixedScalar(amounts + i, count - i, cross_rate,
+                            divisor_digits, out + i);
+}
+
+// Four values per step: each lane gathers the 8 bytes holding its value and
+// shifts it into place. A value of up to 57 bits always fits in 8 bytes read
+// from its first byte; wider values take the scalar path.
+void UnpackZigzagAvx2(const uint64_t* packed, int width, size_t count,
+                      int64_t* out) {
+  if (width == 0 || width > 57) {
+    UnpackZigzagScalar(packed, width, count, out);
+    return;
+  }
+  const long long* bytes = reinterpret_cast<const long long*>(packed);
+  const __m256i mask = _mm256_set1_epi64x((int64_t{1} << width) - 1);
+  const __m256i seven = _mm256_set1_epi64x(7);
+  const __m256i one = _mm256_set1_epi64x(1);
+  const __m256i step = _mm256_set1_epi64x(4 * width);
+  __m256i bits = _mm256_setr_epi64x(0, width, 2 * width, 3 * width);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m256i v = _mm256_i64gather_epi64(bytes, _mm256_srli_epi64(bits, 3), 1);
+    v = _mm256_and_si256(_mm256_srlv_epi64(v, _mm256_and_si256(bits, seven)),
+                         mask);
+    __m256i sign = _mm256_sub_epi64(_mm256_setzero_si256(),
+                                    _mm256_and_si256(v, one));
+    v = _mm256_xor_si256(_mm256_srli_epi64(v, 1), sign);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), v);
+    bits = _mm256_add_epi64(bits, step);
+  }
+  UnpackZigzagRange(packed, width, i, count, out);
+}
+
+// Inclusive scan of four lanes in two shift-and-add steps, plus the running
+// total carried in from the previous four.
+void PrefixSumAvx2(int64_t* values, size_t count, int64_t first,
+                   int64_t scale) {
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i carry = _mm256_set1_epi64x(scale == 1 ? first : 0);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<__m256i*>(values + i));
+    __m256i shifted = _mm256_blend_epi32(
+        _mm256_permute4x64_epi64(x, _MM_SHUFFLE(2, 1, 0, 0)), zero, 0x03);
+    x = _mm256_add_epi64(x, shifted);
+    shifted = _mm256_blend_epi32(
+        _mm256_permute4x64_epi64(x, _MM_SHUFFLE(1, 0, 0, 0)), zero, 0x0f);
+    x = _mm256_add_epi64(_mm256_add_epi64(x, shifted), carry);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(values + i), x);
+    carry = _mm256_permute4x64_epi64(x, _MM_SHUFFLE(3, 3, 3, 3));
+  }
+  int64_t total = _mm256_extract_epi64(carry, 0);
+  if (scale != 1) {
+    for (size_t j = 0; j < i; j++) {
+      values[j] = static_cast<int64_t>(static_cast<uint64_t>(first) +
+                                       static_cast<uint64_t>(scale) *
+                                           static_cast<uint64_t>(values[j]));
+    }
+    // The scalar tail applies |scale| to its own sums only, so fold the
+    // running total in before it.
+    if (i < count) {
+      values[i] = static_cast<int64_t>(static_cast<uint64_t>(values[i]) +
+                                       static_cast<uint64_t>(total));
+    }
+    PrefixSumScalar(values + i, count - i, first, scale);
+    return;
+  }
+  PrefixSumScalar(values + i, count - i, total, 1);
+}
+
+// Low 64 bits of a * b in each lane, from three 32-bit multiplies.
+inline __m256i MulLo64(__m256i a, __m256i b) {
+  __m256i cross = _mm256_add_epi64(
+      _mm256_mul_epu32(_mm256_srli_epi64(a, 32), b),
+      _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)));
+  return _mm256_add_epi64(_mm256_mul_epu32(a, b),
+                          _mm256_slli_epi64(cross, 32));
+}
+
+// The 8 bytes of |packed| starting at the byte holding bit |bit|.
+inline long long LoadAt(const char* packed, size_t bit) {
+  long long word;
+  memcpy(&word, packed + bit / 8, sizeof(word));
+  return word;
+}
+
+// UnpackZigzagAvx2 followed by PrefixSumAvx2, with the values kept in
+// registers in between so each is written once. The four lanes are loaded
+// with plain loads rather than a gather, which is slower for the 4 to 8
+// words one step spans.
+template <bool kScaled>
+void UnpackDeltaLoop(const uint64_t* packed, int width, size_t count,
+                     int64_t first, int64_t scale, int64_t* out) {
+  const char* bytes = reinterpret_cast<const char*>(packed);
+  const __m256i mask = _mm256_set1_epi64x((int64_t{1} << width) - 1);
+  const __m256i seven = _mm256_set1_epi64x(7);
+  const __m256i one = _mm256_set1_epi64x(1);
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i step = _mm256_set1_epi64x(4 * width);
+  const __m256i base = _mm256_set1_epi64x(first);
+  const __m256i multiplier = _mm256_set1_epi64x(scale);
+  __m256i bits = _mm256_setr_epi64x(0, width, 2 * width, 3 * width);
+  __m256i sum = zero;
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    size_t bit = i * width;
+    __m256i v = _mm256_setr_epi64x(
+        LoadAt(bytes, bit), LoadAt(bytes, bit + width),
+        LoadAt(bytes, bit + 2 * width), LoadAt(bytes, bit + 3 * width));
+    v = _mm256_and_si256(_mm256_srlv_epi64(v, _mm256_and_si256(bits, seven)),
+                         mask);
+    __m256i sign = _mm256_sub_epi64(zero, _mm256_and_si256(v, one));
+    v = _mm256_xor_si256(_mm256_srli_epi64(v, 1), sign);
+    __m256i shifted = _mm256_blend_epi32(
+        _mm256_permute4x64_epi64(v, _MM_SHUFFLE(2, 1, 0, 0)), zero, 0x03);
+    v = _mm256_add_epi64(v, shifted);
+    shifted = _mm256_blend_epi32(
+        _mm256_permute4x64_epi64(v, _MM_SHUFFLE(1, 0, 0, 0)), zero, 0x0f);
+    sum = _mm256_add_epi64(_mm256_add_epi64(v, shifted), sum);
+    __m256i scaled = kScaled ? MulLo64(sum, multiplier) : sum;
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                        _mm256_add_epi64(scaled, base));
+    sum = _mm256_permute4x64_epi64(sum, _MM_SHUFFLE(3, 3, 3, 3));
+    bits = _mm256_add_epi64(bits, step);
+  }
+  UnpackDeltaRange(packed, width, i, count,
+                   static_cast<uint64_t>(_mm256_extract_epi64(sum, 0)), first,
+                   scale, out);
+}
+
+void UnpackDeltaAvx2(const uint64_t* packed, int width, size_t count,
+                     int64_t first, int64_t scale, int64_t* out) {
+  if (width == 0 || width > 57) {
+    UnpackDeltaScalar(packed, width, count, first, scale, out);
+  } else if (scale == 1) {
+    UnpackDeltaLoop<false>(packed, width, count, first, scale, out);
+  } else {
+    UnpackDeltaLoop<true>(packed, width, count, first, scale, out);
+  }
+}
+
+}  // namespace
+
+const ConversionKernels kAvx2Kernels = {
+    KernelLevel::kAvx2,
+    "avx2",
+    ConvertDoubleAvx2,
+    ConvertFixedAvx2,
+    UnpackZigzagAvx2,
+    PrefixSumAvx2,
+    UnpackDeltaAvx2,
+};
+
+}  // namespace internal
+}  // namespace converter
@@ -0,0 +1,44 @@
+// Built with -msse4.2; only called after runtime detection.
+
+#include <smmintrin.h>
+
+#include "kernels.h"
+
+namespace converter {
+namespace internal {
+
+namespace {
+
+void ConvertDoubleSse42(const double* amounts, size_t count, double minor_rate,
+                        double minor_scale, double* out) {
+  const __m128d rate = _mm_set1_pd(minor_rate);
+  const __m128d scale = _mm_set1_pd(minor_scale);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128d a = _mm_mul_pd(_mm_loadu_pd(amounts + i), rate);
+    __m128d b = _mm_mul_pd(_mm_loadu_pd(amounts + i + 2), rate);
+    a = _mm_round_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    b = _mm_round_pd(b, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    _mm_storeu_pd(out + i, _mm_div_pd(a, scale));
+    _mm_storeu_pd(out + i + 2, _mm_div_pd(b, scale));
+  }
+  ConvertDoubleScalar(amounts + i, count - i, minor_rate, minor_scale, out + i);
+}
+
+}  // namespace
+
+// Exact fixed-point conversion needs fused multiply-add to split products,
+// which SSE4.2-only CPUs lack, so that path stays scalar here. So does
+// history decoding, which relies on gathers and per-lane shifts.
+const ConversionKernels kSse42Kernels = {
+    KernelLevel::kSse42,
+    "sse4.2",
+    ConvertDoubleSse42,
+    ConvertFixedScalar,
+    UnpackZigzagScalar,
+    PrefixSumScalar,
+    UnpackDeltaScalar,
+};
+
+}  // namespace internal
+}  // namespace converter
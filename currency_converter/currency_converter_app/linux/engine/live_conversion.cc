@@ -0,0 +1,56 @@
+#include "live_conversion.h"
+
+#include <algorithm>
+
+namespace converter {
+
+bool LiveConversions::Update(LiveRequest request) {
+  bool was_empty = pending_.empty();
+  auto it = std::lower_bound(pending_.begin(), pending_.end(), request.field,
+                             [](const LiveRequest& pending, uint32_t field) {
+                               return pending.field < field;
+                             });
+  if (it != pending_.end() && it->field == request.field) {
+    // A reply to an older request that arrives late is of no use, so an
+    // out-of-order request never replaces a newer one.
+    if (request.sequence >= it->sequence) {
+      *it = std::move(request);
+    }
+    coalesced_++;
+  } else {
+    pending_.insert(it, std::move(request));
+  }
+  return was_empty;
+}
+
+void LiveConversions::Flush(std::vector<LiveResult>* out) {
+  for (const LiveRequest& request : pending_) {
+    LiveResult result = {request.field, request.sequence, Status::kOk, 0, 0,
+                         std::string()};
+    if (request.from >= CurrencyCount() || request.to >= CurrencyCount()) {
+      result.status = Status::kUnknownCurrency;
+    } else {
+      const NumberFormat& format = request.format != nullptr
+                                       ? *request.format
+                                       : NumberFormatForLocale("");
+      int64_t amount;
+      if (!ParseAmount(request.amount, GetCurrency(request.from).minor_units,
+                       format, &amount)) {
+        result.status = Status::kInvalidAmount;
+      } else {
+        result.status =
+            engine_->Convert(amount, request.from, request.to, &result.minor);
+      }
+      if (result.status == Status::kOk) {
+        result.minor_units = GetCurrency(request.to).minor_units;
+        char text[kMaxAmountTextSize];
+        result.text.assign(
+            text, FormatAmount(result.minor, result.minor_units, format, text));
+      }
+    }
+    out->push_back(std::move(result));
+  }
+  pending_.clear();
+}
+
+}  // namespace converter
@@ -0,0 +1,72 @@
+#ifndef CONVERTER_ENGINE_LIVE_CONVERSION_H_
+#define CONVERTER_ENGINE_LIVE_CONVERSION_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "amount_format.h"
+#include "conversion_engine.h"
+
+namespace converter {
+
+// One keystroke's worth of input for a live-converted field.
+struct LiveRequest {
+  // Identifies the input field; each field has at most one pending request.
+  uint32_t field = 0;
+  // Caller-assigned and increasing per field, echoed back in the result so
+  // the UI can tell which input a result belongs to.
+  int64_t sequence = 0;
+  std::string amount;
+  CurrencyId from = kInvalidCurrency;
+  CurrencyId to = kInvalidCurrency;
+  const NumberFormat* format = nullptr;
+};
+
+struct LiveResult {
+  uint32_t field;
+  int64_t sequence;
+  Status status;
+  // The converted amount in minor units of the request's "to" currency,
+  // and as display text. Only set if |status| is kOk.
+  int64_t minor;
+  int minor_units;
+  std::string text;
+};
+
+// Coalesces live-as-you-type conversion requests. Inputs arrive faster than
+// frames are drawn, so only the latest input per field is kept; the ones it
+// replaces are dropped without being computed. Flush converts what is left,
+// once per frame.
+//
+// Not thread-safe; the runner calls it from the main loop only.
+class LiveConversions {
+ public:
+  explicit LiveConversions(const ConversionEngine* engine) : engine_(engine) {}
+
+  // Makes |request| the pending input of its field, replacing any earlier
+  // one that has not been flushed yet. Returns true if nothing was pending
+  // before, i.e. the caller should schedule a flush.
+  bool Update(LiveRequest request);
+
+  bool has_pending() const { return !pending_.empty(); }
+
+  // Converts the pending input of every field, appends the results to |out|
+  // in field order, and clears the pending set.
+  void Flush(std::vector<LiveResult>* out);
+
+  // Number of requests replaced before they were computed.
+  uint64_t coalesced() const { return coalesced_; }
+
+ private:
+  const ConversionEngine* engine_;
+  // Kept sorted by field. A screen has a handful of fields, so a vector
+  // beats any map.
+  std::vector<LiveRequest> pending_;
+  uint64_t coalesced_ = 0;
+};
+
+}  // namespace converter
+
+#endif  // CONVERTER_ENGINE_LIVE_CONVERSION_H_
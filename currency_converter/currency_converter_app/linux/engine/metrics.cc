@@ -0,0 +1,299 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+
+namespace converter {
+
+// Owns the current thread's recorder and hands it back when the thread
+// exits.
+struct ThreadRecorder {
+  ~ThreadRecorder() {
+    if (recorder != nullptr) {
+      Metrics::ReleaseRecorder(recorder);
+    }
+  }
+
+  Metrics::Recorder* recorder = nullptr;
+};
+
+namespace {
+
+thread_local ThreadRecorder current_thread_recorder;
+
+constexpr double kQuantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+// Single-writer increment: only the owning thread writes, so a relaxed load
+// and store is enough and avoids a locked instruction.
+inline void Bump(std::atomic<uint64_t>* value, uint64_t amount) {
+  value->store(value->load(std::memory_order_relaxed) + amount,
+               std::memory_order_relaxed);
+}
+
+void AppendSeconds(uint64_t nanoseconds, std::string* out) {
+  char text[32];
+  snprintf(text, sizeof(text), "%.9g", static_cast<double>(nanoseconds) / 1e9);
+  out->append(text);
+}
+
+void AppendUnsigned(uint64_t value, std::string* out) {
+  char text[24];
+  snprintf(text, sizeof(text), "%" PRIu64, value);
+  out->append(text);
+}
+
+// Appends "family+suffix{labels,extra} ", leaving out empty parts.
+void AppendSample(const MetricReading& reading, const char* suffix,
+                  const char* extra, std::string* out) {
+  out->append(reading.family).append(suffix);
+  if (!reading.labels.empty() || extra[0] != '\0') {
+    out->push_back('{');
+    out->append(reading.labels);
+    if (!reading.labels.empty() && extra[0] != '\0') {
+      out->push_back(',');
+    }
+    out->append(extra);
+    out->push_back('}');
+  }
+  out->push_back(' ');
+}
+
+}  // namespace
+
+uint64_t LatencyHistogram::BucketLowest(size_t index) {
+  if (index < size_t{2} << kSubBucketBits) {
+    return index;
+  }
+  int shift = static_cast<int>(index >> kSubBucketBits) - 1;
+  uint64_t sub = index & ((size_t{1} << kSubBucketBits) - 1);
+  return ((uint64_t{1} << kSubBucketBits) + sub) << shift;
+}
+
+uint64_t LatencyHistogram::BucketHighest(size_t index) {
+  if (index == kBucketCount - 1) {
+    return UINT64_MAX;
+  }
+  return BucketLowest(index + 1) - 1;
+}
+
+void LatencyHistogram::Add(uint64_t value) {
+  buckets_[BucketIndex(value)]++;
+  count_++;
+  sum_ += value;
+  max_ = std::max(max_, value);
+}
+
+void LatencyHistogram::Merge(const std::atomic<uint64_t>* buckets,
+                             uint64_t sum, uint64_t max) {
+  // The count is taken from the buckets, so quantiles stay consistent with
+  // it even while the recording thread moves on.
+  for (size_t i = 0; i < kBucketCount; i++) {
+    uint64_t count = buckets[i].load(std::memory_order_relaxed);
+    buckets_[i] += count;
+    count_ += count;
+  }
+  sum_ += sum;
+  max_ = std::max(max_, max);
+}
+
+uint64_t LatencyHistogram::Quantile(double quantile) const {
+  if (count_ == 0) {
+    return 0;
+  }
+  uint64_t rank = static_cast<uint64_t>(
+      std::ceil(std::clamp(quantile, 0.0, 1.0) * static_cast<double>(count_)));
+  rank = std::max<uint64_t>(rank, 1);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kBucketCount; i++) {
+    seen += buckets_[i];
+    if (seen >= rank) {
+      return std::min(BucketHighest(i), max_);
+    }
+  }
+  return max_;
+}
+
+MetricId OperationMetric(std::string_view operation) {
+  std::string labels = "op=\"";
+  labels.append(operation).push_back('"');
+  return Metrics::Get().Register(MetricKind::kLatency,
+                                 "currency_converter_operation_seconds",
+                                 "Time spent in one native operation.",
+                                 labels);
+}
+
+Metrics& Metrics::Get() {
+  // Intentionally leaked so that threads exiting during static destruction
+  // can still release their recorders.
+  static Metrics* metrics = new Metrics();
+  return *metrics;
+}
+
+MetricId Metrics::Register(MetricKind kind, std::string_view family,
+                           std::string_view help, std::string_view labels) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (size_t i = 0; i < infos_.size(); i++) {
+    if (infos_[i].kind == kind && infos_[i].family == family &&
+        infos_[i].labels == labels) {
+      return static_cast<MetricId>(i);
+    }
+  }
+  if (infos_.size() >= kMaxMetrics) {
+    return kInvalidMetric;
+  }
+  infos_.push_back(
+      {kind, std::string(family), std::string(labels), std::string(help)});
+  return static_cast<MetricId>(infos_.size() - 1);
+}
+
+Metrics::Recorder* Metrics::LocalRecorder() {
+  ThreadRecorder& local = current_thread_recorder;
+  if (local.recorder == nullptr) {
+    local.recorder = Get().ClaimRecorder();
+  }
+  return local.recorder;
+}
+
+Metrics::Recorder* Metrics::ClaimRecorder() {
+  for (Recorder* recorder = recorders_.load(); recorder != nullptr;
+       recorder = recorder->next) {
+    bool expected = false;
+    if (!recorder->claimed.load(std::memory_order_relaxed) &&
+        recorder->claimed.compare_exchange_strong(expected, true)) {
+      return recorder;
+    }
+  }
+  Recorder* recorder = new Recorder();
+  recorder->next = recorders_.load();
+  while (!recorders_.compare_exchange_weak(recorder->next, recorder)) {
+  }
+  return recorder;
+}
+
+void Metrics::ReleaseRecorder(Recorder* recorder) {
+  // Releasing hands the counts over to the next thread that claims it.
+  recorder->claimed.store(false, std::memory_order_release);
+}
+
+Metrics::Histogram* Metrics::AllocateHistogram(Recorder* recorder,
+                                               MetricId id) {
+  Histogram* histogram = new Histogram();
+  recorder->histograms[id].store(histogram, std::memory_order_release);
+  return histogram;
+}
+
+void Metrics::Record(MetricId id, uint64_t nanoseconds) {
+  if (id >= kMaxMetrics) {
+    return;
+  }
+  Recorder* recorder = LocalRecorder();
+  Histogram* histogram =
+      recorder->histograms[id].load(std::memory_order_relaxed);
+  if (histogram == nullptr) {
+    histogram = AllocateHistogram(recorder, id);
+  }
+  Bump(&histogram->buckets[LatencyHistogram::BucketIndex(nanoseconds)], 1);
+  Bump(&histogram->sum, nanoseconds);
+  if (nanoseconds > histogram->max.load(std::memory_order_relaxed)) {
+    histogram->max.store(nanoseconds, std::memory_order_relaxed);
+  }
+}
+
+void Metrics::Add(MetricId id, uint64_t amount) {
+  if (id >= kMaxMetrics) {
+    return;
+  }
+  Bump(&LocalRecorder()->counters[id], amount);
+}
+
+void Metrics::Read(std::vector<MetricReading>* out) const {
+  out->clear();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    out->resize(infos_.size());
+    for (size_t i = 0; i < infos_.size(); i++) {
+      (*out)[i].kind = infos_[i].kind;
+      (*out)[i].family = infos_[i].family;
+      (*out)[i].labels = infos_[i].labels;
+      (*out)[i].help = infos_[i].help;
+    }
+  }
+  for (const Recorder* recorder = recorders_.load(); recorder != nullptr;
+       recorder = recorder->next) {
+    for (size_t i = 0; i < out->size(); i++) {
+      MetricReading& reading = (*out)[i];
+      if (reading.kind == MetricKind::kCounter) {
+        reading.total += recorder->counters[i].load(std::memory_order_relaxed);
+        continue;
+      }
+      const Histogram* histogram =
+          recorder->histograms[i].load(std::memory_order_acquire);
+      if (histogram == nullptr) {
+        continue;
+      }
+      reading.histogram.Merge(histogram->buckets,
+                              histogram->sum.load(std::memory_order_relaxed),
+                              histogram->max.load(std::memory_order_relaxed));
+    }
+  }
+}
+
+void Metrics::WritePrometheus(std::string* out) const {
+  std::vector<MetricReading> readings;
+  Read(&readings);
+  // Samples of a family must be consecutive, so group them by the order in
+  // which each family was first registered.
+  std::vector<const std::string*> families;
+  for (const MetricReading& reading : readings) {
+    if (std::none_of(families.begin(), families.end(),
+                     [&](const std::string* family) {
+                       return *family == reading.family;
+                     })) {
+      families.push_back(&reading.family);
+    }
+  }
+  for (const std::string* family : families) {
+    bool header = false;
+    for (const MetricReading& reading : readings) {
+      if (reading.family != *family) {
+        continue;
+      }
+      bool latency = reading.kind == MetricKind::kLatency;
+      if (!header) {
+        out->append("# HELP ").append(*family).push_back(' ');
+        out->append(reading.help).push_back('\n');
+        out->append("# TYPE ").append(*family);
+        out->append(latency ? " summary\n" : " counter\n");
+        header = true;
+      }
+      const LatencyHistogram& histogram = reading.histogram;
+      if (!latency) {
+        AppendSample(reading, "", "", out);
+        AppendUnsigned(reading.total, out);
+        out->push_back('\n');
+        continue;
+      }
+      for (double quantile : kQuantiles) {
+        char label[32];
+        snprintf(label, sizeof(label), "quantile=\"%g\"", quantile);
+        AppendSample(reading, "", label, out);
+        if (histogram.count() == 0) {
+          out->append("NaN");
+        } else {
+          AppendSeconds(histogram.Quantile(quantile), out);
+        }
+        out->push_back('\n');
+      }
+      AppendSample(reading, "_sum", "", out);
+      AppendSeconds(histogram.sum(), out);
+      out->push_back('\n');
+      AppendSample(reading, "_count", "", out);
+      AppendUnsigned(histogram.count(), out);
+      out->push_back('\n');
+    }
+  }
+}
+
+}  // namespace converter
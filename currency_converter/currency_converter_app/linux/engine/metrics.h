@@ -0,0 +1,195 @@
+#ifndef CONVERTER_ENGINE_METRICS_H_
+#define CONVERTER_ENGINE_METRICS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace converter {
+
+// Latencies in nanoseconds, counted in log-linear buckets as an HDR
+// histogram does: values below 32 exactly, larger ones in 16 buckets per
+// power of two, so every bucket is within 1/16 of the values it holds.
+// Values of 2^40 ns (some 18 minutes) and above share the last bucket.
+class LatencyHistogram {
+ public:
+  static constexpr int kSubBucketBits = 4;
+  static constexpr int kMaxValueBits = 40;
+  static constexpr size_t kBucketCount =
+      static_cast<size_t>(kMaxValueBits - kSubBucketBits + 1)
+      << kSubBucketBits;
+
+  static size_t BucketIndex(uint64_t value) {
+    if (value >= uint64_t{1} << kMaxValueBits) {
+      return kBucketCount - 1;
+    }
+    if (value < uint64_t{2} << kSubBucketBits) {
+      return static_cast<size_t>(value);
+    }
+    int exponent = 63 - __builtin_clzll(value);
+    int shift = exponent - kSubBucketBits;
+    return (static_cast<size_t>(shift + 1) << kSubBucketBits) +
+           static_cast<size_t>((value >> shift) &
+                               ((uint64_t{1} << kSubBucketBits) - 1));
+  }
+  // Smallest and largest value counted in bucket |index|.
+  static uint64_t BucketLowest(size_t index);
+  static uint64_t BucketHighest(size_t index);
+
+  LatencyHistogram() : buckets_(kBucketCount, 0) {}
+
+  void Add(uint64_t value);
+  // Adds the values counted in |buckets|, an array of kBucketCount
+  // entries, which sum to |sum| and are at most |max|.
+  void Merge(const std::atomic<uint64_t>* buckets, uint64_t sum,
+             uint64_t max);
+
+  uint64_t count() const { return count_; }
+  uint64_t sum() const { return sum_; }
+  uint64_t max() const { return max_; }
+  const std::vector<uint64_t>& buckets() const { return buckets_; }
+
+  // Value at or below which a fraction |quantile| of the values lie, as the
+  // largest value of its bucket but at most max(). 0 if empty.
+  uint64_t Quantile(double quantile) const;
+
+ private:
+  std::vector<uint64_t> buckets_;
+  uint64_t count_ = 0;
+  uint64_t sum_ = 0;
+  uint64_t max_ = 0;
+};
+
+enum class MetricKind : uint8_t {
+  // Latencies recorded with Metrics::Record, exported as a summary.
+  kLatency,
+  // A total increased with Metrics::Add, exported as a counter.
+  kCounter,
+};
+
+using MetricId = uint32_t;
+constexpr MetricId kInvalidMetric = 0xffffffff;
+
+struct MetricReading {
+  MetricKind kind;
+  // Prometheus metric name, and its labels as name="value" pairs separated
+  // by commas, e.g. stage="parse"; may be empty.
+  std::string family;
+  std::string labels;
+  std::string help;
+  // Merged over every thread: the total of a counter, or the latencies
+  // recorded.
+  uint64_t total = 0;
+  LatencyHistogram histogram;
+};
+
+// Process-wide latency histograms and counters for the hot paths.
+//
+// Each thread records into recorders of its own, with plain relaxed loads
+// and stores and no read-modify-write, so recording never contends with
+// other threads and costs a few nanoseconds. Histograms are allocated on a
+// thread's first record to them. Readers merge every thread's recorders;
+// a reading may miss events recorded concurrently with it, never more.
+// Recorders of exited threads are reused by new ones, so their counts are
+// kept and memory stays bounded by the number of live threads.
+class Metrics {
+ public:
+  // Upper bound on registered metrics. Registering more returns
+  // kInvalidMetric, which recording ignores.
+  static constexpr size_t kMaxMetrics = 128;
+
+  static Metrics& Get();
+
+  // Returns the id of the metric of |family| with |labels|, registering it
+  // with |help| if new. Ids stay valid for the life of the process. Takes a
+  // lock, so call sites keep the id rather than registering per event.
+  MetricId Register(MetricKind kind, std::string_view family,
+                    std::string_view help, std::string_view labels);
+
+  // Records a latency of |nanoseconds| against the kLatency metric |id|.
+  void Record(MetricId id, uint64_t nanoseconds);
+  // Adds |amount| to the kCounter metric |id|.
+  void Add(MetricId id, uint64_t amount = 1);
+
+  // Replaces |out| with every registered metric, merged over all threads,
+  // in the order they were registered.
+  void Read(std::vector<MetricReading>* out) const;
+
+  // Appends every metric to |out| in the Prometheus text exposition
+  // format. Latencies become summaries in seconds, with the 0.5, 0.9, 0.99
+  // and 0.999 quantiles.
+  void WritePrometheus(std::string* out) const;
+
+ private:
+  struct Histogram {
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> max{0};
+    std::atomic<uint64_t> buckets[LatencyHistogram::kBucketCount] = {};
+  };
+
+  // The metrics of one thread. Only the owning thread writes to it.
+  struct Recorder {
+    std::atomic<bool> claimed{true};
+    Recorder* next = nullptr;
+    std::atomic<uint64_t> counters[kMaxMetrics] = {};
+    std::atomic<Histogram*> histograms[kMaxMetrics] = {};
+  };
+
+  struct Info {
+    MetricKind kind;
+    std::string family;
+    std::string labels;
+    std::string help;
+  };
+
+  Metrics() = default;
+
+  static Recorder* LocalRecorder();
+  Recorder* ClaimRecorder();
+  static void ReleaseRecorder(Recorder* recorder);
+  static Histogram* AllocateHistogram(Recorder* recorder, MetricId id);
+
+  mutable std::mutex mutex_;
+  std::vector<Info> infos_;
+  // Every recorder ever created, newest first. Never freed.
+  std::atomic<Recorder*> recorders_{nullptr};
+
+  friend struct ThreadRecorder;
+};
+
+// Returns the id of the latency metric of the native operation
+// |operation|, such as "parse" or "feed_publish", registering it if new.
+// Operations share one family, labelled op="<operation>".
+MetricId OperationMetric(std::string_view operation);
+
+// Monotonic time in nanoseconds, for measuring latencies.
+inline uint64_t MetricsClock() {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+// Records the time from construction to destruction against a latency
+// metric.
+class ScopedLatency {
+ public:
+  explicit ScopedLatency(MetricId id) : id_(id), start_(MetricsClock()) {}
+  ~ScopedLatency() { Metrics::Get().Record(id_, MetricsClock() - start_); }
+
+  ScopedLatency(const ScopedLatency&) = delete;
+  ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+ private:
+  MetricId id_;
+  uint64_t start_;
+};
+
+}  // namespace converter
+
+#endif  // CONVERTER_ENGINE_METRICS_H_
@@ -0,0 +1,160 @@
+#include "metrics_server.h"
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "metrics.h"
+
+namespace converter {
+
+namespace {
+
+// Longest a client may take to send its request or read the response, so a
+// stuck client cannot hold up the next scrape for long.
+constexpr int kClientTimeoutMs = 1000;
+
+// Requests are not parsed beyond their first bytes; this much is read at
+// most.
+constexpr size_t kMaxRequestSize = 4096;
+
+bool WriteAll(int fd, const char* data, size_t size) {
+  while (size > 0) {
+    ssize_t written = send(fd, data, size, MSG_NOSIGNAL);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      return false;
+    }
+    data += written;
+    size -= static_cast<size_t>(written);
+  }
+  return true;
+}
+
+}  // namespace
+
+MetricsServer::~MetricsServer() {
+  Stop();
+}
+
+bool MetricsServer::Start(const std::string& path) {
+  if (thread_.joinable()) {
+    return true;
+  }
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path)) {
+    errno = ENAMETOOLONG;
+    return false;
+  }
+  memcpy(address.sun_path, path.data(), path.size());
+
+  listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (listen_fd_ < 0) {
+    return false;
+  }
+  unlink(path.c_str());
+  if (bind(listen_fd_, reinterpret_cast<const sockaddr*>(&address),
+           sizeof(address)) != 0 ||
+      listen(listen_fd_, 8) != 0) {
+    int error = errno;
+    close(listen_fd_);
+    listen_fd_ = -1;
+    errno = error;
+    return false;
+  }
+  wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (wake_fd_ < 0) {
+    int error = errno;
+    close(listen_fd_);
+    listen_fd_ = -1;
+    unlink(path.c_str());
+    errno = error;
+    return false;
+  }
+  path_ = path;
+  stopping_ = false;
+  thread_ = std::thread([this] { Run(); });
+  return true;
+}
+
+void MetricsServer::Stop() {
+  if (!thread_.joinable()) {
+    return;
+  }
+  stopping_ = true;
+  uint64_t one = 1;
+  ssize_t written = write(wake_fd_, &one, sizeof(one));
+  (void)written;
+  thread_.join();
+  close(wake_fd_);
+  wake_fd_ = -1;
+  close(listen_fd_);
+  listen_fd_ = -1;
+  unlink(path_.c_str());
+}
+
+void MetricsServer::Run() {
+  pollfd fds[2] = {{wake_fd_, POLLIN, 0}, {listen_fd_, POLLIN, 0}};
+  while (!stopping_) {
+    if (poll(fds, 2, -1) < 0 && errno != EINTR) {
+      break;
+    }
+    if (stopping_ || !(fds[1].revents & POLLIN)) {
+      continue;
+    }
+    int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) {
+      continue;
+    }
+    timeval timeout = {kClientTimeoutMs / 1000,
+                       kClientTimeoutMs % 1000 * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    Serve(fd);
+    close(fd);
+  }
+}
+
+void MetricsServer::Serve(int fd) {
+  // Read up to the end of the request headers, end of input or the timeout.
+  char request[kMaxRequestSize];
+  size_t size = 0;
+  while (size < sizeof(request)) {
+    ssize_t count = recv(fd, request + size, sizeof(request) - size, 0);
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count <= 0) {
+      break;
+    }
+    size += static_cast<size_t>(count);
+    if (size >= 4 && memcmp(request + size - 4, "\r\n\r\n", 4) == 0) {
+      break;
+    }
+  }
+
+  std::string body;
+  Metrics::Get().WritePrometheus(&body);
+  if (size < 4 || memcmp(request, "GET ", 4) != 0) {
+    WriteAll(fd, body.data(), body.size());
+    return;
+  }
+  std::string response =
+      "HTTP/1.0 200 OK\r\n"
+      "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+      "Content-Length: " +
+      std::to_string(body.size()) + "\r\n\r\n";
+  response += body;
+  WriteAll(fd, response.data(), response.size());
+}
+
+}  // namespace converter
@@ -0,0 +1,49 @@
+#ifndef CONVERTER_ENGINE_METRICS_SERVER_H_
+#define CONVERTER_ENGINE_METRICS_SERVER_H_
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+namespace converter {
+
+// Serves Metrics::Get() in the Prometheus text format on a Unix socket, on
+// a thread of its own, for a local scraper or a shell:
+//
+//   curl --unix-socket PATH http://localhost/metrics
+//   nc -U PATH < /dev/null
+//
+// A request starting with "GET " gets an HTTP/1.0 response; a client that
+// sends nothing and shuts down its side gets the bare text. Either way the
+// connection is closed after one response.
+class MetricsServer {
+ public:
+  MetricsServer() = default;
+  ~MetricsServer();
+  MetricsServer(const MetricsServer&) = delete;
+  MetricsServer& operator=(const MetricsServer&) = delete;
+
+  // Listens on |path|, replacing a socket left there by a process that
+  // exited without removing it, and starts serving. Returns false, with
+  // errno set, if the socket could not be set up.
+  bool Start(const std::string& path);
+
+  // Stops serving, joins the thread and removes the socket. Safe to call
+  // more than once.
+  void Stop();
+
+ private:
+  void Run();
+  void Serve(int fd);
+
+  std::string path_;
+  int listen_fd_ = -1;
+  // Written to wake the server thread when stopping.
+  int wake_fd_ = -1;
+  std::thread thread_;
+  std::atomic<bool> stopping_{false};
+};
+
+}  // namespace converter
+
+#endif  // CONVERTER_ENGINE_METRICS_SERVER_H_
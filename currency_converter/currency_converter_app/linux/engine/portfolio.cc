@@ -0,0 +1,211 @@
+#include "portfolio.h"
+
+#include <algorithm>
+#include <array>
+#include <utility>
+
+#include "decimal.h"
+#include "kernels.h"
+
+namespace converter {
+
+namespace {
+
+// Values |sum| minor units of one currency at |cross_rate| / 10^Digits minor
+// units of another per unit, rounded half to even as the kernels round.
+// Returns false if the product or the result overflows.
+template <int Digits>
+bool ValueSum(__int128 sum, int64_t cross_rate, int64_t* out) {
+  Decimal<0> value;
+  if (!Decimal<0, __int128>::FromRaw(sum).Multiply(
+          Decimal<Digits, int64_t>::FromRaw(cross_rate), &value)) {
+    return false;
+  }
+  *out = value.raw();
+  return true;
+}
+
+using ValueSumFn = bool (*)(__int128 sum, int64_t cross_rate, int64_t* out);
+
+template <size_t... Digits>
+constexpr std::array<ValueSumFn, sizeof...(Digits)> MakeValueSumTable(
+    std::index_sequence<Digits...>) {
+  return {ValueSum<static_cast<int>(Digits)>...};
+}
+
+constexpr std::array<ValueSumFn, kMaxDivisorDigits + 1> kValueSumByDigits =
+    MakeValueSumTable(std::make_index_sequence<kMaxDivisorDigits + 1>());
+
+}  // namespace
+
+Portfolio::Portfolio(CurrencyId reporting_currency)
+    : reporting_currency_(reporting_currency),
+      aggregates_(CurrencyCount()) {}
+
+bool Portfolio::set_reporting_currency(CurrencyId currency) {
+  if (currency >= CurrencyCount()) {
+    return false;
+  }
+  reporting_currency_ = currency;
+  // Forces every held currency to be revalued.
+  reporting_rate_ = 0;
+  return true;
+}
+
+PositionId Portfolio::Add(CurrencyId currency, int64_t amount) {
+  if (currency >= CurrencyCount()) {
+    return kInvalidPosition;
+  }
+  PositionId id;
+  if (!free_ids_.empty()) {
+    id = free_ids_.back();
+    free_ids_.pop_back();
+  } else {
+    id = static_cast<PositionId>(currencies_.size());
+    currencies_.push_back(kInvalidCurrency);
+    amounts_.push_back(0);
+  }
+  currencies_[id] = currency;
+  amounts_[id] = amount;
+  size_++;
+
+  Aggregate& aggregate = aggregates_[currency];
+  if (aggregate.positions++ == 0) {
+    held_.push_back(currency);
+  }
+  aggregate.sum += amount;
+  MarkDirty(currency);
+  return id;
+}
+
+bool Portfolio::Update(PositionId id, int64_t amount) {
+  if (id >= currencies_.size() || currencies_[id] == kInvalidCurrency) {
+    return false;
+  }
+  CurrencyId currency = currencies_[id];
+  aggregates_[currency].sum += static_cast<__int128>(amount) - amounts_[id];
+  amounts_[id] = amount;
+  MarkDirty(currency);
+  return true;
+}
+
+bool Portfolio::Remove(PositionId id) {
+  if (id >= currencies_.size() || currencies_[id] == kInvalidCurrency) {
+    return false;
+  }
+  CurrencyId currency = currencies_[id];
+  Aggregate& aggregate = aggregates_[currency];
+  aggregate.sum -= amounts_[id];
+  if (--aggregate.positions == 0) {
+    held_.erase(std::find(held_.begin(), held_.end(), currency));
+  }
+  MarkDirty(currency);
+  currencies_[id] = kInvalidCurrency;
+  amounts_[id] = 0;
+  free_ids_.push_back(id);
+  size_--;
+  return true;
+}
+
+size_t Portfolio::Refresh(const RateTable& rates) {
+  if (rates.BaseRate(reporting_currency_) != reporting_rate_) {
+    Revalue(rates);
+    return held_.size();
+  }
+  for (CurrencyId currency : held_) {
+    if (rates.BaseRate(currency) != aggregates_[currency].valued_at_rate) {
+      MarkDirty(currency);
+    }
+  }
+  return RevalueDirty(rates);
+}
+
+size_t Portfolio::ApplyTicks(const RateTable& rates, const RateTick* ticks,
+                             size_t count) {
+  if (rates.BaseRate(reporting_currency_) != reporting_rate_) {
+    Revalue(rates);
+    return held_.size();
+  }
+  for (size_t i = 0; i < count; i++) {
+    CurrencyId currency = ticks[i].currency;
+    if (currency < aggregates_.size() && aggregates_[currency].positions != 0) {
+      MarkDirty(currency);
+    }
+  }
+  return RevalueDirty(rates);
+}
+
+void Portfolio::Revalue(const RateTable& rates) {
+  reporting_rate_ = rates.BaseRate(reporting_currency_);
+  for (CurrencyId currency : dirty_) {
+    aggregates_[currency].dirty = false;
+  }
+  dirty_.clear();
+  // Currencies that lost their last position still hold a stale value.
+  for (CurrencyId currency = 0; currency < aggregates_.size(); currency++) {
+    if (aggregates_[currency].positions != 0 ||
+        aggregates_[currency].value != 0 || aggregates_[currency].overflow) {
+      Revalue(rates, currency);
+    }
+  }
+}
+
+Status Portfolio::Total(int64_t* out) const {
+  if (overflowed_ != 0 || total_ > INT64_MAX || total_ < INT64_MIN) {
+    return Status::kOverflow;
+  }
+  *out = static_cast<int64_t>(total_);
+  return Status::kOk;
+}
+
+__int128 Portfolio::Exposure(CurrencyId currency) const {
+  return currency < aggregates_.size() ? aggregates_[currency].sum : 0;
+}
+
+void Portfolio::MarkDirty(CurrencyId currency) {
+  Aggregate& aggregate = aggregates_[currency];
+  if (!aggregate.dirty) {
+    aggregate.dirty = true;
+    dirty_.push_back(currency);
+  }
+}
+
+size_t Portfolio::RevalueDirty(const RateTable& rates) {
+  size_t count = dirty_.size();
+  for (CurrencyId currency : dirty_) {
+    aggregates_[currency].dirty = false;
+    Revalue(rates, currency);
+  }
+  dirty_.clear();
+  return count;
+}
+
+void Portfolio::Revalue(const RateTable& rates, CurrencyId currency) {
+  Aggregate& aggregate = aggregates_[currency];
+  if (aggregate.overflow) {
+    overflowed_--;
+  } else {
+    total_ -= aggregate.value;
+  }
+  aggregate.value = 0;
+  aggregate.overflow = false;
+  aggregate.valued_at_rate = rates.BaseRate(currency);
+
+  bool ok = true;
+  if (aggregate.sum != 0) {
+    PairFactors factors;
+    ok = ConversionEngine::PrepareFactors(rates, currency, reporting_currency_,
+                                          &factors) == Status::kOk &&
+         kValueSumByDigits[factors.divisor_digits](
+             aggregate.sum, factors.cross_rate, &aggregate.value);
+  }
+  if (ok) {
+    total_ += aggregate.value;
+  } else {
+    aggregate.value = 0;
+    aggregate.overflow = true;
+    overflowed_++;
+  }
+}
+
+}  // namespace converter
@@ -0,0 +1,114 @@
+#ifndef CONVERTER_ENGINE_PORTFOLIO_H_
+#define CONVERTER_ENGINE_PORTFOLIO_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "conversion_engine.h"
+#include "rate_store.h"
+#include "rate_table.h"
+
+namespace converter {
+
+using PositionId = uint32_t;
+constexpr PositionId kInvalidPosition = 0xffffffff;
+
+// Positions held in many currencies, valued in one reporting currency.
+//
+// Positions are indexed by currency: each currency keeps the exact sum of
+// its positions and that sum's value in the reporting currency, and the
+// total is the sum of those values. A rate change therefore revalues one
+// currency's aggregate, not the positions in it, so the cost of a tick does
+// not depend on the number of positions. Only a change of the reporting
+// currency's own rate touches every held currency, of which there are at
+// most CurrencyCount().
+//
+// Each currency's value is computed from scratch from its exact sum, at the
+// same cross rate and rounding as ConversionEngine::Convert, so incremental
+// updates never drift from a full revaluation.
+//
+// Not thread-safe.
+class Portfolio {
+ public:
+  explicit Portfolio(CurrencyId reporting_currency = BaseCurrency());
+
+  CurrencyId reporting_currency() const { return reporting_currency_; }
+
+  // Switches the currency totals are reported in. Every held currency is
+  // revalued at the next Refresh or ApplyTicks.
+  bool set_reporting_currency(CurrencyId currency);
+
+  // Adds a position of |amount| minor units of |currency|. Returns its id,
+  // or kInvalidPosition for an unknown currency. Ids of removed positions
+  // are reused.
+  PositionId Add(CurrencyId currency, int64_t amount);
+  // Sets the amount of position |id|. Returns false if there is no such
+  // position.
+  bool Update(PositionId id, int64_t amount);
+  bool Remove(PositionId id);
+
+  // Number of positions held.
+  size_t size() const { return size_; }
+
+  // Brings the totals up to date with |rates|: revalues the currencies whose
+  // positions changed and those whose base rate differs from the one they
+  // were last valued at. Returns the number of currencies revalued.
+  size_t Refresh(const RateTable& rates);
+
+  // As Refresh, but trusts |ticks| to list every base rate that changed
+  // since the last update, so unchanged currencies are not even compared.
+  size_t ApplyTicks(const RateTable& rates, const RateTick* ticks,
+                    size_t count);
+
+  // Revalues every held currency.
+  void Revalue(const RateTable& rates);
+
+  // The value of all positions in minor units of the reporting currency,
+  // as of the last update. Returns kOverflow if it does not fit in int64,
+  // or if some currency's sum could not be converted.
+  Status Total(int64_t* out) const;
+
+  // The sum of all positions in |currency|, in its minor units.
+  __int128 Exposure(CurrencyId currency) const;
+
+ private:
+  struct Aggregate {
+    // Exact sum of the positions, in minor units of the currency.
+    __int128 sum = 0;
+    // |sum| in minor units of the reporting currency, and the base rate it
+    // was computed at.
+    int64_t value = 0;
+    int64_t valued_at_rate = 0;
+    uint32_t positions = 0;
+    bool dirty = false;
+    bool overflow = false;
+  };
+
+  void MarkDirty(CurrencyId currency);
+  // Recomputes |aggregate|'s value for |currency| at |rates| and adjusts
+  // the total by the difference.
+  void Revalue(const RateTable& rates, CurrencyId currency);
+  // Revalues the currencies in |dirty_|.
+  size_t RevalueDirty(const RateTable& rates);
+
+  CurrencyId reporting_currency_;
+  int64_t reporting_rate_ = 0;
+  std::vector<Aggregate> aggregates_;
+  std::vector<CurrencyId> dirty_;
+  // Currencies with at least one position, for full revaluation.
+  std::vector<CurrencyId> held_;
+  __int128 total_ = 0;
+  // Number of currencies whose value overflowed.
+  size_t overflowed_ = 0;
+
+  // Per position id; kInvalidCurrency marks a free id.
+  std::vector<CurrencyId> currencies_;
+  std::vector<int64_t> amounts_;
+  std::vector<PositionId> free_ids_;
+  size_t size_ = 0;
+};
+
+}  // namespace converter
+
+#endif  // CONVERTER_ENGINE_PORTFOLIO_H_
@@ -0,0 +1,573 @@
+#include "rate_feed.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+
+#include "currency.h"
+#include "metrics.h"
+#include "tick_csv.h"
+
+namespace converter {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// How long to wait before opening a source again after it failed or ended.
+constexpr int kReopenDelayMs = 1000;
+
+// Non-blocking read following the RateSource::Read contract.
+ssize_t ReadAvailable(int fd, char* buffer, size_t size) {
+  ssize_t count = read(fd, buffer, size);
+  if (count > 0) {
+    return count;
+  }
+  if (count < 0 && (errno == EAGAIN || errno == EINTR)) {
+    return 0;
+  }
+  return -1;
+}
+
+class UnixSocketSource : public RateSource {
+ public:
+  explicit UnixSocketSource(std::string path) : path_(std::move(path)) {}
+  ~UnixSocketSource() override { Close(); }
+
+  std::string name() const override { return "unix:" + path_; }
+
+  bool Open() override {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (path_.size() >= sizeof(address.sun_path)) {
+      return false;
+    }
+    memcpy(address.sun_path, path_.data(), path_.size());
+    fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) {
+      return false;
+    }
+    if (connect(fd_, reinterpret_cast<const sockaddr*>(&address),
+                sizeof(address)) != 0 ||
+        fcntl(fd_, F_SETFL, O_NONBLOCK) != 0) {
+      Close();
+      return false;
+    }
+    return true;
+  }
+
+  void Close() override {
+    if (fd_ >= 0) {
+      close(fd_);
+      fd_ = -1;
+    }
+  }
+
+  int fd() const override { return fd_; }
+
+  ssize_t Read(char* buffer, size_t size) override {
+    return ReadAvailable(fd_, buffer, size);
+  }
+
+ private:
+  std::string path_;
+  int fd_ = -1;
+};
+
+class NamedPipeSource : public RateSource {
+ public:
+  explicit NamedPipeSource(std::string path) : path_(std::move(path)) {}
+  ~NamedPipeSource() override { Close(); }
+
+  std::string name() const override { return "fifo:" + path_; }
+
+  bool Open() override {
+    if (mkfifo(path_.c_str(), 0600) != 0 && errno != EEXIST) {
+      return false;
+    }
+    fd_ = open(path_.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd_ < 0) {
+      return false;
+    }
+    // Holding a write end of our own means the pipe never reports end of
+    // file, so producers can disconnect and come back without the feed
+    // spinning on it.
+    keep_open_fd_ = open(path_.c_str(), O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    if (keep_open_fd_ < 0) {
+      Close();
+      return false;
+    }
+    return true;
+  }
+
+  void Close() override {
+    for (int* fd : {&fd_, &keep_open_fd_}) {
+      if (*fd >= 0) {
+        close(*fd);
+        *fd = -1;
+      }
+    }
+  }
+
+  int fd() const override { return fd_; }
+
+  ssize_t Read(char* buffer, size_t size) override {
+    return ReadAvailable(fd_, buffer, size);
+  }
+
+ private:
+  std::string path_;
+  int fd_ = -1;
+  int keep_open_fd_ = -1;
+};
+
+class ReplayFileSource : public RateSource {
+ public:
+  ReplayFileSource(std::string path, uint64_t ticks_per_second)
+      : path_(std::move(path)), ticks_per_second_(ticks_per_second) {}
+  ~ReplayFileSource() override { Close(); }
+
+  std::string name() const override {
+    std::string name = "replay:" + path_;
+    if (ticks_per_second_ != 0) {
+      name += "@" + std::to_string(ticks_per_second_);
+    }
+    return name;
+  }
+
+  bool Open() override {
+    fd_ = open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd_ < 0) {
+      return false;
+    }
+    start_ = Clock::now();
+    sent_ = 0;
+    buffered_.clear();
+    position_ = 0;
+    at_end_ = false;
+    return true;
+  }
+
+  void Close() override {
+    if (fd_ >= 0) {
+      close(fd_);
+      fd_ = -1;
+    }
+  }
+
+  // A regular file is always readable, so only an unpaced replay polls it.
+  int fd() const override { return ticks_per_second_ == 0 ? fd_ : -1; }
+
+  ssize_t Read(char* buffer, size_t size) override {
+    if (ticks_per_second_ == 0) {
+      return ReadAvailable(fd_, buffer, size);
+    }
+    uint64_t due = Due();
+    size_t copied = 0;
+    while (sent_ < due && copied < size) {
+      if (position_ == buffered_.size() && !Refill()) {
+        break;
+      }
+      // Copy whole lines only, up to the number now due.
+      const char* begin = buffered_.data() + position_;
+      size_t available =
+          std::min(buffered_.size() - position_, size - copied);
+      const char* p = begin;
+      const char* end = begin + available;
+      while (sent_ < due && p != end) {
+        const char* newline =
+            static_cast<const char*>(memchr(p, '\n', end - p));
+        if (newline == nullptr) {
+          if (at_end_ && end == buffered_.data() + buffered_.size()) {
+            // The file's last line has no terminator.
+            p = end;
+            sent_++;
+          }
+          break;
+        }
+        p = newline + 1;
+        sent_++;
+      }
+      if (p == begin) {
+        if (available == size - copied) {
+          if (copied != 0) {
+            break;  // No room for the next line this time.
+          }
+          // The line is longer than the caller's buffer, which drops such
+          // lines anyway; pass it on in pieces.
+          p = end;
+        } else {
+          // A partial line at the end of the buffer; read the rest of it.
+          buffered_.erase(0, position_);
+          position_ = 0;
+          if (!Refill()) {
+            break;
+          }
+          continue;
+        }
+      }
+      memcpy(buffer + copied, begin, p - begin);
+      copied += p - begin;
+      position_ += p - begin;
+    }
+    if (copied == 0 && at_end_ && position_ == buffered_.size()) {
+      return -1;
+    }
+    return static_cast<ssize_t>(copied);
+  }
+
+  int wait_ms() const override {
+    if (ticks_per_second_ == 0) {
+      return -1;
+    }
+    // Until the next line is due.
+    double due_seconds = static_cast<double>(sent_ + 1) / ticks_per_second_;
+    double elapsed =
+        std::chrono::duration<double>(Clock::now() - start_).count();
+    return std::max(0, static_cast<int>((due_seconds - elapsed) * 1000 + 1));
+  }
+
+  bool reopen() const override { return false; }
+
+ private:
+  static constexpr size_t kReadSize = 64 << 10;
+
+  // Number of lines that should have been sent by now.
+  uint64_t Due() const {
+    double elapsed =
+        std::chrono::duration<double>(Clock::now() - start_).count();
+    return static_cast<uint64_t>(elapsed * ticks_per_second_);
+  }
+
+  // Appends the next block of the file to |buffered_|. Returns false at the
+  // end of the file or on an error.
+  bool Refill() {
+    if (at_end_) {
+      return false;
+    }
+    if (position_ == buffered_.size()) {
+      buffered_.clear();
+      position_ = 0;
+    }
+    size_t old_size = buffered_.size();
+    buffered_.resize(old_size + kReadSize);
+    ssize_t count = read(fd_, &buffered_[old_size], kReadSize);
+    buffered_.resize(old_size + std::max<ssize_t>(count, 0));
+    if (count <= 0) {
+      at_end_ = true;
+      return false;
+    }
+    return true;
+  }
+
+  std::string path_;
+  uint64_t ticks_per_second_;
+  int fd_ = -1;
+  Clock::time_point start_;
+  uint64_t sent_ = 0;
+  std::string buffered_;
+  size_t position_ = 0;
+  bool at_end_ = false;
+};
+
+}  // namespace
+
+std::unique_ptr<RateSource> CreateRateSource(std::string_view spec) {
+  size_t colon = spec.find(':');
+  if (colon == std::string_view::npos || colon + 1 == spec.size()) {
+    return nullptr;
+  }
+  std::string_view kind = spec.substr(0, colon);
+  std::string_view path = spec.substr(colon + 1);
+  if (kind == "unix") {
+    return std::make_unique<UnixSocketSource>(std::string(path));
+  }
+  if (kind == "fifo") {
+    return std::make_unique<NamedPipeSource>(std::string(path));
+  }
+  if (kind == "replay") {
+    uint64_t ticks_per_second = 0;
+    size_t at = path.rfind('@');
+    if (at != std::string_view::npos) {
+      std::string_view rate = path.substr(at + 1);
+      auto parsed = std::from_chars(rate.data(), rate.data() + rate.size(),
+                                    ticks_per_second);
+      if (parsed.ec != std::errc() ||
+          parsed.ptr != rate.data() + rate.size() || at == 0) {
+        return nullptr;
+      }
+      path = path.substr(0, at);
+    }
+    return std::make_unique<ReplayFileSource>(std::string(path),
+                                              ticks_per_second);
+  }
+  return nullptr;
+}
+
+RateFeed::RateFeed(RateStore* store, std::unique_ptr<RateSource> source,
+                   RateFeedOptions options)
+    : store_(store),
+      source_(std::move(source)),
+      options_(options),
+      window_(std::max<size_t>(options.window_size, 1)),
+      latest_(CurrencyCount(), 0),
+      delta_rates_(CurrencyCount(), 0) {}
+
+RateFeed::~RateFeed() {
+  Stop();
+}
+
+bool RateFeed::Start(std::function<void()> on_delta) {
+  if (thread_.joinable()) {
+    return true;
+  }
+  wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (wake_fd_ < 0) {
+    return false;
+  }
+  on_delta_ = std::move(on_delta);
+  stopping_ = false;
+  thread_ = std::thread([this] { Run(); });
+  return true;
+}
+
+void RateFeed::Stop() {
+  if (!thread_.joinable()) {
+    return;
+  }
+  stopping_ = true;
+  uint64_t one = 1;
+  ssize_t written = write(wake_fd_, &one, sizeof(one));
+  (void)written;
+  thread_.join();
+  close(wake_fd_);
+  wake_fd_ = -1;
+}
+
+uint64_t RateFeed::TakeDelta(std::vector<RateTick>* out) {
+  out->clear();
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::sort(delta_currencies_.begin(), delta_currencies_.end());
+  for (CurrencyId currency : delta_currencies_) {
+    out->push_back({currency, delta_rates_[currency]});
+    delta_rates_[currency] = 0;
+  }
+  delta_currencies_.clear();
+  return delta_version_;
+}
+
+bool RateFeed::TakeCycles(std::vector<ArbitrageCycle>* out) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  *out = cycles_;
+  bool changed = cycles_changed_;
+  cycles_changed_ = false;
+  return changed;
+}
+
+RateFeedStats RateFeed::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+bool RateFeed::Wait(int fd, int timeout_ms) {
+  pollfd fds[2] = {{wake_fd_, POLLIN, 0}, {fd, POLLIN, 0}};
+  while (!stopping_) {
+    int ready = poll(fds, 2, timeout_ms);
+    if (ready >= 0 || errno != EINTR) {
+      break;
+    }
+  }
+  return !stopping_;
+}
+
+void RateFeed::Run() {
+  bool opened_before = false;
+  while (!stopping_) {
+    if (!source_->Open()) {
+      if (!Wait(-1, kReopenDelayMs)) {
+        break;
+      }
+      continue;
+    }
+    if (opened_before) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stats_.reopens++;
+    }
+    opened_before = true;
+    at_source_start_ = true;
+
+    // Publishing is due this long after the oldest unpublished input
+    // arrived; max() while there is none.
+    Clock::time_point deadline = Clock::time_point::max();
+    bool ended = false;
+    while (!ended) {
+      int timeout_ms = source_->wait_ms();
+      if (deadline != Clock::time_point::max()) {
+        auto remaining = std::chrono::ceil<std::chrono::milliseconds>(
+            deadline - Clock::now());
+        int deadline_ms = std::max(0, static_cast<int>(remaining.count()));
+        timeout_ms = timeout_ms < 0 ? deadline_ms
+                                    : std::min(timeout_ms, deadline_ms);
+      }
+      if (!Wait(source_->fd(), timeout_ms)) {
+        break;
+      }
+
+      while (filled_ < window_.size()) {
+        ssize_t count =
+            source_->Read(window_.data() + filled_, window_.size() - filled_);
+        if (count <= 0) {
+          ended = count < 0;
+          break;
+        }
+        if (deadline == Clock::time_point::max()) {
+          deadline = Clock::now() + options_.publish_interval;
+        }
+        filled_ += count;
+      }
+      if (ended || filled_ == window_.size() ||
+          (deadline != Clock::time_point::max() && Clock::now() >= deadline)) {
+        if (ended && filled_ != 0 && window_[filled_ - 1] != '\n') {
+          // Complete the final line so it is not held back as partial.
+          if (filled_ == window_.size()) {
+            Publish();
+          }
+          window_[filled_++] = '\n';
+        }
+        Publish();
+        // Only a partial line can be left, which waits for more input.
+        deadline = Clock::time_point::max();
+      }
+    }
+    source_->Close();
+    filled_ = 0;
+    skipping_long_line_ = false;
+    if (stopping_ || !source_->reopen()) {
+      break;
+    }
+    if (!Wait(-1, kReopenDelayMs)) {
+      break;
+    }
+  }
+}
+
+void RateFeed::Publish() {
+  static const MetricId metric = OperationMetric("feed_publish");
+  ScopedLatency latency(metric);
+  std::string_view data(window_.data(), filled_);
+  uint64_t skipped = 0;
+  uint64_t rejected = 0;
+  if (skipping_long_line_) {
+    size_t newline = data.find('\n');
+    size_t skip = newline == std::string_view::npos ? data.size() : newline + 1;
+    skipped += skip;
+    data.remove_prefix(skip);
+    skipping_long_line_ = newline == std::string_view::npos;
+  }
+  size_t newline = data.rfind('\n');
+  size_t complete = newline == std::string_view::npos ? 0 : newline + 1;
+  if (complete == 0 && data.size() == window_.size()) {
+    // A line fills the whole window; drop it.
+    rejected++;
+    skipped += data.size();
+    skipping_long_line_ = true;
+    at_source_start_ = false;
+    data.remove_prefix(data.size());
+  }
+
+  TickIngestStats parsed;
+  std::string_view lines = data.substr(0, complete);
+  if (at_source_start_ && complete != 0) {
+    // Only the source's first line can be a header; in later windows a line
+    // that is not a quote is rejected like any other.
+    lines = SkipHeader(lines, &parsed);
+    at_source_start_ = false;
+  }
+  ticks_.clear();
+  ParseWindow(lines, 1, &ticks_, &parsed);
+
+  // Keep only the latest quote per currency; one version carries them all.
+  uint64_t superseded = 0;
+  for (size_t i = 0; i < ticks_.size(); i++) {
+    RateTick tick;
+    if (!QuoteToRateTick(ticks_.pairs[i], ticks_.rates[i], &tick)) {
+      continue;
+    }
+    if (latest_[tick.currency] == 0) {
+      changed_.push_back(tick.currency);
+    } else {
+      superseded++;
+    }
+    latest_[tick.currency] = tick.rate;
+  }
+  changes_.clear();
+  for (CurrencyId currency : changed_) {
+    changes_.push_back({currency, latest_[currency]});
+    latest_[currency] = 0;
+  }
+  changed_.clear();
+  uint64_t version = 0;
+  if (!changes_.empty()) {
+    version = store_->Publish(changes_.data(), changes_.size());
+    if (mirror_ != nullptr) {
+      mirror_->Append(changes_.data(), changes_.size(), version);
+    }
+  }
+  if (candles_ != nullptr && ticks_.size() != 0) {
+    candles_->Append(ticks_);
+  }
+  // Cross quotes move no base rate, but only they can disagree with the
+  // base rates, so the detector sees every quote.
+  bool cycles_changed = false;
+  if (detector_ != nullptr && ticks_.size() != 0) {
+    for (size_t i = 0; i < ticks_.size(); i++) {
+      detector_->ApplyQuote(ticks_.pairs[i], ticks_.rates[i]);
+    }
+    cycles_changed = detector_->Check();
+  }
+
+  bool notify = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool idle = delta_currencies_.empty() && !cycles_changed_;
+    if (cycles_changed) {
+      cycles_ = detector_->cycles();
+      cycles_changed_ = true;
+      notify = idle;
+    }
+    if (version != 0) {
+      notify = idle;
+      for (const RateTick& change : changes_) {
+        if (delta_rates_[change.currency] == 0) {
+          delta_currencies_.push_back(change.currency);
+        }
+        delta_rates_[change.currency] = change.rate;
+      }
+      delta_version_ = version;
+      stats_.versions++;
+    }
+    stats_.bytes += skipped + parsed.bytes;
+    stats_.ticks += parsed.rows;
+    stats_.rejected += rejected + parsed.rejected;
+    stats_.superseded += superseded;
+  }
+  if (notify && on_delta_) {
+    on_delta_();
+  }
+
+  // Move the partial line, if any, to the front of the window.
+  size_t consumed = filled_ - (data.size() - std::min(complete, data.size()));
+  memmove(window_.data(), window_.data() + consumed, filled_ - consumed);
+  filled_ -= consumed;
+}
+
+}  // namespace converter
@@ -0,0 +1,186 @@
+#ifndef CONVERTER_ENGINE_RATE_FEED_H_
+#define CONVERTER_ENGINE_RATE_FEED_H_
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "arbitrage.h"
+#include "candles.h"
+#include "rate_store.h"
+#include "shared_rates.h"
+#include "tick.h"
+
+namespace converter {
+
+// Where a RateFeed reads its quotes from. Every source delivers the
+// "timestamp,pair,rate" lines understood by ParseTicks.
+class RateSource {
+ public:
+  virtual ~RateSource() = default;
+
+  // Human-readable description for logs, e.g. "unix:/run/rates.sock".
+  virtual std::string name() const = 0;
+
+  // Opens or reconnects the source. Returns false if it is not available
+  // right now; the feed retries later.
+  virtual bool Open() = 0;
+  virtual void Close() = 0;
+
+  // Descriptor that becomes readable when Read has input, or -1 if the
+  // source is paced by wait_ms() instead.
+  virtual int fd() const = 0;
+
+  // Reads up to |size| bytes without blocking. Returns the number read, 0
+  // if nothing is available yet, or -1 at the end of the feed or on an
+  // error, after which the feed closes the source.
+  virtual ssize_t Read(char* buffer, size_t size) = 0;
+
+  // Milliseconds until Read may have input that fd() does not announce, or
+  // -1 to wait for fd() alone.
+  virtual int wait_ms() const { return -1; }
+
+  // Whether the feed should open the source again once it has ended.
+  virtual bool reopen() const { return true; }
+};
+
+// Creates a source from a specification of the form:
+//   unix:PATH     connects to a stream socket, reconnecting when it closes
+//   fifo:PATH     reads a named pipe, created if missing; writers may come
+//                 and go
+//   replay:PATH[@TICKS_PER_SECOND]
+//                 plays a recorded tick file once, as fast as it can be
+//                 read or paced to the given rate
+// Returns null if |spec| is malformed.
+std::unique_ptr<RateSource> CreateRateSource(std::string_view spec);
+
+struct RateFeedOptions {
+  // Longest time ticks wait before they are published. Ticks arriving
+  // within one interval become a single rate version.
+  std::chrono::microseconds publish_interval{1000};
+  // Input buffered between publishes.
+  size_t window_size = 64 << 10;
+};
+
+struct RateFeedStats {
+  uint64_t bytes = 0;
+  // Valid quotes read, and lines that were not.
+  uint64_t ticks = 0;
+  uint64_t rejected = 0;
+  // Quotes replaced by a newer one for the same currency before they were
+  // published.
+  uint64_t superseded = 0;
+  // Rate versions published to the store.
+  uint64_t versions = 0;
+  // Times the source was opened after the first.
+  uint64_t reopens = 0;
+};
+
+// Applies quotes from a RateSource to a RateStore on a thread of its own,
+// and collects the resulting changes for a UI to pick up once per frame.
+//
+// Memory is bounded no matter how fast quotes arrive. Input is read into a
+// fixed window and published, one version per window or publish interval,
+// with only the latest quote per currency kept. If publishing falls behind,
+// the feed stops reading, the pipe or socket buffer fills up and the kernel
+// blocks the producer. Towards the UI, changes are merged into one pending
+// delta holding at most one rate per currency, however long it goes untaken.
+class RateFeed {
+ public:
+  RateFeed(RateStore* store, std::unique_ptr<RateSource> source,
+           RateFeedOptions options = RateFeedOptions());
+  ~RateFeed();
+  RateFeed(const RateFeed&) = delete;
+  RateFeed& operator=(const RateFeed&) = delete;
+
+  // Starts the feed thread. |on_delta| is called on that thread whenever the
+  // pending delta goes from empty to non-empty, so a UI can schedule a frame
+  // to take it. Returns false if the thread could not be set up.
+  bool Start(std::function<void()> on_delta);
+
+  // Also appends every published change to |writer|, so other processes can
+  // follow this feed. Must be called before Start.
+  void MirrorTo(SharedRatesWriter* writer) { mirror_ = writer; }
+
+  // Also feeds every quote, cross pairs included, to |detector| and checks
+  // it after each publish. The detector must be seeded with the current
+  // base rates and belongs to the feed thread once started. Must be called
+  // before Start.
+  void DetectArbitrage(ArbitrageDetector* detector) { detector_ = detector; }
+
+  // Also appends every quote, with its own timestamp, to |candles|. Must be
+  // called before Start.
+  void RecordCandles(CandleStore* candles) { candles_ = candles; }
+
+  // Stops and joins the feed thread. Safe to call more than once.
+  void Stop();
+
+  // Moves the base-rate changes published since the previous call into
+  // |out|, one per currency and in currency order, replacing its contents.
+  // Returns the store version they bring the caller up to.
+  uint64_t TakeDelta(std::vector<RateTick>* out);
+
+  // Copies the cycles the arbitrage detector has flagged into |out|.
+  // Returns whether they changed since the previous call. Changes also wake
+  // |on_delta|, as rate changes do.
+  bool TakeCycles(std::vector<ArbitrageCycle>* out);
+
+  RateFeedStats stats() const;
+
+ private:
+  void Run();
+  // Waits up to |timeout_ms| (-1 for ever) for the source or a stop
+  // request. Returns false once stopping.
+  bool Wait(int fd, int timeout_ms);
+  // Parses whole lines from the window, publishes them and keeps any
+  // partial line for the next read.
+  void Publish();
+
+  RateStore* store_;
+  std::unique_ptr<RateSource> source_;
+  RateFeedOptions options_;
+  std::function<void()> on_delta_;
+  SharedRatesWriter* mirror_ = nullptr;
+  ArbitrageDetector* detector_ = nullptr;
+  CandleStore* candles_ = nullptr;
+  std::thread thread_;
+  std::atomic<bool> stopping_{false};
+  // Written to wake the feed thread when stopping.
+  int wake_fd_ = -1;
+
+  // Owned by the feed thread.
+  std::vector<char> window_;
+  size_t filled_ = 0;
+  bool skipping_long_line_ = false;
+  // Nothing of the open source has been parsed yet, so its next line may be
+  // a header.
+  bool at_source_start_ = false;
+  TickColumns ticks_;
+  std::vector<int64_t> latest_;
+  std::vector<CurrencyId> changed_;
+  std::vector<RateTick> changes_;
+
+  mutable std::mutex mutex_;
+  // Latest unseen rate per currency, 0 where unchanged, and the currencies
+  // set in it.
+  std::vector<int64_t> delta_rates_;
+  std::vector<CurrencyId> delta_currencies_;
+  uint64_t delta_version_ = 0;
+  std::vector<ArbitrageCycle> cycles_;
+  bool cycles_changed_ = false;
+  RateFeedStats stats_;
+};
+
+}  // namespace converter
+
+#endif  // CONVERTER_ENGINE_RATE_FEED_H_
@@ -0,0 +1,175 @@
+#include "rate_snapshot.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace converter {
+
+namespace {
+
+// Layout: SnapshotHeader, SnapshotRate[rate_count], then state_size bytes
+// of state. Little-endian and naturally aligned, like history files.
+constexpr uint64_t kSnapshotMagic = 0x3130504e53434343;  // "CCCSNP01"
+constexpr uint32_t kSnapshotVersion = 1;
+
+struct SnapshotHeader {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t rate_count;
+  int64_t saved_at;
+  uint32_t state_size;
+  // FNV-1a of everything after the header.
+  uint32_t checksum;
+};
+
+struct SnapshotRate {
+  // ISO-4217 code, NUL-padded.
+  char code[8];
+  int64_t rate;
+};
+
+static_assert(sizeof(SnapshotHeader) == 32, "SnapshotHeader layout");
+static_assert(sizeof(SnapshotRate) == 16, "SnapshotRate layout");
+
+// Large enough for every registry, small enough to reject garbage early.
+constexpr uint32_t kMaxRates = 1 << 16;
+constexpr uint32_t kMaxStateSize = 1 << 20;
+
+uint32_t Fnv1a(const char* data, size_t size, uint32_t hash = 2166136261u) {
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ static_cast<uint8_t>(data[i])) * 16777619u;
+  }
+  return hash;
+}
+
+bool WriteAll(int fd, const char* data, size_t size) {
+  while (size > 0) {
+    ssize_t written = write(fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+}  // namespace
+
+bool WriteRateSnapshot(const RateTable& rates, int64_t saved_at,
+                       std::string_view state, const char* path) {
+  if (state.size() > kMaxStateSize) {
+    errno = EINVAL;
+    return false;
+  }
+  size_t count = rates.size();
+  std::vector<char> file(sizeof(SnapshotHeader) +
+                         count * sizeof(SnapshotRate) + state.size());
+  char* body = file.data() + sizeof(SnapshotHeader);
+  for (size_t i = 0; i < count; i++) {
+    CurrencyId currency = static_cast<CurrencyId>(i);
+    SnapshotRate entry = {};
+    const char* code = GetCurrency(currency).code;
+    memcpy(entry.code, code, strnlen(code, sizeof(entry.code)));
+    entry.rate = rates.BaseRate(currency);
+    memcpy(body + i * sizeof(SnapshotRate), &entry, sizeof(entry));
+  }
+  memcpy(body + count * sizeof(SnapshotRate), state.data(), state.size());
+  SnapshotHeader header = {};
+  header.magic = kSnapshotMagic;
+  header.version = kSnapshotVersion;
+  header.rate_count = static_cast<uint32_t>(count);
+  header.saved_at = saved_at;
+  header.state_size = static_cast<uint32_t>(state.size());
+  header.checksum = Fnv1a(body, file.size() - sizeof(header));
+  memcpy(file.data(), &header, sizeof(header));
+
+  // A temporary file of its own, in the same directory so the rename is
+  // atomic, so that concurrent writers never write into each other's file.
+  std::string temp_path = std::string(path) + ".XXXXXX";
+  int fd = mkostemp(temp_path.data(), O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  bool ok = WriteAll(fd, file.data(), file.size()) && fsync(fd) == 0;
+  int saved_errno = errno;
+  if (close(fd) != 0 && ok) {
+    saved_errno = errno;
+    ok = false;
+  }
+  if (ok && rename(temp_path.c_str(), path) != 0) {
+    saved_errno = errno;
+    ok = false;
+  }
+  if (!ok) {
+    unlink(temp_path.c_str());
+    errno = saved_errno;
+  }
+  return ok;
+}
+
+bool LoadRateSnapshot(const char* path, RateStore* store, RateSnapshot* out) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 ||
+      static_cast<size_t>(info.st_size) < sizeof(SnapshotHeader)) {
+    close(fd);
+    return false;
+  }
+  size_t size = info.st_size;
+  void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    return false;
+  }
+  const char* data = static_cast<const char*>(mapped);
+  const SnapshotHeader* header = reinterpret_cast<const SnapshotHeader*>(data);
+  const char* body = data + sizeof(SnapshotHeader);
+  bool valid =
+      header->magic == kSnapshotMagic &&
+      header->version == kSnapshotVersion && header->rate_count <= kMaxRates &&
+      header->state_size <= kMaxStateSize &&
+      size == sizeof(SnapshotHeader) +
+                  header->rate_count * sizeof(SnapshotRate) +
+                  header->state_size &&
+      Fnv1a(body, size - sizeof(SnapshotHeader)) == header->checksum;
+  if (!valid) {
+    munmap(mapped, size);
+    return false;
+  }
+
+  const SnapshotRate* rates = reinterpret_cast<const SnapshotRate*>(body);
+  std::vector<RateTick> ticks;
+  ticks.reserve(header->rate_count);
+  for (uint32_t i = 0; i < header->rate_count; i++) {
+    const SnapshotRate& entry = rates[i];
+    CurrencyId currency = FindCurrency(
+        std::string_view(entry.code, strnlen(entry.code, sizeof(entry.code))));
+    if (currency != kInvalidCurrency && entry.rate > 0) {
+      ticks.push_back({currency, entry.rate});
+    }
+  }
+  store->Publish(ticks.data(), ticks.size());
+  out->saved_at = header->saved_at;
+  out->rates = ticks.size();
+  out->state.assign(body + header->rate_count * sizeof(SnapshotRate),
+                    header->state_size);
+  munmap(mapped, size);
+  return true;
+}
+
+}  // namespace converter
@@ -0,0 +1,42 @@
+#ifndef CONVERTER_ENGINE_RATE_SNAPSHOT_H_
+#define CONVERTER_ENGINE_RATE_SNAPSHOT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "rate_store.h"
+#include "rate_table.h"
+
+namespace converter {
+
+// What a warm-start snapshot held besides its rates.
+struct RateSnapshot {
+  // When the snapshot was written, in milliseconds since the epoch.
+  int64_t saved_at = 0;
+  // Number of base rates restored.
+  size_t rates = 0;
+  // Opaque state saved alongside the rates, such as the UI's.
+  std::string state;
+};
+
+// Writes the base rates of |rates| and |state| to |path| as a warm-start
+// snapshot, atomically replacing any existing file. Concurrent writers each
+// write a temporary file of their own and the last to finish wins. The file
+// is readable by its owner only. Rates are keyed by currency code, so a
+// snapshot survives changes to the registry. Returns false on an I/O error,
+// with errno set.
+bool WriteRateSnapshot(const RateTable& rates, int64_t saved_at,
+                       std::string_view state, const char* path);
+
+// Maps the snapshot at |path| and publishes its rates to |store| as one
+// version, skipping currencies no longer in the registry. The file is a
+// fixed layout read in place, so this costs one mapping and a pass over
+// the rates. Returns false, leaving |store| untouched, if the file is
+// missing or not a valid snapshot.
+bool LoadRateSnapshot(const char* path, RateStore* store, RateSnapshot* out);
+
+}  // namespace converter
+
+#endif  // CONVERTER_ENGINE_RATE_SNAPSHOT_H_
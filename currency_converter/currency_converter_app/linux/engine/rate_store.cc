@@ -0,0 +1,76 @@
+#include "rate_store.h"
+
+namespace converter {
+
+namespace {
+
+// The current table plus two spares, so a writer normally finds a spare that
+// readers left long ago and does not have to wait for them: only a reader
+// still inside a snapshot taken before the spare was replaced holds it up.
+constexpr size_t kVersionCount = 3;
+
+}  // namespace
+
+RateStore::RateStore() : changed_at_(CurrencyCount(), 0) {
+  // Building a table is O(N^2) divisions; copy the first one instead.
+  versions_.push_back(std::make_unique<Version>());
+  for (size_t i = 1; i < kVersionCount; i++) {
+    versions_.push_back(std::make_unique<Version>(*versions_[0]));
+  }
+  versions_[0]->number = 1;
+  current_.store(versions_[0].get());
+}
+
+uint64_t RateStore::version() const {
+  return current_.load(std::memory_order_acquire)->number;
+}
+
+uint64_t RateStore::Publish(const RateTick* ticks, size_t count) {
+  std::lock_guard<std::mutex> lock(writer_mutex_);
+  const Version* current = current_.load(std::memory_order_relaxed);
+
+  // Reuse the oldest table. It may still be read by snapshots taken before
+  // it was replaced; wait for those, if any, to finish first.
+  Version* spare = nullptr;
+  Version* replaced = nullptr;
+  for (const std::unique_ptr<Version>& version : versions_) {
+    if (version.get() == current) {
+      replaced = version.get();
+    } else if (spare == nullptr || version->number < spare->number) {
+      spare = version.get();
+    }
+  }
+  EpochDomain& epochs = EpochDomain::Get();
+  epochs.WaitFor(spare->retired_at);
+
+  // Catch up with every version published since the spare was current.
+  size_t stale = 0;
+  for (uint64_t changed : changed_at_) {
+    stale += changed > spare->number;
+  }
+  if (stale * 4 > changed_at_.size()) {
+    spare->table.CopyFrom(current->table);
+  } else {
+    for (size_t i = 0; i < changed_at_.size() && stale > 0; i++) {
+      if (changed_at_[i] > spare->number) {
+        CurrencyId id = static_cast<CurrencyId>(i);
+        spare->table.SetBaseRate(id, current->table.BaseRate(id));
+        stale--;
+      }
+    }
+  }
+
+  uint64_t number = current->number + 1;
+  for (size_t i = 0; i < count; i++) {
+    if (ticks[i].currency < changed_at_.size() &&
+        spare->table.SetBaseRate(ticks[i].currency, ticks[i].rate)) {
+      changed_at_[ticks[i].currency] = number;
+    }
+  }
+  spare->number = number;
+  current_.store(spare);
+  replaced->retired_at = epochs.Retire();
+  return number;
+}
+
+}  // namespace converter
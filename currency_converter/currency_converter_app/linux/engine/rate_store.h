@@ -0,0 +1,91 @@
+#ifndef CONVERTER_ENGINE_RATE_STORE_H_
+#define CONVERTER_ENGINE_RATE_STORE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "epoch.h"
+#include "rate_table.h"
+
+namespace converter {
+
+// A base-rate change for one currency.
+struct RateTick {
+  CurrencyId currency;
+  int64_t rate;
+};
+
+// Publishes versioned RateTable snapshots to concurrent readers without
+// locks on the read side.
+//
+// Readers take a Snapshot, which pins the table that was current at that
+// moment for as long as it lives; every read through it sees one consistent
+// version. Writers build the next version in a spare table, publish it with
+// a single pointer store and recycle tables once EpochDomain reports that
+// no reader can still see them. Each table remembers the epoch it was
+// retired at, so reusing one that readers left long ago costs a scan of the
+// reader slots rather than a wait. Spare tables are brought up to date by
+// replaying only the currencies that changed since they were last current,
+// so a tick costs O(N) rather than a full N x N rebuild.
+class RateStore {
+ public:
+  RateStore();
+  RateStore(const RateStore&) = delete;
+  RateStore& operator=(const RateStore&) = delete;
+
+  class Snapshot {
+   public:
+    const RateTable& table() const { return version_->table; }
+    uint64_t version() const { return version_->number; }
+
+   private:
+    friend class RateStore;
+    struct Version {
+      RateTable table;
+      uint64_t number = 0;
+      // EpochDomain::Retire() when the table was last replaced, or 0 if it
+      // has never been current since.
+      uint64_t retired_at = 0;
+    };
+
+    explicit Snapshot(const std::atomic<const Version*>& current)
+        : version_(current.load()) {}
+
+    // Declared first so the epoch is announced before the pointer is loaded.
+    EpochDomain::Guard guard_;
+    const Version* version_;
+  };
+
+  // Pins the current table. Never blocks. The snapshot must be released on
+  // the thread that took it and should be short-lived, since writers wait
+  // for it before reusing the table.
+  Snapshot Read() const { return Snapshot(current_); }
+
+  // Version number of the current table, starting at 1.
+  uint64_t version() const;
+
+  // Applies |ticks| as one new version. Ticks with a non-positive rate or an
+  // unknown currency are skipped. Writers are serialised with each other but
+  // never block readers. Returns the published version number.
+  uint64_t Publish(const RateTick* ticks, size_t count);
+  uint64_t Publish(CurrencyId currency, int64_t rate) {
+    RateTick tick = {currency, rate};
+    return Publish(&tick, 1);
+  }
+
+ private:
+  using Version = Snapshot::Version;
+
+  std::mutex writer_mutex_;
+  std::vector<std::unique_ptr<Version>> versions_;
+  // Version number at which each currency's base rate last changed.
+  std::vector<uint64_t> changed_at_;
+  std::atomic<const Version*> current_;
+};
+
+}  // namespace converter
+
+#endif  // CONVERTER_ENGINE_RATE_STORE_H_
@@ -0,0 +1,61 @@
+#include "rate_table.h"
+
+#include "fixed_point.h"
+
+namespace converter {
+
+namespace {
+
+constexpr size_t kRowAlignment = kCacheLineSize / sizeof(int64_t);
+
+}  // namespace
+
+RateTable::RateTable()
+    : base_rates_(CurrencyCount()),
+      stride_((CurrencyCount() + kRowAlignment - 1) / kRowAlignment *
+              kRowAlignment),
+      cross_(CurrencyCount() * stride_),
+      cross_real_(CurrencyCount() * stride_) {
+  for (size_t i = 0; i < base_rates_.size(); i++) {
+    const Currency& currency = GetCurrency(static_cast<CurrencyId>(i));
+    // The seed table is compiled in and always well formed.
+    ParseScaledDecimal(currency.seed_rate, kRateScaleDigits, &base_rates_[i]);
+  }
+  for (size_t from = 0; from < size(); from++) {
+    for (size_t to = 0; to < size(); to++) {
+      UpdateCell(from, to);
+    }
+  }
+}
+
+bool RateTable::SetBaseRate(CurrencyId id, int64_t rate) {
+  if (rate <= 0) {
+    return false;
+  }
+  base_rates_[id] = rate;
+  for (size_t other = 0; other < size(); other++) {
+    UpdateCell(id, other);
+    UpdateCell(other, id);
+  }
+  return true;
+}
+
+void RateTable::CopyFrom(const RateTable& other) {
+  base_rates_ = other.base_rates_;
+  cross_.CopyFrom(other.cross_);
+  cross_real_.CopyFrom(other.cross_real_);
+}
+
+void RateTable::UpdateCell(size_t from, size_t to) {
+  int64_t rate = kRateScale;
+  if (from != to &&
+      !DivRoundHalfEven(static_cast<__int128>(base_rates_[to]) * kRateScale,
+                        base_rates_[from], &rate)) {
+    rate = 0;
+  }
+  size_t index = from * stride_ + to;
+  cross_[index] = rate;
+  cross_real_[index] = static_cast<double>(rate) / kRateScale;
+}
+
+}  // namespace converter
@@ -0,0 +1,70 @@
+#ifndef CONVERTER_ENGINE_RATE_TABLE_H_
+#define CONVERTER_ENGINE_RATE_TABLE_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "aligned_buffer.h"
+#include "currency.h"
+
+namespace converter {
+
+// Holds the rate of every registry currency against the base currency, as
+// fixed-point integers scaled by kRateScale, together with the dense N x N
+// cross-rate matrix derived from them by triangulating through the base.
+//
+// Matrix rows are padded to a whole number of cache lines and start on a
+// cache-line boundary, so a row scan never straddles a partial line.
+// Changing one base rate only recomputes that currency's row and column.
+class RateTable {
+ public:
+  // Creates a table seeded with the registry's seed rates.
+  RateTable();
+
+  size_t size() const { return base_rates_.size(); }
+
+  // Distance in elements between the starts of consecutive matrix rows.
+  size_t stride() const { return stride_; }
+
+  // Units of |id| per one unit of the base currency, scaled by kRateScale.
+  int64_t BaseRate(CurrencyId id) const { return base_rates_[id]; }
+
+  // Replaces the base rate of |id| and updates the affected row and column
+  // of the cross-rate matrix. Returns false if |rate| is not positive.
+  bool SetBaseRate(CurrencyId id, int64_t rate);
+
+  // Makes this table identical to |other| without reallocating.
+  void CopyFrom(const RateTable& other);
+
+  // Looks up the units of |to| per one unit of |from|, scaled by kRateScale
+  // and rounded half to even. Returns false if the cross rate does not fit
+  // in int64.
+  bool CrossRate(CurrencyId from, CurrencyId to, int64_t* out) const {
+    *out = cross_[from * stride_ + to];
+    return *out != 0;
+  }
+
+  // Row |from| of the fixed-point matrix: element j holds the cross rate to
+  // currency j, or 0 if it overflowed.
+  const int64_t* CrossRow(CurrencyId from) const {
+    return cross_.data() + from * stride_;
+  }
+
+  // Row |from| of the matrix as doubles in natural units, i.e. the fixed-point
+  // row divided by kRateScale.
+  const double* CrossRowReal(CurrencyId from) const {
+    return cross_real_.data() + from * stride_;
+  }
+
+ private:
+  void UpdateCell(size_t from, size_t to);
+
+  std::vector<int64_t> base_rates_;
+  size_t stride_;
+  AlignedBuffer<int64_t> cross_;
+  AlignedBuffer<double> cross_real_;
+};
+
+}  // namespace converter
+
+#endif  // CONVERTER_ENGINE_RATE_TABLE_H_
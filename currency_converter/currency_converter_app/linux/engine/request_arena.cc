@@ -0,0 +1,51 @@
+#include "request_arena.h"
+
+#include <algorithm>
+
+namespace converter {
+
+void* RequestArena::Upstream::do_allocate(size_t bytes, size_t alignment) {
+  allocations++;
+  this->bytes += bytes;
+  return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void RequestArena::Upstream::do_deallocate(void* p, size_t bytes,
+                                           size_t alignment) {
+  std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+}
+
+bool RequestArena::Upstream::do_is_equal(
+    const std::pmr::memory_resource& other) const noexcept {
+  return this == &other;
+}
+
+RequestArena::RequestArena(size_t initial_size)
+    : block_(std::clamp(initial_size, kCacheLineSize, kMaxRetainedSize)) {
+  buffer_.emplace(block_.data(), block_.size(), &upstream_);
+}
+
+size_t RequestArena::Reset() {
+  size_t allocations = upstream_.allocations;
+  if (allocations == 0) {
+    // Only the retained block was used; rewind to its start.
+    buffer_->release();
+    return 0;
+  }
+  // Gives back the blocks taken from the heap.
+  buffer_.reset();
+  if (block_.size() < kMaxRetainedSize) {
+    size_t needed = block_.size() + upstream_.bytes;
+    size_t size = block_.size();
+    while (size < needed && size < kMaxRetainedSize) {
+      size *= 2;
+    }
+    block_ = AlignedBuffer<unsigned char>(std::min(size, kMaxRetainedSize));
+  }
+  upstream_.allocations = 0;
+  upstream_.bytes = 0;
+  buffer_.emplace(block_.data(), block_.size(), &upstream_);
+  return allocations;
+}
+
+}  // namespace converter
@@ -0,0 +1,63 @@
+#ifndef CONVERTER_ENGINE_REQUEST_ARENA_H_
+#define CONVERTER_ENGINE_REQUEST_ARENA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
+
+#include "aligned_buffer.h"
+
+namespace converter {
+
+// Memory for the temporaries of one request, such as the text and offsets of
+// a formatted batch. Allocations bump a pointer through a retained block and
+// are all freed at once by Reset(), so once the block has grown to fit the
+// requests a channel sees, they allocate nothing from the heap at all.
+//
+// Pass resource() to std::pmr containers. Not thread-safe; a channel keeps
+// one for the requests it handles on the main thread.
+class RequestArena {
+ public:
+  // Largest block kept between requests. Bigger requests still work, taking
+  // the excess from the heap every time: the work they do dwarfs the
+  // allocation, and the arena does not hold on to the memory of the largest
+  // request ever made.
+  static constexpr size_t kMaxRetainedSize = size_t{4} << 20;
+
+  explicit RequestArena(size_t initial_size = size_t{64} << 10);
+  RequestArena(const RequestArena&) = delete;
+  RequestArena& operator=(const RequestArena&) = delete;
+
+  std::pmr::memory_resource* resource() { return &*buffer_; }
+
+  // Frees everything allocated since the last reset; nothing allocated
+  // from resource() may be used afterwards. Returns the number of heap
+  // allocations the request needed beyond the retained block, which then
+  // grows, up to kMaxRetainedSize, so the same request needs none next time.
+  size_t Reset();
+
+  size_t retained_size() const { return block_.size(); }
+
+ private:
+  // The heap, counting what the arena takes from it.
+  class Upstream : public std::pmr::memory_resource {
+   public:
+    size_t allocations = 0;
+    size_t bytes = 0;
+
+   private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(
+        const std::pmr::memory_resource& other) const noexcept override;
+  };
+
+  Upstream upstream_;
+  AlignedBuffer<unsigned char> block_;
+  std::optional<std::pmr::monotonic_buffer_resource> buffer_;
+};
+
+}  // namespace converter
+
+#endif  // CONVERTER_ENGINE_REQUEST_ARENA_H_
@@ -0,0 +1,323 @@
+#include "shared_rates.h"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "currency.h"
+
+namespace converter {
+
+namespace {
+
+using shared_rates::SharedRateSlot;
+using shared_rates::SharedRatesHeader;
+
+constexpr size_t RoundUp(size_t size) {
+  return (size + kCacheLineSize - 1) / kCacheLineSize * kCacheLineSize;
+}
+
+constexpr size_t SnapshotOffset() {
+  return RoundUp(sizeof(SharedRatesHeader));
+}
+
+size_t RingOffset(uint32_t currency_count) {
+  return SnapshotOffset() + RoundUp(currency_count * sizeof(int64_t));
+}
+
+size_t ObjectSize(uint32_t currency_count, uint32_t capacity) {
+  return RingOffset(currency_count) +
+         static_cast<size_t>(capacity) * sizeof(SharedRateSlot);
+}
+
+uint32_t RoundUpToPowerOfTwo(uint32_t value) {
+  uint32_t result = 1;
+  while (result < value && result < (1u << 31)) {
+    result <<= 1;
+  }
+  return result;
+}
+
+// Whether the object described by |info| belongs to this user and nobody
+// else can write to it.
+bool IsPrivate(const struct stat& info) {
+  return info.st_uid == geteuid() && (info.st_mode & (S_IWGRP | S_IWOTH)) == 0;
+}
+
+// Whether the mapped object at |header| of |size| bytes was set up with the
+// layout this build expects.
+bool IsCompatible(const SharedRatesHeader* header, size_t size) {
+  return size >= sizeof(SharedRatesHeader) &&
+         header->magic.load(std::memory_order_acquire) ==
+             shared_rates::kMagic &&
+         header->layout_version == shared_rates::kLayoutVersion &&
+         header->currency_count == CurrencyCount() && header->capacity != 0 &&
+         (header->capacity & (header->capacity - 1)) == 0 &&
+         size == ObjectSize(header->currency_count, header->capacity);
+}
+
+// An update of the page takes well under a microsecond, so this many
+// failed attempts means the writer stopped halfway.
+constexpr int kMaxSnapshotAttempts = 1 << 20;
+
+// Copies the snapshot page, retrying while the writer updates it. Returns
+// false if no consistent copy could be made.
+bool ReadSnapshotPage(const SharedRatesHeader* header,
+                      const std::atomic<int64_t>* snapshot,
+                      std::vector<int64_t>* rates, uint64_t* version,
+                      uint64_t* end) {
+  rates->resize(header->currency_count);
+  for (int attempt = 0; attempt < kMaxSnapshotAttempts; attempt++) {
+    uint64_t before = header->snapshot_sequence.load(std::memory_order_acquire);
+    if (before & 1) {
+      continue;
+    }
+    for (uint32_t i = 0; i < header->currency_count; i++) {
+      (*rates)[i] = snapshot[i].load(std::memory_order_relaxed);
+    }
+    *version = header->snapshot_version.load(std::memory_order_relaxed);
+    *end = header->snapshot_end.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (header->snapshot_sequence.load(std::memory_order_relaxed) == before) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+namespace shared_rates {
+
+std::string DefaultName() {
+  return "/currency_converter_rates-" + std::to_string(geteuid());
+}
+
+}  // namespace shared_rates
+
+std::unique_ptr<SharedRatesWriter> SharedRatesWriter::Create(
+    const std::string& name, uint32_t capacity) {
+  capacity = RoundUpToPowerOfTwo(capacity);
+  uint32_t currency_count = static_cast<uint32_t>(CurrencyCount());
+  size_t size = ObjectSize(currency_count, capacity);
+
+  int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    return nullptr;
+  }
+  // Held for the life of the writer; a second publisher fails here.
+  if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+    close(fd);
+    return nullptr;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || !IsPrivate(info)) {
+    close(fd);
+    return nullptr;
+  }
+
+  bool reuse = false;
+  if (info.st_size != 0) {
+    void* existing = mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE,
+                          MAP_SHARED, fd, 0);
+    if (existing != MAP_FAILED) {
+      SharedRatesHeader* header = static_cast<SharedRatesHeader*>(existing);
+      reuse = IsCompatible(header, info.st_size) &&
+              header->capacity == capacity;
+      if (!reuse && static_cast<size_t>(info.st_size) >=
+                        sizeof(SharedRatesHeader) &&
+          header->magic.load(std::memory_order_acquire) ==
+              shared_rates::kMagic &&
+          header->layout_version == shared_rates::kLayoutVersion) {
+        // Tell readers of the old object to open the new one.
+        header->retired.store(1, std::memory_order_release);
+      }
+      munmap(existing, info.st_size);
+    }
+  }
+  if (!reuse && info.st_size != 0) {
+    // Readers of an object with another layout must not see it resized
+    // under them, so start a new object under the same name; they keep the
+    // old one until they see it retired and reopen.
+    shm_unlink(name.c_str());
+    close(fd);
+    fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd < 0 || flock(fd, LOCK_EX | LOCK_NB) != 0) {
+      if (fd >= 0) {
+        close(fd);
+      }
+      return nullptr;
+    }
+  }
+  if (!reuse && ftruncate(fd, size) != 0) {
+    close(fd);
+    return nullptr;
+  }
+
+  void* mapping =
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (mapping == MAP_FAILED) {
+    close(fd);
+    return nullptr;
+  }
+  if (!reuse) {
+    // The object is zero-filled, which is a valid empty ring and snapshot.
+    SharedRatesHeader* header = static_cast<SharedRatesHeader*>(mapping);
+    header->layout_version = shared_rates::kLayoutVersion;
+    header->currency_count = currency_count;
+    header->capacity = capacity;
+    header->magic.store(shared_rates::kMagic, std::memory_order_release);
+  }
+  return std::unique_ptr<SharedRatesWriter>(
+      new SharedRatesWriter(fd, mapping, size));
+}
+
+SharedRatesWriter::SharedRatesWriter(int fd, void* mapping, size_t size)
+    : fd_(fd),
+      mapping_(mapping),
+      size_(size),
+      header_(static_cast<SharedRatesHeader*>(mapping)),
+      snapshot_(reinterpret_cast<std::atomic<int64_t>*>(
+          static_cast<char*>(mapping) + SnapshotOffset())),
+      ring_(reinterpret_cast<SharedRateSlot*>(
+          static_cast<char*>(mapping) +
+          RingOffset(header_->currency_count))) {}
+
+SharedRatesWriter::~SharedRatesWriter() {
+  munmap(mapping_, size_);
+  // Also releases the lock. The object stays for the next publisher.
+  close(fd_);
+}
+
+void SharedRatesWriter::Append(const RateTick* ticks, size_t count,
+                               uint64_t version) {
+  uint64_t mask = header_->capacity - 1;
+  uint64_t sequence = header_->write_sequence.load(std::memory_order_relaxed);
+  uint64_t end = sequence;
+  for (size_t i = 0; i < count; i++) {
+    if (ticks[i].currency >= header_->currency_count) {
+      continue;
+    }
+    SharedRateSlot& slot = ring_[end & mask];
+    slot.sequence.store(2 * end + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.version.store(version, std::memory_order_relaxed);
+    slot.rate.store(ticks[i].rate, std::memory_order_relaxed);
+    slot.currency.store(ticks[i].currency, std::memory_order_relaxed);
+    slot.sequence.store(2 * (end + 1), std::memory_order_release);
+    end++;
+  }
+
+  // The page is updated before the new entries are announced, so a reader
+  // that resynchronises from it never goes back in time.
+  header_->snapshot_sequence.fetch_add(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  for (size_t i = 0; i < count; i++) {
+    if (ticks[i].currency < header_->currency_count) {
+      snapshot_[ticks[i].currency].store(ticks[i].rate,
+                                         std::memory_order_relaxed);
+    }
+  }
+  header_->snapshot_version.store(version, std::memory_order_relaxed);
+  header_->snapshot_end.store(end, std::memory_order_relaxed);
+  header_->snapshot_sequence.fetch_add(1, std::memory_order_release);
+
+  header_->write_sequence.store(end, std::memory_order_release);
+}
+
+std::unique_ptr<SharedRatesReader> SharedRatesReader::Open(
+    const std::string& name) {
+  int fd = shm_open(name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat info;
+  void* mapping = MAP_FAILED;
+  if (fstat(fd, &info) == 0 && IsPrivate(info) &&
+      static_cast<size_t>(info.st_size) >= sizeof(SharedRatesHeader)) {
+    mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  }
+  // The mapping keeps the object alive.
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    return nullptr;
+  }
+  const SharedRatesHeader* header =
+      static_cast<const SharedRatesHeader*>(mapping);
+  if (!IsCompatible(header, info.st_size) ||
+      header->retired.load(std::memory_order_acquire) != 0) {
+    munmap(mapping, info.st_size);
+    return nullptr;
+  }
+  return std::unique_ptr<SharedRatesReader>(
+      new SharedRatesReader(mapping, info.st_size));
+}
+
+SharedRatesReader::SharedRatesReader(void* mapping, size_t size)
+    : mapping_(mapping),
+      size_(size),
+      header_(static_cast<const SharedRatesHeader*>(mapping)),
+      snapshot_(reinterpret_cast<const std::atomic<int64_t>*>(
+          static_cast<const char*>(mapping) + SnapshotOffset())),
+      ring_(reinterpret_cast<const SharedRateSlot*>(
+          static_cast<const char*>(mapping) +
+          RingOffset(header_->currency_count))) {}
+
+SharedRatesReader::~SharedRatesReader() {
+  munmap(mapping_, size_);
+}
+
+uint64_t SharedRatesReader::ReadSnapshot(std::vector<int64_t>* rates) {
+  uint64_t version;
+  uint64_t end;
+  if (!ReadSnapshotPage(header_, snapshot_, rates, &version, &end)) {
+    rates->clear();
+    return 0;
+  }
+  next_ = end;
+  return version;
+}
+
+uint64_t SharedRatesReader::Poll(std::vector<RateTick>* out) {
+  uint64_t end = header_->write_sequence.load(std::memory_order_acquire);
+  uint64_t mask = header_->capacity - 1;
+  uint64_t version = 0;
+  bool lapped = end - next_ > header_->capacity;
+  for (; !lapped && next_ != end; next_++) {
+    const SharedRateSlot& slot = ring_[next_ & mask];
+    uint64_t expected = 2 * (next_ + 1);
+    if (slot.sequence.load(std::memory_order_acquire) != expected) {
+      lapped = true;
+      break;
+    }
+    RateTick tick;
+    uint64_t tick_version = slot.version.load(std::memory_order_relaxed);
+    tick.rate = slot.rate.load(std::memory_order_relaxed);
+    tick.currency =
+        static_cast<CurrencyId>(slot.currency.load(std::memory_order_relaxed));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.sequence.load(std::memory_order_relaxed) != expected) {
+      lapped = true;
+      break;
+    }
+    out->push_back(tick);
+    version = tick_version;
+  }
+  if (lapped) {
+    // The entries in between are gone; the page has every rate they set.
+    overruns_++;
+    version = ReadSnapshot(&scratch_);
+    for (size_t i = 0; i < scratch_.size(); i++) {
+      if (scratch_[i] > 0) {
+        out->push_back({static_cast<CurrencyId>(i), scratch_[i]});
+      }
+    }
+  }
+  return version;
+}
+
+}  // namespace converter
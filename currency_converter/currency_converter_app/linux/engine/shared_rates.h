@@ -0,0 +1,176 @@
+#ifndef CONVERTER_ENGINE_SHARED_RATES_H_
+#define CONVERTER_ENGINE_SHARED_RATES_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "aligned_buffer.h"
+#include "rate_store.h"
+
+namespace converter {
+
+// Base rates shared between processes through one POSIX shared-memory
+// object, so a single publisher can parse a rate feed for every running
+// instance of the application.
+//
+// The object holds a ring of rate changes and a page with the current rate
+// of every currency. There is exactly one writer; any number of readers map
+// it read-only and read it in place. Neither side takes locks or makes
+// system calls after the mapping is set up.
+//
+//   SharedRatesHeader
+//   int64_t snapshot_rates[currency_count]   (cache-line aligned)
+//   SharedRateSlot ring[capacity]            (cache-line aligned)
+//
+// Ring entry n lives in slot n % capacity. The writer may lap a slow
+// reader, which notices from the sequence numbers and resynchronises from
+// the snapshot page.
+//
+// The object is private to one user: it is created with mode 0600 and
+// either side refuses one owned by someone else or writable by others, so
+// no other local user can feed rates to the application.
+namespace shared_rates {
+
+constexpr uint64_t kMagic = 0x3130455441524343;  // "CCRATE01"
+constexpr uint32_t kLayoutVersion = 2;
+
+// Name of the object shared by every instance of the application the
+// current user runs.
+std::string DefaultName();
+constexpr uint32_t kDefaultCapacity = 1 << 16;
+
+// Seqlock convention: a sequence word is odd while the data it guards is
+// being written.
+struct alignas(kCacheLineSize) SharedRatesHeader {
+  // Set last when the object is first set up, so a reader that sees it can
+  // rely on the rest of the layout.
+  std::atomic<uint64_t> magic;
+  uint32_t layout_version;
+  uint32_t currency_count;
+  // A power of two.
+  uint32_t capacity;
+  // Set by a writer that replaced the object with one of another size and
+  // unlinked it; readers should open the name again.
+  std::atomic<uint32_t> retired;
+
+  // Number of ring entries ever written; entry n is complete once this
+  // exceeds n.
+  alignas(kCacheLineSize) std::atomic<uint64_t> write_sequence;
+
+  // Guards the two fields below and the snapshot page.
+  alignas(kCacheLineSize) std::atomic<uint64_t> snapshot_sequence;
+  // Publisher's RateStore version the snapshot page reflects, and the
+  // number of ring entries it includes.
+  std::atomic<uint64_t> snapshot_version;
+  std::atomic<uint64_t> snapshot_end;
+};
+
+struct alignas(32) SharedRateSlot {
+  // 2 * (entry number + 1) once written, odd while being rewritten.
+  std::atomic<uint64_t> sequence;
+  std::atomic<uint64_t> version;
+  std::atomic<int64_t> rate;
+  std::atomic<uint32_t> currency;
+  uint32_t reserved;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free &&
+                  std::atomic<uint32_t>::is_always_lock_free,
+              "Shared rates need address-free atomics");
+
+}  // namespace shared_rates
+
+// The publishing side. Creating it claims the object for this process.
+class SharedRatesWriter {
+ public:
+  // Creates or reuses the object |name| with room for |capacity| entries,
+  // rounded up to a power of two. An existing object with the same layout
+  // is continued, so readers that have it mapped carry on; one of another
+  // size is marked retired and replaced. Returns null if the object cannot
+  // be set up, belongs to another user, or another process is already
+  // publishing to it.
+  static std::unique_ptr<SharedRatesWriter> Create(
+      const std::string& name = shared_rates::DefaultName(),
+      uint32_t capacity = shared_rates::kDefaultCapacity);
+
+  ~SharedRatesWriter();
+  SharedRatesWriter(const SharedRatesWriter&) = delete;
+  SharedRatesWriter& operator=(const SharedRatesWriter&) = delete;
+
+  // Appends |ticks|, published locally as |version|, to the ring and applies
+  // them to the snapshot page.
+  void Append(const RateTick* ticks, size_t count, uint64_t version);
+
+ private:
+  SharedRatesWriter(int fd, void* mapping, size_t size);
+
+  int fd_;
+  void* mapping_;
+  size_t size_;
+  shared_rates::SharedRatesHeader* header_;
+  std::atomic<int64_t>* snapshot_;
+  shared_rates::SharedRateSlot* ring_;
+};
+
+// A read-only view of the object for one consumer. Not thread-safe; each
+// thread that reads should have its own reader.
+class SharedRatesReader {
+ public:
+  // Maps the object |name|. Returns null if it does not exist yet, was set
+  // up by an incompatible build, belongs to another user or is retired.
+  static std::unique_ptr<SharedRatesReader> Open(
+      const std::string& name = shared_rates::DefaultName());
+
+  ~SharedRatesReader();
+  SharedRatesReader(const SharedRatesReader&) = delete;
+  SharedRatesReader& operator=(const SharedRatesReader&) = delete;
+
+  // Whether the writer has appended entries this reader has not read yet.
+  // A single load from shared memory.
+  bool has_new() const {
+    return header_->write_sequence.load(std::memory_order_acquire) != next_;
+  }
+
+  // Reads the rate of every currency from the snapshot page into |rates|,
+  // indexed by CurrencyId, and positions the reader after the last entry
+  // the page includes. Returns the publisher's version of the page, or 0 if
+  // the page stayed mid-update, as when the publisher died while writing
+  // it.
+  uint64_t ReadSnapshot(std::vector<int64_t>* rates);
+
+  // Appends the entries written since the previous call to |out|, oldest
+  // first. If the writer lapped this reader, the entries in between are
+  // lost; the latest rate of every currency from the snapshot page is
+  // appended instead, and overruns() goes up. Returns the publisher's
+  // version of the newest entry read, or 0 if there was none.
+  uint64_t Poll(std::vector<RateTick>* out);
+
+  // Whether the writer replaced the object. Nothing more will be written
+  // to it, so the reader should be dropped and the name opened again.
+  bool retired() const {
+    return header_->retired.load(std::memory_order_acquire) != 0;
+  }
+
+  // Number of times this reader was lapped.
+  uint64_t overruns() const { return overruns_; }
+
+ private:
+  SharedRatesReader(void* mapping, size_t size);
+
+  void* mapping_;
+  size_t size_;
+  const shared_rates::SharedRatesHeader* header_;
+  const std::atomic<int64_t>* snapshot_;
+  const shared_rates::SharedRateSlot* ring_;
+  uint64_t next_ = 0;
+  uint64_t overruns_ = 0;
+  std::vector<int64_t> scratch_;
+};
+
+}  // namespace converter
+
+#endif  // CONVERTER_ENGINE_SHARED_RATES_H_
@@ -0,0 +1,159 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace converter {
+
+namespace {
+
+// The pool and index of the worker running on this thread, if any.
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local size_t current_worker = 0;
+
+// Shared by the calling thread and the helper tasks of one ParallelFor.
+struct ParallelJob {
+  const std::function<void(size_t, size_t)>* body;
+  size_t count;
+  size_t chunks;
+  std::atomic<size_t> next_chunk{0};
+  std::atomic<size_t> finished{0};
+  std::mutex mutex;
+  std::condition_variable done;
+
+  // Claims and runs chunks until none are left.
+  void Work() {
+    size_t chunk;
+    while ((chunk = next_chunk.fetch_add(1)) < chunks) {
+      (*body)(count * chunk / chunks, count * (chunk + 1) / chunks);
+      if (finished.fetch_add(1) + 1 == chunks) {
+        std::lock_guard<std::mutex> lock(mutex);
+        done.notify_all();
+      }
+    }
+  }
+};
+
+}  // namespace
+
+ThreadPool::ThreadPool(unsigned threads) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (unsigned i = 0; i < threads; i++) {
+    workers_.push_back(std::make_unique<Worker>());
+  }
+  for (unsigned i = 0; i < threads; i++) {
+    threads_.emplace_back(&ThreadPool::Run, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+ThreadPool& ThreadPool::Get() {
+  // Intentionally leaked: tasks may still be running during static
+  // destruction.
+  static ThreadPool* pool = new ThreadPool();
+  return *pool;
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+  size_t index = current_pool == this
+                     ? current_worker
+                     : next_worker_.fetch_add(1, std::memory_order_relaxed) %
+                           workers_.size();
+  {
+    std::lock_guard<std::mutex> lock(workers_[index]->mutex);
+    workers_[index]->tasks.push_back(std::move(task));
+  }
+  {
+    // Taking the sleep lock orders the increment against a worker that has
+    // just seen no work and is about to wait.
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    pending_.fetch_add(1);
+  }
+  wake_.notify_one();
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t grain,
+                             const std::function<void(size_t, size_t)>& body) {
+  if (count == 0) {
+    return;
+  }
+  grain = std::max<size_t>(grain, 1);
+  // A few chunks per worker lets fast workers pick up the slack of slow
+  // ones without making chunks so small that claiming them dominates.
+  size_t chunks = std::min((count + grain - 1) / grain, 4 * size());
+  if (chunks <= 1) {
+    body(0, count);
+    return;
+  }
+
+  auto job = std::make_shared<ParallelJob>();
+  job->body = &body;
+  job->count = count;
+  job->chunks = chunks;
+  size_t helpers = std::min(chunks - 1, size());
+  for (size_t i = 0; i < helpers; i++) {
+    Submit([job] { job->Work(); });
+  }
+  job->Work();
+  // Helpers that start after the last chunk was claimed find nothing to do,
+  // so only chunks already running are waited for.
+  std::unique_lock<std::mutex> lock(job->mutex);
+  job->done.wait(lock, [&] { return job->finished.load() == chunks; });
+}
+
+bool ThreadPool::PopOwn(size_t index, std::function<void()>* task) {
+  Worker& worker = *workers_[index];
+  std::lock_guard<std::mutex> lock(worker.mutex);
+  if (worker.tasks.empty()) {
+    return false;
+  }
+  *task = std::move(worker.tasks.back());
+  worker.tasks.pop_back();
+  return true;
+}
+
+bool ThreadPool::Steal(size_t thief, std::function<void()>* task) {
+  for (size_t i = 1; i < workers_.size(); i++) {
+    Worker& victim = *workers_[(thief + i) % workers_.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      *task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::Run(size_t index) {
+  current_pool = this;
+  current_worker = index;
+  while (true) {
+    std::function<void()> task;
+    if (PopOwn(index, &task) || Steal(index, &task)) {
+      pending_.fetch_sub(1);
+      task();
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    if (pending_.load() == 0) {
+      if (stopping_) {
+        return;
+      }
+      wake_.wait(lock);
+    }
+  }
+}
+
+}  // namespace converter
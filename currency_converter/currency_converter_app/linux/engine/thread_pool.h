@@ -0,0 +1,70 @@
+#ifndef CONVERTER_ENGINE_THREAD_POOL_H_
+#define CONVERTER_ENGINE_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "aligned_buffer.h"
+
+namespace converter {
+
+// A fixed set of worker threads with one task deque each. A worker runs its
+// own tasks newest first and, when it runs out, steals the oldest task of
+// another worker, so load evens out without a shared queue to contend on.
+class ThreadPool {
+ public:
+  // Starts |threads| workers, or one per hardware core if 0.
+  explicit ThreadPool(unsigned threads = 0);
+  // Runs every task already submitted, then joins the workers.
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // The process-wide pool, sized to the hardware, created on first use.
+  static ThreadPool& Get();
+
+  size_t size() const { return workers_.size(); }
+
+  // Queues |task|. Called from a worker, the task goes to that worker's own
+  // deque; otherwise workers are picked round-robin.
+  void Submit(std::function<void()> task);
+
+  // Calls |body|(begin, end) for consecutive chunks covering [0, count), of
+  // at least |grain| elements each, and returns once all have run. Chunks
+  // are claimed dynamically by the calling thread and by helper tasks on the
+  // pool, so the call may be nested inside a task without deadlocking.
+  void ParallelFor(size_t count, size_t grain,
+                   const std::function<void(size_t, size_t)>& body);
+
+ private:
+  struct alignas(kCacheLineSize) Worker {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  void Run(size_t index);
+  bool PopOwn(size_t index, std::function<void()>* task);
+  bool Steal(size_t thief, std::function<void()>* task);
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<std::thread> threads_;
+  std::atomic<size_t> next_worker_{0};
+
+  // Tasks queued but not yet taken, and the sleep of idle workers.
+  std::atomic<size_t> pending_{0};
+  std::mutex sleep_mutex_;
+  std::condition_variable wake_;
+  bool stopping_ = false;
+};
+
+}  // namespace converter
+
+#endif  // CONVERTER_ENGINE_THREAD_POOL_H_
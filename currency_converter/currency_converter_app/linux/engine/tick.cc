@@ -0,0 +1,53 @@
+#include "tick.h"
+
+#include "conversion_engine.h"
+#include "fixed_point.h"
+
+namespace converter {
+
+bool QuoteToRateTick(uint32_t pair, int64_t rate, RateTick* out) {
+  CurrencyId first = pair >> 16;
+  CurrencyId second = pair & 0xffff;
+  CurrencyId base = BaseCurrency();
+  if (rate <= 0 || first == second) {
+    return false;
+  }
+  if (first == base) {
+    *out = {second, rate};
+    return second < CurrencyCount();
+  }
+  if (second == base && first < CurrencyCount()) {
+    // Units of |first| per base unit is the reciprocal of the quote.
+    out->currency = first;
+    return DivRoundHalfEven(static_cast<__int128>(kRateScale) * kRateScale,
+                            rate, &out->rate) &&
+           out->rate > 0;
+  }
+  return false;
+}
+
+size_t PublishLatest(const TickColumns& ticks, RateStore* store) {
+  std::vector<int64_t> latest(CurrencyCount(), 0);
+  std::vector<int64_t> latest_time(CurrencyCount(), INT64_MIN);
+  for (size_t i = 0; i < ticks.size(); i++) {
+    RateTick tick;
+    if (QuoteToRateTick(ticks.pairs[i], ticks.rates[i], &tick) &&
+        ticks.timestamps[i] >= latest_time[tick.currency]) {
+      latest_time[tick.currency] = ticks.timestamps[i];
+      latest[tick.currency] = tick.rate;
+    }
+  }
+
+  std::vector<RateTick> changes;
+  for (size_t i = 0; i < latest.size(); i++) {
+    if (latest[i] > 0) {
+      changes.push_back({static_cast<CurrencyId>(i), latest[i]});
+    }
+  }
+  if (!changes.empty()) {
+    store->Publish(changes.data(), changes.size());
+  }
+  return changes.size();
+}
+
+}  // namespace converter
@@ -0,0 +1,45 @@
+#ifndef CONVERTER_ENGINE_TICK_H_
+#define CONVERTER_ENGINE_TICK_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "currency.h"
+#include "rate_store.h"
+
+namespace converter {
+
+// A batch of quotes stored column by column, so each column can be handed to
+// the engine or a history writer as one contiguous array.
+//
+// A quote for pair (first, second) is the number of units of second per one
+// unit of first, scaled by kRateScale; pairs are packed with PackPair.
+struct TickColumns {
+  std::vector<int64_t> timestamps;
+  std::vector<uint32_t> pairs;
+  std::vector<int64_t> rates;
+
+  size_t size() const { return timestamps.size(); }
+
+  void resize(size_t size) {
+    timestamps.resize(size);
+    pairs.resize(size);
+    rates.resize(size);
+  }
+
+  void clear() { resize(0); }
+};
+
+// Turns a quote for |pair| into the base-rate change it implies. Returns
+// false if neither side of the pair is the base currency, since such a quote
+// cannot move a base rate on its own.
+bool QuoteToRateTick(uint32_t pair, int64_t rate, RateTick* out);
+
+// Publishes the last quote in |ticks| for every base-currency pair to
+// |store| as one new version. Returns the number of currencies updated.
+size_t PublishLatest(const TickColumns& ticks, RateStore* store);
+
+}  // namespace converter
+
+#endif  // CONVERTER_ENGINE_TICK_H_
@@ -0,0 +1,374 @@
+#include "tick_csv.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "conversion_engine.h"
+#include "fixed_point.h"
+#include "thread_pool.h"
+
+namespace converter {
+
+namespace {
+
+// Below this a chunk is not worth a thread of its own.
+constexpr size_t kMinChunkSize = 1 << 20;
+constexpr size_t kStreamWindowSize = 64 << 20;
+
+constexpr int64_t kPow10[] = {1,
+                              10,
+                              100,
+                              1000,
+                              10000,
+                              100000,
+                              1000000,
+                              10000000,
+                              100000000,
+                              1000000000,
+                              10000000000,
+                              100000000000,
+                              1000000000000};
+
+// Parses the positive rate that starts at |begin| and runs to the end of the
+// line. The common case of at most six integer digits and kRateScaleDigits
+// fraction digits is handled inline; anything else goes through
+// ParseScaledDecimal, which also rounds excess fraction digits. |*stop|
+// receives the line terminator (or |end|).
+bool ParseRate(const char* begin, const char* end, int64_t* out,
+               const char** stop) {
+  const char* p = begin;
+  uint64_t mantissa = 0;
+  int integer_digits = 0;
+  while (p != end && static_cast<unsigned>(*p - '0') < 10) {
+    mantissa = mantissa * 10 + (*p++ - '0');
+    integer_digits++;
+  }
+  int fraction_digits = 0;
+  if (p != end && *p == '.') {
+    p++;
+    while (p != end && static_cast<unsigned>(*p - '0') < 10 &&
+           fraction_digits <= kRateScaleDigits) {
+      mantissa = mantissa * 10 + (*p++ - '0');
+      fraction_digits++;
+    }
+  }
+  if ((p == end || *p == '\n') && integer_digits <= 6 &&
+      fraction_digits <= kRateScaleDigits &&
+      integer_digits + fraction_digits > 0) {
+    *stop = p;
+    *out = static_cast<int64_t>(mantissa) *
+           kPow10[kRateScaleDigits - fraction_digits];
+    return *out > 0;
+  }
+
+  const char* newline = static_cast<const char*>(memchr(p, '\n', end - p));
+  *stop = newline ? newline : end;
+  const char* field_end = *stop;
+  while (field_end != begin && (field_end[-1] == '\r' || field_end[-1] == ' ')) {
+    field_end--;
+  }
+  return ParseScaledDecimal(std::string_view(begin, field_end - begin),
+                            kRateScaleDigits, out) &&
+         *out > 0;
+}
+
+// Remembers recently seen pair spellings so that the currency lookups run
+// once per distinct pair rather than once per line.
+class PairCache {
+ public:
+  PairCache() { std::fill(std::begin(keys_), std::end(keys_), 0); }
+
+  // Returns the packed pair for the codes at |first| and |second|, or false if
+  // either is unknown.
+  bool Find(const char* first, const char* second, uint32_t* pair) {
+    uint64_t key = 0;
+    memcpy(&key, first, 3);
+    uint64_t second_key = 0;
+    memcpy(&second_key, second, 3);
+    key |= second_key << 24;
+    size_t slot = (key * 0x9e3779b97f4a7c15ull) >> (64 - kBits);
+    if (keys_[slot] == key) {
+      *pair = pairs_[slot];
+      return true;
+    }
+    CurrencyId from = FindCurrency(std::string_view(first, 3));
+    CurrencyId to = FindCurrency(std::string_view(second, 3));
+    if (from == kInvalidCurrency || to == kInvalidCurrency) {
+      return false;
+    }
+    keys_[slot] = key;
+    pairs_[slot] = PackPair(from, to);
+    *pair = pairs_[slot];
+    return true;
+  }
+
+ private:
+  static constexpr int kBits = 8;
+  uint64_t keys_[1 << kBits];
+  uint32_t pairs_[1 << kBits];
+};
+
+// Parses the line that starts at |p|. |*next| receives the start of the
+// following line whether or not the line is valid, so that the input is
+// scanned once rather than split into lines up front.
+bool ParseLine(const char* p, const char* end, PairCache* cache,
+               int64_t* timestamp, uint32_t* pair, int64_t* rate,
+               const char** next) {
+  const char* line = p;
+  bool valid = false;
+  std::from_chars_result parsed = std::from_chars(p, end, *timestamp);
+  if (parsed.ec == std::errc() && parsed.ptr != end && *parsed.ptr == ',') {
+    p = parsed.ptr + 1;
+    const char* first = p;
+    const char* second = nullptr;
+    if (end - p > 7 && p[3] == '/' && p[7] == ',') {
+      second = p + 4;
+      p += 8;
+    } else if (end - p > 6 && p[6] == ',') {
+      second = p + 3;
+      p += 7;
+    }
+    if (second && cache->Find(first, second, pair)) {
+      valid = ParseRate(p, end, rate, &p);
+      *next = p == end ? end : p + 1;
+      return valid;
+    }
+  }
+  const char* newline = static_cast<const char*>(memchr(line, '\n', end - line));
+  *next = newline ? newline + 1 : end;
+  return false;
+}
+
+size_t CountLines(std::string_view chunk) {
+  // Byte-wide counters over blocks of at most 255 bytes let the compiler
+  // compare a full vector of bytes per instruction.
+  size_t lines = 0;
+  for (size_t start = 0; start < chunk.size(); start += 255) {
+    size_t stop = std::min(chunk.size(), start + 255);
+    uint8_t found = 0;
+    for (size_t i = start; i < stop; i++) {
+      found += chunk[i] == '\n';
+    }
+    lines += found;
+  }
+  if (!chunk.empty() && chunk.back() != '\n') {
+    lines++;
+  }
+  return lines;
+}
+
+// Parses every line of |chunk| into the columns starting at |first|. Returns
+// the number of valid rows written; |rejected| receives the rest.
+size_t ParseChunk(std::string_view chunk, TickColumns* out, size_t first,
+                  uint64_t* rejected) {
+  PairCache cache;
+  int64_t* timestamps = out->timestamps.data() + first;
+  uint32_t* pairs = out->pairs.data() + first;
+  int64_t* rates = out->rates.data() + first;
+  size_t rows = 0;
+  const char* p = chunk.data();
+  const char* end = p + chunk.size();
+  while (p != end) {
+    if (*p == '\n' || *p == '\r') {
+      p++;
+      continue;
+    }
+    if (ParseLine(p, end, &cache, &timestamps[rows], &pairs[rows],
+                  &rates[rows], &p)) {
+      rows++;
+    } else {
+      (*rejected)++;
+    }
+  }
+  return rows;
+}
+
+// Runs |task|(i) for i in [0, count) on the shared thread pool, with the
+// calling thread taking part.
+template <typename Task>
+void RunParallel(size_t count, Task&& task) {
+  ThreadPool::Get().ParallelFor(count, 1, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      task(i);
+    }
+  });
+}
+
+}  // namespace
+
+void ParseWindow(std::string_view data, unsigned threads, TickColumns* out,
+                 TickIngestStats* stats) {
+  if (data.empty()) {
+    return;
+  }
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  size_t chunk_count =
+      std::max<size_t>(1, std::min<size_t>(threads, data.size() / kMinChunkSize));
+
+  // Split at the first line break after each even share of the input.
+  std::vector<std::string_view> chunks;
+  size_t start = 0;
+  for (size_t i = 1; i <= chunk_count && start < data.size(); i++) {
+    size_t stop = data.size() * i / chunk_count;
+    if (i == chunk_count) {
+      stop = data.size();
+    } else {
+      stop = std::max(stop, start);
+      size_t newline = data.find('\n', stop);
+      stop = newline == std::string_view::npos ? data.size() : newline + 1;
+    }
+    chunks.push_back(data.substr(start, stop - start));
+    start = stop;
+  }
+
+  // Counting lines first lets every chunk parse straight into its own slice
+  // of the output, so the columns are never copied or merged afterwards.
+  std::vector<size_t> offsets(chunks.size() + 1, out->size());
+  std::vector<size_t> rows(chunks.size());
+  std::vector<uint64_t> rejected(chunks.size());
+  RunParallel(chunks.size(), [&](size_t i) { rows[i] = CountLines(chunks[i]); });
+  for (size_t i = 0; i < chunks.size(); i++) {
+    offsets[i + 1] = offsets[i] + rows[i];
+  }
+  out->resize(offsets.back());
+  RunParallel(chunks.size(), [&](size_t i) {
+    rows[i] = ParseChunk(chunks[i], out, offsets[i], &rejected[i]);
+  });
+
+  // Close the gaps left by rejected and blank lines.
+  size_t size = offsets[0];
+  for (size_t i = 0; i < chunks.size(); i++) {
+    if (size != offsets[i]) {
+      std::copy_n(out->timestamps.begin() + offsets[i], rows[i],
+                  out->timestamps.begin() + size);
+      std::copy_n(out->pairs.begin() + offsets[i], rows[i],
+                  out->pairs.begin() + size);
+      std::copy_n(out->rates.begin() + offsets[i], rows[i],
+                  out->rates.begin() + size);
+    }
+    size += rows[i];
+    stats->rows += rows[i];
+    stats->rejected += rejected[i];
+  }
+  out->resize(size);
+  stats->bytes += data.size();
+}
+
+std::string_view SkipHeader(std::string_view data, TickIngestStats* stats) {
+  if (!data.empty() && static_cast<unsigned>(data.front() - '0') >= 10 &&
+      data.front() != '-') {
+    size_t newline = data.find('\n');
+    size_t skip = newline == std::string_view::npos ? data.size() : newline + 1;
+    stats->bytes += skip;
+    data.remove_prefix(skip);
+  }
+  return data;
+}
+
+void ParseTicks(std::string_view data, unsigned threads, TickColumns* out,
+                TickIngestStats* stats) {
+  ParseWindow(SkipHeader(data, stats), threads, out, stats);
+}
+
+bool IngestTickFile(const char* path, unsigned threads, TickColumns* out,
+                    TickIngestStats* stats) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+    bool ok = IngestTickStream(fd, threads, out, stats);
+    close(fd);
+    return ok;
+  }
+  if (info.st_size == 0) {
+    close(fd);
+    return true;
+  }
+  void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    return false;
+  }
+  // Each thread reads its chunk front to back.
+  madvise(mapped, info.st_size, MADV_SEQUENTIAL);
+  ParseTicks(std::string_view(static_cast<const char*>(mapped), info.st_size),
+             threads, out, stats);
+  munmap(mapped, info.st_size);
+  return true;
+}
+
+bool IngestTickStream(int fd, unsigned threads, TickColumns* out,
+                      TickIngestStats* stats) {
+  std::vector<char> window(kStreamWindowSize);
+  size_t filled = 0;
+  bool first_window = true;
+  bool skipping_long_line = false;
+  while (true) {
+    ssize_t count = read(fd, window.data() + filled, window.size() - filled);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    filled += count;
+    bool at_end = count == 0;
+    if (!at_end && filled < window.size()) {
+      continue;
+    }
+
+    std::string_view data(window.data(), filled);
+    if (skipping_long_line) {
+      size_t newline = data.find('\n');
+      if (newline == std::string_view::npos && !at_end) {
+        stats->bytes += filled;
+        filled = 0;
+        continue;
+      }
+      size_t skip = newline == std::string_view::npos ? filled : newline + 1;
+      stats->bytes += skip;
+      data.remove_prefix(skip);
+      skipping_long_line = false;
+    }
+    if (first_window) {
+      data = SkipHeader(data, stats);
+      first_window = false;
+    }
+
+    size_t complete = data.size();
+    if (!at_end) {
+      size_t newline = data.rfind('\n');
+      if (newline == std::string_view::npos) {
+        // A line fills the whole window; drop it.
+        stats->rejected++;
+        stats->bytes += data.size();
+        skipping_long_line = true;
+        filled = 0;
+        continue;
+      }
+      complete = newline + 1;
+    }
+    ParseWindow(data.substr(0, complete), threads, out, stats);
+    if (at_end) {
+      return true;
+    }
+    std::string_view rest = data.substr(complete);
+    memmove(window.data(), rest.data(), rest.size());
+    filled = rest.size();
+  }
+}
+
+}  // namespace converter
@@ -0,0 +1,58 @@
+#ifndef CONVERTER_ENGINE_TICK_CSV_H_
+#define CONVERTER_ENGINE_TICK_CSV_H_
+
+#include <cstdint>
+#include <string_view>
+
+#include "tick.h"
+
+namespace converter {
+
+struct TickIngestStats {
+  // Input bytes consumed.
+  uint64_t bytes = 0;
+  // Quotes appended to the output, excluding an optional header.
+  uint64_t rows = 0;
+  // Lines that were not valid quotes. They are dropped.
+  uint64_t rejected = 0;
+};
+
+// Parses tick lines of the form "timestamp,pair,rate", for example
+// "1700000000123,EURUSD,1.08345" or "1700000000123,EUR/USD,1.08345", and
+// appends them to |out|. The timestamp is an integer whose unit is up to the
+// producer; rates are converted exactly to kRateScale fixed point.
+//
+// |data| is split at line boundaries into one chunk per thread and the chunks
+// are parsed in parallel, each straight into its slice of the output columns.
+// A first line that does not start with a digit is skipped as a header.
+// |threads| == 0 uses one thread per hardware core.
+void ParseTicks(std::string_view data, unsigned threads, TickColumns* out,
+                TickIngestStats* stats);
+
+// The two halves of ParseTicks, for inputs read in pieces, such as a stream
+// or a live feed, of which only the first can start with a header.
+//
+// SkipHeader returns |data| without its first line if that does not start
+// with a digit or '-', counting the line's bytes in |stats|. ParseWindow
+// parses |data|, which holds whole lines only, in parallel, rejecting any
+// line that is not a quote.
+std::string_view SkipHeader(std::string_view data, TickIngestStats* stats);
+void ParseWindow(std::string_view data, unsigned threads, TickColumns* out,
+                 TickIngestStats* stats);
+
+// Maps the file at |path| into memory and parses it with ParseTicks. Inputs
+// that cannot be mapped, such as pipes, are streamed instead. Returns false if
+// the file cannot be opened or read.
+bool IngestTickFile(const char* path, unsigned threads, TickColumns* out,
+                    TickIngestStats* stats);
+
+// Reads |fd| to the end in fixed windows (64 MiB) and parses each window in
+// parallel, so memory use besides |out| does not depend on the input size.
+// Lines longer than a window are counted as rejected. Returns false on a read
+// error.
+bool IngestTickStream(int fd, unsigned threads, TickColumns* out,
+                      TickIngestStats* stats);
+
+}  // namespace converter
+
+#endif  // CONVERTER_ENGINE_TICK_CSV_H_
@@ -0,0 +1,192 @@
+#include "live_channel.h"
+
+#include <cstring>
+#include <vector>
+
+#include "channel_util.h"
+#include "engine/amount_format.h"
+#include "engine/live_conversion.h"
+#include "engine/metrics.h"
+#include "metrics_channel.h"
+
+struct _LiveChannel {
+  GObject parent_instance;
+  FlMethodChannel* channel;
+  FlEventChannel* results_channel;
+  GtkWidget* view;
+  converter::LiveConversions* live;
+  // Reused between frames so a flush does not allocate once warm.
+  std::vector<converter::LiveResult>* results;
+  // The tick callback on |view|, installed only while input is pending, or
+  // 0.
+  guint tick_id;
+  gboolean listening;
+};
+
+G_DEFINE_TYPE(LiveChannel, live_channel, G_TYPE_OBJECT)
+
+static constexpr char kChannelName[] = "currency_converter/live";
+static constexpr char kResultsChannelName[] = "currency_converter/live_results";
+
+// Sends the results of every field updated since the last frame as one
+// event: a list of {field, sequence} maps, each with either {minor,
+// minorUnits, text} or an "error" code.
+static void send_results(LiveChannel* self) {
+  self->results->clear();
+  self->live->Flush(self->results);
+  if (!self->listening) {
+    return;
+  }
+
+  g_autoptr(FlValue) event = fl_value_new_list();
+  for (const converter::LiveResult& result : *self->results) {
+    FlValue* entry = fl_value_new_map();
+    fl_value_set_string_take(entry, "field", fl_value_new_int(result.field));
+    fl_value_set_string_take(entry, "sequence",
+                             fl_value_new_int(result.sequence));
+    if (result.status == converter::Status::kOk) {
+      fl_value_set_string_take(entry, "minor", fl_value_new_int(result.minor));
+      fl_value_set_string_take(entry, "minorUnits",
+                               fl_value_new_int(result.minor_units));
+      fl_value_set_string_take(entry, "text",
+                               fl_value_new_string(result.text.c_str()));
+    } else {
+      fl_value_set_string_take(
+          entry, "error",
+          fl_value_new_string(status_error_code(result.status)));
+    }
+    fl_value_append_take(event, entry);
+  }
+  g_autoptr(GError) error = nullptr;
+  if (!fl_event_channel_send(self->results_channel, event, nullptr, &error)) {
+    g_warning("Failed to send live results: %s", error->message);
+  }
+}
+
+// Runs once per frame while input is pending. Everything typed since the
+// previous frame has been coalesced by then, so each field is converted
+// once, and the callback removes itself until more input arrives.
+static gboolean tick_cb(GtkWidget* widget, GdkFrameClock* frame_clock,
+                        gpointer user_data) {
+  LiveChannel* self = LIVE_CHANNEL(user_data);
+  self->tick_id = 0;
+  send_results(self);
+  return G_SOURCE_REMOVE;
+}
+
+// Handles "update" with arguments {field, sequence, amount, from, to} and an
+// optional "locale". "field" identifies the input, and "sequence" increases
+// with every edit of it and comes back with the result. Responds at once
+// with null; the conversion follows on the results channel, and is skipped
+// entirely if the field changes again before the next frame.
+static FlMethodResponse* update(LiveChannel* self, FlValue* args) {
+  if (args == nullptr || fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
+    return invalid_arguments_response("Expected a map of arguments");
+  }
+  FlValue* field = lookup_typed(args, "field", FL_VALUE_TYPE_INT);
+  FlValue* sequence = lookup_typed(args, "sequence", FL_VALUE_TYPE_INT);
+  FlValue* amount = lookup_typed(args, "amount", FL_VALUE_TYPE_STRING);
+  FlValue* from = lookup_typed(args, "from", FL_VALUE_TYPE_STRING);
+  FlValue* to = lookup_typed(args, "to", FL_VALUE_TYPE_STRING);
+  if (field == nullptr || sequence == nullptr || amount == nullptr ||
+      from == nullptr || to == nullptr) {
+    return invalid_arguments_response(
+        "Expected field, sequence, amount, from and to");
+  }
+  FlValue* locale = lookup_typed(args, "locale", FL_VALUE_TYPE_STRING);
+
+  converter::LiveRequest request;
+  request.field = static_cast<uint32_t>(fl_value_get_int(field));
+  request.sequence = fl_value_get_int(sequence);
+  request.amount = fl_value_get_string(amount);
+  request.from = converter::FindCurrency(fl_value_get_string(from));
+  request.to = converter::FindCurrency(fl_value_get_string(to));
+  request.format = &converter::NumberFormatForLocale(
+      locale != nullptr ? fl_value_get_string(locale) : "");
+  if (self->live->Update(std::move(request)) && self->tick_id == 0) {
+    self->tick_id =
+        gtk_widget_add_tick_callback(self->view, tick_cb, self, nullptr);
+  }
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+}
+
+// Called when a method call is received from Flutter.
+static void method_call_cb(FlMethodChannel* channel, FlMethodCall* method_call,
+                           gpointer user_data) {
+  LiveChannel* self = LIVE_CHANNEL(user_data);
+  uint64_t start = converter::MetricsClock();
+  const gchar* method = fl_method_call_get_name(method_call);
+  FlValue* args = fl_method_call_get_args(method_call);
+
+  g_autoptr(FlMethodResponse) response = nullptr;
+  if (strcmp(method, "update") == 0) {
+    response = update(self, args);
+  } else {
+    response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+  }
+
+  g_autoptr(GError) error = nullptr;
+  if (!fl_method_call_respond(method_call, response, &error)) {
+    g_warning("Failed to send response: %s", error->message);
+  }
+  metrics_channel_record_call(kChannelName, method, start, response);
+}
+
+static FlMethodErrorResponse* listen_cb(FlEventChannel* channel, FlValue* args,
+                                        gpointer user_data) {
+  LIVE_CHANNEL(user_data)->listening = TRUE;
+  return nullptr;
+}
+
+static FlMethodErrorResponse* cancel_cb(FlEventChannel* channel, FlValue* args,
+                                        gpointer user_data) {
+  LIVE_CHANNEL(user_data)->listening = FALSE;
+  return nullptr;
+}
+
+static void live_channel_dispose(GObject* object) {
+  LiveChannel* self = LIVE_CHANNEL(object);
+  if (self->tick_id != 0) {
+    gtk_widget_remove_tick_callback(self->view, self->tick_id);
+    self->tick_id = 0;
+  }
+  g_clear_object(&self->channel);
+  g_clear_object(&self->results_channel);
+  g_clear_object(&self->view);
+  G_OBJECT_CLASS(live_channel_parent_class)->dispose(object);
+}
+
+static void live_channel_finalize(GObject* object) {
+  LiveChannel* self = LIVE_CHANNEL(object);
+  delete self->live;
+  delete self->results;
+  G_OBJECT_CLASS(live_channel_parent_class)->finalize(object);
+}
+
+static void live_channel_class_init(LiveChannelClass* klass) {
+  G_OBJECT_CLASS(klass)->dispose = live_channel_dispose;
+  G_OBJECT_CLASS(klass)->finalize = live_channel_finalize;
+}
+
+static void live_channel_init(LiveChannel* self) {}
+
+LiveChannel* live_channel_new(FlBinaryMessenger* messenger,
+                              converter::ConversionEngine* engine,
+                              GtkWidget* view) {
+  LiveChannel* self =
+      LIVE_CHANNEL(g_object_new(live_channel_get_type(), nullptr));
+  self->view = GTK_WIDGET(g_object_ref(view));
+  self->live = new converter::LiveConversions(engine);
+  self->results = new std::vector<converter::LiveResult>();
+
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  self->channel = fl_method_channel_new(messenger, kChannelName,
+                                        FL_METHOD_CODEC(codec));
+  fl_method_channel_set_method_call_handler(self->channel, method_call_cb,
+                                            self, nullptr);
+  self->results_channel = fl_event_channel_new(
+      messenger, kResultsChannelName, FL_METHOD_CODEC(codec));
+  fl_event_channel_set_stream_handlers(self->results_channel, listen_cb,
+                                       cancel_cb, self, nullptr);
+  return self;
+}
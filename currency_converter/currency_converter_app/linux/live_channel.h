@@ -0,0 +1,28 @@
+#ifndef FLUTTER_LIVE_CHANNEL_H_
+#define FLUTTER_LIVE_CHANNEL_H_
+
+#include <flutter_linux/flutter_linux.h>
+#include <gtk/gtk.h>
+
+#include "engine/conversion_engine.h"
+
+G_DECLARE_FINAL_TYPE(LiveChannel, live_channel, LIVE, CHANNEL, GObject)
+
+/**
+ * live_channel_new:
+ * @messenger: an #FlBinaryMessenger to register the channels on.
+ * @engine: the native conversion engine to serve. Must outlive the channel.
+ * @view: the widget whose frame clock paces result delivery.
+ *
+ * Creates the "currency_converter/live" method channel, which takes the
+ * latest text of live-converted input fields, and the
+ * "currency_converter/live_results" event channel, which delivers their
+ * conversions at most once per frame of @view.
+ *
+ * Returns: a new #LiveChannel.
+ */
+LiveChannel* live_channel_new(FlBinaryMessenger* messenger,
+                              converter::ConversionEngine* engine,
+                              GtkWidget* view);
+
+#endif  // FLUTTER_LIVE_CHANNEL_H_
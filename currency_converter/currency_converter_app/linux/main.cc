@@ -1,6 +1,9 @@
 #include "my_application.h"
+#include "startup_trace.h"
 
 int main(int argc, char** argv) {
+  // Spans until Flutter's first frame, see startup_trace_first_frame().
+  startup_trace_begin("startup");
   g_autoptr(MyApplication) app = my_application_new();
   return g_application_run(G_APPLICATION(app), argc, argv);
 }
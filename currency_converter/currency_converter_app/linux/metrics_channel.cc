@@ -0,0 +1,199 @@
+#include "metrics_channel.h"
+
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "engine/metrics.h"
+#include "engine/metrics_server.h"
+
+struct _MetricsChannel {
+  GObject parent_instance;
+  FlMethodChannel* channel;
+  converter::MetricsServer* server;
+};
+
+G_DEFINE_TYPE(MetricsChannel, metrics_channel, G_TYPE_OBJECT)
+
+static constexpr char kChannelName[] = "currency_converter/metrics";
+
+static constexpr char kChannelPrefix[] = "currency_converter/";
+
+// Metrics of the calls of one method.
+struct CallMetrics {
+  const gchar* channel;
+  std::string method;
+  converter::MetricId latency;
+  converter::MetricId errors;
+};
+
+// Returns the metrics of |method| on |channel|, registering them on first
+// use. Channels pass their static name, so it is compared by address.
+static const CallMetrics& call_metrics(const gchar* channel,
+                                       const gchar* method) {
+  static std::vector<CallMetrics>* registered = new std::vector<CallMetrics>();
+  for (const CallMetrics& metrics : *registered) {
+    if (metrics.channel == channel && metrics.method == method) {
+      return metrics;
+    }
+  }
+  const gchar* short_name = g_str_has_prefix(channel, kChannelPrefix)
+                                ? channel + strlen(kChannelPrefix)
+                                : channel;
+  g_autofree gchar* labels =
+      g_strdup_printf("channel=\"%s\",method=\"%s\"", short_name, method);
+  converter::Metrics& metrics = converter::Metrics::Get();
+  registered->push_back({
+      channel,
+      method,
+      metrics.Register(converter::MetricKind::kLatency,
+                       "currency_converter_call_seconds",
+                       "Time spent handling a method-channel call.", labels),
+      metrics.Register(converter::MetricKind::kCounter,
+                       "currency_converter_call_errors_total",
+                       "Method-channel calls answered with an error.", labels),
+  });
+  return registered->back();
+}
+
+void metrics_channel_record_call(const gchar* channel, const gchar* method,
+                                 uint64_t start, FlMethodResponse* response) {
+  uint64_t elapsed = converter::MetricsClock() - start;
+  // Dart decides the method names; only count the ones that exist.
+  if (FL_IS_METHOD_NOT_IMPLEMENTED_RESPONSE(response)) {
+    method = "unknown";
+  }
+  const CallMetrics& metrics = call_metrics(channel, method);
+  converter::Metrics::Get().Record(metrics.latency, elapsed);
+  if (FL_IS_METHOD_ERROR_RESPONSE(response)) {
+    converter::Metrics::Get().Add(metrics.errors);
+  }
+}
+
+// Handles "read". Responds with the metrics in parallel lists, an entry
+// each: {names, kinds, counts, sums, maxes, p50, p90, p99, p999}. Names are
+// in the Prometheus form family{labels}, kinds 0 for a latency and 1 for a
+// counter. Latencies are in nanoseconds; a counter has only its total, in
+// counts.
+static FlMethodResponse* read_metrics() {
+  std::vector<converter::MetricReading> readings;
+  converter::Metrics::Get().Read(&readings);
+  size_t count = readings.size();
+  g_autoptr(FlValue) names = fl_value_new_list();
+  std::vector<uint8_t> kinds(count);
+  std::vector<int64_t> columns[7];
+  for (std::vector<int64_t>& column : columns) {
+    column.resize(count);
+  }
+  for (size_t i = 0; i < count; i++) {
+    const converter::MetricReading& reading = readings[i];
+    std::string name = reading.family;
+    if (!reading.labels.empty()) {
+      name += "{" + reading.labels + "}";
+    }
+    fl_value_append_take(names, fl_value_new_string(name.c_str()));
+    const converter::LatencyHistogram& histogram = reading.histogram;
+    bool latency = reading.kind == converter::MetricKind::kLatency;
+    kinds[i] = latency ? 0 : 1;
+    columns[0][i] = latency ? histogram.count() : reading.total;
+    columns[1][i] = histogram.sum();
+    columns[2][i] = histogram.max();
+    columns[3][i] = histogram.Quantile(0.5);
+    columns[4][i] = histogram.Quantile(0.9);
+    columns[5][i] = histogram.Quantile(0.99);
+    columns[6][i] = histogram.Quantile(0.999);
+  }
+  static constexpr const char* kColumnNames[] = {
+      "counts", "sums", "maxes", "p50", "p90", "p99", "p999"};
+  g_autoptr(FlValue) result = fl_value_new_map();
+  fl_value_set_string_take(result, "names", fl_value_ref(names));
+  fl_value_set_string_take(result, "kinds",
+                           fl_value_new_uint8_list(kinds.data(), count));
+  for (size_t i = 0; i < 7; i++) {
+    fl_value_set_string_take(
+        result, kColumnNames[i],
+        fl_value_new_int64_list(columns[i].data(), count));
+  }
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// Handles "prometheus". Responds with the metrics as served on the socket.
+static FlMethodResponse* prometheus() {
+  std::string text;
+  converter::Metrics::Get().WritePrometheus(&text);
+  g_autoptr(FlValue) result = fl_value_new_string(text.c_str());
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// Called when a method call is received from Flutter.
+static void method_call_cb(FlMethodChannel* channel, FlMethodCall* method_call,
+                           gpointer user_data) {
+  const gchar* method = fl_method_call_get_name(method_call);
+
+  g_autoptr(FlMethodResponse) response = nullptr;
+  if (strcmp(method, "read") == 0) {
+    response = read_metrics();
+  } else if (strcmp(method, "prometheus") == 0) {
+    response = prometheus();
+  } else {
+    response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+  }
+
+  g_autoptr(GError) error = nullptr;
+  if (!fl_method_call_respond(method_call, response, &error)) {
+    g_warning("Failed to send response: %s", error->message);
+  }
+}
+
+gchar* metrics_channel_socket_path() {
+  g_autofree gchar* name =
+      g_strdup_printf("metrics-%d.sock", static_cast<int>(getpid()));
+  return g_build_filename(g_get_user_runtime_dir(), "currency_converter", name,
+                          nullptr);
+}
+
+static void metrics_channel_dispose(GObject* object) {
+  MetricsChannel* self = METRICS_CHANNEL(object);
+  g_clear_object(&self->channel);
+  if (self->server != nullptr) {
+    self->server->Stop();
+  }
+  G_OBJECT_CLASS(metrics_channel_parent_class)->dispose(object);
+}
+
+static void metrics_channel_finalize(GObject* object) {
+  MetricsChannel* self = METRICS_CHANNEL(object);
+  delete self->server;
+  G_OBJECT_CLASS(metrics_channel_parent_class)->finalize(object);
+}
+
+static void metrics_channel_class_init(MetricsChannelClass* klass) {
+  G_OBJECT_CLASS(klass)->dispose = metrics_channel_dispose;
+  G_OBJECT_CLASS(klass)->finalize = metrics_channel_finalize;
+}
+
+static void metrics_channel_init(MetricsChannel* self) {
+  self->server = new converter::MetricsServer();
+}
+
+MetricsChannel* metrics_channel_new(FlBinaryMessenger* messenger) {
+  MetricsChannel* self =
+      METRICS_CHANNEL(g_object_new(metrics_channel_get_type(), nullptr));
+
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  self->channel = fl_method_channel_new(messenger, kChannelName,
+                                        FL_METHOD_CODEC(codec));
+  fl_method_channel_set_method_call_handler(self->channel, method_call_cb,
+                                            self, nullptr);
+
+  g_autofree gchar* path = metrics_channel_socket_path();
+  g_autofree gchar* directory = g_path_get_dirname(path);
+  g_mkdir_with_parents(directory, 0700);
+  if (!self->server->Start(path)) {
+    g_warning("Failed to serve metrics on %s: %s", path, strerror(errno));
+  }
+  return self;
+}
@@ -0,0 +1,51 @@
+#ifndef FLUTTER_METRICS_CHANNEL_H_
+#define FLUTTER_METRICS_CHANNEL_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+#include <cstdint>
+
+G_DECLARE_FINAL_TYPE(MetricsChannel, metrics_channel, METRICS, CHANNEL,
+                     GObject)
+
+/**
+ * metrics_channel_socket_path:
+ *
+ * Gets the Unix socket on which this process serves its metrics in the
+ * Prometheus text format. The process id is part of the name, since several
+ * instances may run at once.
+ *
+ * Returns: (transfer full): a path under the user runtime directory.
+ */
+gchar* metrics_channel_socket_path();
+
+/**
+ * metrics_channel_new:
+ * @messenger: an #FlBinaryMessenger to register the channel on.
+ *
+ * Creates the "currency_converter/metrics" method channel, on which Dart
+ * reads the latency histograms and counters of the native side, and starts
+ * serving them on metrics_channel_socket_path() until the channel is
+ * disposed.
+ *
+ * Returns: a new #MetricsChannel.
+ */
+MetricsChannel* metrics_channel_new(FlBinaryMessenger* messenger);
+
+/**
+ * metrics_channel_record_call:
+ * @channel: the name of the channel the call came in on.
+ * @method: the name of the method called.
+ * @start: converter::MetricsClock() when the call was dispatched.
+ * @response: the response sent.
+ *
+ * Records the latency of a method call up to now, and counts it as failed
+ * if @response is an error. A call answered later, from another thread's
+ * work, is recorded when its response is sent. Calls of methods the channel
+ * does not implement are recorded under the method "unknown". Must be
+ * called on the main thread.
+ */
+void metrics_channel_record_call(const gchar* channel, const gchar* method,
+                                 uint64_t start, FlMethodResponse* response);
+
+#endif  // FLUTTER_METRICS_CHANNEL_H_
@@ -5,18 +5,61 @@
 #include <gdk/gdkx.h>
 #endif
 
+#include "alert_channel.h"
+#include "batch_mode.h"
+#include "candle_channel.h"
+#include "converter_channel.h"
+#include "engine/conversion_engine.h"
+#include "engine/rate_snapshot.h"
 #include "flutter/generated_plugin_registrant.h"
+#include "live_channel.h"
+#include "metrics_channel.h"
+#include "portfolio_channel.h"
+#include "rate_feed_channel.h"
+#include "session_channel.h"
+#include "startup_trace.h"
 
 struct _MyApplication {
   GtkApplication parent_instance;
   char** dart_entrypoint_arguments;
+  converter::ConversionEngine* conversion_engine;
+  ConverterChannel* converter_channel;
+  AlertChannel* alert_channel;
+  CandleChannel* candle_channel;
+  LiveChannel* live_channel;
+  MetricsChannel* metrics_channel;
+  PortfolioChannel* portfolio_channel;
+  RateFeedChannel* rate_feed_channel;
+  SessionChannel* session_channel;
 };
 
 G_DEFINE_TYPE(MyApplication, my_application, GTK_TYPE_APPLICATION)
 
+// Ends the start-up trace once Flutter has drawn.
+static void first_frame_cb(FlView* view) {
+  startup_trace_first_frame();
+}
+
+static gboolean first_tick_cb(GtkWidget* widget, GdkFrameClock* frame_clock,
+                              gpointer user_data) {
+  startup_trace_first_frame();
+  return G_SOURCE_REMOVE;
+}
+
 // Implements GApplication::activate.
 static void my_application_activate(GApplication* application) {
   MyApplication* self = MY_APPLICATION(application);
+
+  // The previous session's rates make the first conversion available before
+  // any feed connects.
+  startup_trace_begin("snapshot_load");
+  converter::RateSnapshot restored;
+  g_autofree gchar* snapshot_path = session_channel_snapshot_path();
+  gboolean have_snapshot = converter::LoadRateSnapshot(
+      snapshot_path, &self->conversion_engine->rates(), &restored);
+  startup_trace_end();
+
+  startup_trace_begin("window");
   GtkWindow* window =
       GTK_WINDOW(gtk_application_window_new(GTK_APPLICATION(application)));
 
@@ -49,15 +92,80 @@ static void my_application_activate(GApplication* application) {
 
   gtk_window_set_default_size(window, 1280, 720);
   gtk_widget_show(GTK_WIDGET(window));
+  startup_trace_end();
 
+  startup_trace_begin("fl_dart_project_new");
   g_autoptr(FlDartProject) project = fl_dart_project_new();
   fl_dart_project_set_dart_entrypoint_arguments(project, self->dart_entrypoint_arguments);
+  startup_trace_end();
 
+  startup_trace_begin("fl_view_new");
   FlView* view = fl_view_new(project);
   gtk_widget_show(GTK_WIDGET(view));
   gtk_container_add(GTK_CONTAINER(window), GTK_WIDGET(view));
+  startup_trace_end();
+  // Embedders without the "first-frame" signal get the view's first frame
+  // clock tick instead, which comes slightly before Flutter's frame.
+  if (g_signal_lookup("first-frame", fl_view_get_type()) != 0) {
+    g_signal_connect(view, "first-frame", G_CALLBACK(first_frame_cb),
+                     nullptr);
+  } else {
+    gtk_widget_add_tick_callback(GTK_WIDGET(view), first_tick_cb, nullptr,
+                                 nullptr);
+  }
 
+  startup_trace_begin("fl_register_plugins");
   fl_register_plugins(FL_PLUGIN_REGISTRY(view));
+  startup_trace_end();
+
+  startup_trace_begin("channels");
+  // Serve conversions natively so they do not run on the Dart UI thread.
+  FlEngine* engine = fl_view_get_engine(view);
+  g_clear_object(&self->converter_channel);
+  self->converter_channel = converter_channel_new(
+      fl_engine_get_binary_messenger(engine), self->conversion_engine);
+  // Results of live-as-you-type conversion are paced by the view's frames.
+  g_clear_object(&self->live_channel);
+  self->live_channel =
+      live_channel_new(fl_engine_get_binary_messenger(engine),
+                       self->conversion_engine, GTK_WIDGET(view));
+  // Live rates, if a feed is configured, are applied off the main thread and
+  // reach Dart as one delta per frame.
+  g_clear_object(&self->rate_feed_channel);
+  self->rate_feed_channel = rate_feed_channel_new(
+      fl_engine_get_binary_messenger(engine), self->conversion_engine,
+      GTK_WIDGET(view), g_getenv("CURRENCY_CONVERTER_RATE_FEED"));
+  // The portfolio total follows the feed, revaluing only the currencies
+  // whose rates moved.
+  g_clear_object(&self->portfolio_channel);
+  self->portfolio_channel = portfolio_channel_new(
+      fl_engine_get_binary_messenger(engine), self->conversion_engine);
+  g_signal_connect_object(self->rate_feed_channel, "rates-changed",
+                          G_CALLBACK(portfolio_channel_rates_changed),
+                          self->portfolio_channel, G_CONNECT_SWAPPED);
+  // Threshold alerts are evaluated on the same signal, so each rate update
+  // fires one batch.
+  g_clear_object(&self->alert_channel);
+  self->alert_channel = alert_channel_new(
+      fl_engine_get_binary_messenger(engine), self->conversion_engine);
+  g_signal_connect_object(self->rate_feed_channel, "rates-changed",
+                          G_CALLBACK(alert_channel_rates_changed),
+                          self->alert_channel, G_CONNECT_SWAPPED);
+  // Candles come from the history file and the quotes the feed records.
+  g_clear_object(&self->candle_channel);
+  self->candle_channel = candle_channel_new(
+      fl_engine_get_binary_messenger(engine), self->conversion_engine);
+  // Dart restores its UI state from the snapshot and hands over its own for
+  // the next one.
+  g_clear_object(&self->session_channel);
+  self->session_channel =
+      session_channel_new(fl_engine_get_binary_messenger(engine),
+                          have_snapshot ? &restored : nullptr);
+  // Latencies of the calls above, also served on a socket for scrapers.
+  g_clear_object(&self->metrics_channel);
+  self->metrics_channel =
+      metrics_channel_new(fl_engine_get_binary_messenger(engine));
+  startup_trace_end();
 
   gtk_widget_grab_focus(GTK_WIDGET(view));
 }
@@ -68,6 +176,14 @@ static gboolean my_application_local_command_line(GApplication* application, gch
   // Strip out the first argument as it is the binary name.
   self->dart_entrypoint_arguments = g_strdupv(*arguments + 1);
 
+  // Batch jobs only need the native engine, so skip registration and
+  // activation, which would bring up GTK, the Flutter engine and the Dart VM.
+  if (batch_mode_requested(self->dart_entrypoint_arguments)) {
+    *exit_status =
+        batch_mode_run(self->conversion_engine, self->dart_entrypoint_arguments);
+    return TRUE;
+  }
+
   g_autoptr(GError) error = nullptr;
   if (!g_application_register(application, nullptr, &error)) {
      g_warning("Failed to register: %s", error->message);
@@ -85,6 +201,30 @@ static gboolean my_application_local_command_line(GApplication* application, gch
 static void my_application_dispose(GObject* object) {
   MyApplication* self = MY_APPLICATION(object);
   g_clear_pointer(&self->dart_entrypoint_arguments, g_strfreev);
+  // Calls the feed queued on the main loop may still hold the channel, so
+  // dropping this reference need not dispose it; stop it explicitly.
+  if (self->rate_feed_channel != nullptr) {
+    rate_feed_channel_stop(self->rate_feed_channel);
+  }
+  // Waits for batches still converting on the thread pool.
+  g_clear_object(&self->converter_channel);
+  g_clear_object(&self->live_channel);
+  g_clear_object(&self->rate_feed_channel);
+  g_clear_object(&self->portfolio_channel);
+  g_clear_object(&self->alert_channel);
+  // Waits for candles still being built on the thread pool.
+  g_clear_object(&self->candle_channel);
+  g_clear_object(&self->metrics_channel);
+  // Only sessions that ran the UI leave a snapshot; batch jobs do not. The
+  // feed was stopped above, so holding the rates while writing blocks no
+  // publisher.
+  if (self->session_channel != nullptr && self->conversion_engine != nullptr) {
+    session_channel_save_snapshot(self->session_channel,
+                                  self->conversion_engine);
+  }
+  g_clear_object(&self->session_channel);
+  delete self->conversion_engine;
+  self->conversion_engine = nullptr;
   G_OBJECT_CLASS(my_application_parent_class)->dispose(object);
 }
 
@@ -94,7 +234,19 @@ static void my_application_class_init(MyApplicationClass* klass) {
   G_OBJECT_CLASS(klass)->dispose = my_application_dispose;
 }
 
-static void my_application_init(MyApplication* self) {}
+static void my_application_init(MyApplication* self) {
+  startup_trace_begin("engine_init");
+  self->conversion_engine = new converter::ConversionEngine();
+  self->conversion_engine->set_thread_pool(&converter::ThreadPool::Get());
+
+  // Mapping the history is cheap, so it is always done; without a file,
+  // conversions at a past time report that no history is available.
+  startup_trace_begin("history_open");
+  g_autofree gchar* history_path = batch_mode_history_path();
+  self->conversion_engine->history().Open(history_path);
+  startup_trace_end();
+  startup_trace_end();
+}
 
 MyApplication* my_application_new() {
   return MY_APPLICATION(g_object_new(my_application_get_type(),
@@ -0,0 +1,280 @@
+#include "portfolio_channel.h"
+
+#include <cstring>
+#include <vector>
+
+#include "channel_util.h"
+#include "engine/amount_format.h"
+#include "engine/metrics.h"
+#include "engine/portfolio.h"
+#include "metrics_channel.h"
+
+struct _PortfolioChannel {
+  GObject parent_instance;
+  FlMethodChannel* channel;
+  FlEventChannel* total_channel;
+  converter::ConversionEngine* engine;
+  converter::Portfolio* portfolio;
+  const converter::NumberFormat* format;
+  // What was last sent on |total_channel|, so unchanged totals are not sent
+  // again.
+  gboolean sent;
+  converter::Status sent_status;
+  int64_t sent_minor;
+  converter::CurrencyId sent_currency;
+  gboolean listening;
+};
+
+G_DEFINE_TYPE(PortfolioChannel, portfolio_channel, G_TYPE_OBJECT)
+
+static constexpr char kChannelName[] = "currency_converter/portfolio";
+static constexpr char kTotalChannelName[] =
+    "currency_converter/portfolio_total";
+
+// Brings the portfolio up to date with the engine's current rates. Only
+// the currencies whose rates or positions changed are revalued.
+static void refresh(PortfolioChannel* self) {
+  converter::RateStore::Snapshot snapshot = self->engine->rates().Read();
+  self->portfolio->Refresh(snapshot.table());
+}
+
+// Returns the total as {currency, minor, minorUnits, text}, or {currency,
+// error} if it overflowed.
+static FlValue* total_value(PortfolioChannel* self, converter::Status status,
+                            int64_t minor) {
+  converter::CurrencyId currency = self->portfolio->reporting_currency();
+  const converter::Currency& info = converter::GetCurrency(currency);
+  FlValue* value = fl_value_new_map();
+  fl_value_set_string_take(value, "currency", fl_value_new_string(info.code));
+  if (status != converter::Status::kOk) {
+    fl_value_set_string_take(value, "error", fl_value_new_string("overflow"));
+    return value;
+  }
+  char text[converter::kMaxAmountTextSize];
+  size_t length =
+      converter::FormatAmount(minor, info.minor_units, *self->format, text);
+  fl_value_set_string_take(value, "minor", fl_value_new_int(minor));
+  fl_value_set_string_take(value, "minorUnits",
+                           fl_value_new_int(info.minor_units));
+  fl_value_set_string_take(value, "text",
+                           fl_value_new_string_sized(text, length));
+  return value;
+}
+
+// Sends the total if Dart is listening and it differs from the last one
+// sent.
+static void send_total_if_changed(PortfolioChannel* self) {
+  if (!self->listening) {
+    return;
+  }
+  int64_t minor = 0;
+  converter::Status status = self->portfolio->Total(&minor);
+  converter::CurrencyId currency = self->portfolio->reporting_currency();
+  if (self->sent && status == self->sent_status && minor == self->sent_minor &&
+      currency == self->sent_currency) {
+    return;
+  }
+  self->sent = TRUE;
+  self->sent_status = status;
+  self->sent_minor = minor;
+  self->sent_currency = currency;
+
+  g_autoptr(FlValue) event = total_value(self, status, minor);
+  g_autoptr(GError) error = nullptr;
+  if (!fl_event_channel_send(self->total_channel, event, nullptr, &error)) {
+    g_warning("Failed to send the portfolio total: %s", error->message);
+  }
+}
+
+// Handles "add" with arguments {currencies, amounts}: an Int32List of
+// currency indices, as returned by "currencies" on the engine channel, and
+// an Int64List of amounts in minor units of each. Responds with the ids of
+// the new positions as an Int32List.
+static FlMethodResponse* add(PortfolioChannel* self, FlValue* args) {
+  FlValue* currencies =
+      lookup_typed(args, "currencies", FL_VALUE_TYPE_INT32_LIST);
+  FlValue* amounts = lookup_typed(args, "amounts", FL_VALUE_TYPE_INT64_LIST);
+  if (currencies == nullptr || amounts == nullptr ||
+      fl_value_get_length(currencies) != fl_value_get_length(amounts)) {
+    return invalid_arguments_response(
+        "Expected currencies as an Int32List and amounts as a matching "
+        "Int64List");
+  }
+  size_t count = fl_value_get_length(amounts);
+  const int32_t* currency_list = fl_value_get_int32_list(currencies);
+  for (size_t i = 0; i < count; i++) {
+    if (currency_list[i] < 0 ||
+        static_cast<size_t>(currency_list[i]) >= converter::CurrencyCount()) {
+      return status_error_response(converter::Status::kUnknownCurrency);
+    }
+  }
+
+  const int64_t* amount_list = fl_value_get_int64_list(amounts);
+  std::vector<int32_t> ids(count);
+  for (size_t i = 0; i < count; i++) {
+    ids[i] = static_cast<int32_t>(self->portfolio->Add(
+        static_cast<converter::CurrencyId>(currency_list[i]), amount_list[i]));
+  }
+  refresh(self);
+  send_total_if_changed(self);
+  g_autoptr(FlValue) result = fl_value_new_int32_list(ids.data(), count);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// Handles "update" with arguments {ids, amounts}, an Int32List of position
+// ids and an Int64List of their new amounts, and "remove" with {ids}. Ids
+// that do not name a position are ignored.
+static FlMethodResponse* update(PortfolioChannel* self, FlValue* args,
+                                bool remove) {
+  FlValue* ids = lookup_typed(args, "ids", FL_VALUE_TYPE_INT32_LIST);
+  FlValue* amounts = lookup_typed(args, "amounts", FL_VALUE_TYPE_INT64_LIST);
+  if (ids == nullptr ||
+      (!remove && (amounts == nullptr ||
+                   fl_value_get_length(amounts) != fl_value_get_length(ids)))) {
+    return invalid_arguments_response(
+        remove ? "Expected ids as an Int32List"
+               : "Expected ids as an Int32List and amounts as a matching "
+                 "Int64List");
+  }
+  size_t count = fl_value_get_length(ids);
+  const int32_t* id_list = fl_value_get_int32_list(ids);
+  for (size_t i = 0; i < count; i++) {
+    converter::PositionId id = static_cast<converter::PositionId>(id_list[i]);
+    if (remove) {
+      self->portfolio->Remove(id);
+    } else {
+      self->portfolio->Update(id, fl_value_get_int64_list(amounts)[i]);
+    }
+  }
+  refresh(self);
+  send_total_if_changed(self);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+}
+
+// Handles "setReportingCurrency" with arguments {currency} and an optional
+// "locale" the total text is formatted for.
+static FlMethodResponse* set_reporting_currency(PortfolioChannel* self,
+                                                FlValue* args) {
+  FlValue* currency = lookup_typed(args, "currency", FL_VALUE_TYPE_STRING);
+  if (currency == nullptr) {
+    return invalid_arguments_response("Expected currency");
+  }
+  if (!self->portfolio->set_reporting_currency(
+          converter::FindCurrency(fl_value_get_string(currency)))) {
+    return status_error_response(converter::Status::kUnknownCurrency);
+  }
+  FlValue* locale = lookup_typed(args, "locale", FL_VALUE_TYPE_STRING);
+  if (locale != nullptr) {
+    self->format = &converter::NumberFormatForLocale(fl_value_get_string(locale));
+    // The text changes even if the amount does not.
+    self->sent = FALSE;
+  }
+  refresh(self);
+  send_total_if_changed(self);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+}
+
+// Handles "total". Responds with the current total, as sent on the total
+// channel.
+static FlMethodResponse* total(PortfolioChannel* self) {
+  refresh(self);
+  int64_t minor = 0;
+  converter::Status status = self->portfolio->Total(&minor);
+  g_autoptr(FlValue) result = total_value(self, status, minor);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// Called when a method call is received from Flutter.
+static void method_call_cb(FlMethodChannel* channel, FlMethodCall* method_call,
+                           gpointer user_data) {
+  PortfolioChannel* self = PORTFOLIO_CHANNEL(user_data);
+  uint64_t start = converter::MetricsClock();
+  const gchar* method = fl_method_call_get_name(method_call);
+  FlValue* args = fl_method_call_get_args(method_call);
+
+  g_autoptr(FlMethodResponse) response = nullptr;
+  if (strcmp(method, "add") == 0) {
+    response = add(self, args);
+  } else if (strcmp(method, "update") == 0) {
+    response = update(self, args, false);
+  } else if (strcmp(method, "remove") == 0) {
+    response = update(self, args, true);
+  } else if (strcmp(method, "setReportingCurrency") == 0) {
+    response = set_reporting_currency(self, args);
+  } else if (strcmp(method, "total") == 0) {
+    response = total(self);
+  } else {
+    response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+  }
+
+  g_autoptr(GError) error = nullptr;
+  if (!fl_method_call_respond(method_call, response, &error)) {
+    g_warning("Failed to send response: %s", error->message);
+  }
+  metrics_channel_record_call(kChannelName, method, start, response);
+}
+
+// Starts the stream with the current total.
+static FlMethodErrorResponse* listen_cb(FlEventChannel* channel, FlValue* args,
+                                        gpointer user_data) {
+  PortfolioChannel* self = PORTFOLIO_CHANNEL(user_data);
+  self->listening = TRUE;
+  self->sent = FALSE;
+  refresh(self);
+  send_total_if_changed(self);
+  return nullptr;
+}
+
+static FlMethodErrorResponse* cancel_cb(FlEventChannel* channel, FlValue* args,
+                                        gpointer user_data) {
+  PORTFOLIO_CHANNEL(user_data)->listening = FALSE;
+  return nullptr;
+}
+
+void portfolio_channel_rates_changed(PortfolioChannel* self) {
+  if (self->portfolio->size() == 0) {
+    return;
+  }
+  refresh(self);
+  send_total_if_changed(self);
+}
+
+static void portfolio_channel_dispose(GObject* object) {
+  PortfolioChannel* self = PORTFOLIO_CHANNEL(object);
+  g_clear_object(&self->channel);
+  g_clear_object(&self->total_channel);
+  G_OBJECT_CLASS(portfolio_channel_parent_class)->dispose(object);
+}
+
+static void portfolio_channel_finalize(GObject* object) {
+  PortfolioChannel* self = PORTFOLIO_CHANNEL(object);
+  delete self->portfolio;
+  G_OBJECT_CLASS(portfolio_channel_parent_class)->finalize(object);
+}
+
+static void portfolio_channel_class_init(PortfolioChannelClass* klass) {
+  G_OBJECT_CLASS(klass)->dispose = portfolio_channel_dispose;
+  G_OBJECT_CLASS(klass)->finalize = portfolio_channel_finalize;
+}
+
+static void portfolio_channel_init(PortfolioChannel* self) {}
+
+PortfolioChannel* portfolio_channel_new(FlBinaryMessenger* messenger,
+                                        converter::ConversionEngine* engine) {
+  PortfolioChannel* self =
+      PORTFOLIO_CHANNEL(g_object_new(portfolio_channel_get_type(), nullptr));
+  self->engine = engine;
+  self->portfolio = new converter::Portfolio();
+  self->format = &converter::NumberFormatForLocale("");
+
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  self->channel = fl_method_channel_new(messenger, kChannelName,
+                                        FL_METHOD_CODEC(codec));
+  fl_method_channel_set_method_call_handler(self->channel, method_call_cb,
+                                            self, nullptr);
+  self->total_channel = fl_event_channel_new(messenger, kTotalChannelName,
+                                             FL_METHOD_CODEC(codec));
+  fl_event_channel_set_stream_handlers(self->total_channel, listen_cb,
+                                       cancel_cb, self, nullptr);
+  return self;
+}
@@ -0,0 +1,37 @@
+#ifndef FLUTTER_PORTFOLIO_CHANNEL_H_
+#define FLUTTER_PORTFOLIO_CHANNEL_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+#include "engine/conversion_engine.h"
+
+G_DECLARE_FINAL_TYPE(PortfolioChannel, portfolio_channel, PORTFOLIO, CHANNEL,
+                     GObject)
+
+/**
+ * portfolio_channel_new:
+ * @messenger: an #FlBinaryMessenger to register the channels on.
+ * @engine: the native conversion engine whose rates value the portfolio.
+ * Must outlive the channel.
+ *
+ * Creates the "currency_converter/portfolio" method channel, which holds a
+ * portfolio of positions in native code, and the
+ * "currency_converter/portfolio_total" event channel, which sends its total
+ * whenever it changes.
+ *
+ * Returns: a new #PortfolioChannel.
+ */
+PortfolioChannel* portfolio_channel_new(FlBinaryMessenger* messenger,
+                                        converter::ConversionEngine* engine);
+
+/**
+ * portfolio_channel_rates_changed:
+ * @self: a #PortfolioChannel.
+ *
+ * Revalues the positions in the currencies whose rates changed, and sends
+ * the new total if it moved. Connect it to the "rates-changed" signal of a
+ * #RateFeedChannel.
+ */
+void portfolio_channel_rates_changed(PortfolioChannel* self);
+
+#endif  // FLUTTER_PORTFOLIO_CHANNEL_H_
@@ -0,0 +1,358 @@
+#include "rate_feed_channel.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "engine/arbitrage.h"
+#include "engine/rate_feed.h"
+#include "engine/shared_rates.h"
+
+struct _RateFeedChannel {
+  GObject parent_instance;
+  FlEventChannel* channel;
+  FlEventChannel* arbitrage_channel;
+  GtkWidget* view;
+  converter::ConversionEngine* engine;
+  converter::RateFeed* feed;
+  // Checks the quotes |feed| reads for cycles, on the feed thread.
+  converter::ArbitrageDetector* detector;
+  // Set instead of |feed| when following a publisher process through shared
+  // memory; null until its object exists.
+  converter::SharedRatesReader* shared;
+  // The timer checking |shared| for new entries, or 0.
+  guint shared_timer_id;
+  guint shared_open_countdown;
+  // Reused between frames so sending a delta does not allocate once warm.
+  std::vector<converter::RateTick>* delta;
+  std::vector<converter::ArbitrageCycle>* cycles;
+  // The tick callback on |view|, installed only while a delta is pending,
+  // or 0.
+  guint tick_id;
+  gboolean listening;
+  gboolean arbitrage_listening;
+};
+
+G_DEFINE_TYPE(RateFeedChannel, rate_feed_channel, G_TYPE_OBJECT)
+
+enum { kRatesChangedSignal, kLastSignal };
+
+static guint signals[kLastSignal];
+
+static constexpr char kChannelName[] = "currency_converter/rates";
+static constexpr char kArbitrageChannelName[] = "currency_converter/arbitrage";
+
+// How often shared memory is checked for new rates. Checking is one load,
+// and anything found is sent on the next frame.
+static constexpr guint kSharedPollIntervalMs = 8;
+// Polls between attempts to open the shared object while no publisher has
+// created it yet, about a second.
+static constexpr guint kSharedOpenRetryPolls = 125;
+
+// Sends |rates| as one event: {version, currencies, rates}, with the
+// currency indices in an Int32List and their base rates, scaled by
+// converter::kRateScale, in an Int64List.
+static void send_rates(RateFeedChannel* self, uint64_t version,
+                       const std::vector<converter::RateTick>& rates) {
+  std::vector<int32_t> currencies(rates.size());
+  std::vector<int64_t> values(rates.size());
+  for (size_t i = 0; i < rates.size(); i++) {
+    currencies[i] = rates[i].currency;
+    values[i] = rates[i].rate;
+  }
+  g_autoptr(FlValue) event = fl_value_new_map();
+  fl_value_set_string_take(event, "version",
+                           fl_value_new_int(static_cast<int64_t>(version)));
+  fl_value_set_string_take(
+      event, "currencies",
+      fl_value_new_int32_list(currencies.data(), currencies.size()));
+  fl_value_set_string_take(event, "rates",
+                           fl_value_new_int64_list(values.data(), values.size()));
+  g_autoptr(GError) error = nullptr;
+  if (!fl_event_channel_send(self->channel, event, nullptr, &error)) {
+    g_warning("Failed to send rates: %s", error->message);
+  }
+}
+
+// Sends the flagged cycles as one event: a list of {currencies, gain} maps,
+// with the currency codes of each cycle in order. An empty list clears
+// earlier alerts.
+static void send_cycles(RateFeedChannel* self,
+                        const std::vector<converter::ArbitrageCycle>& cycles) {
+  g_autoptr(FlValue) event = fl_value_new_list();
+  for (const converter::ArbitrageCycle& cycle : cycles) {
+    FlValue* codes = fl_value_new_list();
+    for (converter::CurrencyId currency : cycle.currencies) {
+      fl_value_append_take(
+          codes, fl_value_new_string(converter::GetCurrency(currency).code));
+    }
+    FlValue* entry = fl_value_new_map();
+    fl_value_set_string_take(entry, "currencies", codes);
+    fl_value_set_string_take(entry, "gain", fl_value_new_float(cycle.gain));
+    fl_value_append_take(event, entry);
+  }
+  g_autoptr(GError) error = nullptr;
+  if (!fl_event_channel_send(self->arbitrage_channel, event, nullptr,
+                             &error)) {
+    g_warning("Failed to send arbitrage alerts: %s", error->message);
+  }
+}
+
+// Moves the entries written to shared memory since the last frame into
+// |self->delta|, keeping the latest rate per currency, and applies them to
+// the engine as one version. Returns the publisher's version.
+static uint64_t take_shared_delta(RateFeedChannel* self) {
+  self->delta->clear();
+  uint64_t version = self->shared->Poll(self->delta);
+  // Keep the last entry per currency, in currency order.
+  std::stable_sort(self->delta->begin(), self->delta->end(),
+                   [](const converter::RateTick& a,
+                      const converter::RateTick& b) {
+                     return a.currency < b.currency;
+                   });
+  auto last = std::unique(self->delta->rbegin(), self->delta->rend(),
+                          [](const converter::RateTick& a,
+                             const converter::RateTick& b) {
+                            return a.currency == b.currency;
+                          });
+  self->delta->erase(self->delta->begin(), last.base());
+  if (!self->delta->empty()) {
+    self->engine->rates().Publish(self->delta->data(), self->delta->size());
+  }
+  return version;
+}
+
+// Runs on the frame after rates changed. However many ticks arrived since
+// the last frame, Dart gets one event with the latest rate per currency.
+static gboolean tick_cb(GtkWidget* widget, GdkFrameClock* frame_clock,
+                        gpointer user_data) {
+  RateFeedChannel* self = RATE_FEED_CHANNEL(user_data);
+  self->tick_id = 0;
+  if (self->feed != nullptr && self->feed->TakeCycles(self->cycles) &&
+      self->arbitrage_listening) {
+    send_cycles(self, *self->cycles);
+  }
+  uint64_t version = self->feed != nullptr ? self->feed->TakeDelta(self->delta)
+                                           : take_shared_delta(self);
+  if (self->delta->empty()) {
+    return G_SOURCE_REMOVE;
+  }
+  if (self->listening) {
+    send_rates(self, version, *self->delta);
+  }
+  g_signal_emit(self, signals[kRatesChangedSignal], 0);
+  return G_SOURCE_REMOVE;
+}
+
+// Schedules tick_cb. Invoked on the main loop by the feed thread, possibly
+// after rate_feed_channel_stop(), when there is no feed left to take a delta
+// from.
+static gboolean delta_pending_cb(gpointer user_data) {
+  RateFeedChannel* self = RATE_FEED_CHANNEL(user_data);
+  if (self->feed != nullptr && self->tick_id == 0) {
+    self->tick_id =
+        gtk_widget_add_tick_callback(self->view, tick_cb, self, nullptr);
+  }
+  return G_SOURCE_REMOVE;
+}
+
+// Maps the publisher's shared memory and takes over its current rates.
+static void open_shared(RateFeedChannel* self) {
+  std::unique_ptr<converter::SharedRatesReader> reader =
+      converter::SharedRatesReader::Open();
+  if (reader == nullptr) {
+    return;
+  }
+  std::vector<int64_t> rates;
+  reader->ReadSnapshot(&rates);
+  std::vector<converter::RateTick> ticks;
+  for (size_t i = 0; i < rates.size(); i++) {
+    if (rates[i] > 0) {
+      ticks.push_back({static_cast<converter::CurrencyId>(i), rates[i]});
+    }
+  }
+  if (!ticks.empty()) {
+    self->engine->rates().Publish(ticks.data(), ticks.size());
+  }
+  self->shared = reader.release();
+}
+
+// Checks shared memory for new rates, and schedules a frame to take them.
+static gboolean shared_poll_cb(gpointer user_data) {
+  RateFeedChannel* self = RATE_FEED_CHANNEL(user_data);
+  if (self->shared == nullptr) {
+    if (self->shared_open_countdown-- == 0) {
+      self->shared_open_countdown = kSharedOpenRetryPolls;
+      open_shared(self);
+    }
+    return G_SOURCE_CONTINUE;
+  }
+  if (self->shared->retired()) {
+    // The publisher replaced the object; follow it to the new one.
+    if (self->tick_id != 0) {
+      gtk_widget_remove_tick_callback(self->view, self->tick_id);
+      self->tick_id = 0;
+    }
+    delete self->shared;
+    self->shared = nullptr;
+    self->shared_open_countdown = kSharedOpenRetryPolls;
+    open_shared(self);
+    return G_SOURCE_CONTINUE;
+  }
+  if (self->shared->has_new() && self->tick_id == 0) {
+    self->tick_id =
+        gtk_widget_add_tick_callback(self->view, tick_cb, self, nullptr);
+  }
+  return G_SOURCE_CONTINUE;
+}
+
+// Starts the stream with every current rate, so Dart never has to combine
+// deltas with rates it did not see.
+static FlMethodErrorResponse* listen_cb(FlEventChannel* channel, FlValue* args,
+                                        gpointer user_data) {
+  RateFeedChannel* self = RATE_FEED_CHANNEL(user_data);
+  self->listening = TRUE;
+  std::vector<converter::RateTick> rates;
+  uint64_t version;
+  {
+    converter::RateStore::Snapshot snapshot = self->engine->rates().Read();
+    version = snapshot.version();
+    for (size_t i = 0; i < snapshot.table().size(); i++) {
+      converter::CurrencyId currency = static_cast<converter::CurrencyId>(i);
+      rates.push_back({currency, snapshot.table().BaseRate(currency)});
+    }
+  }
+  send_rates(self, version, rates);
+  return nullptr;
+}
+
+static FlMethodErrorResponse* cancel_cb(FlEventChannel* channel, FlValue* args,
+                                        gpointer user_data) {
+  RATE_FEED_CHANNEL(user_data)->listening = FALSE;
+  return nullptr;
+}
+
+// Starts the alert stream with the cycles flagged so far.
+static FlMethodErrorResponse* arbitrage_listen_cb(FlEventChannel* channel,
+                                                  FlValue* args,
+                                                  gpointer user_data) {
+  RateFeedChannel* self = RATE_FEED_CHANNEL(user_data);
+  self->arbitrage_listening = TRUE;
+  if (self->feed != nullptr) {
+    self->feed->TakeCycles(self->cycles);
+  }
+  send_cycles(self, *self->cycles);
+  return nullptr;
+}
+
+static FlMethodErrorResponse* arbitrage_cancel_cb(FlEventChannel* channel,
+                                                  FlValue* args,
+                                                  gpointer user_data) {
+  RATE_FEED_CHANNEL(user_data)->arbitrage_listening = FALSE;
+  return nullptr;
+}
+
+static void rate_feed_channel_dispose(GObject* object) {
+  RateFeedChannel* self = RATE_FEED_CHANNEL(object);
+  rate_feed_channel_stop(self);
+  g_clear_object(&self->channel);
+  g_clear_object(&self->arbitrage_channel);
+  g_clear_object(&self->view);
+  G_OBJECT_CLASS(rate_feed_channel_parent_class)->dispose(object);
+}
+
+static void rate_feed_channel_finalize(GObject* object) {
+  RateFeedChannel* self = RATE_FEED_CHANNEL(object);
+  delete self->delta;
+  delete self->cycles;
+  G_OBJECT_CLASS(rate_feed_channel_parent_class)->finalize(object);
+}
+
+static void rate_feed_channel_class_init(RateFeedChannelClass* klass) {
+  G_OBJECT_CLASS(klass)->dispose = rate_feed_channel_dispose;
+  G_OBJECT_CLASS(klass)->finalize = rate_feed_channel_finalize;
+
+  signals[kRatesChangedSignal] =
+      g_signal_new("rates-changed", G_TYPE_FROM_CLASS(klass),
+                   G_SIGNAL_RUN_LAST, 0, nullptr, nullptr, nullptr,
+                   G_TYPE_NONE, 0);
+}
+
+static void rate_feed_channel_init(RateFeedChannel* self) {}
+
+RateFeedChannel* rate_feed_channel_new(FlBinaryMessenger* messenger,
+                                       converter::ConversionEngine* engine,
+                                       GtkWidget* view, const gchar* source) {
+  RateFeedChannel* self =
+      RATE_FEED_CHANNEL(g_object_new(rate_feed_channel_get_type(), nullptr));
+  self->view = GTK_WIDGET(g_object_ref(view));
+  self->engine = engine;
+  self->delta = new std::vector<converter::RateTick>();
+  self->cycles = new std::vector<converter::ArbitrageCycle>();
+
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  self->channel =
+      fl_event_channel_new(messenger, kChannelName, FL_METHOD_CODEC(codec));
+  fl_event_channel_set_stream_handlers(self->channel, listen_cb, cancel_cb,
+                                       self, nullptr);
+  self->arbitrage_channel = fl_event_channel_new(
+      messenger, kArbitrageChannelName, FL_METHOD_CODEC(codec));
+  fl_event_channel_set_stream_handlers(self->arbitrage_channel,
+                                       arbitrage_listen_cb, arbitrage_cancel_cb,
+                                       self, nullptr);
+
+  if (source == nullptr) {
+    return self;
+  }
+  if (strcmp(source, "shm") == 0) {
+    // Another process parses the feed; see batch_mode_run().
+    open_shared(self);
+    self->shared_open_countdown = kSharedOpenRetryPolls;
+    self->shared_timer_id =
+        g_timeout_add(kSharedPollIntervalMs, shared_poll_cb, self);
+    return self;
+  }
+  std::unique_ptr<converter::RateSource> rate_source =
+      converter::CreateRateSource(source);
+  if (rate_source == nullptr) {
+    g_warning("Invalid rate feed source: %s", source);
+    return self;
+  }
+  self->feed =
+      new converter::RateFeed(&engine->rates(), std::move(rate_source));
+  self->detector = new converter::ArbitrageDetector();
+  self->detector->SetBaseRates(engine->rates().Read().table());
+  self->feed->DetectArbitrage(self->detector);
+  self->feed->RecordCandles(&engine->candles());
+  // The feed thread only hands over to the main loop; the pending tick
+  // callback and the frame clock do the rest.
+  bool started = self->feed->Start([self] {
+    g_main_context_invoke_full(nullptr, G_PRIORITY_DEFAULT, delta_pending_cb,
+                               g_object_ref(self), g_object_unref);
+  });
+  if (!started) {
+    g_warning("Failed to start the rate feed from %s", source);
+    delete self->feed;
+    self->feed = nullptr;
+  }
+  return self;
+}
+
+void rate_feed_channel_stop(RateFeedChannel* self) {
+  // Joins the feed thread, so no more delta_pending_cb calls get queued.
+  delete self->feed;
+  self->feed = nullptr;
+  delete self->detector;
+  self->detector = nullptr;
+  if (self->shared_timer_id != 0) {
+    g_source_remove(self->shared_timer_id);
+    self->shared_timer_id = 0;
+  }
+  delete self->shared;
+  self->shared = nullptr;
+  if (self->tick_id != 0) {
+    gtk_widget_remove_tick_callback(self->view, self->tick_id);
+    self->tick_id = 0;
+  }
+}
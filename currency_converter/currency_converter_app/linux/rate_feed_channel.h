@@ -0,0 +1,59 @@
+#ifndef FLUTTER_RATE_FEED_CHANNEL_H_
+#define FLUTTER_RATE_FEED_CHANNEL_H_
+
+#include <flutter_linux/flutter_linux.h>
+#include <gtk/gtk.h>
+
+#include "engine/conversion_engine.h"
+
+G_DECLARE_FINAL_TYPE(RateFeedChannel, rate_feed_channel, RATE_FEED, CHANNEL,
+                     GObject)
+
+/**
+ * rate_feed_channel_new:
+ * @messenger: an #FlBinaryMessenger to register the channel on.
+ * @engine: the native conversion engine to feed. Must outlive the channel.
+ * @view: the widget whose frame clock paces rate updates.
+ * @source: (nullable): a rate source specification such as
+ * "unix:/run/rates.sock", "fifo:/tmp/rates" or "replay:ticks.csv@100000",
+ * see converter::CreateRateSource(); "shm" to follow the rates another
+ * process publishes in shared memory; or %NULL for no feed.
+ *
+ * Starts a thread applying quotes from @source to the rates of @engine, or
+ * with "shm" polls shared memory for them on the main loop, and
+ * creates the "currency_converter/rates" event channel, which sends the
+ * rates that changed as at most one event per frame of @view.
+ *
+ * Quotes read from a feed, cross pairs included, are also checked for
+ * cycles whose rates multiply to more than one, which usually mean a stale
+ * or bad quote; the "currency_converter/arbitrage" event channel sends the
+ * cycles flagged whenever they change. Rates followed through shared
+ * memory carry no cross quotes and are not checked.
+ *
+ * Every quote read from a feed also extends the candles of
+ * converter::ConversionEngine::candles(). Rates followed through shared
+ * memory carry no quote timestamps and do not.
+ *
+ * The channel emits "rates-changed" on the main loop after each frame that
+ * applied new rates to @engine, whether or not Dart is listening.
+ *
+ * Returns: a new #RateFeedChannel.
+ */
+RateFeedChannel* rate_feed_channel_new(FlBinaryMessenger* messenger,
+                                       converter::ConversionEngine* engine,
+                                       GtkWidget* view, const gchar* source);
+
+/**
+ * rate_feed_channel_stop:
+ * @channel: a #RateFeedChannel.
+ *
+ * Joins the feed thread, or stops following shared memory, so that the
+ * channel no longer touches the rates or candles of its engine, and drops
+ * any frame pending. Calls the feed thread queued on the main loop before
+ * this do nothing when they run, and may never run at all, so their
+ * references to @channel cannot be relied on to dispose it; call this
+ * before the engine is destroyed. Safe to call more than once.
+ */
+void rate_feed_channel_stop(RateFeedChannel* channel);
+
+#endif  // FLUTTER_RATE_FEED_CHANNEL_H_
@@ -0,0 +1,129 @@
+#include "session_channel.h"
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#include "channel_util.h"
+#include "engine/metrics.h"
+#include "metrics_channel.h"
+
+struct _SessionChannel {
+  GObject parent_instance;
+  FlMethodChannel* channel;
+  // UI state, restored from the snapshot until Dart saves its own.
+  std::string* state;
+  // When the restored snapshot was written, or 0 if there was none.
+  int64_t saved_at;
+};
+
+G_DEFINE_TYPE(SessionChannel, session_channel, G_TYPE_OBJECT)
+
+static constexpr char kChannelName[] = "currency_converter/session";
+
+// Handles "restore". Responds with {state, savedAt} from the previous
+// session's snapshot, or an empty map if there was none.
+static FlMethodResponse* restore(SessionChannel* self) {
+  g_autoptr(FlValue) result = fl_value_new_map();
+  if (self->saved_at != 0) {
+    fl_value_set_string_take(
+        result, "state",
+        fl_value_new_string_sized(self->state->data(), self->state->size()));
+    fl_value_set_string_take(result, "savedAt",
+                             fl_value_new_int(self->saved_at));
+  }
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// Handles "save" with arguments {state}, a string kept for the next
+// session's snapshot.
+static FlMethodResponse* save(SessionChannel* self, FlValue* args) {
+  FlValue* state = lookup_typed(args, "state", FL_VALUE_TYPE_STRING);
+  if (state == nullptr) {
+    return invalid_arguments_response("Expected state as a String");
+  }
+  self->state->assign(fl_value_get_string(state));
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+}
+
+// Called when a method call is received from Flutter.
+static void method_call_cb(FlMethodChannel* channel, FlMethodCall* method_call,
+                           gpointer user_data) {
+  SessionChannel* self = SESSION_CHANNEL(user_data);
+  uint64_t start = converter::MetricsClock();
+  const gchar* method = fl_method_call_get_name(method_call);
+  FlValue* args = fl_method_call_get_args(method_call);
+
+  g_autoptr(FlMethodResponse) response = nullptr;
+  if (strcmp(method, "restore") == 0) {
+    response = restore(self);
+  } else if (strcmp(method, "save") == 0) {
+    response = save(self, args);
+  } else {
+    response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+  }
+
+  g_autoptr(GError) error = nullptr;
+  if (!fl_method_call_respond(method_call, response, &error)) {
+    g_warning("Failed to send response: %s", error->message);
+  }
+  metrics_channel_record_call(kChannelName, method, start, response);
+}
+
+gchar* session_channel_snapshot_path() {
+  return g_build_filename(g_get_user_data_dir(), "currency_converter",
+                          "warm_start.bin", nullptr);
+}
+
+gboolean session_channel_save_snapshot(SessionChannel* self,
+                                       converter::ConversionEngine* engine) {
+  g_autofree gchar* path = session_channel_snapshot_path();
+  g_autofree gchar* directory = g_path_get_dirname(path);
+  g_mkdir_with_parents(directory, 0755);
+  converter::RateStore::Snapshot snapshot = engine->rates().Read();
+  if (!converter::WriteRateSnapshot(snapshot.table(),
+                                    g_get_real_time() / 1000, *self->state,
+                                    path)) {
+    g_warning("Failed to write the warm-start snapshot to %s: %s", path,
+              strerror(errno));
+    return FALSE;
+  }
+  return TRUE;
+}
+
+static void session_channel_dispose(GObject* object) {
+  SessionChannel* self = SESSION_CHANNEL(object);
+  g_clear_object(&self->channel);
+  G_OBJECT_CLASS(session_channel_parent_class)->dispose(object);
+}
+
+static void session_channel_finalize(GObject* object) {
+  SessionChannel* self = SESSION_CHANNEL(object);
+  delete self->state;
+  G_OBJECT_CLASS(session_channel_parent_class)->finalize(object);
+}
+
+static void session_channel_class_init(SessionChannelClass* klass) {
+  G_OBJECT_CLASS(klass)->dispose = session_channel_dispose;
+  G_OBJECT_CLASS(klass)->finalize = session_channel_finalize;
+}
+
+static void session_channel_init(SessionChannel* self) {}
+
+SessionChannel* session_channel_new(FlBinaryMessenger* messenger,
+                                    const converter::RateSnapshot* restored) {
+  SessionChannel* self =
+      SESSION_CHANNEL(g_object_new(session_channel_get_type(), nullptr));
+  self->state = new std::string();
+  if (restored != nullptr) {
+    self->state->assign(restored->state);
+    self->saved_at = restored->saved_at;
+  }
+
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  self->channel = fl_method_channel_new(messenger, kChannelName,
+                                        FL_METHOD_CODEC(codec));
+  fl_method_channel_set_method_call_handler(self->channel, method_call_cb,
+                                            self, nullptr);
+  return self;
+}
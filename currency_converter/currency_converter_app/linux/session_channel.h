@@ -0,0 +1,51 @@
+#ifndef FLUTTER_SESSION_CHANNEL_H_
+#define FLUTTER_SESSION_CHANNEL_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+#include "engine/conversion_engine.h"
+#include "engine/rate_snapshot.h"
+
+G_DECLARE_FINAL_TYPE(SessionChannel, session_channel, SESSION, CHANNEL,
+                     GObject)
+
+/**
+ * session_channel_snapshot_path:
+ *
+ * Gets the location of the warm-start snapshot, which holds the rates and
+ * UI state of the previous session.
+ *
+ * Returns: (transfer full): a path under the user data directory.
+ */
+gchar* session_channel_snapshot_path();
+
+/**
+ * session_channel_new:
+ * @messenger: an #FlBinaryMessenger to register the channel on.
+ * @restored: (nullable): what converter::LoadRateSnapshot() restored from
+ * the snapshot, or %NULL if there was none.
+ *
+ * Creates the "currency_converter/session" method channel, on which Dart
+ * fetches the UI state of the previous session and hands over its own, to
+ * be kept in the snapshot written by session_channel_save_snapshot().
+ *
+ * Returns: a new #SessionChannel.
+ */
+SessionChannel* session_channel_new(FlBinaryMessenger* messenger,
+                                    const converter::RateSnapshot* restored);
+
+/**
+ * session_channel_save_snapshot:
+ * @self: a #SessionChannel.
+ * @engine: the native conversion engine whose current rates are saved.
+ *
+ * Writes the current rates of @engine and the latest UI state to the
+ * snapshot at session_channel_snapshot_path(), for the next session to
+ * start from.
+ *
+ * Returns: %TRUE on success.
+ */
+gboolean session_channel_save_snapshot(SessionChannel* self,
+                                       converter::ConversionEngine* engine);
+
+#endif  // FLUTTER_SESSION_CHANNEL_H_
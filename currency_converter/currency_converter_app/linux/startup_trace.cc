@@ -0,0 +1,101 @@
+#include "startup_trace.h"
+
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+struct Span {
+  const gchar* name;
+  // Microseconds since the trace began; end is -1 while open.
+  gint64 begin;
+  gint64 end;
+  int depth;
+};
+
+// Start-up runs on the main thread, so the trace needs no locking.
+struct Trace {
+  gint64 origin = -1;
+  std::vector<Span> spans;
+  // Indices in |spans| of the open spans, innermost last.
+  std::vector<size_t> open;
+  gint64 first_frame = -1;
+};
+
+Trace& trace() {
+  static Trace* trace = new Trace();
+  return *trace;
+}
+
+gint64 now(Trace& trace) {
+  gint64 time = g_get_monotonic_time();
+  if (trace.origin < 0) {
+    trace.origin = time;
+  }
+  return time - trace.origin;
+}
+
+// Writes the spans and the first frame to |path| as Chrome trace events.
+void write_chrome_trace(const Trace& trace, const gchar* path) {
+  FILE* file = fopen(path, "w");
+  if (file == nullptr) {
+    g_warning("Failed to write the start-up trace to %s", path);
+    return;
+  }
+  fprintf(file, "{\"traceEvents\":[\n");
+  for (const Span& span : trace.spans) {
+    fprintf(file,
+            "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"
+            "\"ts\":%" G_GINT64_FORMAT ",\"dur\":%" G_GINT64_FORMAT "},\n",
+            span.name, span.begin, span.end - span.begin);
+  }
+  fprintf(file,
+          "{\"name\":\"first_frame\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,"
+          "\"tid\":1,\"ts\":%" G_GINT64_FORMAT "}\n]}\n",
+          trace.first_frame);
+  if (fclose(file) != 0) {
+    g_warning("Failed to write the start-up trace to %s", path);
+  }
+}
+
+}  // namespace
+
+void startup_trace_begin(const gchar* name) {
+  Trace& trace = ::trace();
+  if (trace.first_frame >= 0) {
+    return;
+  }
+  trace.open.push_back(trace.spans.size());
+  trace.spans.push_back({name, now(trace), -1,
+                         static_cast<int>(trace.open.size()) - 1});
+}
+
+void startup_trace_end() {
+  Trace& trace = ::trace();
+  if (trace.open.empty()) {
+    return;
+  }
+  trace.spans[trace.open.back()].end = now(trace);
+  trace.open.pop_back();
+}
+
+void startup_trace_first_frame() {
+  Trace& trace = ::trace();
+  if (trace.first_frame >= 0) {
+    return;
+  }
+  while (!trace.open.empty()) {
+    startup_trace_end();
+  }
+  trace.first_frame = now(trace);
+
+  for (const Span& span : trace.spans) {
+    g_debug("startup: %*s%s %.2f ms (at %.2f ms)", 2 * span.depth, "",
+            span.name, (span.end - span.begin) / 1e3, span.begin / 1e3);
+  }
+  g_debug("startup: first frame at %.2f ms", trace.first_frame / 1e3);
+  const gchar* path = g_getenv("CURRENCY_CONVERTER_STARTUP_TRACE");
+  if (path != nullptr && path[0] != '\0') {
+    write_chrome_trace(trace, path);
+  }
+}
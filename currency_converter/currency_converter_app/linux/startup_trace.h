@@ -0,0 +1,36 @@
+#ifndef FLUTTER_STARTUP_TRACE_H_
+#define FLUTTER_STARTUP_TRACE_H_
+
+#include <glib.h>
+
+/**
+ * startup_trace_begin:
+ * @name: a string naming the span, which must outlive the trace, such as a
+ * literal.
+ *
+ * Opens a span of start-up work, nested in the innermost span still open.
+ * The first call fixes the origin all times are reported against, so call
+ * it first thing in main(). Spans opened after
+ * startup_trace_first_frame() are ignored.
+ */
+void startup_trace_begin(const gchar* name);
+
+/**
+ * startup_trace_end:
+ *
+ * Closes the innermost open span.
+ */
+void startup_trace_end();
+
+/**
+ * startup_trace_first_frame:
+ *
+ * Records that Flutter rendered its first frame, closes every span still
+ * open and reports the trace: each span is logged with g_debug(), and if
+ * `CURRENCY_CONVERTER_STARTUP_TRACE` names a file the trace is also written
+ * there in the Chrome trace event format, for chrome://tracing or Perfetto.
+ * Only the first call has any effect.
+ */
+void startup_trace_first_frame();
+
+#endif  // FLUTTER_STARTUP_TRACE_H_
@@ -0,0 +1,69 @@
+// Alert ids across the reuse of their slots: a stale id, of an alert that
+// fired or was removed, never names the alert that took its slot over.
+
+#include <cstdint>
+#include <vector>
+
+#include "engine/alert_index.h"
+#include "engine/conversion_engine.h"
+#include "engine/currency.h"
+#include "engine/rate_table.h"
+#include "test.h"
+
+namespace {
+
+using converter::AlertDirection;
+using converter::AlertId;
+using converter::AlertIndex;
+
+}  // namespace
+
+TEST_CASE(alert_index_removed_ids_are_not_reused) {
+  converter::CurrencyId usd = converter::FindCurrency("USD");
+  converter::CurrencyId inr = converter::FindCurrency("INR");
+  uint32_t pair = converter::PackPair(usd, inr);
+  converter::RateTable rates;
+  int64_t rate;
+  EXPECT_TRUE(rates.CrossRate(usd, inr, &rate));
+
+  AlertIndex index;
+  AlertId first = index.Add(pair, AlertDirection::kAbove, rate * 2);
+  EXPECT_TRUE(index.Remove(first));
+  AlertId second = index.Add(pair, AlertDirection::kAbove, rate * 2);
+  EXPECT_TRUE(second != first);
+  EXPECT_TRUE(second <= INT32_MAX);
+  EXPECT_FALSE(index.Remove(first));
+  EXPECT_EQ(index.size(), 1u);
+  EXPECT_TRUE(index.Remove(second));
+  EXPECT_FALSE(index.Remove(converter::kInvalidAlert));
+  EXPECT_EQ(index.size(), 0u);
+}
+
+TEST_CASE(alert_index_fired_ids_are_not_reused) {
+  converter::CurrencyId usd = converter::FindCurrency("USD");
+  converter::CurrencyId inr = converter::FindCurrency("INR");
+  uint32_t pair = converter::PackPair(usd, inr);
+  converter::RateTable rates;
+  int64_t rate;
+  EXPECT_TRUE(rates.CrossRate(usd, inr, &rate));
+
+  AlertIndex index;
+  AlertId fired_id = index.Add(pair, AlertDirection::kAbove, rate + 1);
+  std::vector<converter::FiredAlert> fired;
+  EXPECT_EQ(index.Refresh(rates, &fired), 0u);
+  EXPECT_TRUE(rates.SetBaseRate(inr, rates.BaseRate(inr) * 2));
+  EXPECT_EQ(index.Refresh(rates, &fired), 1u);
+  EXPECT_EQ(fired[0].id, fired_id);
+  EXPECT_EQ(fired[0].pair, pair);
+
+  // A remove sent before Dart heard of the firing must not cancel the
+  // alert now in the same slot.
+  AlertId next = index.Add(pair, AlertDirection::kBelow, rate);
+  EXPECT_TRUE(next != fired_id);
+  EXPECT_FALSE(index.Remove(fired_id));
+  EXPECT_EQ(index.size(), 1u);
+  fired.clear();
+  EXPECT_TRUE(rates.SetBaseRate(inr, rates.BaseRate(inr) / 4));
+  EXPECT_EQ(index.Refresh(rates, &fired), 1u);
+  EXPECT_EQ(fired[0].id, next);
+}
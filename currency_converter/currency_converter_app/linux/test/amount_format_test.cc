@@ -0,0 +1,107 @@
+#include <cstdint>
+#include <random>
+#include <string>
+#include <string_view>
+
+#include "engine/amount_format.h"
+#include "test.h"
+
+namespace {
+
+using converter::FormatAmount;
+using converter::NumberFormatForLocale;
+using converter::ParseAmount;
+
+constexpr std::string_view kLocales[] = {"en_US", "en_IN", "de_DE",
+                                         "de_CH", "fr_FR", "cs_CZ"};
+
+std::string Format(int64_t minor, int minor_units, std::string_view locale) {
+  char text[converter::kMaxAmountTextSize];
+  size_t size = FormatAmount(minor, minor_units,
+                             NumberFormatForLocale(locale), text);
+  return std::string(text, size);
+}
+
+// Parses |text| in |locale| with two minor units, or returns INT64_MIN if it
+// is rejected.
+int64_t Parse(std::string_view text, std::string_view locale) {
+  int64_t minor;
+  if (!ParseAmount(text, 2, NumberFormatForLocale(locale), &minor)) {
+    return INT64_MIN;
+  }
+  return minor;
+}
+
+}  // namespace
+
+TEST_CASE(amount_format_examples) {
+  EXPECT_EQ(Format(123456789, 2, "en_US"), "1,234,567.89");
+  EXPECT_EQ(Format(123456789, 2, "en_IN"), "12,34,567.89");
+  EXPECT_EQ(Format(123456789, 2, "de_DE"), "1.234.567,89");
+  EXPECT_EQ(Format(-5, 2, "en_US"), "-0.05");
+  EXPECT_EQ(Format(1234, 0, "en_US"), "1,234");
+  EXPECT_EQ(Format(INT64_MIN, 3, "en_US"), "-9,223,372,036,854,775.808");
+}
+
+TEST_CASE(amount_format_parse_examples) {
+  EXPECT_EQ(Parse("1,234,567.89", "en_US"), 123456789);
+  EXPECT_EQ(Parse("  -1234.5 ", "en_US"), -123450);
+  EXPECT_EQ(Parse(".5", "en_US"), 50);
+  EXPECT_EQ(Parse("1.234.567,89", "de_DE"), 123456789);
+  EXPECT_EQ(Parse("1 234,5", "fr_FR"), 123450);
+  EXPECT_EQ(Parse("", "en_US"), INT64_MIN);
+  EXPECT_EQ(Parse("1.2.3", "en_US"), INT64_MIN);
+  EXPECT_EQ(Parse("1,", "en_US"), INT64_MIN);
+  EXPECT_EQ(Parse("99999999999999999999", "en_US"), INT64_MIN);
+}
+
+TEST_CASE(amount_format_parse_checks_group_sizes) {
+  EXPECT_EQ(Parse("1,234", "en_US"), 123400);
+  EXPECT_EQ(Parse("12,345,678.9", "en_US"), 1234567890);
+  EXPECT_EQ(Parse("1234567", "en_US"), 123456700);
+  EXPECT_EQ(Parse("1,5", "en_US"), INT64_MIN);
+  EXPECT_EQ(Parse("1,0,0", "en_US"), INT64_MIN);
+  EXPECT_EQ(Parse("1,2345", "en_US"), INT64_MIN);
+  EXPECT_EQ(Parse("1234,567", "en_US"), INT64_MIN);
+  EXPECT_EQ(Parse("1,23,456", "en_US"), INT64_MIN);
+
+  // A dot groups thousands in de_DE, so the en_US decimal is an error.
+  EXPECT_EQ(Parse("1.5", "de_DE"), INT64_MIN);
+  EXPECT_EQ(Parse("1.50", "de_DE"), INT64_MIN);
+  EXPECT_EQ(Parse("1.500", "de_DE"), 150000);
+  EXPECT_EQ(Parse("1,5", "de_DE"), 150);
+
+  EXPECT_EQ(Parse("12,34,567", "en_IN"), 123456700);
+  EXPECT_EQ(Parse("1,00,000.5", "en_IN"), 10000050);
+  EXPECT_EQ(Parse("1,234", "en_IN"), 123400);
+  EXPECT_EQ(Parse("1,234,567", "en_IN"), INT64_MIN);
+  EXPECT_EQ(Parse("123,456", "en_IN"), INT64_MIN);
+  EXPECT_EQ(Parse("1,2,345", "en_IN"), INT64_MIN);
+}
+
+TEST_CASE(amount_format_parse_rounds_half_to_even) {
+  EXPECT_EQ(Parse("0.125", "en_US"), 12);
+  EXPECT_EQ(Parse("0.135", "en_US"), 14);
+  EXPECT_EQ(Parse("0.1251", "en_US"), 13);
+  EXPECT_EQ(Parse("-0.125", "en_US"), -12);
+}
+
+TEST_CASE(amount_format_round_trips) {
+  std::mt19937_64 random(5);
+  for (std::string_view locale : kLocales) {
+    for (int minor_units = 0; minor_units <= 6; minor_units++) {
+      for (int i = 0; i < 2000; i++) {
+        // Values of every length, up to the parser's limit.
+        int64_t minor = static_cast<int64_t>(random() >> (random() % 64));
+        if (i & 1) {
+          minor = -minor;
+        }
+        std::string text = Format(minor, minor_units, locale);
+        int64_t parsed;
+        EXPECT_TRUE(ParseAmount(text, minor_units,
+                                NumberFormatForLocale(locale), &parsed));
+        EXPECT_EQ(parsed, minor);
+      }
+    }
+  }
+}
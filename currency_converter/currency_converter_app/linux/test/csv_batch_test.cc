@@ -0,0 +1,141 @@
+// ConvertCsvStream over inputs whose lines straddle the read chunks, checked
+// row by row against single conversions.
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <thread>
+
+#include "engine/conversion_engine.h"
+#include "engine/csv_batch.h"
+#include "engine/currency.h"
+#include "engine/fixed_point.h"
+#include "test.h"
+
+namespace {
+
+constexpr const char* kCodes[] = {"USD", "INR", "EUR", "JPY", "KWD", "GBP"};
+
+// Input of |rows| rows padded to varying lengths, so line ends fall at every
+// offset around the 1 MiB chunk boundaries, and the output expected for it.
+void MakeCsv(size_t rows, std::string* input, std::string* expected) {
+  converter::ConversionEngine engine;
+  std::mt19937_64 random(7);
+  *input = "amount,from,to\n";
+  *expected = "amount,from,to,result\n";
+  for (size_t i = 0; i < rows; i++) {
+    const char* from = kCodes[random() % 6];
+    const char* to = kCodes[random() % 6];
+    std::string amount = std::to_string(random() % 10000000) + "." +
+                         std::to_string(random() % 100);
+    std::string line = std::string(random() % 40, ' ') + amount + "," +
+                       from + "," + to;
+    if (i % 1000 == 999) {
+      line = amount + ",XXX," + to;
+    }
+    if (i % 7 == 0) {
+      line += "\r";
+    }
+    *input += line + "\n";
+
+    std::string row = line.substr(0, line.find('\r'));
+    converter::CurrencyId from_id = converter::FindCurrency(from);
+    converter::CurrencyId to_id = converter::FindCurrency(to);
+    int64_t minor;
+    int64_t result;
+    *expected += row + ",";
+    if (i % 1000 != 999 &&
+        converter::ParseScaledDecimal(
+            amount, converter::GetCurrency(from_id).minor_units, &minor) &&
+        engine.Convert(minor, from_id, to_id, &result) ==
+            converter::Status::kOk) {
+      char text[32];
+      *expected += std::string(
+          text, converter::FormatScaledDecimal(
+                    result, converter::GetCurrency(to_id).minor_units, text));
+    }
+    *expected += "\n";
+  }
+}
+
+std::string ReadFile(const std::string& path) {
+  std::string contents;
+  int fd = open(path.c_str(), O_RDONLY);
+  char buffer[65536];
+  ssize_t count;
+  while ((count = read(fd, buffer, sizeof(buffer))) > 0) {
+    contents.append(buffer, count);
+  }
+  close(fd);
+  return contents;
+}
+
+std::string TempPath(const char* name) {
+  return "/tmp/converter_engine_tests_" + std::to_string(getpid()) + "_" +
+         name;
+}
+
+}  // namespace
+
+TEST_CASE(csv_batch_lines_across_chunks) {
+  std::string input;
+  std::string expected;
+  MakeCsv(200000, &input, &expected);
+  EXPECT_TRUE(input.size() > 3 << 20);
+
+  // From a pipe written in uneven pieces, so reads end mid-line too.
+  int pipe_fds[2];
+  EXPECT_TRUE(pipe(pipe_fds) == 0);
+  std::thread writer([&] {
+    for (size_t offset = 0; offset < input.size(); offset += 7777) {
+      size_t size = std::min<size_t>(7777, input.size() - offset);
+      EXPECT_EQ(write(pipe_fds[1], input.data() + offset, size),
+                static_cast<ssize_t>(size));
+    }
+    close(pipe_fds[1]);
+  });
+  std::string output_path = TempPath("out.csv");
+  int out_fd = open(output_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  converter::ConversionEngine engine;
+  converter::CsvBatchStats stats;
+  EXPECT_TRUE(converter::ConvertCsvStream(engine, pipe_fds[0], out_fd, &stats));
+  writer.join();
+  close(pipe_fds[0]);
+  close(out_fd);
+
+  EXPECT_EQ(stats.rows, 200000u);
+  EXPECT_EQ(stats.rejected, 200u);
+  EXPECT_TRUE(ReadFile(output_path) == expected);
+  unlink(output_path.c_str());
+}
+
+TEST_CASE(csv_batch_rejects_lines_longer_than_a_chunk) {
+  std::string input_path = TempPath("long.csv");
+  std::string output_path = TempPath("long_out.csv");
+  int in_fd = open(input_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  std::string input = "1,USD,EUR\n" + std::string(3 << 20, '9') +
+                      ",USD,EUR\n2,USD,USD\n";
+  EXPECT_EQ(write(in_fd, input.data(), input.size()),
+            static_cast<ssize_t>(input.size()));
+  close(in_fd);
+
+  in_fd = open(input_path.c_str(), O_RDONLY);
+  int out_fd = open(output_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  converter::ConversionEngine engine;
+  converter::CsvBatchStats stats;
+  EXPECT_TRUE(converter::ConvertCsvStream(engine, in_fd, out_fd, &stats));
+  close(in_fd);
+  close(out_fd);
+
+  EXPECT_EQ(stats.rows, 3u);
+  EXPECT_EQ(stats.rejected, 1u);
+  std::string output = ReadFile(output_path);
+  EXPECT_TRUE(output.find("2,USD,USD,2.00\n") != std::string::npos);
+  EXPECT_EQ(output.find("9999999999"), std::string::npos);
+  unlink(input_path.c_str());
+  unlink(output_path.c_str());
+}
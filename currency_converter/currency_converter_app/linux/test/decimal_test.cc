@@ -0,0 +1,122 @@
+// Decimal<Scale> at both representations: parsing and formatting, exact
+// arithmetic, banker's rounding and overflow reporting.
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+#include "engine/decimal.h"
+#include "test.h"
+
+namespace {
+
+using converter::Decimal;
+
+using Cents = Decimal<2>;
+using Rate = Decimal<12>;
+using Wide = Decimal<18>;
+
+static_assert(std::is_same_v<Cents::Rep, int64_t>, "small scales are int64");
+static_assert(std::is_same_v<Rate::Rep, int64_t>, "rates are int64");
+static_assert(std::is_same_v<Wide::Rep, __int128>, "wide scales are int128");
+static_assert(std::is_same_v<Decimal<0, __int128>::Rep, __int128>,
+              "the representation can be given");
+
+template <int Scale, typename Rep>
+std::string Format(Decimal<Scale, Rep> value) {
+  char text[42];
+  return std::string(text, value.Format(text));
+}
+
+template <typename D>
+D Parse(const std::string& text) {
+  D value;
+  EXPECT_TRUE(D::Parse(text, &value));
+  return value;
+}
+
+}  // namespace
+
+TEST_CASE(decimal_parse_and_format) {
+  EXPECT_EQ(Format(Parse<Cents>("-12.345")), "-12.34");
+  EXPECT_EQ(Format(Parse<Cents>("12.355")), "12.36");
+  EXPECT_EQ(Format(Parse<Rate>("83.245")), "83.245000000000");
+  EXPECT_EQ(Format(Parse<Wide>("-123456789.000000000000000001")),
+            "-123456789.000000000000000001");
+  Cents cents;
+  EXPECT_FALSE(Cents::Parse("92233720368547758.08", &cents));
+  EXPECT_FALSE(Cents::Parse("1.2.3", &cents));
+  // Out of range for int64 at this scale, but not for int128.
+  Wide wide;
+  EXPECT_TRUE(Wide::Parse("92233720368547758.08", &wide));
+}
+
+TEST_CASE(decimal_add_and_subtract_report_overflow) {
+  Cents sum = Cents::FromRaw(7);
+  EXPECT_TRUE(Cents::FromRaw(INT64_MAX - 1).Add(Cents::FromRaw(1), &sum));
+  EXPECT_EQ(sum.raw(), INT64_MAX);
+  EXPECT_FALSE(sum.Add(Cents::FromRaw(1), &sum));
+  EXPECT_EQ(sum.raw(), INT64_MAX);
+  Cents difference;
+  EXPECT_FALSE(Cents::FromRaw(INT64_MIN).Subtract(Cents::FromRaw(1),
+                                                  &difference));
+  EXPECT_TRUE(Cents::FromRaw(5).Subtract(Cents::FromRaw(7), &difference));
+  EXPECT_EQ(difference.raw(), -2);
+}
+
+TEST_CASE(decimal_rescale_rounds_half_to_even) {
+  Decimal<0> whole;
+  EXPECT_TRUE(Cents::FromRaw(250).Rescale(&whole));
+  EXPECT_EQ(whole.raw(), 2);
+  EXPECT_TRUE(Cents::FromRaw(350).Rescale(&whole));
+  EXPECT_EQ(whole.raw(), 4);
+  EXPECT_TRUE(Cents::FromRaw(-251).Rescale(&whole));
+  EXPECT_EQ(whole.raw(), -3);
+  Decimal<4> fine;
+  EXPECT_TRUE(Cents::FromRaw(-125).Rescale(&fine));
+  EXPECT_EQ(fine.raw(), -12500);
+  // Adding digits can overflow int64, but not int128.
+  Rate rate;
+  EXPECT_FALSE(Cents::FromRaw(INT64_MAX / 1000).Rescale(&rate));
+  Wide wide;
+  EXPECT_TRUE(Cents::FromRaw(INT64_MAX).Rescale(&wide));
+  EXPECT_TRUE(wide.raw() == __int128{INT64_MAX} * 10000000000000000);
+}
+
+TEST_CASE(decimal_multiply_by_rate) {
+  // 12.34 USD at 83.245 INR per USD is 1027.2433 INR, so 1027.24.
+  Cents inr;
+  EXPECT_TRUE(Cents::FromRaw(1234).Multiply(Parse<Rate>("83.245"), &inr));
+  EXPECT_EQ(inr.raw(), 102724);
+  // Exact ties round to even, either side of zero.
+  Decimal<0> yen;
+  EXPECT_TRUE(Cents::FromRaw(250).Multiply(Parse<Rate>("1"), &yen));
+  EXPECT_EQ(yen.raw(), 2);
+  EXPECT_TRUE(Cents::FromRaw(-350).Multiply(Parse<Rate>("1"), &yen));
+  EXPECT_EQ(yen.raw(), -4);
+  EXPECT_TRUE(Cents::FromRaw(-1).Multiply(Parse<Rate>("0.5"), &yen));
+  EXPECT_EQ(yen.raw(), 0);
+  // More digits on the result than the operands have between them.
+  Wide wide;
+  EXPECT_TRUE(Cents::FromRaw(1).Multiply(Decimal<0>::FromRaw(3), &wide));
+  EXPECT_TRUE(wide.raw() == 3 * __int128{10000000000000000});
+}
+
+TEST_CASE(decimal_multiply_reports_overflow) {
+  Cents out = Cents::FromRaw(7);
+  EXPECT_FALSE(Cents::FromRaw(INT64_MAX).Multiply(Parse<Rate>("2"), &out));
+  EXPECT_EQ(out.raw(), 7);
+  EXPECT_TRUE(Cents::FromRaw(INT64_MAX).Multiply(Parse<Rate>("0.5"), &out));
+  EXPECT_EQ(out.raw(), INT64_MAX / 2 + 1);
+  // An int128 operand whose product overflows even int128.
+  const auto huge = Decimal<0, __int128>::FromRaw(__int128{1} << 100);
+  Decimal<0, __int128> wide;
+  EXPECT_FALSE(huge.Multiply(Decimal<0>::FromRaw(int64_t{1} << 40), &wide));
+  EXPECT_TRUE(huge.Multiply(Decimal<0>::FromRaw(4), &wide));
+  EXPECT_TRUE(wide.raw() == __int128{1} << 102);
+  // A factor held in int64 at a wide scale, as the kernels use it.
+  Decimal<0> minor;
+  EXPECT_TRUE(Decimal<0>::FromRaw(1000).Multiply(
+      Decimal<15, int64_t>::FromRaw(1234500000000000), &minor));
+  EXPECT_EQ(minor.raw(), 1234);
+}
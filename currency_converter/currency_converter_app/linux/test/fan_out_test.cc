@@ -0,0 +1,143 @@
+// ConversionEngine::ConvertToAll against one ConvertBatch or Convert per
+// target, across its block and thread boundaries.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "engine/conversion_engine.h"
+#include "engine/currency.h"
+#include "engine/thread_pool.h"
+#include "test.h"
+
+namespace {
+
+using converter::CurrencyId;
+using converter::FanOutOrder;
+using converter::Status;
+
+constexpr size_t kCounts[] = {0, 1, 15, 16, 17, 4097, 70000};
+
+std::vector<CurrencyId> AllCurrencies() {
+  std::vector<CurrencyId> currencies(converter::CurrencyCount());
+  for (size_t i = 0; i < currencies.size(); i++) {
+    currencies[i] = static_cast<CurrencyId>(i);
+  }
+  return currencies;
+}
+
+}  // namespace
+
+TEST_CASE(fan_out_matches_convert_batch) {
+  converter::ThreadPool pool(4);
+  converter::ConversionEngine engine;
+  engine.set_thread_pool(&pool);
+  CurrencyId from = converter::FindCurrency("USD");
+  std::mt19937_64 random(8);
+  for (size_t count : kCounts) {
+    std::vector<int64_t> amounts(count);
+    std::vector<double> double_amounts(count);
+    for (size_t i = 0; i < count; i++) {
+      amounts[i] = static_cast<int64_t>(random() % 100000000000);
+      double_amounts[i] = amounts[i] / 100.0;
+    }
+    std::vector<CurrencyId> targets = AllCurrencies();
+    std::vector<int64_t> out(count * targets.size());
+    std::vector<double> double_out(count * targets.size());
+    EXPECT_EQ(engine.ConvertToAll(amounts.data(), count, from, targets.data(),
+                                  targets.size(), FanOutOrder::kAsGiven,
+                                  out.data()),
+              Status::kOk);
+    EXPECT_EQ(engine.ConvertToAll(double_amounts.data(), count, from,
+                                  targets.data(), targets.size(),
+                                  FanOutOrder::kAsGiven, double_out.data()),
+              Status::kOk);
+    std::vector<int64_t> expected(count);
+    std::vector<double> double_expected(count);
+    for (size_t t = 0; t < targets.size(); t++) {
+      EXPECT_EQ(engine.ConvertBatch(amounts.data(), count, from, targets[t],
+                                    expected.data()),
+                Status::kOk);
+      EXPECT_EQ(engine.ConvertBatch(double_amounts.data(), count, from,
+                                    targets[t], double_expected.data()),
+                Status::kOk);
+      EXPECT_TRUE(std::equal(expected.begin(), expected.end(),
+                             out.begin() + t * count));
+      EXPECT_TRUE(std::equal(double_expected.begin(), double_expected.end(),
+                             double_out.begin() + t * count));
+    }
+  }
+}
+
+TEST_CASE(fan_out_marks_overflow_per_result) {
+  converter::ConversionEngine engine;
+  CurrencyId from = converter::FindCurrency("USD");
+  std::vector<int64_t> amounts(40, 100);
+  amounts[3] = INT64_MAX / 4;
+  amounts[31] = INT64_MAX / 4;
+  std::vector<CurrencyId> targets = AllCurrencies();
+  std::vector<int64_t> out(amounts.size() * targets.size());
+  EXPECT_EQ(engine.ConvertToAll(amounts.data(), amounts.size(), from,
+                                targets.data(), targets.size(),
+                                FanOutOrder::kAsGiven, out.data()),
+            Status::kOk);
+  size_t overflows = 0;
+  for (size_t t = 0; t < targets.size(); t++) {
+    for (size_t i = 0; i < amounts.size(); i++) {
+      int64_t expected;
+      if (engine.Convert(amounts[i], from, targets[t], &expected) !=
+          Status::kOk) {
+        expected = converter::kFanOutOverflow;
+        overflows++;
+      }
+      EXPECT_EQ(out[t * amounts.size() + i], expected);
+    }
+  }
+  // Currencies worth less than a dollar overflow; the rest convert.
+  EXPECT_TRUE(overflows > 0);
+  EXPECT_TRUE(overflows < 2 * targets.size());
+}
+
+TEST_CASE(fan_out_orders_targets) {
+  converter::ConversionEngine engine;
+  CurrencyId from = converter::FindCurrency("EUR");
+  double amount = 10;
+  std::vector<CurrencyId> targets = AllCurrencies();
+  std::vector<double> out(targets.size());
+
+  EXPECT_EQ(engine.ConvertToAll(&amount, 1, from, targets.data(),
+                                targets.size(), FanOutOrder::kCode,
+                                out.data()),
+            Status::kOk);
+  for (size_t t = 1; t < targets.size(); t++) {
+    EXPECT_TRUE(strcmp(converter::GetCurrency(targets[t - 1]).code,
+                       converter::GetCurrency(targets[t]).code) < 0);
+  }
+
+  EXPECT_EQ(engine.ConvertToAll(&amount, 1, from, targets.data(),
+                                targets.size(), FanOutOrder::kValue,
+                                out.data()),
+            Status::kOk);
+  for (size_t t = 1; t < targets.size(); t++) {
+    EXPECT_TRUE(std::isnan(out[t]) || out[t - 1] >= out[t]);
+  }
+  for (size_t t = 0; t < targets.size(); t++) {
+    double expected;
+    EXPECT_EQ(engine.ConvertDouble(amount, from, targets[t], &expected),
+              Status::kOk);
+    EXPECT_EQ(out[t], expected);
+  }
+}
+
+TEST_CASE(fan_out_rejects_unknown_currencies) {
+  converter::ConversionEngine engine;
+  int64_t amount = 1;
+  int64_t out;
+  CurrencyId target = converter::kInvalidCurrency;
+  EXPECT_EQ(engine.ConvertToAll(&amount, 1, converter::FindCurrency("USD"),
+                                &target, 1, FanOutOrder::kAsGiven, &out),
+            Status::kUnknownCurrency);
+}
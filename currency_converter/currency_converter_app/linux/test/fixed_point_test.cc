@@ -0,0 +1,141 @@
+// Rounding and overflow of the fixed-point helpers every exact conversion
+// goes through.
+
+#include <cstdint>
+#include <random>
+#include <string>
+
+#include "engine/decimal.h"
+#include "engine/fixed_point.h"
+#include "test.h"
+
+namespace {
+
+using converter::DivPow10RoundHalfEven;
+using converter::DivRoundHalfEven;
+using converter::FormatScaledDecimal;
+using converter::ParseScaledDecimal;
+using converter::Pow10;
+
+// The reference quotient, or INT64_MIN if it does not fit.
+int64_t Reference(__int128 n, int digits) {
+  int64_t quotient;
+  if (!DivRoundHalfEven(n, Pow10(digits), &quotient)) {
+    return INT64_MIN;
+  }
+  return quotient;
+}
+
+// DivPow10RoundHalfEven<Digits> against DivRoundHalfEven on random values,
+// on values too wide for its 64-bit path, and on exact ties either side of
+// zero.
+template <int Digits>
+void CheckDivPow10() {
+  std::mt19937_64 random(Digits);
+  constexpr __int128 kDivisor = Pow10(Digits);
+  for (int i = 0; i < 1000; i++) {
+    __int128 n = static_cast<int64_t>(random());
+    if (i % 2 == 1) {
+      n *= static_cast<int64_t>(random() >> 20);
+    }
+    for (__int128 value : {n, -n}) {
+      if (Reference(value, Digits) == INT64_MIN) {
+        continue;
+      }
+      EXPECT_TRUE(DivPow10RoundHalfEven<Digits>(value) ==
+                  Reference(value, Digits));
+    }
+  }
+  if constexpr (Digits > 0) {
+    for (int64_t quotient : {0, 1, 2, 3, 41, 42}) {
+      __int128 tie = quotient * kDivisor + kDivisor / 2;
+      int64_t even = quotient % 2 == 0 ? quotient : quotient + 1;
+      EXPECT_TRUE(DivPow10RoundHalfEven<Digits>(tie) == even);
+      EXPECT_TRUE(DivPow10RoundHalfEven<Digits>(-tie) == -even);
+      EXPECT_TRUE(DivPow10RoundHalfEven<Digits>(tie - 1) == quotient);
+      EXPECT_TRUE(DivPow10RoundHalfEven<Digits>(tie + 1) == quotient + 1);
+    }
+  }
+}
+
+int64_t Parse(const std::string& text, int scale_digits) {
+  int64_t value;
+  if (!ParseScaledDecimal(text, scale_digits, &value)) {
+    return INT64_MIN;
+  }
+  return value;
+}
+
+std::string Format(int64_t value, int scale_digits) {
+  char text[22];
+  return std::string(text, FormatScaledDecimal(value, scale_digits, text));
+}
+
+}  // namespace
+
+TEST_CASE(fixed_point_div_pow10_matches_reference) {
+  CheckDivPow10<0>();
+  CheckDivPow10<1>();
+  CheckDivPow10<2>();
+  CheckDivPow10<12>();
+  CheckDivPow10<18>();
+  CheckDivPow10<27>();
+  CheckDivPow10<30>();
+}
+
+TEST_CASE(fixed_point_div_round_half_even_reports_overflow) {
+  int64_t out = 7;
+  EXPECT_TRUE(DivRoundHalfEven(__int128{INT64_MAX} * 10 + 4, 10, &out));
+  EXPECT_EQ(out, INT64_MAX);
+  EXPECT_FALSE(DivRoundHalfEven(__int128{INT64_MAX} * 10 + 5, 10, &out));
+  EXPECT_TRUE(DivRoundHalfEven(__int128{INT64_MIN} * 10 - 5, 10, &out));
+  EXPECT_EQ(out, INT64_MIN);
+  EXPECT_FALSE(DivRoundHalfEven(__int128{INT64_MIN} * 10 - 6, 10, &out));
+  EXPECT_EQ(out, INT64_MIN);
+}
+
+TEST_CASE(fixed_point_parse_rounds_half_to_even) {
+  EXPECT_EQ(Parse("0.125", 2), 12);
+  EXPECT_EQ(Parse("0.135", 2), 14);
+  EXPECT_EQ(Parse("-0.125", 2), -12);
+  EXPECT_EQ(Parse("0.1250000001", 2), 13);
+  EXPECT_EQ(Parse("2.5", 0), 2);
+  EXPECT_EQ(Parse("3.5", 0), 4);
+  EXPECT_EQ(Parse("83.245", 12), 83245000000000);
+  EXPECT_EQ(Parse("+1.", 2), 100);
+  EXPECT_EQ(Parse(".5", 1), 5);
+}
+
+TEST_CASE(fixed_point_parse_reports_overflow_and_bad_input) {
+  EXPECT_EQ(Parse("9223372036854775807", 0), INT64_MAX);
+  EXPECT_EQ(Parse("9223372036854775808", 0), INT64_MIN);
+  int64_t min = 0;
+  EXPECT_TRUE(ParseScaledDecimal("-9223372036854775808", 0, &min));
+  EXPECT_EQ(min, INT64_MIN);
+  EXPECT_FALSE(ParseScaledDecimal("-9223372036854775809", 0, &min));
+  EXPECT_EQ(Parse("92233720368547758.07", 2), INT64_MAX);
+  EXPECT_EQ(Parse("92233720368547758.08", 2), INT64_MIN);
+  // Rounding up can be what overflows.
+  EXPECT_EQ(Parse("92233720368547758.075", 2), INT64_MIN);
+  EXPECT_EQ(Parse("9223372", 12), 9223372 * int64_t{1000000000000});
+  EXPECT_EQ(Parse("9223373", 12), INT64_MIN);
+  // More digits than the parser accumulates.
+  EXPECT_EQ(Parse("0." + std::string(40, '1'), 2), INT64_MIN);
+  for (const char* text : {"", "-", ".", "1.2.3", "1e5", " 1", "1,000"}) {
+    EXPECT_EQ(Parse(text, 2), INT64_MIN);
+  }
+}
+
+TEST_CASE(fixed_point_format_round_trips) {
+  EXPECT_EQ(Format(-123450, 2), "-1234.50");
+  EXPECT_EQ(Format(5, 3), "0.005");
+  EXPECT_EQ(Format(7, 0), "7");
+  EXPECT_EQ(Format(INT64_MIN, 0), "-9223372036854775808");
+  EXPECT_EQ(Format(INT64_MIN, 18), "-9.223372036854775808");
+  std::mt19937_64 random(9);
+  for (int i = 0; i < 1000; i++) {
+    int64_t value = static_cast<int64_t>(random());
+    int scale_digits = static_cast<int>(random() % 19);
+    EXPECT_EQ(Parse(Format(value, scale_digits), scale_digits), value);
+  }
+}
@@ -0,0 +1,162 @@
+// History files written in each encoding and read back through
+// HistoryStore, compared with the ticks that went in.
+
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "engine/conversion_engine.h"
+#include "engine/currency.h"
+#include "engine/history_store.h"
+#include "engine/history_writer.h"
+#include "test.h"
+
+namespace {
+
+using converter::history::BlockEncoding;
+
+std::string TempPath(const char* name) {
+  return "/tmp/converter_engine_tests_" + std::to_string(getpid()) + "_" +
+         name;
+}
+
+// Ticks of two pairs: one at a regular spacing with small rate moves, which
+// packs tightly, and one with irregular spacing and large jumps.
+converter::TickColumns MakeTicks(uint32_t regular, uint32_t irregular) {
+  std::mt19937_64 random(6);
+  converter::TickColumns ticks;
+  int64_t timestamp = 1700000000000;
+  int64_t rate = 830000000000;
+  int64_t other_timestamp = timestamp;
+  for (int i = 0; i < 10000; i++) {
+    timestamp += 250;
+    rate += static_cast<int64_t>(random() % 2001) * 1000000 - 1000000000;
+    ticks.timestamps.push_back(timestamp);
+    ticks.pairs.push_back(regular);
+    ticks.rates.push_back(rate);
+    if (i % 3 == 0) {
+      other_timestamp += 1 + static_cast<int64_t>(random() % 100000);
+      ticks.timestamps.push_back(other_timestamp);
+      ticks.pairs.push_back(irregular);
+      ticks.rates.push_back(static_cast<int64_t>(random() >> 2));
+    }
+  }
+  return ticks;
+}
+
+// Returns the ticks of |pair| in [begin, end), in order.
+void Expected(const converter::TickColumns& ticks, uint32_t pair,
+              int64_t begin, int64_t end, std::vector<int64_t>* timestamps,
+              std::vector<int64_t>* rates) {
+  for (size_t i = 0; i < ticks.size(); i++) {
+    if (ticks.pairs[i] == pair && ticks.timestamps[i] >= begin &&
+        ticks.timestamps[i] < end) {
+      timestamps->push_back(ticks.timestamps[i]);
+      rates->push_back(ticks.rates[i]);
+    }
+  }
+}
+
+}  // namespace
+
+TEST_CASE(history_round_trips_in_each_encoding) {
+  converter::CurrencyId usd = converter::FindCurrency("USD");
+  uint32_t regular = converter::PackPair(usd, converter::FindCurrency("INR"));
+  uint32_t irregular = converter::PackPair(usd, converter::FindCurrency("EUR"));
+  converter::TickColumns ticks = MakeTicks(regular, irregular);
+  for (BlockEncoding encoding :
+       {BlockEncoding::kRaw, BlockEncoding::kDeltaPacked}) {
+    std::string path = TempPath("history.bin");
+    EXPECT_TRUE(converter::WriteHistoryFile(ticks, path.c_str(), encoding));
+    converter::HistoryStore store;
+    EXPECT_TRUE(store.Open(path.c_str()));
+    EXPECT_EQ(store.pair_count(), 2u);
+
+    for (uint32_t pair : {regular, irregular}) {
+      converter::HistorySpan span;
+      EXPECT_TRUE(store.Span(pair, &span));
+      // The whole history, then ranges cutting through blocks and frames.
+      int64_t first = span.first_timestamp;
+      int64_t last = span.last_timestamp;
+      int64_t ranges[][2] = {{first, last + 1},
+                             {first + 12345, first + 987654},
+                             {first - 1000, first + 1},
+                             {last, last + 1},
+                             {last + 1, last + 1000}};
+      for (const auto& range : ranges) {
+        std::vector<int64_t> timestamps;
+        std::vector<int64_t> rates;
+        std::vector<int64_t> expected_timestamps;
+        std::vector<int64_t> expected_rates;
+        EXPECT_TRUE(
+            store.ReadRange(pair, range[0], range[1], &timestamps, &rates));
+        Expected(ticks, pair, range[0], range[1], &expected_timestamps,
+                 &expected_rates);
+        EXPECT_TRUE(timestamps == expected_timestamps);
+        EXPECT_TRUE(rates == expected_rates);
+      }
+
+      // The quote in effect at each tick, and just before the first.
+      converter::HistoryPoint point;
+      EXPECT_FALSE(store.RateAt(pair, first - 1, &point));
+      for (size_t i = 0; i < ticks.size(); i += 97) {
+        if (ticks.pairs[i] != pair) {
+          continue;
+        }
+        EXPECT_TRUE(store.RateAt(pair, ticks.timestamps[i], &point));
+        EXPECT_EQ(point.timestamp, ticks.timestamps[i]);
+        EXPECT_EQ(point.rate, ticks.rates[i]);
+      }
+    }
+    store.Close();
+    unlink(path.c_str());
+  }
+}
+
+TEST_CASE(history_rejects_corrupt_files) {
+  std::string path = TempPath("corrupt.bin");
+  FILE* file = fopen(path.c_str(), "w");
+  fputs("not a history file, but long enough to have a header and trailer "
+        "if it were one of them................................",
+        file);
+  fclose(file);
+  converter::HistoryStore store;
+  EXPECT_FALSE(store.Open(path.c_str()));
+  EXPECT_FALSE(store.is_open());
+  unlink(path.c_str());
+}
+
+TEST_CASE(history_rejects_out_of_range_index_entries) {
+  converter::CurrencyId usd = converter::FindCurrency("USD");
+  uint32_t regular = converter::PackPair(usd, converter::FindCurrency("INR"));
+  uint32_t irregular = converter::PackPair(usd, converter::FindCurrency("EUR"));
+  std::string path = TempPath("bad_index.bin");
+  EXPECT_TRUE(converter::WriteHistoryFile(MakeTicks(regular, irregular),
+                                          path.c_str(),
+                                          BlockEncoding::kDeltaPacked));
+
+  // Point the root of the first pair's index past its blocks.
+  FILE* file = fopen(path.c_str(), "r+b");
+  converter::history::FileTrailer trailer;
+  fseek(file, -static_cast<long>(sizeof(trailer)), SEEK_END);
+  EXPECT_EQ(fread(&trailer, sizeof(trailer), 1, file), 1u);
+  converter::history::PairEntry entry;
+  fseek(file, static_cast<long>(trailer.directory_offset), SEEK_SET);
+  EXPECT_EQ(fread(&entry, sizeof(entry), 1, file), 1u);
+  uint32_t rank = entry.block_count;
+  fseek(file,
+        static_cast<long>(trailer.index_blocks_offset +
+                          (entry.first_index + 1) * sizeof(uint32_t)),
+        SEEK_SET);
+  EXPECT_EQ(fwrite(&rank, sizeof(rank), 1, file), 1u);
+  fclose(file);
+
+  converter::HistoryStore store;
+  EXPECT_FALSE(store.Open(path.c_str()));
+  EXPECT_FALSE(store.is_open());
+  unlink(path.c_str());
+}
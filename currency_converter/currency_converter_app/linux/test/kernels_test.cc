@@ -0,0 +1,183 @@
+// Every vector kernel the CPU supports against the scalar reference, over
+// sizes that exercise the tails and values at the edges of each kernel's
+// exact range.
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "engine/history_format.h"
+#include "engine/kernels.h"
+#include "test.h"
+
+namespace {
+
+using converter::ConversionKernels;
+using converter::GetKernels;
+using converter::KernelLevel;
+
+constexpr size_t kSizes[] = {0, 1, 3, 4, 7, 8, 15, 16, 17, 31, 64, 1000};
+
+std::vector<const ConversionKernels*> AvailableKernels() {
+  std::vector<const ConversionKernels*> kernels;
+  for (KernelLevel level :
+       {KernelLevel::kScalar, KernelLevel::kSse42, KernelLevel::kAvx2}) {
+    if (const ConversionKernels* k = GetKernels(level)) {
+      kernels.push_back(k);
+    }
+  }
+  return kernels;
+}
+
+std::vector<int64_t> RandomAmounts(size_t count, int64_t limit,
+                                   std::mt19937_64* random) {
+  std::uniform_int_distribution<int64_t> amount(-limit, limit);
+  std::vector<int64_t> amounts(count);
+  for (int64_t& value : amounts) {
+    value = amount(*random);
+  }
+  // Exact halves, which round to even.
+  if (count > 2) {
+    amounts[0] = 5;
+    amounts[1] = -15;
+    amounts[2] = 25;
+  }
+  return amounts;
+}
+
+}  // namespace
+
+TEST_CASE(kernels_convert_double_match_scalar) {
+  std::mt19937_64 random(1);
+  std::uniform_real_distribution<double> amount(-1e9, 1e9);
+  for (const ConversionKernels* kernels : AvailableKernels()) {
+    for (size_t size : kSizes) {
+      std::vector<double> amounts(size);
+      for (double& value : amounts) {
+        value = amount(random);
+      }
+      if (size > 3) {
+        amounts[0] = 0.125;
+        amounts[1] = -0.125;
+        amounts[2] = 2.5;
+        amounts[3] = NAN;
+      }
+      for (double minor_rate : {100.0, 83.125 * 100, 1e-3}) {
+        std::vector<double> expected(size);
+        std::vector<double> actual(size);
+        converter::internal::ConvertDoubleScalar(amounts.data(), size,
+                                                 minor_rate, 100,
+                                                 expected.data());
+        kernels->convert_double(amounts.data(), size, minor_rate, 100,
+                                actual.data());
+        for (size_t i = 0; i < size; i++) {
+          EXPECT_TRUE(actual[i] == expected[i] ||
+                      (std::isnan(actual[i]) && std::isnan(expected[i])));
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE(kernels_convert_fixed_match_scalar) {
+  std::mt19937_64 random(2);
+  for (const ConversionKernels* kernels : AvailableKernels()) {
+    for (size_t size : kSizes) {
+      for (int64_t limit : {int64_t{1000}, int64_t{1} << 40}) {
+        std::vector<int64_t> amounts = RandomAmounts(size, limit, &random);
+        for (int64_t cross_rate : {int64_t{1}, int64_t{8312500000000},
+                                   int64_t{7} << 40}) {
+          for (int digits : {0, 1, 12, converter::kMaxDivisorDigits}) {
+            std::vector<int64_t> expected(size);
+            std::vector<int64_t> actual(size);
+            bool expected_ok = converter::internal::ConvertFixedScalar(
+                amounts.data(), size, cross_rate, digits, expected.data());
+            bool actual_ok = kernels->convert_fixed(
+                amounts.data(), size, cross_rate, digits, actual.data());
+            EXPECT_EQ(actual_ok, expected_ok);
+            if (expected_ok) {
+              EXPECT_TRUE(actual == expected);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE(kernels_convert_fixed_report_overflow) {
+  for (const ConversionKernels* kernels : AvailableKernels()) {
+    std::vector<int64_t> amounts(20, 1);
+    amounts[17] = INT64_MAX / 2;
+    std::vector<int64_t> out(amounts.size());
+    EXPECT_FALSE(kernels->convert_fixed(amounts.data(), amounts.size(), 4, 0,
+                                        out.data()));
+    EXPECT_TRUE(kernels->convert_fixed(amounts.data(), 17, 4, 0, out.data()));
+  }
+}
+
+TEST_CASE(kernels_unpack_zigzag_match_scalar) {
+  std::mt19937_64 random(3);
+  for (const ConversionKernels* kernels : AvailableKernels()) {
+    for (size_t size : kSizes) {
+      for (int width = 0; width <= 64; width++) {
+        std::vector<uint64_t> packed(
+            converter::history::PackedWords(size, width) + 1);
+        for (size_t i = 0; i + 1 < packed.size(); i++) {
+          packed[i] = random();
+        }
+        std::vector<int64_t> expected(size);
+        std::vector<int64_t> actual(size);
+        converter::internal::UnpackZigzagScalar(packed.data(), width, size,
+                                                expected.data());
+        kernels->unpack_zigzag(packed.data(), width, size, actual.data());
+        EXPECT_TRUE(actual == expected);
+      }
+    }
+  }
+}
+
+TEST_CASE(kernels_prefix_sum_match_scalar) {
+  std::mt19937_64 random(4);
+  for (const ConversionKernels* kernels : AvailableKernels()) {
+    for (size_t size : kSizes) {
+      std::vector<int64_t> values = RandomAmounts(size, INT64_MAX, &random);
+      for (int64_t scale : {int64_t{1}, int64_t{1000}}) {
+        std::vector<int64_t> expected = values;
+        std::vector<int64_t> actual = values;
+        converter::internal::PrefixSumScalar(expected.data(), size, 42, scale);
+        kernels->prefix_sum(actual.data(), size, 42, scale);
+        EXPECT_TRUE(actual == expected);
+      }
+    }
+  }
+}
+
+TEST_CASE(kernels_unpack_delta_match_scalar) {
+  std::mt19937_64 random(5);
+  for (const ConversionKernels* kernels : AvailableKernels()) {
+    for (size_t size : kSizes) {
+      for (int width = 0; width <= 64; width++) {
+        std::vector<uint64_t> packed(
+            converter::history::PackedWords(size, width) + 1);
+        for (size_t i = 0; i + 1 < packed.size(); i++) {
+          packed[i] = random();
+        }
+        for (int64_t scale : {int64_t{1}, int64_t{1000},
+                              int64_t{1000000000000000000}}) {
+          // Unpacking then summing is the definition.
+          std::vector<int64_t> expected(size);
+          std::vector<int64_t> actual(size);
+          converter::internal::UnpackZigzagScalar(packed.data(), width, size,
+                                                  expected.data());
+          converter::internal::PrefixSumScalar(expected.data(), size, -42,
+                                               scale);
+          kernels->unpack_delta(packed.data(), width, size, -42, scale,
+                                actual.data());
+          EXPECT_TRUE(actual == expected);
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,73 @@
+// RateFeed over a FIFO, fed in pieces that each become a window of their
+// own.
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include "engine/conversion_engine.h"
+#include "engine/rate_feed.h"
+#include "test.h"
+
+namespace {
+
+// Waits up to five seconds for |feed| to have read |ticks| quotes and
+// |rejected| other lines.
+bool WaitForLines(const converter::RateFeed& feed, uint64_t ticks,
+                  uint64_t rejected) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (std::chrono::steady_clock::now() < deadline) {
+    converter::RateFeedStats stats = feed.stats();
+    if (stats.ticks >= ticks && stats.rejected >= rejected) {
+      return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return false;
+}
+
+void WriteAll(int fd, const char* text) {
+  size_t size = strlen(text);
+  EXPECT_EQ(write(fd, text, size), static_cast<ssize_t>(size));
+}
+
+}  // namespace
+
+TEST_CASE(rate_feed_skips_a_header_only_at_the_start_of_a_source) {
+  char directory[] = "/tmp/converter_engine_tests_XXXXXX";
+  EXPECT_TRUE(mkdtemp(directory) != nullptr);
+  std::string path = std::string(directory) + "/feed";
+
+  converter::ConversionEngine engine;
+  converter::RateFeed feed(&engine.rates(),
+                           converter::CreateRateSource("fifo:" + path));
+  EXPECT_TRUE(feed.Start([] {}));
+  while (access(path.c_str(), F_OK) != 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  int fd = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+  EXPECT_TRUE(fd >= 0);
+
+  const char* first = "timestamp,pair,rate\n1700000000000,EURUSD,1.08\n";
+  WriteAll(fd, first);
+  EXPECT_TRUE(WaitForLines(feed, 1, 0));
+  // A later window that starts with a line that is not a quote rejects it
+  // rather than taking it for a header.
+  const char* second = "garbage\n1700000000001,EURUSD,1.09\n";
+  WriteAll(fd, second);
+  EXPECT_TRUE(WaitForLines(feed, 2, 1));
+  close(fd);
+  feed.Stop();
+
+  converter::RateFeedStats stats = feed.stats();
+  EXPECT_EQ(stats.ticks, 2u);
+  EXPECT_EQ(stats.rejected, 1u);
+  EXPECT_EQ(stats.bytes, strlen(first) + strlen(second));
+  unlink(path.c_str());
+  rmdir(directory);
+}
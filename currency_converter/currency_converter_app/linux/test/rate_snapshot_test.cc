@@ -0,0 +1,46 @@
+// Rate snapshots written by several instances at once.
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "engine/rate_snapshot.h"
+#include "engine/rate_store.h"
+#include "test.h"
+
+TEST_CASE(rate_snapshot_concurrent_writers_leave_a_whole_file) {
+  char directory[] = "/tmp/converter_engine_tests_XXXXXX";
+  EXPECT_TRUE(mkdtemp(directory) != nullptr);
+  std::string path = std::string(directory) + "/snapshot.bin";
+
+  converter::RateTable rates;
+  std::atomic<int> failures{0};
+  std::vector<std::thread> writers;
+  for (int w = 0; w < 4; w++) {
+    writers.emplace_back([&, w] {
+      std::string state(4096 * (w + 1), static_cast<char>('a' + w));
+      for (int i = 0; i < 25; i++) {
+        if (!converter::WriteRateSnapshot(rates, i, state, path.c_str())) {
+          failures++;
+        }
+      }
+    });
+  }
+  for (std::thread& writer : writers) {
+    writer.join();
+  }
+  EXPECT_EQ(failures.load(), 0);
+
+  converter::RateStore store;
+  converter::RateSnapshot snapshot;
+  EXPECT_TRUE(converter::LoadRateSnapshot(path.c_str(), &store, &snapshot));
+  EXPECT_EQ(snapshot.saved_at, 24);
+  EXPECT_EQ(snapshot.state.size() % 4096, 0u);
+  // No temporary file is left behind.
+  unlink(path.c_str());
+  EXPECT_EQ(rmdir(directory), 0);
+}
@@ -0,0 +1,48 @@
+// RateStore publishing around readers that hold snapshots.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#include "engine/currency.h"
+#include "engine/rate_store.h"
+#include "test.h"
+
+TEST_CASE(rate_store_publish_waits_only_for_readers_of_the_spare) {
+  converter::RateStore store;
+  converter::CurrencyId inr = converter::FindCurrency("INR");
+  int64_t rate = store.Read().table().BaseRate(inr);
+
+  // A reader pins the first version until told to let go, or for long
+  // enough that a writer waiting on it would be seen to.
+  std::atomic<bool> pinned{false};
+  std::atomic<bool> release{false};
+  std::atomic<bool> released{false};
+  std::thread reader([&] {
+    converter::RateStore::Snapshot snapshot = store.Read();
+    pinned = true;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!release && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(snapshot.version(), 1u);
+    EXPECT_EQ(snapshot.table().BaseRate(inr), rate);
+    released = true;
+  });
+  while (!pinned) {
+    std::this_thread::yield();
+  }
+
+  // Both spares were never read, so neither publish waits for the reader.
+  EXPECT_EQ(store.Publish(inr, rate + 1), 2u);
+  EXPECT_EQ(store.Publish(inr, rate + 2), 3u);
+  EXPECT_FALSE(released);
+
+  // The next one reuses the reader's table, so it has to.
+  release = true;
+  EXPECT_EQ(store.Publish(inr, rate + 3), 4u);
+  EXPECT_TRUE(released);
+  EXPECT_EQ(store.Read().table().BaseRate(inr), rate + 3);
+  reader.join();
+}
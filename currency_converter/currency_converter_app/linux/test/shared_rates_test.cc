@@ -0,0 +1,90 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "engine/shared_rates.h"
+#include "test.h"
+
+namespace {
+
+using converter::RateTick;
+using converter::SharedRatesReader;
+using converter::SharedRatesWriter;
+
+std::string TestName() {
+  return "/converter_engine_tests_" + std::to_string(getpid());
+}
+
+}  // namespace
+
+TEST_CASE(shared_rates_reader_follows_writer) {
+  std::string name = TestName();
+  std::unique_ptr<SharedRatesWriter> writer =
+      SharedRatesWriter::Create(name, 16);
+  std::unique_ptr<SharedRatesReader> reader = SharedRatesReader::Open(name);
+  EXPECT_TRUE(writer != nullptr && reader != nullptr);
+  if (writer == nullptr || reader == nullptr) {
+    return;
+  }
+  // A second publisher is refused while the first holds the object.
+  EXPECT_TRUE(SharedRatesWriter::Create(name, 16) == nullptr);
+
+  RateTick ticks[] = {{1, 100}, {2, 200}};
+  writer->Append(ticks, 2, 7);
+  EXPECT_TRUE(reader->has_new());
+  std::vector<RateTick> out;
+  EXPECT_EQ(reader->Poll(&out), 7u);
+  EXPECT_EQ(out.size(), 2u);
+  EXPECT_FALSE(reader->has_new());
+
+  // Lapped: the reader falls back to the snapshot page.
+  for (uint64_t version = 8; version < 30; version++) {
+    RateTick tick = {3, static_cast<int64_t>(version)};
+    writer->Append(&tick, 1, version);
+  }
+  out.clear();
+  EXPECT_EQ(reader->Poll(&out), 29u);
+  EXPECT_EQ(reader->overruns(), 1u);
+  std::vector<int64_t> rates;
+  EXPECT_EQ(reader->ReadSnapshot(&rates), 29u);
+  EXPECT_EQ(rates[3], 29);
+  shm_unlink(name.c_str());
+}
+
+TEST_CASE(shared_rates_retires_replaced_objects) {
+  std::string name = TestName();
+  std::unique_ptr<SharedRatesWriter> writer =
+      SharedRatesWriter::Create(name, 16);
+  std::unique_ptr<SharedRatesReader> reader = SharedRatesReader::Open(name);
+  EXPECT_TRUE(reader != nullptr && !reader->retired());
+  writer.reset();
+
+  // A writer with another capacity replaces the object.
+  writer = SharedRatesWriter::Create(name, 64);
+  EXPECT_TRUE(writer != nullptr);
+  EXPECT_TRUE(reader != nullptr && reader->retired());
+  reader = SharedRatesReader::Open(name);
+  EXPECT_TRUE(reader != nullptr && !reader->retired());
+  shm_unlink(name.c_str());
+}
+
+TEST_CASE(shared_rates_refuse_objects_others_can_write) {
+  std::string name = TestName();
+  std::unique_ptr<SharedRatesWriter> writer =
+      SharedRatesWriter::Create(name, 16);
+  int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  struct stat info;
+  EXPECT_TRUE(fd >= 0 && fstat(fd, &info) == 0);
+  EXPECT_EQ(info.st_mode & 0777, 0600u);
+  EXPECT_TRUE(fchmod(fd, 0622) == 0);
+  close(fd);
+  EXPECT_TRUE(SharedRatesReader::Open(name) == nullptr);
+  writer.reset();
+  EXPECT_TRUE(SharedRatesWriter::Create(name, 16) == nullptr);
+  shm_unlink(name.c_str());
+}
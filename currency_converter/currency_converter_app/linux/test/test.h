@@ -0,0 +1,71 @@
+#ifndef CONVERTER_TEST_TEST_H_
+#define CONVERTER_TEST_TEST_H_
+
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+namespace test {
+
+// Records a failed check of the running case, printing |message| with where
+// it was made.
+void Fail(const char* file, int line, const std::string& message);
+
+using CaseFn = void (*)();
+
+// Adds a test case to the suite. Returns true so it can initialise a
+// static, see TEST_CASE.
+bool RegisterCase(const char* name, CaseFn fn);
+
+// Describes a value in a failure message. Enumerators are shown as their
+// numeric value.
+template <typename T>
+std::string Describe(const T& value) {
+  if constexpr (std::is_enum<T>::value) {
+    return std::to_string(static_cast<long long>(value));
+  } else {
+    std::ostringstream text;
+    text << value;
+    return text.str();
+  }
+}
+
+inline std::string Describe(signed char value) {
+  return std::to_string(value);
+}
+
+inline std::string Describe(unsigned char value) {
+  return std::to_string(value);
+}
+
+}  // namespace test
+
+// Defines a test case that is registered with the suite at start-up.
+#define TEST_CASE(name)                                                   \
+  static void name();                                                     \
+  static const bool name##_registered = test::RegisterCase(#name, name);  \
+  static void name()
+
+// Checks that |condition| holds, carrying on with the case if not.
+#define EXPECT_TRUE(condition)                                   \
+  do {                                                           \
+    if (!(condition)) {                                          \
+      test::Fail(__FILE__, __LINE__, "expected " #condition);    \
+    }                                                            \
+  } while (false)
+
+#define EXPECT_FALSE(condition) EXPECT_TRUE(!(condition))
+
+// Checks that |actual| == |expected|, printing both if not.
+#define EXPECT_EQ(actual, expected)                                        \
+  do {                                                                     \
+    const auto& test_actual = (actual);                                    \
+    const auto& test_expected = (expected);                                \
+    if (!(test_actual == test_expected)) {                                 \
+      test::Fail(__FILE__, __LINE__,                                       \
+                 #actual " is " + test::Describe(test_actual) +            \
+                     ", expected " + test::Describe(test_expected));       \
+    }                                                                      \
+  } while (false)
+
+#endif  // CONVERTER_TEST_TEST_H_
@@ -0,0 +1,64 @@
+// Runs the engine test suite. Pass substrings as arguments to only run the
+// cases whose names contain one of them. Exits with status 1 if any check
+// failed.
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+namespace test {
+
+namespace {
+
+struct Case {
+  const char* name;
+  CaseFn fn;
+};
+
+std::vector<Case>& Cases() {
+  static std::vector<Case> cases;
+  return cases;
+}
+
+// Failed checks of the running case.
+int failures = 0;
+
+}  // namespace
+
+bool RegisterCase(const char* name, CaseFn fn) {
+  Cases().push_back({name, fn});
+  return true;
+}
+
+void Fail(const char* file, int line, const std::string& message) {
+  printf("%s:%d: %s\n", file, line, message.c_str());
+  fflush(stdout);
+  failures++;
+}
+
+}  // namespace test
+
+int main(int argc, char** argv) {
+  int run = 0;
+  int failed = 0;
+  for (const test::Case& c : test::Cases()) {
+    bool selected = argc == 1;
+    for (int i = 1; i < argc && !selected; i++) {
+      selected = strstr(c.name, argv[i]) != nullptr;
+    }
+    if (!selected) {
+      continue;
+    }
+    test::failures = 0;
+    c.fn();
+    run++;
+    failed += test::failures != 0;
+    printf("%-48s %s\n", c.name, test::failures == 0 ? "ok" : "FAILED");
+    fflush(stdout);
+  }
+  printf("%d of %d cases failed\n", failed, run);
+  return failed == 0 ? 0 : 1;
+}
@@ -1,30 +1,46 @@
-// This is a basic Flutter widget test.
-//
-// To perform an interaction with a widget in your test, use the WidgetTester
-// utility in the flutter_test package. For example, you can send tap and scroll
-// gestures. You can also use WidgetTester to find child widgets in the widget
-// tree, read text, and verify that the values of widget properties are correct.
-
 import 'package:flutter/material.dart';
+import 'package:flutter/services.dart';
 import 'package:flutter_test/flutter_test.dart';
 
 import 'package:currency_converter/main.dart';
 
 void main() {
-  testWidgets('Counter increments smoke test', (WidgetTester tester) async {
-    // Build our app and trigger a frame.
+  // The native engine is not loaded in widget tests, so conversions take
+  // the fixed-rate fallback of NativeConverter and LiveConverter. The event
+  // channels report a failed listen as an error, so they get handlers that
+  // accept it and never send anything.
+  setUp(() {
+    for (final name in [
+      'currency_converter/arbitrage',
+      'currency_converter/live_results',
+      'currency_converter/rates',
+    ]) {
+      TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger
+          .setMockMethodCallHandler(MethodChannel(name), (call) async => null);
+    }
+  });
+
+  testWidgets('Converts as the amount is typed', (WidgetTester tester) async {
     await tester.pumpWidget(const MyApp());
+    expect(find.text('INR 0'), findsOneWidget);
 
-    // Verify that our counter starts at 0.
-    expect(find.text('0'), findsOneWidget);
-    expect(find.text('1'), findsNothing);
+    await tester.enterText(find.byType(TextField), '2.5');
+    await tester.pump();
+    expect(find.text('INR 200.000'), findsOneWidget);
 
-    // Tap the '+' icon and trigger a frame.
-    await tester.tap(find.byIcon(Icons.add));
+    await tester.enterText(find.byType(TextField), '1,000');
     await tester.pump();
+    expect(find.text('INR 80000.000'), findsOneWidget);
+  });
 
-    // Verify that our counter has incremented.
-    expect(find.text('0'), findsNothing);
-    expect(find.text('1'), findsOneWidget);
+  testWidgets('Convert button converts the amount',
+      (WidgetTester tester) async {
+    await tester.pumpWidget(const MyApp());
+    await tester.enterText(find.byType(TextField), '10');
+    await tester.pump();
+
+    await tester.tap(find.text('Convert'));
+    await tester.pump();
+    expect(find.text('INR 800.000'), findsOneWidget);
   });
 }